@@ -3,6 +3,8 @@ mod seek_sequence;
 mod standalone_executable;
 
 use std::collections::HashMap;
+use std::collections::HashSet;
+use std::num::NonZeroUsize;
 use std::path::Path;
 use std::path::PathBuf;
 use std::str::Utf8Error;
@@ -14,6 +16,7 @@ pub use parser::ParseError;
 use parser::ParseError::*;
 use parser::UpdateFileChunk;
 pub use parser::parse_patch;
+use seek_sequence::LineIndex;
 use similar::TextDiff;
 use thiserror::Error;
 use tree_sitter::LanguageError;
@@ -27,6 +30,10 @@ pub const APPLY_PATCH_TOOL_INSTRUCTIONS: &str = include_str!("../apply_patch_too
 
 const APPLY_PATCH_COMMANDS: [&str; 2] = ["apply_patch", "applypatch"];
 
+/// Below this many file updates, computing their new contents on other
+/// threads costs more than it saves.
+const PARALLEL_UPDATE_MIN_FILES: usize = 8;
+
 #[derive(Debug, Error, PartialEq)]
 pub enum ApplyPatchError {
     #[error(transparent)]
@@ -413,68 +420,277 @@ pub struct AffectedPaths {
 
 /// Apply the hunks to the filesystem, returning which files were added, modified, or deleted.
 /// Returns an error if the patch could not be applied.
+///
+/// The patch is applied all or nothing: the result of every hunk is computed
+/// before anything is written, so a hunk that does not apply leaves every file
+/// untouched, and if a write fails the files written before it are restored.
 fn apply_hunks_to_files(hunks: &[Hunk]) -> anyhow::Result<AffectedPaths> {
     if hunks.is_empty() {
         anyhow::bail!("No files were modified.");
     }
 
+    let changes = plan_file_changes(hunks)?;
+    let mut rollback = Rollback::default();
+    if let Err(err) = write_file_changes(&changes, &mut rollback) {
+        rollback.restore();
+        return Err(err);
+    }
+
     let mut added: Vec<PathBuf> = Vec::new();
     let mut modified: Vec<PathBuf> = Vec::new();
     let mut deleted: Vec<PathBuf> = Vec::new();
-    for hunk in hunks {
+    for change in changes {
+        match change {
+            FileChange::Add { path, .. } => added.push(path.to_path_buf()),
+            FileChange::Delete { path } => deleted.push(path.to_path_buf()),
+            FileChange::Update {
+                path, move_path, ..
+            } => modified.push(move_path.unwrap_or(path).to_path_buf()),
+        }
+    }
+    Ok(AffectedPaths {
+        added,
+        modified,
+        deleted,
+    })
+}
+
+/// A hunk whose result has been computed but not yet written.
+enum FileChange<'a> {
+    Add {
+        path: &'a Path,
+        contents: &'a str,
+    },
+    Delete {
+        path: &'a Path,
+    },
+    Update {
+        path: &'a Path,
+        move_path: Option<&'a Path>,
+        new_contents: String,
+    },
+}
+
+/// Computes the result of every hunk without writing anything.
+///
+/// Updates of files that no earlier hunk of the patch touches only depend on
+/// what is on disk, so they are computed up front, in parallel for large
+/// patches. The remaining hunks are resolved in order against the results of
+/// the hunks before them.
+fn plan_file_changes(hunks: &[Hunk]) -> anyhow::Result<Vec<FileChange<'_>>> {
+    let mut touched: HashSet<&Path> = HashSet::new();
+    let independent: Vec<Option<(&Path, &[UpdateFileChunk])>> = hunks
+        .iter()
+        .map(|hunk| match hunk {
+            Hunk::AddFile { path, .. } | Hunk::DeleteFile { path } => {
+                touched.insert(path);
+                None
+            }
+            Hunk::UpdateFile {
+                path,
+                move_path,
+                chunks,
+            } => {
+                let independent = !touched.contains(path.as_path());
+                touched.insert(path);
+                touched.extend(move_path.as_deref());
+                independent.then_some((path.as_path(), chunks.as_slice()))
+            }
+        })
+        .collect();
+    let precomputed = derive_new_contents_in_parallel(&independent);
+
+    // Contents of the files written by the hunks planned so far; `None` for
+    // files they remove.
+    let mut planned: HashMap<&Path, Option<String>> = HashMap::new();
+    let mut changes = Vec::with_capacity(hunks.len());
+    for (hunk, precomputed) in hunks.iter().zip(precomputed) {
         match hunk {
             Hunk::AddFile { path, contents } => {
-                if let Some(parent) = path.parent()
-                    && !parent.as_os_str().is_empty()
-                {
-                    std::fs::create_dir_all(parent).with_context(|| {
-                        format!("Failed to create parent directories for {}", path.display())
-                    })?;
-                }
-                std::fs::write(path, contents)
-                    .with_context(|| format!("Failed to write file {}", path.display()))?;
-                added.push(path.clone());
+                planned.insert(path, Some(contents.clone()));
+                changes.push(FileChange::Add { path, contents });
             }
             Hunk::DeleteFile { path } => {
-                std::fs::remove_file(path)
-                    .with_context(|| format!("Failed to delete file {}", path.display()))?;
-                deleted.push(path.clone());
+                match planned.get(path.as_path()) {
+                    Some(Some(_)) => {}
+                    Some(None) => {
+                        return Err(std::io::Error::from(std::io::ErrorKind::NotFound))
+                            .with_context(|| format!("Failed to delete file {}", path.display()));
+                    }
+                    None => {
+                        std::fs::metadata(path)
+                            .with_context(|| format!("Failed to delete file {}", path.display()))?;
+                    }
+                }
+                planned.insert(path, None);
+                changes.push(FileChange::Delete { path });
             }
             Hunk::UpdateFile {
                 path,
                 move_path,
                 chunks,
             } => {
-                let AppliedPatch { new_contents, .. } =
-                    derive_new_contents_from_chunks(path, chunks)?;
-                if let Some(dest) = move_path {
-                    if let Some(parent) = dest.parent()
-                        && !parent.as_os_str().is_empty()
-                    {
-                        std::fs::create_dir_all(parent).with_context(|| {
-                            format!("Failed to create parent directories for {}", dest.display())
-                        })?;
+                let applied = match precomputed {
+                    Some(applied) => applied?,
+                    None => match planned.get(path.as_path()) {
+                        Some(Some(contents)) => {
+                            new_contents_from_chunks(path, contents.clone(), chunks)?
+                        }
+                        Some(None) => {
+                            return Err(ApplyPatchError::IoError(IoError {
+                                context: format!(
+                                    "Failed to read file to update {}",
+                                    path.display()
+                                ),
+                                source: std::io::ErrorKind::NotFound.into(),
+                            })
+                            .into());
+                        }
+                        None => derive_new_contents_from_chunks(path, chunks)?,
+                    },
+                };
+                let new_contents = applied.new_contents;
+                match move_path {
+                    Some(dest) => {
+                        planned.insert(path, None);
+                        planned.insert(dest, Some(new_contents.clone()));
+                    }
+                    None => {
+                        planned.insert(path, Some(new_contents.clone()));
                     }
-                    std::fs::write(dest, new_contents)
-                        .with_context(|| format!("Failed to write file {}", dest.display()))?;
-                    std::fs::remove_file(path)
-                        .with_context(|| format!("Failed to remove original {}", path.display()))?;
-                    modified.push(dest.clone());
-                } else {
-                    std::fs::write(path, new_contents)
-                        .with_context(|| format!("Failed to write file {}", path.display()))?;
-                    modified.push(path.clone());
                 }
+                changes.push(FileChange::Update {
+                    path,
+                    move_path: move_path.as_deref(),
+                    new_contents,
+                });
             }
         }
     }
-    Ok(AffectedPaths {
-        added,
-        modified,
-        deleted,
+    Ok(changes)
+}
+
+type DerivedContents = std::result::Result<AppliedPatch, ApplyPatchError>;
+
+/// Runs [`derive_new_contents_from_chunks`] for every `Some` entry, spreading
+/// the work over the available cores when there are enough of them.
+fn derive_new_contents_in_parallel(
+    updates: &[Option<(&Path, &[UpdateFileChunk])>],
+) -> Vec<Option<DerivedContents>> {
+    let derive = |update: &Option<(&Path, &[UpdateFileChunk])>| {
+        update.map(|(path, chunks)| derive_new_contents_from_chunks(path, chunks))
+    };
+    let parallelism = std::thread::available_parallelism().map_or(1, NonZeroUsize::get);
+    if updates.iter().flatten().count() < PARALLEL_UPDATE_MIN_FILES || parallelism == 1 {
+        return updates.iter().map(derive).collect();
+    }
+
+    let chunk_size = updates.len().div_ceil(parallelism);
+    std::thread::scope(|scope| {
+        let handles: Vec<_> = updates
+            .chunks(chunk_size)
+            .map(|chunk| scope.spawn(move || chunk.iter().map(derive).collect::<Vec<_>>()))
+            .collect();
+        handles
+            .into_iter()
+            .flat_map(|handle| {
+                handle
+                    .join()
+                    .unwrap_or_else(|panic| std::panic::resume_unwind(panic))
+            })
+            .collect()
     })
 }
 
+fn write_file_changes(changes: &[FileChange<'_>], rollback: &mut Rollback) -> anyhow::Result<()> {
+    for change in changes {
+        match change {
+            FileChange::Add { path, contents } => {
+                create_parent_dirs(path)?;
+                rollback.save(path)?;
+                std::fs::write(path, contents)
+                    .with_context(|| format!("Failed to write file {}", path.display()))?;
+            }
+            FileChange::Delete { path } => {
+                rollback.save(path)?;
+                std::fs::remove_file(path)
+                    .with_context(|| format!("Failed to delete file {}", path.display()))?;
+            }
+            FileChange::Update {
+                path,
+                move_path: Some(dest),
+                new_contents,
+            } => {
+                create_parent_dirs(dest)?;
+                rollback.save(dest)?;
+                rollback.save(path)?;
+                std::fs::write(dest, new_contents)
+                    .with_context(|| format!("Failed to write file {}", dest.display()))?;
+                std::fs::remove_file(path)
+                    .with_context(|| format!("Failed to remove original {}", path.display()))?;
+            }
+            FileChange::Update {
+                path,
+                move_path: None,
+                new_contents,
+            } => {
+                rollback.save(path)?;
+                std::fs::write(path, new_contents)
+                    .with_context(|| format!("Failed to write file {}", path.display()))?;
+            }
+        }
+    }
+    Ok(())
+}
+
+fn create_parent_dirs(path: &Path) -> anyhow::Result<()> {
+    if let Some(parent) = path.parent()
+        && !parent.as_os_str().is_empty()
+    {
+        std::fs::create_dir_all(parent).with_context(|| {
+            format!("Failed to create parent directories for {}", path.display())
+        })?;
+    }
+    Ok(())
+}
+
+/// Contents that files had before the patch started writing them, so that a
+/// failed write can be undone. Directories created for new files are left in
+/// place.
+#[derive(Default)]
+struct Rollback {
+    saved: Vec<(PathBuf, Option<Vec<u8>>)>,
+    seen: HashSet<PathBuf>,
+}
+
+impl Rollback {
+    /// Remembers the current contents of `path`, or that it does not exist,
+    /// unless an earlier write of the patch already did.
+    fn save(&mut self, path: &Path) -> anyhow::Result<()> {
+        if !self.seen.insert(path.to_path_buf()) {
+            return Ok(());
+        }
+        let contents = match std::fs::read(path) {
+            Ok(contents) => Some(contents),
+            Err(err) if err.kind() == std::io::ErrorKind::NotFound => None,
+            Err(err) => {
+                return Err(err).with_context(|| format!("Failed to read file {}", path.display()));
+            }
+        };
+        self.saved.push((path.to_path_buf(), contents));
+        Ok(())
+    }
+
+    fn restore(self) {
+        for (path, contents) in self.saved.into_iter().rev() {
+            let _ = match contents {
+                Some(contents) => std::fs::write(&path, contents),
+                None => std::fs::remove_file(&path),
+            };
+        }
+    }
+}
+
 struct AppliedPatch {
     original_contents: String,
     new_contents: String,
@@ -495,7 +711,16 @@ fn derive_new_contents_from_chunks(
             }));
         }
     };
+    new_contents_from_chunks(path, original_contents, chunks)
+}
 
+/// Applies the chunks to `original_contents`, the current contents of the
+/// file at `path`.
+fn new_contents_from_chunks(
+    path: &Path,
+    original_contents: String,
+    chunks: &[UpdateFileChunk],
+) -> std::result::Result<AppliedPatch, ApplyPatchError> {
     let mut original_lines: Vec<String> = original_contents
         .split('\n')
         .map(|s| s.to_string())
@@ -530,17 +755,13 @@ fn compute_replacements(
 ) -> std::result::Result<Vec<(usize, usize, Vec<String>)>, ApplyPatchError> {
     let mut replacements: Vec<(usize, usize, Vec<String>)> = Vec::new();
     let mut line_index: usize = 0;
+    let index = LineIndex::new(original_lines);
 
     for chunk in chunks {
         // If a chunk has a `change_context`, we use seek_sequence to find it, then
         // adjust our `line_index` to continue from there.
         if let Some(ctx_line) = &chunk.change_context {
-            if let Some(idx) = seek_sequence::seek_sequence(
-                original_lines,
-                std::slice::from_ref(ctx_line),
-                line_index,
-                false,
-            ) {
+            if let Some(idx) = index.seek(std::slice::from_ref(ctx_line), line_index, false) {
                 line_index = idx + 1;
             } else {
                 return Err(ApplyPatchError::ComputeReplacements(format!(
@@ -575,8 +796,7 @@ fn compute_replacements(
         // located reliably.
 
         let mut pattern: &[String] = &chunk.old_lines;
-        let mut found =
-            seek_sequence::seek_sequence(original_lines, pattern, line_index, chunk.is_end_of_file);
+        let mut found = index.seek(pattern, line_index, chunk.is_end_of_file);
 
         let mut new_slice: &[String] = &chunk.new_lines;
 
@@ -588,12 +808,7 @@ fn compute_replacements(
                 new_slice = &new_slice[..new_slice.len() - 1];
             }
 
-            found = seek_sequence::seek_sequence(
-                original_lines,
-                pattern,
-                line_index,
-                chunk.is_end_of_file,
-            );
+            found = index.seek(pattern, line_index, chunk.is_end_of_file);
         }
 
         if let Some(start_idx) = found {
@@ -916,6 +1131,98 @@ PATCH"#,
         assert_eq!(contents, "line2\n");
     }
 
+    #[test]
+    fn test_failing_hunk_leaves_all_files_untouched() {
+        let dir = tempdir().unwrap();
+        let first = dir.path().join("first.txt");
+        let second = dir.path().join("second.txt");
+        let added = dir.path().join("added.txt");
+        fs::write(&first, "one\n").unwrap();
+        fs::write(&second, "two\n").unwrap();
+        let patch = wrap_patch(&format!(
+            r#"*** Add File: {}
++new
+*** Update File: {}
+@@
+-one
++ONE
+*** Update File: {}
+@@
+-missing
++MISSING"#,
+            added.display(),
+            first.display(),
+            second.display()
+        ));
+        let mut stdout = Vec::new();
+        let mut stderr = Vec::new();
+        assert!(apply_patch(&patch, &mut stdout, &mut stderr).is_err());
+        assert!(!added.exists());
+        assert_eq!(fs::read_to_string(&first).unwrap(), "one\n");
+        assert_eq!(fs::read_to_string(&second).unwrap(), "two\n");
+    }
+
+    #[test]
+    fn test_later_hunks_see_earlier_hunks_of_the_same_file() {
+        let dir = tempdir().unwrap();
+        let path = dir.path().join("file.txt");
+        let dest = dir.path().join("moved.txt");
+        let patch = wrap_patch(&format!(
+            r#"*** Add File: {}
++a
++b
+*** Update File: {}
+*** Move to: {}
+@@
+-a
++A
+*** Update File: {}
+@@
+ A
+-b
++B"#,
+            path.display(),
+            path.display(),
+            dest.display(),
+            dest.display()
+        ));
+        let mut stdout = Vec::new();
+        let mut stderr = Vec::new();
+        apply_patch(&patch, &mut stdout, &mut stderr).unwrap();
+        assert!(!path.exists());
+        assert_eq!(fs::read_to_string(&dest).unwrap(), "A\nB\n");
+    }
+
+    #[test]
+    fn test_many_files_are_updated_in_hunk_order() {
+        let dir = tempdir().unwrap();
+        let paths: Vec<PathBuf> = (0..PARALLEL_UPDATE_MIN_FILES * 4)
+            .map(|i| dir.path().join(format!("file{i}.txt")))
+            .collect();
+        let mut body = String::new();
+        for (i, path) in paths.iter().enumerate() {
+            fs::write(path, format!("head\nvalue {i}\ntail\n")).unwrap();
+            body.push_str(&format!(
+                "*** Update File: {}\n@@\n head\n-value {i}\n+updated {i}\n",
+                path.display()
+            ));
+        }
+        let patch = wrap_patch(body.trim_end());
+        let mut stdout = Vec::new();
+        let mut stderr = Vec::new();
+        apply_patch(&patch, &mut stdout, &mut stderr).unwrap();
+
+        let mut expected_out = "Success. Updated the following files:\n".to_string();
+        for (i, path) in paths.iter().enumerate() {
+            assert_eq!(
+                fs::read_to_string(path).unwrap(),
+                format!("head\nupdated {i}\ntail\n")
+            );
+            expected_out.push_str(&format!("M {}\n", path.display()));
+        }
+        assert_eq!(String::from_utf8(stdout).unwrap(), expected_out);
+    }
+
     /// Verify that a single `Update File` hunk with multiple change chunks can update different
     /// parts of a file and that the file is listed only once in the summary.
     #[test]
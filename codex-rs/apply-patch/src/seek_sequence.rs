@@ -1,117 +1,200 @@
-/// Attempt to find the sequence of `pattern` lines within `lines` beginning at or after `start`.
-/// Returns the starting index of the match or `None` if not found. Matches are attempted with
-/// decreasing strictness: exact match, then ignoring trailing whitespace, then ignoring leading
-/// and trailing whitespace. When `eof` is true, we first try starting at the end-of-file (so that
-/// patterns intended to match file endings are applied at the end), and fall back to searching
-/// from `start` if needed.
-///
-/// Special cases handled defensively:
-///  • Empty `pattern` → returns `Some(start)` (no-op match)
-///  • `pattern.len() > lines.len()` → returns `None` (cannot match, avoids
-///    out‑of‑bounds panic that occurred pre‑2025‑04‑12)
-pub(crate) fn seek_sequence(
-    lines: &[String],
-    pattern: &[String],
-    start: usize,
-    eof: bool,
-) -> Option<usize> {
-    if pattern.is_empty() {
-        return Some(start);
-    }
-
-    // When the pattern is longer than the available input there is no possible
-    // match. Early‑return to avoid the out‑of‑bounds slice that would occur in
-    // the search loops below (previously caused a panic when
-    // `pattern.len() > lines.len()`).
-    if pattern.len() > lines.len() {
-        return None;
-    }
-    let search_start = if eof && lines.len() >= pattern.len() {
-        lines.len() - pattern.len()
-    } else {
-        start
-    };
-    // Exact match first.
-    for i in search_start..=lines.len().saturating_sub(pattern.len()) {
-        if lines[i..i + pattern.len()] == *pattern {
-            return Some(i);
+use std::borrow::Cow;
+use std::cell::OnceCell;
+use std::collections::HashMap;
+
+/// Successively looser ways of comparing a pattern line with a line of the
+/// file, in the order they are tried.
+#[derive(Clone, Copy, Debug)]
+enum Normalization {
+    Exact,
+    /// Ignore trailing whitespace.
+    TrimEnd,
+    /// Ignore leading and trailing whitespace.
+    Trim,
+    /// Additionally map common Unicode punctuation to its ASCII equivalent.
+    Unicode,
+}
+
+impl Normalization {
+    const ALL: [Normalization; 4] = [
+        Normalization::Exact,
+        Normalization::TrimEnd,
+        Normalization::Trim,
+        Normalization::Unicode,
+    ];
+
+    fn apply(self, line: &str) -> Cow<'_, str> {
+        match self {
+            Normalization::Exact => Cow::Borrowed(line),
+            Normalization::TrimEnd => Cow::Borrowed(line.trim_end()),
+            Normalization::Trim => Cow::Borrowed(line.trim()),
+            Normalization::Unicode => normalise(line),
         }
     }
-    // Then rstrip match.
-    for i in search_start..=lines.len().saturating_sub(pattern.len()) {
-        let mut ok = true;
-        for (p_idx, pat) in pattern.iter().enumerate() {
-            if lines[i + p_idx].trim_end() != pat.trim_end() {
-                ok = false;
-                break;
-            }
+}
+
+/// The lines of a file, indexed by their normalized text so that the places
+/// where a pattern could start are looked up instead of scanned for.
+///
+/// The index for each [`Normalization`] is built the first time a lookup
+/// needs it and is then reused by every later lookup, so locating all chunks
+/// of a patch normalizes each line of the file at most once per level.
+pub(crate) struct LineIndex<'a> {
+    lines: &'a [String],
+    levels: [OnceCell<IndexedLines<'a>>; 4],
+}
+
+struct IndexedLines<'a> {
+    normalized: Vec<Cow<'a, str>>,
+    /// Ascending line numbers of every distinct normalized line.
+    positions: HashMap<Cow<'a, str>, Vec<usize>>,
+}
+
+impl<'a> IndexedLines<'a> {
+    fn new(lines: &'a [String], normalization: Normalization) -> Self {
+        let normalized: Vec<Cow<'a, str>> =
+            lines.iter().map(|line| normalization.apply(line)).collect();
+        let mut positions: HashMap<Cow<'a, str>, Vec<usize>> = HashMap::new();
+        for (i, line) in normalized.iter().enumerate() {
+            positions.entry(line.clone()).or_default().push(i);
         }
-        if ok {
-            return Some(i);
+        Self {
+            normalized,
+            positions,
         }
     }
-    // Finally, trim both sides to allow more lenience.
-    for i in search_start..=lines.len().saturating_sub(pattern.len()) {
-        let mut ok = true;
-        for (p_idx, pat) in pattern.iter().enumerate() {
-            if lines[i + p_idx].trim() != pat.trim() {
-                ok = false;
-                break;
-            }
+}
+
+impl<'a> LineIndex<'a> {
+    pub(crate) fn new(lines: &'a [String]) -> Self {
+        Self {
+            lines,
+            levels: Default::default(),
+        }
+    }
+
+    /// Attempt to find the sequence of `pattern` lines beginning at or after `start`.
+    /// Returns the starting index of the match or `None` if not found. Matches are attempted
+    /// with decreasing strictness: exact match, then ignoring trailing whitespace, then ignoring
+    /// leading and trailing whitespace, then normalising Unicode punctuation. When `eof` is
+    /// true, the pattern is only searched for at the end of the file, so that patterns intended
+    /// to match file endings are applied there.
+    ///
+    /// Special cases handled defensively:
+    ///  • Empty `pattern` → returns `Some(start)` (no-op match)
+    ///  • `pattern.len() > lines.len()` → returns `None` (cannot match, avoids
+    ///    out‑of‑bounds panic that occurred pre‑2025‑04‑12)
+    pub(crate) fn seek(&self, pattern: &[String], start: usize, eof: bool) -> Option<usize> {
+        if pattern.is_empty() {
+            return Some(start);
+        }
+
+        // When the pattern is longer than the available input there is no
+        // possible match.
+        if pattern.len() > self.lines.len() {
+            return None;
         }
-        if ok {
-            return Some(i);
+        let last_start = self.lines.len() - pattern.len();
+        let search_start = if eof { last_start } else { start };
+
+        for (level, normalization) in Normalization::ALL.into_iter().enumerate() {
+            let indexed =
+                self.levels[level].get_or_init(|| IndexedLines::new(self.lines, normalization));
+            if let Some(found) = indexed.seek(pattern, normalization, search_start, last_start) {
+                return Some(found);
+            }
         }
+        None
     }
+}
 
-    // ------------------------------------------------------------------
-    // Final, most permissive pass – attempt to match after *normalising*
-    // common Unicode punctuation to their ASCII equivalents so that diffs
-    // authored with plain ASCII characters can still be applied to source
-    // files that contain typographic dashes / quotes, etc.  This mirrors the
-    // fuzzy behaviour of `git apply` which ignores minor byte-level
-    // differences when locating context lines.
-    // ------------------------------------------------------------------
-
-    fn normalise(s: &str) -> String {
-        s.trim()
-            .chars()
-            .map(|c| match c {
-                // Various dash / hyphen code-points → ASCII '-'
-                '\u{2010}' | '\u{2011}' | '\u{2012}' | '\u{2013}' | '\u{2014}' | '\u{2015}'
-                | '\u{2212}' => '-',
-                // Fancy single quotes → '\''
-                '\u{2018}' | '\u{2019}' | '\u{201A}' | '\u{201B}' => '\'',
-                // Fancy double quotes → '"'
-                '\u{201C}' | '\u{201D}' | '\u{201E}' | '\u{201F}' => '"',
-                // Non-breaking space and other odd spaces → normal space
-                '\u{00A0}' | '\u{2002}' | '\u{2003}' | '\u{2004}' | '\u{2005}' | '\u{2006}'
-                | '\u{2007}' | '\u{2008}' | '\u{2009}' | '\u{200A}' | '\u{202F}' | '\u{205F}'
-                | '\u{3000}' => ' ',
-                other => other,
-            })
-            .collect::<String>()
-    }
-
-    for i in search_start..=lines.len().saturating_sub(pattern.len()) {
-        let mut ok = true;
-        for (p_idx, pat) in pattern.iter().enumerate() {
-            if normalise(&lines[i + p_idx]) != normalise(pat) {
-                ok = false;
-                break;
+impl IndexedLines<'_> {
+    /// First match of `pattern` starting within `search_start..=last_start`.
+    fn seek(
+        &self,
+        pattern: &[String],
+        normalization: Normalization,
+        search_start: usize,
+        last_start: usize,
+    ) -> Option<usize> {
+        let pattern: Vec<Cow<'_, str>> = pattern
+            .iter()
+            .map(|line| normalization.apply(line))
+            .collect();
+
+        // Anchor on the pattern line that occurs least often in the file; if
+        // any line of the pattern does not occur at all, neither does the
+        // pattern.
+        let mut anchor: Option<(usize, &[usize])> = None;
+        for (offset, line) in pattern.iter().enumerate() {
+            let positions = self.positions.get(line.as_ref())?;
+            if anchor.is_none_or(|(_, best)| positions.len() < best.len()) {
+                anchor = Some((offset, positions));
             }
         }
-        if ok {
-            return Some(i);
+        let (offset, positions) = anchor?;
+
+        // Positions are ascending, so candidates are tried in file order and
+        // the first one that matches is the earliest match.
+        let first = positions.partition_point(|&pos| pos < search_start + offset);
+        for &pos in &positions[first..] {
+            let candidate = pos - offset;
+            if candidate > last_start {
+                break;
+            }
+            if self.normalized[candidate..candidate + pattern.len()] == pattern[..] {
+                return Some(candidate);
+            }
         }
+        None
     }
+}
 
-    None
+// ----------------------------------------------------------------------
+// The most permissive level normalises common Unicode punctuation to its
+// ASCII equivalent so that diffs authored with plain ASCII characters can
+// still be applied to source files that contain typographic dashes /
+// quotes, etc.  This mirrors the fuzzy behaviour of `git apply` which
+// ignores minor byte-level differences when locating context lines.
+// ----------------------------------------------------------------------
+
+fn normalise(s: &str) -> Cow<'_, str> {
+    let trimmed = s.trim();
+    if !trimmed.chars().any(|c| normalise_char(c) != c) {
+        return Cow::Borrowed(trimmed);
+    }
+    Cow::Owned(trimmed.chars().map(normalise_char).collect())
+}
+
+fn normalise_char(c: char) -> char {
+    match c {
+        // Various dash / hyphen code-points → ASCII '-'
+        '\u{2010}' | '\u{2011}' | '\u{2012}' | '\u{2013}' | '\u{2014}' | '\u{2015}'
+        | '\u{2212}' => '-',
+        // Fancy single quotes → '\''
+        '\u{2018}' | '\u{2019}' | '\u{201A}' | '\u{201B}' => '\'',
+        // Fancy double quotes → '"'
+        '\u{201C}' | '\u{201D}' | '\u{201E}' | '\u{201F}' => '"',
+        // Non-breaking space and other odd spaces → normal space
+        '\u{00A0}' | '\u{2002}' | '\u{2003}' | '\u{2004}' | '\u{2005}' | '\u{2006}'
+        | '\u{2007}' | '\u{2008}' | '\u{2009}' | '\u{200A}' | '\u{202F}' | '\u{205F}'
+        | '\u{3000}' => ' ',
+        other => other,
+    }
 }
 
 #[cfg(test)]
 mod tests {
-    use super::seek_sequence;
+    use super::LineIndex;
+
+    fn seek_sequence(
+        lines: &[String],
+        pattern: &[String],
+        start: usize,
+        eof: bool,
+    ) -> Option<usize> {
+        LineIndex::new(lines).seek(pattern, start, eof)
+    }
 
     fn to_vec(strings: &[&str]) -> Vec<String> {
         strings.iter().map(|s| s.to_string()).collect()
@@ -147,4 +230,43 @@ mod tests {
         // Should not panic – must return None when pattern cannot possibly fit.
         assert_eq!(seek_sequence(&lines, &pattern, 0, false), None);
     }
+
+    #[test]
+    fn test_unicode_normalised_match() {
+        let lines = to_vec(&["let s = \u{201C}hi\u{201D};", "x \u{2014} y"]);
+        let pattern = to_vec(&["let s = \"hi\";", "x - y"]);
+        assert_eq!(seek_sequence(&lines, &pattern, 0, false), Some(0));
+    }
+
+    #[test]
+    fn test_first_match_at_or_after_start_is_returned() {
+        let lines = to_vec(&["}", "a", "}", "b", "}", "a", "}"]);
+        let pattern = to_vec(&["a", "}"]);
+        assert_eq!(seek_sequence(&lines, &pattern, 0, false), Some(1));
+        assert_eq!(seek_sequence(&lines, &pattern, 2, false), Some(5));
+        assert_eq!(seek_sequence(&lines, &pattern, 6, false), None);
+    }
+
+    #[test]
+    fn test_stricter_match_wins_over_earlier_looser_match() {
+        let lines = to_vec(&["  foo", "foo"]);
+        let pattern = to_vec(&["foo"]);
+        assert_eq!(seek_sequence(&lines, &pattern, 0, false), Some(1));
+    }
+
+    #[test]
+    fn test_eof_only_matches_at_the_end() {
+        let lines = to_vec(&["x", "end", "y", "end"]);
+        assert_eq!(seek_sequence(&lines, &to_vec(&["end"]), 0, true), Some(3));
+        assert_eq!(seek_sequence(&lines, &to_vec(&["x"]), 0, true), None);
+    }
+
+    #[test]
+    fn test_index_is_reused_across_lookups() {
+        let lines = to_vec(&["fn a() {", "}", "fn b() {", "  }"]);
+        let index = LineIndex::new(&lines);
+        assert_eq!(index.seek(&to_vec(&["fn a() {"]), 0, false), Some(0));
+        assert_eq!(index.seek(&to_vec(&["fn b() {", "}"]), 1, false), Some(2));
+        assert_eq!(index.seek(&to_vec(&["fn a() {"]), 1, false), None);
+    }
 }
@@ -0,0 +1,465 @@
+#![allow(clippy::expect_used, clippy::unwrap_used)]
+
+//! Benchmarks for the hot paths of the library crates.
+//!
+//! Run with:
+//!
+//! ```text
+//! cargo bench -p codex-bench -- [filter]
+//! ```
+
+use std::collections::HashMap;
+use std::fs;
+use std::num::NonZero;
+use std::path::Path;
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::sync::atomic::AtomicBool;
+use std::time::Duration;
+use std::time::SystemTime;
+
+use bytes::Bytes;
+use codex_apply_patch::Hunk;
+use codex_apply_patch::apply_hunks;
+use codex_apply_patch::parse_patch;
+use codex_bench::report;
+use codex_bench::time;
+use codex_bench::time_with_setup;
+use codex_core::bench::count_chat_sse_events;
+use codex_core::bench::count_sse_events;
+use codex_core::config::Config;
+use codex_core::config::ConfigOverrides;
+use codex_core::config::ConfigToml;
+use codex_core::parse_command::parse_command;
+use codex_core::parse_command::parse_command_impl;
+use codex_core::protocol::FileChange;
+use codex_core::turn_diff_tracker::TurnDiffTracker;
+use codex_execpolicy::ExecCall;
+use codex_execpolicy::get_default_policy;
+use codex_file_search::FileIndex;
+use codex_tui::bench::MarkdownStreamCollector;
+use codex_tui::bench::TextArea;
+use codex_tui::bench::word_wrap_lines;
+use ratatui::style::Stylize;
+use ratatui::text::Line;
+use ratatui::text::Span;
+use tempfile::TempDir;
+use tempfile::tempdir;
+
+fn main() {
+    codex_bench::run(&[
+        ("sse", sse_benchmark),
+        ("apply_hunks", apply_hunks_benchmark),
+        ("get_unified_diff", get_unified_diff_benchmark),
+        ("parse_command", parse_command_benchmark),
+        ("policy_check", policy_check_benchmark),
+        ("file_search", file_search_benchmark),
+        ("markdown_stream", markdown_stream_benchmark),
+        ("word_wrap_lines", word_wrap_lines_benchmark),
+        ("textarea", textarea_benchmark),
+    ]);
+}
+
+/// Reads one of the recorded streams in `core/tests/fixtures` and splits it
+/// into network-sized chunks.
+fn recorded_stream(name: &str) -> Vec<Bytes> {
+    let path = Path::new(env!("CARGO_MANIFEST_DIR"))
+        .join("../core/tests/fixtures")
+        .join(name);
+    let data = Bytes::from(fs::read(path).expect("read fixture"));
+    data.chunks(1024).map(|c| data.slice_ref(c)).collect()
+}
+
+/// Parses recorded model streams in both wire formats.
+fn sse_benchmark() {
+    const ITERATIONS: u32 = 2_000;
+    let runtime = tokio::runtime::Runtime::new().expect("tokio runtime");
+
+    let responses = recorded_stream("responses_stream.sse");
+    let bytes: usize = responses.iter().map(Bytes::len).sum();
+    report(
+        "sse",
+        &format!("responses stream, {bytes} bytes"),
+        time(ITERATIONS, || {
+            runtime.block_on(count_sse_events(responses.clone()))
+        }),
+    );
+
+    let chat = recorded_stream("chat_completions_stream.sse");
+    let bytes: usize = chat.iter().map(Bytes::len).sum();
+    report(
+        "sse",
+        &format!("chat completions stream, {bytes} bytes"),
+        time(ITERATIONS, || {
+            runtime.block_on(count_chat_sse_events(chat.clone()))
+        }),
+    );
+}
+
+/// Applies many small chunks to large files, which exercises the line index
+/// used to seek each chunk's context.
+fn apply_hunks_benchmark() {
+    const FILES: usize = 16;
+    const LINES_PER_FILE: usize = 20_000;
+    const CHUNKS_PER_FILE: usize = 200;
+    const ITERATIONS: u32 = 20;
+
+    let original: String = (0..LINES_PER_FILE)
+        .map(|i| format!("    let value_{i} = compute({i});\n"))
+        .collect();
+    let mut body = String::new();
+    for chunk in 0..CHUNKS_PER_FILE {
+        let line = chunk * (LINES_PER_FILE / CHUNKS_PER_FILE) + 7;
+        body.push_str(&format!(
+            "@@\n     let value_{} = compute({});\n-    let value_{line} = compute({line});\n+    let value_{line} = compute({line}) + 1;\n",
+            line - 1,
+            line - 1
+        ));
+    }
+
+    let dir = tempdir().unwrap();
+    let files: Vec<PathBuf> = (0..FILES)
+        .map(|file| dir.path().join(format!("file_{file}.rs")))
+        .collect();
+    let mut patch = String::from("*** Begin Patch\n");
+    for file in &files {
+        patch.push_str(&format!("*** Update File: {}\n{body}", file.display()));
+    }
+    patch.push_str("*** End Patch");
+    let hunks: Vec<Hunk> = parse_patch(&patch).unwrap().hunks;
+
+    let reset = |count: usize| {
+        for file in &files[..count] {
+            fs::write(file, &original).unwrap();
+        }
+    };
+    let apply = |hunks: &[Hunk]| apply_hunks(hunks, &mut Vec::new(), &mut Vec::new()).unwrap();
+    report(
+        "apply_hunks",
+        &format!("{LINES_PER_FILE}-line file, {CHUNKS_PER_FILE} chunks"),
+        time_with_setup(ITERATIONS, || reset(1), |()| apply(&hunks[..1])),
+    );
+    report(
+        "apply_hunks",
+        &format!("{FILES}-file patch"),
+        time_with_setup(ITERATIONS, || reset(FILES), |()| apply(&hunks)),
+    );
+}
+
+/// Backdates `path` so the diff tracker trusts its mtime.
+fn set_old_mtime(path: &Path) {
+    let modified = SystemTime::now() - Duration::from_secs(60);
+    fs::File::options()
+        .write(true)
+        .open(path)
+        .unwrap()
+        .set_modified(modified)
+        .unwrap();
+}
+
+/// Recomputes the turn diff the way the TUI does after every patch: cold,
+/// with nothing changed, and with one file changed.
+fn get_unified_diff_benchmark() {
+    const FILES: usize = 32;
+    const LINES_PER_FILE: usize = 2_000;
+    const ITERATIONS: u32 = 50;
+
+    let dir = tempdir().unwrap();
+    let original: String = (0..LINES_PER_FILE).map(|i| format!("line {i}\n")).collect();
+    let files: Vec<PathBuf> = (0..FILES)
+        .map(|i| dir.path().join(format!("file_{i}.txt")))
+        .collect();
+    for file in &files {
+        fs::write(file, &original).unwrap();
+    }
+
+    let mut tracker = TurnDiffTracker::new();
+    let changes: HashMap<PathBuf, FileChange> = files
+        .iter()
+        .map(|file| {
+            (
+                file.clone(),
+                FileChange::Update {
+                    unified_diff: String::new(),
+                    move_path: None,
+                },
+            )
+        })
+        .collect();
+    tracker.on_patch_begin(&changes);
+    let modified = original.replace("line 1000\n", "line one thousand\n");
+    for file in &files {
+        fs::write(file, &modified).unwrap();
+        set_old_mtime(file);
+    }
+
+    let case = format!("{FILES} files of {LINES_PER_FILE} lines");
+    report(
+        "get_unified_diff",
+        &format!("{case}, cold"),
+        time(1, || tracker.get_unified_diff().unwrap()),
+    );
+    report(
+        "get_unified_diff",
+        &format!("{case}, cached"),
+        time(ITERATIONS, || tracker.get_unified_diff().unwrap()),
+    );
+    let mut edit = 0;
+    let one_changed = time_with_setup(
+        ITERATIONS,
+        || {
+            edit += 1;
+            fs::write(&files[0], format!("{modified}tail {edit}\n")).unwrap();
+            set_old_mtime(&files[0]);
+        },
+        |()| tracker.get_unified_diff().unwrap(),
+    );
+    report(
+        "get_unified_diff",
+        &format!("{case}, one file changed"),
+        one_changed,
+    );
+}
+
+/// Commands in the shape agents run them, as recorded in exec events.
+const RECORDED_COMMANDS: &[&str] = &[
+    "bash -lc 'git status'",
+    "bash -lc 'git diff --stat'",
+    "bash -lc 'cargo test -p codex-core'",
+    "bash -lc 'rg -n \"fn main\" src'",
+    "bash -lc 'rg --files | head -n 40'",
+    "bash -lc 'sed -n 1,200p src/lib.rs'",
+    "bash -lc 'ls -la && pwd'",
+    "bash -lc 'cat README.md | wc -l'",
+    "bash -lc 'npm run lint'",
+    "bash -lc 'cd codex-rs && cargo fmt'",
+    "git status",
+    "cargo test -p codex-tui",
+    "rg -n TODO -g '*.rs'",
+    "find . -name '*.toml'",
+];
+
+/// Summarizes recorded commands with and without the parse memo.
+fn parse_command_benchmark() {
+    const ITERATIONS: u32 = 200;
+    let commands: Vec<Vec<String>> = RECORDED_COMMANDS
+        .iter()
+        .map(|command| shlex::split(command).unwrap())
+        .collect();
+    let calls = commands.len() as u32;
+
+    let uncached = time(ITERATIONS, || {
+        for command in &commands {
+            parse_command_impl(command);
+        }
+    });
+    report("parse_command", "per call, uncached", uncached / calls);
+    let memoized = time(ITERATIONS, || {
+        for command in &commands {
+            parse_command(command);
+        }
+    });
+    report("parse_command", "per call, memoized", memoized / calls);
+}
+
+/// Commands in the shape agents typically run, allowed and rejected alike.
+const POLICY_CORPUS: &[&[&str]] = &[
+    &["ls", "-la"],
+    &["ls", "-1", "src"],
+    &["cat", "README.md"],
+    &["cat", "-n", "src/main.rs", "src/lib.rs"],
+    &["head", "-n", "40", "Cargo.toml"],
+    &["pwd"],
+    &["which", "cargo"],
+    &["printenv", "PATH"],
+    &["rg", "-n", "fn main", "src"],
+    &["rg", "--files"],
+    &["rg", "-i", "-g", "*.rs", "TODO"],
+    &["sed", "-n", "1,200p", "src/lib.rs"],
+    &["cp", "a.txt", "b.txt"],
+    &["cargo", "test"],
+    &["git", "status"],
+    &["rm", "-rf", "target"],
+    &["python3", "-c", "print(1)"],
+    &["ls", "--color=always"],
+    &["head", "-c", "100", "file"],
+    &["sed", "-i", "s/a/b/", "file"],
+];
+
+/// Checks the corpus against the default execpolicy.
+fn policy_check_benchmark() {
+    const ITERATIONS: u32 = 20_000;
+    let policy = get_default_policy().expect("failed to load default policy");
+    let calls: Vec<ExecCall> = POLICY_CORPUS
+        .iter()
+        .map(|command| ExecCall::new(command[0], &command[1..]))
+        .collect();
+
+    let elapsed = time(ITERATIONS, || {
+        calls
+            .iter()
+            .filter(|call| policy.check(call).is_ok())
+            .count()
+    });
+    report(
+        "policy_check",
+        "default policy, per check",
+        elapsed / calls.len() as u32,
+    );
+}
+
+/// Types a query one keystroke at a time, walking the tree for every
+/// keystroke and then querying a prebuilt index.
+fn file_search_benchmark() {
+    const DIRS: usize = 200;
+    const FILES_PER_DIR: usize = 100;
+    const QUERIES: &[&str] = &["m", "mo", "mod", "modu", "modul", "module_4"];
+    const LIMIT: NonZero<usize> = NonZero::new(16).unwrap();
+
+    let dir = TempDir::new().expect("tempdir");
+    for d in 0..DIRS {
+        let parent = dir.path().join(format!("crate_{d}/src"));
+        fs::create_dir_all(&parent).expect("create parent");
+        for f in 0..FILES_PER_DIR {
+            fs::write(parent.join(format!("module_{f}.rs")), "").expect("write file");
+        }
+    }
+    let threads = std::thread::available_parallelism().unwrap_or(NonZero::<usize>::MIN);
+    let cancel = AtomicBool::new(false);
+    let case = format!(
+        "{} files, {} keystrokes",
+        DIRS * FILES_PER_DIR,
+        QUERIES.len()
+    );
+
+    let walk = time(1, || {
+        for query in QUERIES {
+            codex_file_search::run(
+                query,
+                LIMIT,
+                dir.path(),
+                Vec::new(),
+                threads,
+                Arc::new(AtomicBool::new(false)),
+                false,
+            )
+            .expect("run");
+        }
+    });
+    report("file_search", &format!("{case}, walking each time"), walk);
+
+    let index = FileIndex::new(dir.path().to_path_buf(), Vec::new(), threads);
+    let build = time(1, || index.ensure_built().expect("build index"));
+    report("file_search", &format!("{case}, building the index"), build);
+    let indexed = time(1, || {
+        for query in QUERIES {
+            index.search(query, LIMIT, &cancel, true);
+        }
+    });
+    report(
+        "file_search",
+        &format!("{case}, querying the index"),
+        indexed,
+    );
+}
+
+/// Streams a long answer in small deltas, committing after every newline.
+fn markdown_stream_benchmark() {
+    const SECTIONS: usize = 100;
+    const DELTA_CHARS: usize = 16;
+
+    let codex_home = tempdir().unwrap();
+    let config = Config::load_from_base_config_with_overrides(
+        ConfigToml::default(),
+        ConfigOverrides::default(),
+        codex_home.path().to_path_buf(),
+    )
+    .expect("load config");
+
+    let mut fenced = String::new();
+    let mut fenceless = String::new();
+    for i in 0..SECTIONS {
+        fenced.push_str(&format!(
+            "## Step {i}\n\nThis paragraph explains **step {i}** and links to `src/lib.rs`.\n\n- first item\n- second item with `code`\n\n```rust\nfn step_{i}() -> usize {{\n    {i}\n}}\n```\n\n"
+        ));
+        // A long plan without code blocks, which has no fences to split at.
+        fenceless.push_str(&format!(
+            "## Step {i}\n\nThis paragraph explains **step {i}** and links to `src/lib.rs`,\nthen goes on for a second line.\n\n- first item\n- second item with `code`\n\nThe step ends with a short summary.\n\n"
+        ));
+    }
+
+    for (name, source) in [("fenced", fenced), ("fenceless", fenceless)] {
+        let chars: Vec<char> = source.chars().collect();
+        let deltas: Vec<String> = chars
+            .chunks(DELTA_CHARS)
+            .map(|chunk| chunk.iter().collect())
+            .collect();
+        let elapsed = time(1, || {
+            let mut collector = MarkdownStreamCollector::new();
+            let mut lines = 0;
+            for delta in &deltas {
+                collector.push_delta(delta);
+                if delta.contains('\n') {
+                    lines += collector.commit_complete_lines(&config).len();
+                }
+            }
+            lines + collector.finalize_and_drain(&config).len()
+        });
+        report(
+            "markdown_stream",
+            &format!("{name}, {} bytes, per delta", source.len()),
+            elapsed / deltas.len() as u32,
+        );
+    }
+}
+
+/// Wraps styled history lines at common terminal widths.
+fn word_wrap_lines_benchmark() {
+    const LINES: usize = 2_000;
+    const ITERATIONS: u32 = 20;
+    let lines: Vec<Line> = (0..LINES)
+        .map(|i| {
+            Line::from(vec![
+                Span::from(format!("{i:>5} ")).dim(),
+                "The quick brown fox jumps over the lazy dog while ".into(),
+                "the build keeps running".bold(),
+                " and the tests report their results one line at a time.".into(),
+            ])
+        })
+        .collect();
+
+    for width in [40u16, 80, 120] {
+        report(
+            "word_wrap_lines",
+            &format!("{LINES} lines at width {width}"),
+            time(ITERATIONS, || word_wrap_lines(&lines, width)),
+        );
+    }
+}
+
+/// Types into the composer after pasting a large block of text.
+fn textarea_benchmark() {
+    const LINES: usize = 20_000;
+    const KEYSTROKES: u32 = 1_000;
+    const WIDTH: u16 = 60;
+    let paste: String = (0..LINES)
+        .map(|i| format!("{i:>6} the quick brown fox jumps over the lazy dog\n"))
+        .collect();
+    let mut textarea = TextArea::new();
+    textarea.insert_str(&paste);
+    textarea.set_cursor(paste.len() / 2);
+
+    report(
+        "textarea",
+        &format!("wrap a {LINES}-line paste"),
+        time(1, || textarea.desired_height(WIDTH)),
+    );
+    report(
+        "textarea",
+        "keystroke + relayout",
+        time(KEYSTROKES, || {
+            textarea.insert_str("x");
+            textarea.desired_height(WIDTH)
+        }),
+    );
+}
@@ -0,0 +1,58 @@
+//! Timing helpers shared by the workspace benchmarks.
+//!
+//! Benchmarks are `harness = false` bench targets run with `cargo bench`:
+//! the hot paths of the library crates live in `benches/hot_paths.rs` here,
+//! and the recorded-session replay lives next to the `codex-exec` binary it
+//! drives. Each target hands its benchmarks to [`run`] and prints through
+//! [`report`], so every measurement comes out in the same shape.
+
+use std::fmt::Display;
+use std::hint::black_box;
+use std::time::Duration;
+use std::time::Instant;
+
+/// Runs every benchmark whose name contains the filter given on the command
+/// line (`cargo bench -p codex-bench -- <filter>`), or all of them without
+/// one.
+pub fn run(benchmarks: &[(&str, fn())]) {
+    let filter = std::env::args().skip(1).find(|arg| !arg.starts_with('-'));
+    for (name, benchmark) in benchmarks {
+        if filter.as_deref().is_none_or(|filter| name.contains(filter)) {
+            benchmark();
+        }
+    }
+}
+
+/// Returns the mean wall time of `iterations` calls to `f`.
+pub fn time<T>(iterations: u32, mut f: impl FnMut() -> T) -> Duration {
+    time_with_setup(iterations, || (), |()| f())
+}
+
+/// Like [`time`], but calls `setup` before each iteration and leaves it out
+/// of the measurement.
+pub fn time_with_setup<S, T>(
+    iterations: u32,
+    mut setup: impl FnMut() -> S,
+    mut f: impl FnMut(S) -> T,
+) -> Duration {
+    let mut total = Duration::ZERO;
+    for _ in 0..iterations {
+        let input = setup();
+        let start = Instant::now();
+        black_box(f(input));
+        total += start.elapsed();
+    }
+    total / iterations.max(1)
+}
+
+/// Prints one timing as `<benchmark> <case> <elapsed>`.
+pub fn report(benchmark: &str, case: &str, elapsed: Duration) {
+    report_value(benchmark, case, format!("{elapsed:.2?}"));
+}
+
+/// Prints a measurement that is not a duration, such as a peak RSS, in the
+/// same columns as [`report`].
+pub fn report_value(benchmark: &str, case: &str, value: impl Display) {
+    let value = value.to_string();
+    println!("{benchmark:<20} {case:<56} {value:>12}");
+}
@@ -69,7 +69,7 @@ pub(crate) async fn apply_patch(
             let rx_approve = sess
                 .request_patch_approval(sub_id.to_owned(), call_id.to_owned(), &action, None, None)
                 .await;
-            match rx_approve.await.unwrap_or_default() {
+            match sess.wait_for_approval(rx_approve).await {
                 ReviewDecision::Approved | ReviewDecision::ApprovedForSession => {
                     InternalApplyPatchInvocation::DelegateToExec(ApplyPatchExec {
                         action,
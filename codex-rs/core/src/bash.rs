@@ -1,7 +1,21 @@
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+
 use tree_sitter::Parser;
 use tree_sitter::Tree;
 use tree_sitter_bash::LANGUAGE as BASH;
 
+use crate::lru_cache::LruCache;
+
+/// Number of distinct `bash -lc` scripts whose parse is remembered. Agents
+/// rerun the same handful of commands, and both the command summary and the
+/// safety check need the parse of each one.
+const PLAIN_COMMANDS_CACHE_CAPACITY: usize = 256;
+
+static PLAIN_COMMANDS_CACHE: LazyLock<Mutex<LruCache<String, Option<Vec<Vec<String>>>>>> =
+    LazyLock::new(|| Mutex::new(LruCache::new(PLAIN_COMMANDS_CACHE_CAPACITY)));
+
 /// Parse the provided bash source using tree-sitter-bash, returning a Tree on
 /// success or None if parsing failed.
 pub fn try_parse_bash(bash_lc_arg: &str) -> Option<Tree> {
@@ -130,6 +144,33 @@ fn parse_plain_command_from_node(cmd: tree_sitter::Node, src: &str) -> Option<Ve
     Some(words)
 }
 
+/// For a `bash -lc <script>` invocation whose script is a word-only command
+/// sequence (see [`try_parse_word_only_commands_sequence`]), returns its
+/// commands. Returns `None` for any other command. The tree-sitter parse runs
+/// once per distinct script; later calls are answered from a bounded cache.
+pub fn parse_bash_lc_plain_commands(command: &[String]) -> Option<Vec<Vec<String>>> {
+    let [bash, flag, script] = command else {
+        return None;
+    };
+    if bash != "bash" || flag != "-lc" {
+        return None;
+    }
+    if let Some(cached) = PLAIN_COMMANDS_CACHE
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .get(script.as_str())
+    {
+        return cached;
+    }
+    let commands = try_parse_bash(script)
+        .and_then(|tree| try_parse_word_only_commands_sequence(&tree, script));
+    PLAIN_COMMANDS_CACHE
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .insert(script.clone(), commands.clone());
+    commands
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -215,4 +256,24 @@ mod tests {
     fn rejects_trailing_operator_parse_error() {
         assert!(parse_seq("ls &&").is_none());
     }
+
+    #[test]
+    fn bash_lc_plain_commands_are_parsed_once_and_reused() {
+        let command =
+            |script: &str| vec!["bash".to_string(), "-lc".to_string(), script.to_string()];
+        let expected = Some(vec![vec!["git".to_string(), "status".to_string()]]);
+        assert_eq!(
+            parse_bash_lc_plain_commands(&command("git status")),
+            expected
+        );
+        assert_eq!(
+            parse_bash_lc_plain_commands(&command("git status")),
+            expected
+        );
+        assert_eq!(parse_bash_lc_plain_commands(&command("ls > out.txt")), None);
+        assert_eq!(
+            parse_bash_lc_plain_commands(&["git".to_string(), "status".to_string()]),
+            None
+        );
+    }
 }
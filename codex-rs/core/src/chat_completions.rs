@@ -6,7 +6,9 @@ use futures::Stream;
 use futures::StreamExt;
 use futures::TryStreamExt;
 use reqwest::StatusCode;
+use serde::Deserialize;
 use serde_json::json;
+use serde_json::value::RawValue;
 use std::pin::Pin;
 use std::task::Context;
 use std::task::Poll;
@@ -16,6 +18,7 @@ use tracing::debug;
 use tracing::trace;
 
 use crate::ModelProviderInfo;
+use crate::client_common::JsonStr;
 use crate::client_common::Prompt;
 use crate::client_common::ResponseEvent;
 use crate::client_common::ResponseStream;
@@ -43,8 +46,8 @@ pub(crate) async fn stream_chat_completions(
 
     let input = prompt.get_formatted_input();
 
-    for item in &input {
-        match item {
+    for item in input {
+        match item.as_ref() {
             ResponseItem::Message { role, content, .. } => {
                 let mut text = String::new();
                 for c in content {
@@ -209,6 +212,69 @@ pub(crate) async fn stream_chat_completions(
     }
 }
 
+/// A Chat Completions stream chunk, borrowing from the SSE data. Only the
+/// fields read by [`process_chat_sse`] are parsed; everything else is skipped
+/// without building a `serde_json::Value`. Providers disagree on the shape of
+/// some fields, so a field of an unexpected type is treated as missing (see
+/// [`lenient`]) rather than failing the whole chunk.
+#[derive(Debug, Deserialize)]
+struct ChatChunk<'a> {
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    choices: Option<Vec<ChatChoice<'a>>>,
+}
+
+#[derive(Debug, Deserialize)]
+struct ChatChoice<'a> {
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    delta: Option<ChatDelta<'a>>,
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    finish_reason: Option<JsonStr<'a>>,
+}
+
+#[derive(Debug, Default, Deserialize)]
+struct ChatDelta<'a> {
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    content: Option<JsonStr<'a>>,
+    /// Shape varies by provider, see [`process_chat_sse`].
+    #[serde(borrow)]
+    reasoning: Option<&'a RawValue>,
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    tool_calls: Option<Vec<ChatToolCall<'a>>>,
+}
+
+#[derive(Debug, Deserialize)]
+struct ChatToolCall<'a> {
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    id: Option<JsonStr<'a>>,
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    function: Option<ChatFunction<'a>>,
+}
+
+#[derive(Debug, Deserialize)]
+struct ChatFunction<'a> {
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    name: Option<JsonStr<'a>>,
+    #[serde(borrow, default, deserialize_with = "lenient")]
+    arguments: Option<JsonStr<'a>>,
+}
+
+/// Deserializes an optional chunk field, treating a value that doesn't parse
+/// as `T` like a missing field, the way the `serde_json::Value` lookups did.
+fn lenient<'de, D, T>(deserializer: D) -> std::result::Result<Option<T>, D::Error>
+where
+    D: serde::Deserializer<'de>,
+    T: Deserialize<'de>,
+{
+    let raw = <&'de RawValue>::deserialize(deserializer)?;
+    Ok(serde_json::from_str(raw.get()).unwrap_or_else(|e| {
+        debug!(
+            "ignoring malformed chat completions field {}: {e}",
+            raw.get()
+        );
+        None
+    }))
+}
+
 /// Lightweight SSE processor for the Chat Completions streaming format. The
 /// output is mapped onto Codex's internal [`ResponseEvent`] so that the rest
 /// of the pipeline can stay agnostic of the underlying wire format.
@@ -305,32 +371,37 @@ async fn process_chat_sse<S>(
         }
 
         // Parse JSON chunk
-        let chunk: serde_json::Value = match serde_json::from_str(&sse.data) {
+        trace!("chat_completions received SSE chunk: {}", sse.data);
+        let chunk: ChatChunk = match serde_json::from_str(&sse.data) {
             Ok(v) => v,
-            Err(_) => continue,
+            Err(e) => {
+                debug!("failed to parse chat completions SSE chunk: {e}");
+                continue;
+            }
         };
-        trace!("chat_completions received SSE chunk: {chunk:?}");
 
-        let choice_opt = chunk.get("choices").and_then(|c| c.get(0));
+        let choice_opt = chunk.choices.unwrap_or_default().into_iter().next();
 
         if let Some(choice) = choice_opt {
+            let delta = choice.delta.unwrap_or_default();
+
             // Handle assistant content tokens as streaming deltas.
-            if let Some(content) = choice
-                .get("delta")
-                .and_then(|d| d.get("content"))
-                .and_then(|c| c.as_str())
-                && !content.is_empty()
+            if let Some(content) = delta.content
+                && !content.as_str().is_empty()
             {
-                assistant_text.push_str(content);
+                assistant_text.push_str(content.as_str());
                 let _ = tx_event
-                    .send(Ok(ResponseEvent::OutputTextDelta(content.to_string())))
+                    .send(Ok(ResponseEvent::OutputTextDelta(content.into_owned())))
                     .await;
             }
 
             // Forward any reasoning/thinking deltas if present.
             // Some providers stream `reasoning` as a plain string while others
             // nest the text under an object (e.g. `{ "reasoning": { "text": "…" } }`).
-            if let Some(reasoning_val) = choice.get("delta").and_then(|d| d.get("reasoning")) {
+            if let Some(reasoning_val) = delta
+                .reasoning
+                .and_then(|raw| serde_json::from_str::<serde_json::Value>(raw.get()).ok())
+            {
                 let mut maybe_text = reasoning_val.as_str().map(|s| s.to_string());
 
                 if maybe_text.is_none() && reasoning_val.is_object() {
@@ -357,36 +428,33 @@ async fn process_chat_sse<S>(
             }
 
             // Handle streaming function / tool calls.
-            if let Some(tool_calls) = choice
-                .get("delta")
-                .and_then(|d| d.get("tool_calls"))
-                .and_then(|tc| tc.as_array())
-                && let Some(tool_call) = tool_calls.first()
+            if let Some(tool_call) = delta
+                .tool_calls
+                .and_then(|tool_calls| tool_calls.into_iter().next())
             {
                 // Mark that we have an active function call in progress.
                 fn_call_state.active = true;
 
                 // Extract call_id if present.
-                if let Some(id) = tool_call.get("id").and_then(|v| v.as_str()) {
-                    fn_call_state.call_id.get_or_insert_with(|| id.to_string());
+                if let Some(id) = tool_call.id {
+                    fn_call_state.call_id.get_or_insert_with(|| id.into_owned());
                 }
 
                 // Extract function details if present.
-                if let Some(function) = tool_call.get("function") {
-                    if let Some(name) = function.get("name").and_then(|n| n.as_str()) {
-                        fn_call_state.name.get_or_insert_with(|| name.to_string());
+                if let Some(function) = tool_call.function {
+                    if let Some(name) = function.name {
+                        fn_call_state.name.get_or_insert_with(|| name.into_owned());
                     }
 
-                    if let Some(args_fragment) = function.get("arguments").and_then(|a| a.as_str())
-                    {
-                        fn_call_state.arguments.push_str(args_fragment);
+                    if let Some(args_fragment) = function.arguments {
+                        fn_call_state.arguments.push_str(args_fragment.as_str());
                     }
                 }
             }
 
             // Emit end-of-turn when finish_reason signals completion.
-            if let Some(finish_reason) = choice.get("finish_reason").and_then(|v| v.as_str()) {
-                match finish_reason {
+            if let Some(finish_reason) = choice.finish_reason {
+                match finish_reason.as_str() {
                     "tool_calls" if fn_call_state.active => {
                         // First, flush the terminal raw reasoning so UIs can finalize
                         // the reasoning stream before any exec/tool events begin.
@@ -676,3 +744,150 @@ impl<S> AggregatedChatStream<S> {
         Self::new(inner, AggregateMode::Streaming)
     }
 }
+
+/// Parses a recorded Chat Completions stream and returns how many events it
+/// produced. Exposed for the `codex-bench` benchmarks.
+#[cfg(feature = "bench")]
+pub async fn count_chat_sse_events(chunks: Vec<Bytes>) -> usize {
+    let (tx, mut rx) = mpsc::channel::<Result<ResponseEvent>>(1600);
+    let stream = futures::stream::iter(chunks.into_iter().map(Ok));
+    tokio::spawn(process_chat_sse(stream, tx, Duration::from_secs(5)));
+    let mut events = 0;
+    while let Some(Ok(_)) = rx.recv().await {
+        events += 1;
+    }
+    events
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use pretty_assertions::assert_eq;
+    use std::path::Path;
+
+    async fn collect_chat_events(chunks: Vec<Bytes>) -> Vec<ResponseEvent> {
+        let (tx, mut rx) = mpsc::channel::<Result<ResponseEvent>>(1600);
+        let stream = futures::stream::iter(chunks.into_iter().map(Ok));
+        tokio::spawn(process_chat_sse(stream, tx, Duration::from_secs(5)));
+
+        let mut events = Vec::new();
+        while let Some(ev) = rx.recv().await {
+            events.push(ev.expect("event"));
+        }
+        events
+    }
+
+    /// Reads one of the recorded streams in `tests/fixtures` and splits it into
+    /// network-sized chunks.
+    fn recorded_stream(name: &str) -> Vec<Bytes> {
+        let path = Path::new(env!("CARGO_MANIFEST_DIR"))
+            .join("tests/fixtures")
+            .join(name);
+        let data = Bytes::from(std::fs::read(path).expect("read fixture"));
+        data.chunks(1024).map(|c| data.slice_ref(c)).collect()
+    }
+
+    #[tokio::test]
+    async fn parses_recorded_stream() {
+        let events = collect_chat_events(recorded_stream("chat_completions_stream.sse")).await;
+
+        let deltas: String = events
+            .iter()
+            .filter_map(|ev| match ev {
+                ResponseEvent::OutputTextDelta(delta) => Some(delta.as_str()),
+                _ => None,
+            })
+            .collect();
+        assert!(deltas.contains("```sh\ncd codex-rs\n"));
+
+        let [
+            ..,
+            ResponseEvent::OutputItemDone(item),
+            ResponseEvent::Completed { .. },
+        ] = events.as_slice()
+        else {
+            panic!("unexpected events: {events:?}");
+        };
+        let ResponseItem::Message { content, .. } = item else {
+            panic!("unexpected item: {item:?}");
+        };
+        assert_eq!(
+            content.as_slice(),
+            [ContentItem::OutputText { text: deltas }]
+        );
+    }
+
+    #[tokio::test]
+    async fn accumulates_split_tool_call_arguments() {
+        let body = [
+            r#"{"choices":[{"delta":{"tool_calls":[{"index":0,"id":"call_1","type":"function","function":{"name":"shell","arguments":""}}]},"finish_reason":null}]}"#,
+            r#"{"choices":[{"delta":{"tool_calls":[{"index":0,"function":{"arguments":"{\"command\":"}}]},"finish_reason":null}]}"#,
+            r#"{"choices":[{"delta":{"tool_calls":[{"index":0,"function":{"arguments":"[\"ls\"]}"}}]},"finish_reason":null}]}"#,
+            r#"{"choices":[],"usage":{"prompt_tokens":1}}"#,
+            r#"{"choices":[{"delta":{},"finish_reason":"tool_calls"}]}"#,
+        ]
+        .iter()
+        .map(|data| format!("data: {data}\n\n"))
+        .collect::<String>();
+
+        let events = collect_chat_events(vec![Bytes::from(body)]).await;
+
+        let [
+            ResponseEvent::OutputItemDone(item),
+            ResponseEvent::Completed { .. },
+        ] = events.as_slice()
+        else {
+            panic!("unexpected events: {events:?}");
+        };
+        let ResponseItem::FunctionCall {
+            name,
+            arguments,
+            call_id,
+            ..
+        } = item
+        else {
+            panic!("unexpected item: {item:?}");
+        };
+        assert_eq!(name, "shell");
+        assert_eq!(arguments, r#"{"command":["ls"]}"#);
+        assert_eq!(call_id, "call_1");
+    }
+
+    #[tokio::test]
+    async fn malformed_field_only_drops_that_field() {
+        let body = [
+            // A numeric tool call id and non-string content must only drop
+            // those fields, not the text and tool call deltas around them.
+            r#"{"choices":[{"delta":{"content":"hi"},"finish_reason":null}]}"#,
+            r#"{"choices":[{"delta":{"content":null,"tool_calls":[{"index":0,"id":42,"function":{"name":"shell","arguments":"{}"}}]},"finish_reason":null}]}"#,
+            r#"{"choices":[{"delta":{"content":["not","text"]},"finish_reason":"tool_calls"}]}"#,
+        ]
+        .iter()
+        .map(|data| format!("data: {data}\n\n"))
+        .collect::<String>();
+
+        let events = collect_chat_events(vec![Bytes::from(body)]).await;
+
+        let [
+            ResponseEvent::OutputTextDelta(delta),
+            ResponseEvent::OutputItemDone(item),
+            ResponseEvent::Completed { .. },
+        ] = events.as_slice()
+        else {
+            panic!("unexpected events: {events:?}");
+        };
+        assert_eq!(delta, "hi");
+        let ResponseItem::FunctionCall {
+            name,
+            arguments,
+            call_id,
+            ..
+        } = item
+        else {
+            panic!("unexpected item: {item:?}");
+        };
+        assert_eq!(name, "shell");
+        assert_eq!(arguments, "{}");
+        assert_eq!(call_id, "");
+    }
+}
@@ -1,5 +1,6 @@
 use std::io::BufRead;
 use std::path::Path;
+use std::path::PathBuf;
 use std::time::Duration;
 
 use bytes::Bytes;
@@ -9,8 +10,7 @@ use eventsource_stream::Eventsource;
 use futures::prelude::*;
 use reqwest::StatusCode;
 use serde::Deserialize;
-use serde::Serialize;
-use serde_json::Value;
+use serde_json::value::RawValue;
 use tokio::sync::mpsc;
 use tokio::time::timeout;
 use tokio_util::io::ReaderStream;
@@ -21,6 +21,7 @@ use uuid::Uuid;
 
 use crate::chat_completions::AggregateStreamExt;
 use crate::chat_completions::stream_chat_completions;
+use crate::client_common::JsonStr;
 use crate::client_common::Prompt;
 use crate::client_common::ResponseEvent;
 use crate::client_common::ResponseStream;
@@ -32,18 +33,27 @@ use crate::error::CodexErr;
 use crate::error::Result;
 use crate::error::UsageLimitReachedError;
 use crate::flags::CODEX_RS_SSE_FIXTURE;
+use crate::http_client::client_for_provider;
+use crate::http_client::preconnect;
 use crate::model_family::ModelFamily;
 use crate::model_provider_info::ModelProviderInfo;
 use crate::model_provider_info::WireApi;
 use crate::openai_model_info::get_model_info;
 use crate::openai_tools::create_tools_json_for_responses_api;
 use crate::protocol::TokenUsage;
+use crate::request_body::RequestBodyCache;
+use crate::request_body::request_body_cache_for_session;
 use crate::user_agent::get_codex_user_agent;
 use crate::util::backoff;
 use codex_protocol::config_types::ReasoningEffort as ReasoningEffortConfig;
 use codex_protocol::config_types::ReasoningSummary as ReasoningSummaryConfig;
 use codex_protocol::models::ResponseItem;
+use std::collections::HashMap;
 use std::sync::Arc;
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::sync::Weak;
 
 #[derive(Debug, Deserialize)]
 struct ErrorResponse {
@@ -69,6 +79,9 @@ pub struct ModelClient {
     session_id: Uuid,
     effort: ReasoningEffortConfig,
     summary: ReasoningSummaryConfig,
+    request_body_cache: Arc<Mutex<RequestBodyCache>>,
+    /// Set only when requests are answered from `CODEX_RS_SSE_FIXTURE`.
+    fixture_cursor: Option<Arc<Mutex<FixtureCursor>>>,
 }
 
 impl ModelClient {
@@ -83,11 +96,15 @@ impl ModelClient {
         Self {
             config,
             auth_manager,
-            client: reqwest::Client::new(),
+            client: client_for_provider(&provider),
             provider,
             session_id,
             effort,
             summary,
+            request_body_cache: request_body_cache_for_session(session_id),
+            fixture_cursor: CODEX_RS_SSE_FIXTURE
+                .is_some()
+                .then(|| fixture_cursor_for_session(session_id)),
         }
     }
 
@@ -143,10 +160,16 @@ impl ModelClient {
 
     /// Implementation for the OpenAI *Responses* experimental API.
     async fn stream_responses(&self, prompt: &Prompt) -> Result<ResponseStream> {
-        if let Some(path) = &*CODEX_RS_SSE_FIXTURE {
+        if let Some(path) = &*CODEX_RS_SSE_FIXTURE
+            && let Some(cursor) = &self.fixture_cursor
+        {
             // short circuit for tests
             warn!(path, "Streaming from fixture");
-            return stream_from_fixture(path, self.provider.clone()).await;
+            let request = cursor
+                .lock()
+                .unwrap_or_else(PoisonError::into_inner)
+                .request_for(&prompt.input);
+            return stream_from_fixture(path, request, self.provider.clone()).await;
         }
 
         let auth_manager = self.auth_manager.clone();
@@ -193,7 +216,7 @@ impl ModelClient {
         let payload = ResponsesApiRequest {
             model: &self.config.model,
             instructions: &full_instructions,
-            input: &input_with_instructions,
+            input: input_with_instructions,
             tools: &tools_json,
             tool_choice: "auto",
             parallel_tool_calls: false,
@@ -204,6 +227,11 @@ impl ModelClient {
             prompt_cache_key: Some(self.session_id.to_string()),
             text,
         };
+        let body = self
+            .request_body_cache
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .encode(&payload)?;
 
         let mut attempt = 0;
         let max_retries = self.provider.request_max_retries();
@@ -217,7 +245,7 @@ impl ModelClient {
             trace!(
                 "POST to {}: {}",
                 self.provider.get_full_url(&auth),
-                serde_json::to_string(&payload)?
+                String::from_utf8_lossy(&body)
             );
 
             let mut req_builder = self
@@ -229,7 +257,8 @@ impl ModelClient {
                 .header("OpenAI-Beta", "responses=experimental")
                 .header("session_id", self.session_id.to_string())
                 .header(reqwest::header::ACCEPT, "text/event-stream")
-                .json(&payload);
+                .header(reqwest::header::CONTENT_TYPE, "application/json")
+                .body(body.clone());
 
             if let Some(auth) = auth.as_ref()
                 && auth.mode == AuthMode::ChatGPT
@@ -346,6 +375,23 @@ impl ModelClient {
         }
     }
 
+    /// Connects to the provider in the background if it opted into
+    /// `preconnect`, so the first turn does not pay for connection setup.
+    pub(crate) fn spawn_preconnect(&self) {
+        if !self.provider.preconnect || CODEX_RS_SSE_FIXTURE.is_some() {
+            return;
+        }
+        let auth = self.auth_manager.as_ref().and_then(|m| m.auth());
+        tokio::spawn(preconnect(self.client.clone(), self.provider.clone(), auth));
+    }
+
+    /// Waits for a warm-up of this client's model that is still in flight
+    /// (see [`crate::model_load`]) and returns how long that took.
+    pub async fn wait_for_model_load(&self) -> Duration {
+        crate::model_load::wait_for_model_load(&self.config.model_provider_id, &self.config.model)
+            .await
+    }
+
     pub fn get_provider(&self) -> ModelProviderInfo {
         self.provider.clone()
     }
@@ -375,13 +421,33 @@ impl ModelClient {
     }
 }
 
-#[derive(Debug, Deserialize, Serialize)]
-struct SseEvent {
-    #[serde(rename = "type")]
-    kind: String,
-    response: Option<Value>,
-    item: Option<Value>,
-    delta: Option<String>,
+/// A Responses API event. It borrows from the SSE data: `response` and `item`
+/// are kept as raw JSON and only parsed by the events that use them, so the
+/// frequent delta events never build a `serde_json::Value`.
+#[derive(Debug, Deserialize)]
+struct SseEvent<'a> {
+    #[serde(rename = "type", borrow)]
+    kind: JsonStr<'a>,
+    #[serde(borrow)]
+    response: Option<&'a RawValue>,
+    #[serde(borrow)]
+    item: Option<&'a RawValue>,
+    #[serde(borrow)]
+    delta: Option<JsonStr<'a>>,
+}
+
+#[derive(Debug, Deserialize)]
+struct ResponseFailed<'a> {
+    #[serde(borrow)]
+    error: Option<&'a RawValue>,
+}
+
+#[derive(Debug, Deserialize)]
+struct OutputItemAdded<'a> {
+    #[serde(rename = "type", borrow)]
+    kind: Option<JsonStr<'a>>,
+    #[serde(borrow)]
+    id: Option<JsonStr<'a>>,
 }
 
 #[derive(Debug, Deserialize)]
@@ -481,8 +547,7 @@ async fn process_sse<S>(
             }
         };
 
-        let raw = sse.data.clone();
-        trace!("SSE event: {}", raw);
+        trace!("SSE event: {}", sse.data);
 
         let event: SseEvent = match serde_json::from_str(&sse.data) {
             Ok(event) => event,
@@ -513,7 +578,7 @@ async fn process_sse<S>(
             // drop the duplicated list inside `response.completed`.
             "response.output_item.done" => {
                 let Some(item_val) = event.item else { continue };
-                let Ok(item) = serde_json::from_value::<ResponseItem>(item_val) else {
+                let Ok(item) = serde_json::from_str::<ResponseItem>(item_val.get()) else {
                     debug!("failed to parse ResponseItem from output_item.done");
                     continue;
                 };
@@ -525,7 +590,7 @@ async fn process_sse<S>(
             }
             "response.output_text.delta" => {
                 if let Some(delta) = event.delta {
-                    let event = ResponseEvent::OutputTextDelta(delta);
+                    let event = ResponseEvent::OutputTextDelta(delta.into_owned());
                     if tx_event.send(Ok(event)).await.is_err() {
                         return;
                     }
@@ -533,7 +598,7 @@ async fn process_sse<S>(
             }
             "response.reasoning_summary_text.delta" => {
                 if let Some(delta) = event.delta {
-                    let event = ResponseEvent::ReasoningSummaryDelta(delta);
+                    let event = ResponseEvent::ReasoningSummaryDelta(delta.into_owned());
                     if tx_event.send(Ok(event)).await.is_err() {
                         return;
                     }
@@ -541,7 +606,7 @@ async fn process_sse<S>(
             }
             "response.reasoning_text.delta" => {
                 if let Some(delta) = event.delta {
-                    let event = ResponseEvent::ReasoningContentDelta(delta);
+                    let event = ResponseEvent::ReasoningContentDelta(delta.into_owned());
                     if tx_event.send(Ok(event)).await.is_err() {
                         return;
                     }
@@ -559,10 +624,12 @@ async fn process_sse<S>(
                         None,
                     ));
 
-                    let error = resp_val.get("error");
+                    let error = serde_json::from_str::<ResponseFailed>(resp_val.get())
+                        .ok()
+                        .and_then(|failed| failed.error);
 
                     if let Some(error) = error {
-                        match serde_json::from_value::<Error>(error.clone()) {
+                        match serde_json::from_str::<Error>(error.get()) {
                             Ok(error) => {
                                 let message = error.message.unwrap_or_default();
                                 response_error = Some(CodexErr::Stream(message, None));
@@ -577,7 +644,7 @@ async fn process_sse<S>(
             // Final response completed – includes array of output items & id
             "response.completed" => {
                 if let Some(resp_val) = event.response {
-                    match serde_json::from_value::<ResponseCompleted>(resp_val) {
+                    match serde_json::from_str::<ResponseCompleted>(resp_val.get()) {
                         Ok(r) => {
                             response_completed = Some(r);
                         }
@@ -595,16 +662,14 @@ async fn process_sse<S>(
             | "response.in_progress"
             | "response.output_text.done" => {}
             "response.output_item.added" => {
-                if let Some(item) = event.item.as_ref() {
+                if let Some(item) = event.item
+                    && let Ok(item) = serde_json::from_str::<OutputItemAdded>(item.get())
+                {
                     // Detect web_search_call begin and forward a synthetic event upstream.
-                    if let Some(ty) = item.get("type").and_then(|v| v.as_str())
+                    if let Some(ty) = item.kind.as_ref().map(JsonStr::as_str)
                         && ty == "web_search_call"
                     {
-                        let call_id = item
-                            .get("id")
-                            .and_then(|v| v.as_str())
-                            .unwrap_or("")
-                            .to_string();
+                        let call_id = item.id.map(JsonStr::into_owned).unwrap_or_default();
                         let ev = ResponseEvent::WebSearchCallBegin { call_id };
                         if tx_event.send(Ok(ev)).await.is_err() {
                             return;
@@ -625,13 +690,77 @@ async fn process_sse<S>(
     }
 }
 
-/// used in tests to stream from a text SSE file
+static FIXTURE_CURSORS: LazyLock<Mutex<HashMap<Uuid, Weak<Mutex<FixtureCursor>>>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+/// Returns the fixture cursor shared by every client of session
+/// `session_id`, so that a turn with overridden settings, which gets its own
+/// client, continues where the previous turn stopped.
+fn fixture_cursor_for_session(session_id: Uuid) -> Arc<Mutex<FixtureCursor>> {
+    let mut cursors = FIXTURE_CURSORS
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner);
+    if let Some(cursor) = cursors.get(&session_id).and_then(Weak::upgrade) {
+        return cursor;
+    }
+    cursors.retain(|_, cursor| cursor.strong_count() > 0);
+    let cursor = Arc::new(Mutex::new(FixtureCursor::default()));
+    cursors.insert(session_id, Arc::downgrade(&cursor));
+    cursor
+}
+
+/// Which recorded turn a session's next request is answered with.
+#[derive(Debug, Default)]
+struct FixtureCursor {
+    /// Index of the last request and the input it was sent with.
+    last: Option<(usize, Vec<Arc<ResponseItem>>)>,
+}
+
+impl FixtureCursor {
+    /// Returns the index of the request that sends `input`. A retry sends
+    /// the same input as the request before it and gets the same turn.
+    fn request_for(&mut self, input: &[Arc<ResponseItem>]) -> usize {
+        let request = match &self.last {
+            Some((request, last_input)) if last_input.as_slice() == input => return *request,
+            Some((request, _)) => request + 1,
+            None => 0,
+        };
+        self.last = Some((request, input.to_vec()));
+        request
+    }
+}
+
+/// Picks the fixture for the next request. `path` is either a single SSE file,
+/// which answers every request, or a directory of recorded turns, in which case
+/// the n-th request gets the n-th `.sse` file by name and the last one is
+/// repeated once they run out.
+fn fixture_for_next_request(path: &Path, request: usize) -> std::io::Result<PathBuf> {
+    if !path.is_dir() {
+        return Ok(path.to_path_buf());
+    }
+    let mut turns: Vec<PathBuf> = std::fs::read_dir(path)?
+        .filter_map(|entry| entry.ok().map(|entry| entry.path()))
+        .filter(|path| path.extension().is_some_and(|ext| ext == "sse"))
+        .collect();
+    turns.sort();
+    let len = turns.len();
+    match len {
+        0 => Err(std::io::Error::new(
+            std::io::ErrorKind::NotFound,
+            format!("no .sse fixtures in {}", path.display()),
+        )),
+        _ => Ok(turns.swap_remove(request.min(len - 1))),
+    }
+}
+
+/// used in tests to stream from a text SSE file or a directory of them
 async fn stream_from_fixture(
     path: impl AsRef<Path>,
+    request: usize,
     provider: ModelProviderInfo,
 ) -> Result<ResponseStream> {
     let (tx_event, rx_event) = mpsc::channel::<Result<ResponseEvent>>(1600);
-    let f = std::fs::File::open(path.as_ref())?;
+    let f = std::fs::File::open(fixture_for_next_request(path.as_ref(), request)?)?;
     let lines = std::io::BufReader::new(f).lines();
 
     // insert \n\n after each line for proper SSE parsing
@@ -651,9 +780,24 @@ async fn stream_from_fixture(
     Ok(ResponseStream { rx_event })
 }
 
+/// Parses a recorded Responses API stream and returns how many events it
+/// produced. Exposed for the `codex-bench` benchmarks.
+#[cfg(feature = "bench")]
+pub async fn count_sse_events(chunks: Vec<Bytes>) -> usize {
+    let (tx, mut rx) = mpsc::channel::<Result<ResponseEvent>>(1600);
+    let stream = futures::stream::iter(chunks.into_iter().map(Ok));
+    tokio::spawn(process_sse(stream, tx, Duration::from_secs(5)));
+    let mut events = 0;
+    while let Some(Ok(_)) = rx.recv().await {
+        events += 1;
+    }
+    events
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
+    use codex_protocol::models::ContentItem;
     use serde_json::json;
     use tokio::sync::mpsc;
     use tokio_test::io::Builder as IoBuilder;
@@ -764,6 +908,8 @@ mod tests {
             request_max_retries: Some(0),
             stream_max_retries: Some(0),
             stream_idle_timeout_ms: Some(1000),
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
 
@@ -824,6 +970,8 @@ mod tests {
             request_max_retries: Some(0),
             stream_max_retries: Some(0),
             stream_idle_timeout_ms: Some(1000),
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
 
@@ -858,6 +1006,8 @@ mod tests {
             request_max_retries: Some(0),
             stream_max_retries: Some(0),
             stream_idle_timeout_ms: Some(1000),
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
 
@@ -963,6 +1113,8 @@ mod tests {
                 request_max_retries: Some(0),
                 stream_max_retries: Some(0),
                 stream_idle_timeout_ms: Some(1000),
+                pool_max_idle_per_host: None,
+                preconnect: false,
                 requires_openai_auth: false,
             };
 
@@ -975,4 +1127,112 @@ mod tests {
             );
         }
     }
+
+    /// Reads one of the recorded streams in `tests/fixtures` and splits it into
+    /// network-sized chunks.
+    fn recorded_stream(name: &str) -> Vec<Bytes> {
+        let path = Path::new(env!("CARGO_MANIFEST_DIR"))
+            .join("tests/fixtures")
+            .join(name);
+        let data = Bytes::from(std::fs::read(path).expect("read fixture"));
+        data.chunks(1024).map(|c| data.slice_ref(c)).collect()
+    }
+
+    #[tokio::test]
+    async fn parses_recorded_stream() {
+        let (tx, mut rx) = mpsc::channel::<Result<ResponseEvent>>(1600);
+        let stream =
+            futures::stream::iter(recorded_stream("responses_stream.sse").into_iter().map(Ok));
+        tokio::spawn(process_sse(stream, tx, Duration::from_secs(5)));
+
+        let mut summary = String::new();
+        let mut text = String::new();
+        let mut items = Vec::new();
+        let mut completed = None;
+        while let Some(ev) = rx.recv().await {
+            match ev.expect("event") {
+                ResponseEvent::ReasoningSummaryDelta(delta) => summary.push_str(&delta),
+                ResponseEvent::OutputTextDelta(delta) => text.push_str(&delta),
+                ResponseEvent::OutputItemDone(item) => items.push(item),
+                ResponseEvent::Completed {
+                    response_id,
+                    token_usage,
+                } => completed = Some((response_id, token_usage)),
+                _ => {}
+            }
+        }
+
+        assert!(summary.starts_with("**Inspecting the repository**\n\n"));
+        assert!(summary.ends_with("read the \"README\" first."));
+        let [
+            ResponseItem::Reasoning { .. },
+            ResponseItem::Message { content, .. },
+        ] = items.as_slice()
+        else {
+            panic!("unexpected items: {items:?}");
+        };
+        assert_eq!(
+            content.as_slice(),
+            [ContentItem::OutputText { text: text.clone() }]
+        );
+        assert!(text.contains("```sh\ncd codex-rs\n"));
+
+        let (response_id, token_usage) = completed.expect("completed");
+        assert_eq!(response_id, "resp_fixture");
+        let token_usage = token_usage.expect("usage");
+        assert_eq!(token_usage.cached_input_tokens, Some(1024));
+        assert_eq!(token_usage.total_tokens, 1616);
+    }
+
+    #[test]
+    fn fixture_directory_serves_one_turn_per_request() {
+        let dir = tempfile::tempdir().expect("tempdir");
+        for name in ["002.sse", "001.sse", "notes.txt"] {
+            std::fs::write(dir.path().join(name), "").expect("write fixture");
+        }
+
+        let served: Vec<PathBuf> = (0..3)
+            .map(|request| fixture_for_next_request(dir.path(), request).expect("fixture"))
+            .collect();
+        assert_eq!(
+            served,
+            vec![
+                dir.path().join("001.sse"),
+                dir.path().join("002.sse"),
+                dir.path().join("002.sse"),
+            ]
+        );
+
+        let file = dir.path().join("001.sse");
+        assert_eq!(fixture_for_next_request(&file, 5).expect("fixture"), file);
+    }
+
+    #[test]
+    fn fixture_cursor_is_per_session_and_repeats_retries() {
+        let message = |text: &str| {
+            Arc::new(ResponseItem::Message {
+                id: None,
+                role: "user".to_string(),
+                content: vec![ContentItem::InputText {
+                    text: text.to_string(),
+                }],
+            })
+        };
+        let first = vec![message("first")];
+        let second = vec![message("first"), message("second")];
+
+        let session = Uuid::new_v4();
+        let cursor = fixture_cursor_for_session(session);
+        assert_eq!(cursor.lock().unwrap().request_for(&first), 0);
+        assert_eq!(cursor.lock().unwrap().request_for(&first), 0);
+        assert_eq!(cursor.lock().unwrap().request_for(&second), 1);
+
+        // A client rebuilt for an overridden turn continues the session.
+        let rebuilt = fixture_cursor_for_session(session);
+        assert!(Arc::ptr_eq(&cursor, &rebuilt));
+
+        // Another conversation starts from its first recorded turn.
+        let other = fixture_cursor_for_session(Uuid::new_v4());
+        assert_eq!(other.lock().unwrap().request_for(&second), 0);
+    }
 }
@@ -9,9 +9,11 @@ use codex_protocol::config_types::ReasoningSummary as ReasoningSummaryConfig;
 use codex_protocol::models::ContentItem;
 use codex_protocol::models::ResponseItem;
 use futures::Stream;
+use serde::Deserialize;
 use serde::Serialize;
 use std::borrow::Cow;
 use std::pin::Pin;
+use std::sync::Arc;
 use std::task::Context;
 use std::task::Poll;
 use tokio::sync::mpsc;
@@ -27,8 +29,8 @@ const USER_INSTRUCTIONS_END: &str = "\n\n</user_instructions>";
 /// API request payload for a single model turn
 #[derive(Default, Debug, Clone)]
 pub struct Prompt {
-    /// Conversation context input items.
-    pub input: Vec<ResponseItem>,
+    /// Conversation context input items, shared with the conversation history.
+    pub input: Vec<Arc<ResponseItem>>,
 
     /// Whether to store response on server side (disable_response_storage = !store).
     pub store: bool,
@@ -65,8 +67,8 @@ impl Prompt {
         Cow::Owned(sections.join("\n"))
     }
 
-    pub(crate) fn get_formatted_input(&self) -> Vec<ResponseItem> {
-        self.input.clone()
+    pub(crate) fn get_formatted_input(&self) -> &[Arc<ResponseItem>] {
+        &self.input
     }
 
     /// Creates a formatted user instructions message from a string
@@ -98,7 +100,7 @@ pub enum ResponseEvent {
     },
 }
 
-#[derive(Debug, Serialize)]
+#[derive(Debug, Serialize, Clone)]
 pub(crate) struct Reasoning {
     pub(crate) effort: ReasoningEffortConfig,
     pub(crate) summary: ReasoningSummaryConfig,
@@ -132,14 +134,14 @@ impl From<VerbosityConfig> for OpenAiVerbosity {
 
 /// Request object that is serialized as JSON and POST'ed when using the
 /// Responses API.
-#[derive(Debug, Serialize)]
+#[derive(Debug, Serialize, Clone)]
 pub(crate) struct ResponsesApiRequest<'a> {
     pub(crate) model: &'a str,
     pub(crate) instructions: &'a str,
     // TODO(mbolin): ResponseItem::Other should not be serialized. Currently,
     // we code defensively to avoid this case, but perhaps we should use a
     // separate enum for serialization.
-    pub(crate) input: &'a Vec<ResponseItem>,
+    pub(crate) input: &'a [Arc<ResponseItem>],
     pub(crate) tools: &'a [serde_json::Value],
     pub(crate) tool_choice: &'static str,
     pub(crate) parallel_tool_calls: bool,
@@ -186,6 +188,23 @@ impl Stream for ResponseStream {
     }
 }
 
+/// A JSON string field of a streamed event. It borrows from the event's data
+/// unless the string contains escape sequences, so parsing the many small
+/// delta events does not allocate for every field.
+#[derive(Debug, Deserialize)]
+#[serde(transparent)]
+pub(crate) struct JsonStr<'a>(#[serde(borrow)] pub(crate) Cow<'a, str>);
+
+impl JsonStr<'_> {
+    pub(crate) fn as_str(&self) -> &str {
+        &self.0
+    }
+
+    pub(crate) fn into_owned(self) -> String {
+        self.0.into_owned()
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use crate::model_family::find_family_for_model;
@@ -205,7 +224,7 @@ mod tests {
 
     #[test]
     fn serializes_text_verbosity_when_set() {
-        let input: Vec<ResponseItem> = vec![];
+        let input: Vec<Arc<ResponseItem>> = vec![];
         let tools: Vec<serde_json::Value> = vec![];
         let req = ResponsesApiRequest {
             model: "gpt-5",
@@ -235,7 +254,7 @@ mod tests {
 
     #[test]
     fn omits_text_when_not_set() {
-        let input: Vec<ResponseItem> = vec![];
+        let input: Vec<Arc<ResponseItem>> = vec![];
         let tools: Vec<serde_json::Value> = vec![];
         let req = ResponsesApiRequest {
             model: "gpt-5",
@@ -255,4 +274,21 @@ mod tests {
         let v = serde_json::to_value(&req).expect("json");
         assert!(v.get("text").is_none());
     }
+
+    #[test]
+    fn json_str_borrows_unescaped_strings() {
+        #[derive(Deserialize)]
+        struct Event<'a> {
+            #[serde(borrow)]
+            plain: JsonStr<'a>,
+            #[serde(borrow)]
+            escaped: JsonStr<'a>,
+        }
+
+        let data = r#"{"plain":"hello","escaped":"a\nb"}"#;
+        let event: Event = serde_json::from_str(data).expect("parse");
+        assert!(matches!(event.plain.0, Cow::Borrowed("hello")));
+        assert!(matches!(event.escaped.0, Cow::Owned(_)));
+        assert_eq!(event.escaped.as_str(), "a\nb");
+    }
 }
@@ -7,6 +7,7 @@ use std::sync::Mutex;
 use std::sync::MutexGuard;
 use std::sync::atomic::AtomicU64;
 use std::time::Duration;
+use std::time::Instant;
 
 use async_channel::Receiver;
 use async_channel::Sender;
@@ -19,14 +20,17 @@ use codex_protocol::protocol::TaskStartedEvent;
 use codex_protocol::protocol::TurnAbortReason;
 use codex_protocol::protocol::TurnAbortedEvent;
 use futures::prelude::*;
+use futures::stream::FuturesUnordered;
 use mcp_types::CallToolResult;
 use serde::Serialize;
 use serde_json;
 use tokio::sync::oneshot;
 use tokio::task::AbortHandle;
+use tracing::Instrument;
 use tracing::debug;
 use tracing::error;
 use tracing::info;
+use tracing::info_span;
 use tracing::trace;
 use tracing::warn;
 use uuid::Uuid;
@@ -48,8 +52,14 @@ use crate::error::CodexErr;
 use crate::error::Result as CodexResult;
 use crate::error::SandboxErr;
 use crate::error::get_error_message_ui;
+use crate::event_queue;
+use crate::event_queue::EVENT_QUEUE_CAPACITY;
+use crate::event_queue::EventQueueStats;
+use crate::event_queue::EventReceiver;
+use crate::event_queue::EventSender;
 use crate::exec::ExecParams;
 use crate::exec::ExecToolCallOutput;
+use crate::exec::OutputRetention;
 use crate::exec::SandboxType;
 use crate::exec::StdoutStream;
 use crate::exec::StreamOutput;
@@ -60,6 +70,10 @@ use crate::exec_command::ExecSessionManager;
 use crate::exec_command::WRITE_STDIN_TOOL_NAME;
 use crate::exec_command::WriteStdinParams;
 use crate::exec_env::create_env;
+use crate::exec_output::HeadTailBuffer;
+use crate::exec_output::HeadTailLimits;
+use crate::is_safe_command::is_known_safe_command;
+use crate::mcp_connection_manager::ClientStartErrors;
 use crate::mcp_connection_manager::McpConnectionManager;
 use crate::mcp_tool_call::handle_mcp_tool_call;
 use crate::model_family::find_family_for_model;
@@ -108,6 +122,7 @@ use crate::safety::assess_command_safety;
 use crate::safety::assess_safety_for_untrusted_command;
 use crate::shell;
 use crate::turn_diff_tracker::TurnDiffTracker;
+use crate::turn_metrics::TurnMetrics;
 use crate::user_notification::UserNotification;
 use crate::util::backoff;
 use codex_protocol::config_types::ReasoningEffort as ReasoningEffortConfig;
@@ -143,7 +158,7 @@ impl<T> MutexExt<T> for Mutex<T> {
 pub struct Codex {
     next_id: AtomicU64,
     tx_sub: Sender<Submission>,
-    rx_event: Receiver<Event>,
+    rx_event: EventReceiver,
 }
 
 /// Wrapper returned by [`Codex::spawn`] containing the spawned [`Codex`],
@@ -152,6 +167,9 @@ pub struct Codex {
 pub struct CodexSpawnOk {
     pub codex: Codex,
     pub session_id: Uuid,
+    /// MCP connections of the session, for sessions spawned later with the
+    /// same servers to share.
+    pub(crate) mcp_connection_manager: Arc<McpConnectionManager>,
 }
 
 pub(crate) const INITIAL_SUBMIT_ID: &str = "";
@@ -163,6 +181,22 @@ pub(crate) const MODEL_FORMAT_MAX_LINES: usize = 256; // lines
 pub(crate) const MODEL_FORMAT_HEAD_LINES: usize = MODEL_FORMAT_MAX_LINES / 2;
 pub(crate) const MODEL_FORMAT_TAIL_LINES: usize = MODEL_FORMAT_MAX_LINES - MODEL_FORMAT_HEAD_LINES; // 128
 pub(crate) const MODEL_FORMAT_HEAD_BYTES: usize = MODEL_FORMAT_MAX_BYTES / 2;
+/// Budgets for the output kept while a command runs; see [`HeadTailBuffer`].
+pub(crate) const MODEL_FORMAT_LIMITS: HeadTailLimits = HeadTailLimits {
+    head_bytes: MODEL_FORMAT_HEAD_BYTES,
+    tail_bytes: MODEL_FORMAT_MAX_BYTES - MODEL_FORMAT_HEAD_BYTES,
+    head_lines: MODEL_FORMAT_HEAD_LINES,
+    tail_lines: MODEL_FORMAT_TAIL_LINES,
+};
+
+/// Instructions for the turn that summarizes the history, and the user
+/// message that starts it.
+const SUMMARIZATION_PROMPT: &str = include_str!("prompt_for_compact_command.md");
+const COMPACT_REQUEST: &str = "Start Summarization";
+
+// Auto-compaction first shortens tool outputs outside the newest items.
+const UNTRIMMED_RECENT_ITEMS: usize = 8;
+const STALE_TOOL_OUTPUT_MAX_BYTES: usize = 2 * 1024;
 
 impl Codex {
     /// Spawn a new [`Codex`] and initialize the session.
@@ -170,9 +204,20 @@ impl Codex {
         config: Config,
         auth_manager: Arc<AuthManager>,
         initial_history: Option<Vec<ResponseItem>>,
+    ) -> CodexResult<CodexSpawnOk> {
+        Self::spawn_with_mcp_connection_manager(config, auth_manager, initial_history, None).await
+    }
+
+    /// Like [`Codex::spawn`], but reuses `mcp_connection_manager` instead of
+    /// connecting to the configured MCP servers, when given.
+    pub(crate) async fn spawn_with_mcp_connection_manager(
+        config: Config,
+        auth_manager: Arc<AuthManager>,
+        initial_history: Option<Vec<ResponseItem>>,
+        mcp_connection_manager: Option<Arc<McpConnectionManager>>,
     ) -> CodexResult<CodexSpawnOk> {
         let (tx_sub, rx_sub) = async_channel::bounded(SUBMISSION_CHANNEL_CAPACITY);
-        let (tx_event, rx_event) = async_channel::unbounded();
+        let (tx_event, rx_event) = event_queue::channel(EVENT_QUEUE_CAPACITY);
 
         let user_instructions = get_user_instructions(&config).await;
 
@@ -201,6 +246,7 @@ impl Codex {
             auth_manager.clone(),
             tx_event.clone(),
             initial_history,
+            mcp_connection_manager,
         )
         .await
         .map_err(|e| {
@@ -208,6 +254,7 @@ impl Codex {
             CodexErr::InternalAgentDied
         })?;
         let session_id = session.session_id;
+        let mcp_connection_manager = session.mcp_connection_manager.clone();
 
         // This task will run until Op::Shutdown is received.
         tokio::spawn(submission_loop(
@@ -222,7 +269,11 @@ impl Codex {
             rx_event,
         };
 
-        Ok(CodexSpawnOk { codex, session_id })
+        Ok(CodexSpawnOk {
+            codex,
+            session_id,
+            mcp_connection_manager,
+        })
     }
 
     /// Submit the `op` wrapped in a `Submission` with a unique ID.
@@ -251,9 +302,14 @@ impl Codex {
             .rx_event
             .recv()
             .await
-            .map_err(|_| CodexErr::InternalAgentDied)?;
+            .ok_or(CodexErr::InternalAgentDied)?;
         Ok(event)
     }
+
+    /// How far the consumer of [`Codex::next_event`] is behind the session.
+    pub fn event_queue_stats(&self) -> EventQueueStats {
+        self.rx_event.stats()
+    }
 }
 
 /// Mutable state of the agent
@@ -271,10 +327,11 @@ struct State {
 /// A session has at most 1 running task at a time, and can be interrupted by user input.
 pub(crate) struct Session {
     session_id: Uuid,
-    tx_event: Sender<Event>,
+    tx_event: EventSender,
 
-    /// Manager for external MCP servers/tools.
-    mcp_connection_manager: McpConnectionManager,
+    /// Manager for external MCP servers/tools, shared with other sessions
+    /// spawned from the same warm pool.
+    mcp_connection_manager: Arc<McpConnectionManager>,
     session_manager: ExecSessionManager,
 
     /// External notifier command (will be passed as args to exec()). When
@@ -288,6 +345,15 @@ pub(crate) struct Session {
     codex_linux_sandbox_exe: Option<PathBuf>,
     user_shell: shell::Shell,
     show_raw_agent_reasoning: bool,
+    /// Fraction of the context window at which the history is shrunk before
+    /// a turn. `None` disables auto-compaction.
+    auto_compact_fraction: Option<f64>,
+    /// How much output of each exec call is kept in memory.
+    exec_output_retention: OutputRetention,
+    /// Maximum number of read-only tool calls of a turn that run at once.
+    max_concurrent_tool_calls: usize,
+    /// Timing of the running task, reported when it completes.
+    turn_metrics: TurnMetrics,
 }
 
 /// The context needed for a single turn of the conversation.
@@ -361,8 +427,9 @@ impl Session {
         configure_session: ConfigureSession,
         config: Arc<Config>,
         auth_manager: Arc<AuthManager>,
-        tx_event: Sender<Event>,
+        tx_event: EventSender,
         initial_history: Option<Vec<ResponseItem>>,
+        shared_mcp_connection_manager: Option<Arc<McpConnectionManager>>,
     ) -> anyhow::Result<(Arc<Self>, TurnContext)> {
         let ConfigureSession {
             provider,
@@ -394,7 +461,7 @@ impl Session {
         // - load history metadata
         let rollout_fut = async {
             match resume_path.as_ref() {
-                Some(path) => RolloutRecorder::resume(path, cwd.clone())
+                Some(path) => RolloutRecorder::resume(path, cwd.clone(), config.rollout)
                     .await
                     .map(|(rec, saved)| (saved.session_id, Some(saved), rec)),
                 None => {
@@ -406,7 +473,14 @@ impl Session {
             }
         };
 
-        let mcp_fut = McpConnectionManager::new(config.mcp_servers.clone());
+        let mcp_fut = async {
+            match shared_mcp_connection_manager {
+                Some(mgr) => Ok((mgr, ClientStartErrors::default())),
+                None => McpConnectionManager::new(config.mcp_servers.clone(), &config.codex_home)
+                    .await
+                    .map(|(mgr, failures)| (Arc::new(mgr), failures)),
+            }
+        };
         let default_shell_fut = shell::default_user_shell();
         let history_meta_fut = crate::message_history::history_metadata(&config);
 
@@ -486,7 +560,10 @@ impl Session {
                     id: INITIAL_SUBMIT_ID.to_owned(),
                     msg: EventMsg::Error(ErrorEvent { message }),
                 });
-                (McpConnectionManager::default(), Default::default())
+                (
+                    Arc::new(McpConnectionManager::default()),
+                    Default::default(),
+                )
             }
         };
 
@@ -512,6 +589,7 @@ impl Session {
             model_reasoning_summary,
             session_id,
         );
+        client.spawn_preconnect();
         let turn_context = TurnContext {
             client,
             tools_config: ToolsConfig::new(&ToolsConfigParams {
@@ -543,6 +621,10 @@ impl Session {
             codex_linux_sandbox_exe: config.codex_linux_sandbox_exe.clone(),
             user_shell: default_shell,
             show_raw_agent_reasoning: config.show_raw_agent_reasoning,
+            auto_compact_fraction: config.model_auto_compact_fraction,
+            exec_output_retention: OutputRetention::from_max_bytes(config.exec_output_max_bytes),
+            max_concurrent_tool_calls: config.max_concurrent_tool_calls,
+            turn_metrics: TurnMetrics::default(),
         });
 
         // record the initial user instructions and environment context,
@@ -656,6 +738,25 @@ impl Session {
         rx_approve
     }
 
+    /// Waits for the user's review of a command or patch, counting the wait
+    /// towards the running task's approval time.
+    pub(crate) async fn wait_for_approval(
+        &self,
+        rx_approve: oneshot::Receiver<ReviewDecision>,
+    ) -> ReviewDecision {
+        let start = Instant::now();
+        let decision = rx_approve
+            .instrument(info_span!("approval_wait"))
+            .await
+            .unwrap_or_default();
+        self.turn_metrics.approval_wait(start.elapsed());
+        decision
+    }
+
+    pub(crate) fn turn_metrics(&self) -> &TurnMetrics {
+        &self.turn_metrics
+    }
+
     pub fn notify_approval(&self, sub_id: &str, decision: ReviewDecision) {
         let entry = {
             let mut state = self.state.lock_unchecked();
@@ -686,7 +787,7 @@ impl Session {
     }
 
     async fn record_state_snapshot(&self, items: &[ResponseItem]) {
-        let snapshot = { crate::rollout::SessionStateSnapshot {} };
+        let snapshot = crate::rollout::SessionStateSnapshot::default();
 
         let recorder = {
             let guard = self.rollout.lock_unchecked();
@@ -694,12 +795,65 @@ impl Session {
         };
 
         if let Some(rec) = recorder {
+            let start = Instant::now();
+            async {
+                if let Err(e) = rec.record_state(snapshot).await {
+                    error!("failed to record rollout state: {e:#}");
+                }
+                if let Err(e) = rec.record_items(items).await {
+                    error!("failed to record rollout items: {e:#}");
+                }
+            }
+            .instrument(info_span!("rollout_write", items = items.len()))
+            .await;
+            self.turn_metrics.rollout_write(start.elapsed());
+        }
+    }
+
+    /// Records the current history as a checkpoint after it was replaced, so
+    /// that resuming the session restores it instead of the items recorded
+    /// before.
+    async fn record_history_checkpoint(&self) {
+        let history: Vec<ResponseItem> = self
+            .state
+            .lock_unchecked()
+            .history
+            .contents()
+            .iter()
+            .map(|item| item.as_ref().clone())
+            .collect();
+        let recorder = {
+            let guard = self.rollout.lock_unchecked();
+            guard.as_ref().cloned()
+        };
+        if let Some(rec) = recorder {
+            let snapshot = crate::rollout::SessionStateSnapshot {
+                history: Some(history),
+                ..Default::default()
+            };
             if let Err(e) = rec.record_state(snapshot).await {
-                error!("failed to record rollout state: {e:#}");
+                error!("failed to record rollout history checkpoint: {e:#}");
             }
-            if let Err(e) = rec.record_items(items).await {
-                error!("failed to record rollout items: {e:#}");
+        }
+    }
+
+    /// Lets the rollout writer apply a per-turn fsync policy.
+    async fn end_rollout_turn(&self) {
+        let recorder = {
+            let guard = self.rollout.lock_unchecked();
+            guard.as_ref().cloned()
+        };
+
+        if let Some(rec) = recorder {
+            let start = Instant::now();
+            if let Err(e) = rec
+                .end_turn()
+                .instrument(info_span!("rollout_write", end_turn = true))
+                .await
+            {
+                error!("failed to record rollout turn end: {e:#}");
             }
+            self.turn_metrics.rollout_write(start.elapsed());
         }
     }
 
@@ -759,8 +913,10 @@ impl Session {
             aggregated_output,
             duration,
             exit_code,
+            ..
         } = output;
-        // Send full stdout/stderr to clients; do not truncate.
+        // Clients get everything the exec output store retained, which is
+        // bounded by `OutputRetention`; only the model's copy is formatted down.
         let stdout = stdout.text.clone();
         let stderr = stderr.text.clone();
         let formatted_output = format_exec_output_str(output);
@@ -822,14 +978,25 @@ impl Session {
         self.on_exec_command_begin(turn_diff_tracker, begin_ctx.clone())
             .await;
 
+        let start = Instant::now();
+        let sandbox_type = exec_args.sandbox_type;
         let result = process_exec_tool_call(
             exec_args.params,
             exec_args.sandbox_type,
             exec_args.sandbox_policy,
             exec_args.codex_linux_sandbox_exe,
             exec_args.stdout_stream,
+            exec_args.output_retention,
         )
+        .instrument(info_span!("exec_command", call_id = %call_id, sandbox = ?sandbox_type))
         .await;
+        match &result {
+            Ok(output) => self.turn_metrics.tool_call(
+                output.spawn_duration,
+                output.duration.saturating_sub(output.spawn_duration),
+            ),
+            Err(_) => self.turn_metrics.tool_call(Duration::ZERO, start.elapsed()),
+        }
 
         let output_stderr;
         let borrowed: &ExecToolCallOutput = match &result {
@@ -840,7 +1007,12 @@ impl Session {
                     stdout: StreamOutput::new(String::new()),
                     stderr: StreamOutput::new(get_error_message_ui(e)),
                     aggregated_output: StreamOutput::new(get_error_message_ui(e)),
+                    model_output: HeadTailBuffer::from_text(
+                        MODEL_FORMAT_LIMITS,
+                        &get_error_message_ui(e),
+                    ),
                     duration: Duration::default(),
+                    spawn_duration: Duration::default(),
                 };
                 &output_stderr
             }
@@ -880,10 +1052,37 @@ impl Session {
         let _ = self.tx_event.send(event).await;
     }
 
+    /// Estimated history size above which the history is shrunk before the
+    /// next turn, if auto-compaction is enabled and the context window of the
+    /// model is known.
+    fn auto_compact_token_limit(&self, turn_context: &TurnContext) -> Option<u64> {
+        let fraction = self.auto_compact_fraction?.clamp(0.0, 1.0);
+        let context_window = turn_context.client.get_model_context_window()?;
+        Some((context_window as f64 * fraction) as u64)
+    }
+
+    /// Trims stale tool outputs until the estimated history size is within
+    /// `limit`. Returns whether the history is still larger than `limit`.
+    fn trim_history_to(&self, limit: u64) -> bool {
+        let mut state = self.state.lock_unchecked();
+        if state.history.estimated_tokens() <= limit {
+            return false;
+        }
+        let freed = state
+            .history
+            .trim_stale_tool_outputs(UNTRIMMED_RECENT_ITEMS, STALE_TOOL_OUTPUT_MAX_BYTES);
+        if freed > 0 {
+            debug!("trimmed stale tool outputs, freeing ~{freed} tokens");
+        }
+        state.history.estimated_tokens() > limit
+    }
+
     /// Build the full turn input by concatenating the current conversation
     /// history with additional items for this turn.
-    pub fn turn_input_with_history(&self, extra: Vec<ResponseItem>) -> Vec<ResponseItem> {
-        [self.state.lock_unchecked().history.contents(), extra].concat()
+    pub fn turn_input_with_history(&self, extra: Vec<ResponseItem>) -> Vec<Arc<ResponseItem>> {
+        let mut input = self.state.lock_unchecked().history.contents();
+        input.extend(extra.into_iter().map(Arc::new));
+        input
     }
 
     /// Returns the input if there was no task running to inject into
@@ -999,8 +1198,11 @@ impl AgentTask {
             let sess = sess.clone();
             let sub_id = sub_id.clone();
             let tc = Arc::clone(&turn_context);
-            tokio::spawn(async move { run_task(sess, tc.as_ref(), sub_id, input).await })
-                .abort_handle()
+            let span = info_span!("task", sub_id = %sub_id);
+            tokio::spawn(
+                async move { run_task(sess, tc.as_ref(), sub_id, input).await }.instrument(span),
+            )
+            .abort_handle()
         };
         Self {
             sess,
@@ -1320,12 +1522,9 @@ async fn submission_loop(
                 }
             }
             Op::Compact => {
-                // Create a summarization request as user input
-                const SUMMARIZATION_PROMPT: &str = include_str!("prompt_for_compact_command.md");
-
                 // Attempt to inject input into current task
                 if let Err(items) = sess.inject_input(vec![InputItem::Text {
-                    text: "Start Summarization".to_string(),
+                    text: COMPACT_REQUEST.to_string(),
                 }]) {
                     let task = AgentTask::compact(
                         sess.clone(),
@@ -1375,7 +1574,14 @@ async fn submission_loop(
                     id: sub_id.clone(),
                     msg: EventMsg::ConversationHistory(ConversationHistoryResponseEvent {
                         conversation_id: sess.session_id,
-                        entries: sess.state.lock_unchecked().history.contents(),
+                        entries: sess
+                            .state
+                            .lock_unchecked()
+                            .history
+                            .contents()
+                            .iter()
+                            .map(|item| (**item).clone())
+                            .collect(),
                     }),
                 };
                 if let Err(e) = tx_event.send(event).await {
@@ -1412,6 +1618,8 @@ async fn run_task(
     if input.is_empty() {
         return;
     }
+    let rollout_turn = EndRolloutTurnOnDrop(Some(sess.clone()));
+    sess.turn_metrics.start_task();
     let event = Event {
         id: sub_id.clone(),
         msg: EventMsg::TaskStarted(TaskStartedEvent {
@@ -1422,6 +1630,34 @@ async fn run_task(
         return;
     }
 
+    if let Some(limit) = sess.auto_compact_token_limit(turn_context)
+        && sess.trim_history_to(limit)
+    {
+        // Compact before the new input is recorded so that the summary covers
+        // only what came before it and the new request is answered in full.
+        sess.notify_background_event(&sub_id, "Context window is nearly full; compacting history")
+            .await;
+        match summarize_history(
+            &sess,
+            turn_context,
+            &sub_id,
+            vec![InputItem::Text {
+                text: COMPACT_REQUEST.to_string(),
+            }],
+            SUMMARIZATION_PROMPT,
+        )
+        .await
+        {
+            Ok(()) => {}
+            Err(CodexErr::Interrupted) => return,
+            Err(e) => {
+                warn!("auto-compaction failed: {e}");
+                sess.notify_background_event(&sub_id, format!("auto-compaction failed: {e}"))
+                    .await;
+            }
+        }
+    }
+
     let initial_input_for_turn: ResponseInputItem = ResponseInputItem::from(input);
     sess.record_conversation_items(&[initial_input_for_turn.clone().into()])
         .await;
@@ -1442,16 +1678,22 @@ async fn run_task(
             .collect::<Vec<ResponseItem>>();
         sess.record_conversation_items(&pending_input).await;
 
+        // Within a task only stale tool outputs are trimmed: a summary would
+        // replace the request the model is still working on.
+        if let Some(limit) = sess.auto_compact_token_limit(turn_context) {
+            sess.trim_history_to(limit);
+        }
+
         // Construct the input that we will send to the model. When using the
         // Chat completions API (or ZDR clients), the model needs the full
         // conversation history on each turn. The rollout file, however, should
         // only record the new items that originated in this turn so that it
         // represents an append-only log without duplicates.
-        let turn_input: Vec<ResponseItem> = sess.turn_input_with_history(pending_input);
+        let turn_input: Vec<Arc<ResponseItem>> = sess.turn_input_with_history(pending_input);
 
         let turn_input_messages: Vec<String> = turn_input
             .iter()
-            .filter_map(|item| match item {
+            .filter_map(|item| match item.as_ref() {
                 ResponseItem::Message { content, .. } => Some(content),
                 _ => None,
             })
@@ -1598,7 +1840,13 @@ async fn run_task(
             }
         }
     }
+    rollout_turn.end_turn().await;
     sess.remove_task(&sub_id);
+    let event = Event {
+        id: sub_id.clone(),
+        msg: EventMsg::TurnMetrics(sess.turn_metrics.finish_task()),
+    };
+    sess.tx_event.send(event).await.ok();
     let event = Event {
         id: sub_id,
         msg: EventMsg::TaskComplete(TaskCompleteEvent { last_agent_message }),
@@ -1606,12 +1854,32 @@ async fn run_task(
     sess.tx_event.send(event).await.ok();
 }
 
+/// Ends the rollout turn of a task even when `run_task` returns early or the
+/// task is aborted, so that the `turn` fsync policy covers those turns too.
+struct EndRolloutTurnOnDrop(Option<Arc<Session>>);
+
+impl EndRolloutTurnOnDrop {
+    async fn end_turn(mut self) {
+        if let Some(sess) = self.0.take() {
+            sess.end_rollout_turn().await;
+        }
+    }
+}
+
+impl Drop for EndRolloutTurnOnDrop {
+    fn drop(&mut self) {
+        if let Some(sess) = self.0.take() {
+            tokio::spawn(async move { sess.end_rollout_turn().await });
+        }
+    }
+}
+
 async fn run_turn(
     sess: &Session,
     turn_context: &TurnContext,
     turn_diff_tracker: &mut TurnDiffTracker,
     sub_id: String,
-    input: Vec<ResponseItem>,
+    input: Vec<Arc<ResponseItem>>,
 ) -> CodexResult<Vec<ProcessedResponseItem>> {
     let tools = get_openai_tools(
         &turn_context.tools_config,
@@ -1627,7 +1895,10 @@ async fn run_turn(
 
     let mut retries = 0;
     loop {
-        match try_run_turn(sess, turn_context, turn_diff_tracker, &sub_id, &prompt).await {
+        match try_run_turn(sess, turn_context, turn_diff_tracker, &sub_id, &prompt)
+            .instrument(info_span!("turn_attempt", attempt = retries + 1))
+            .await
+        {
             Ok(output) => return Ok(output),
             Err(CodexErr::Interrupted) => return Err(CodexErr::Interrupted),
             Err(CodexErr::EnvVar(var)) => return Err(CodexErr::EnvVar(var)),
@@ -1658,6 +1929,7 @@ async fn run_turn(
                     )
                     .await;
 
+                    sess.turn_metrics.retry(delay);
                     tokio::time::sleep(delay).await;
                 } else {
                     return Err(e);
@@ -1688,7 +1960,7 @@ async fn try_run_turn(
     let completed_call_ids = prompt
         .input
         .iter()
-        .filter_map(|ri| match ri {
+        .filter_map(|ri| match ri.as_ref() {
             ResponseItem::FunctionCallOutput { call_id, .. } => Some(call_id),
             ResponseItem::LocalShellCall {
                 call_id: Some(call_id),
@@ -1706,7 +1978,7 @@ async fn try_run_turn(
         prompt
             .input
             .iter()
-            .filter_map(|ri| match ri {
+            .filter_map(|ri| match ri.as_ref() {
                 ResponseItem::FunctionCall { call_id, .. } => Some(call_id),
                 ResponseItem::LocalShellCall {
                     call_id: Some(call_id),
@@ -1722,9 +1994,11 @@ async fn try_run_turn(
                     Some(call_id.clone())
                 }
             })
-            .map(|call_id| ResponseItem::CustomToolCallOutput {
-                call_id: call_id.clone(),
-                output: "aborted".to_string(),
+            .map(|call_id| {
+                Arc::new(ResponseItem::CustomToolCallOutput {
+                    call_id: call_id.clone(),
+                    output: "aborted".to_string(),
+                })
             })
             .collect::<Vec<_>>()
     };
@@ -1739,18 +2013,49 @@ async fn try_run_turn(
         })
     };
 
-    let mut stream = turn_context.client.clone().stream(&prompt).await?;
-
-    let mut output = Vec::new();
+    let load_wait = turn_context
+        .client
+        .wait_for_model_load()
+        .instrument(info_span!("model_load_wait"))
+        .await;
+    sess.turn_metrics.model_load_wait(load_wait);
+    sess.turn_metrics.model_request_started();
+    let request_started = Instant::now();
+    // Entered only while the request is sent and while the stream is polled,
+    // so tool calls handled between events do not count as model time.
+    let model_span = info_span!("model_request");
+    let mut stream = turn_context
+        .client
+        .clone()
+        .stream(&prompt)
+        .instrument(model_span.clone())
+        .await?;
+
+    let mut output: Vec<ProcessedResponseItem> = Vec::new();
+    let mut running = RunningCalls::new();
+    let mut output_started = false;
 
     loop {
         // Poll the next item from the model stream. We must inspect *both* Ok and Err
         // cases so that transient stream failures (e.g., dropped SSE connection before
         // `response.completed`) bubble up and trigger the caller's retry logic.
-        let event = stream.next().await;
+        //
+        // Concurrent calls keep running meanwhile; record each one as it
+        // finishes so that its slot frees up.
+        let event = tokio::select! {
+            finished = running.next(), if !running.is_empty() => {
+                running.record(finished, &mut output);
+                if running.has_failed() {
+                    running.finish_all(&mut output).await?;
+                }
+                continue;
+            }
+            event = stream.next().instrument(model_span.clone()) => event,
+        };
         let Some(event) = event else {
             // Channel closed without yielding a final Completed event or explicit error.
             // Treat as a disconnected stream so the caller can retry.
+            running.drain(&mut output).await;
             return Err(CodexErr::Stream(
                 "stream closed before response.completed".into(),
                 None,
@@ -1762,22 +2067,71 @@ async fn try_run_turn(
             Err(e) => {
                 // Propagate the underlying stream error to the caller (run_turn), which
                 // will apply the configured `stream_max_retries` policy.
+                running.drain(&mut output).await;
                 return Err(e);
             }
         };
+        if !output_started && !matches!(event, ResponseEvent::Created) {
+            output_started = true;
+            sess.turn_metrics.model_output_started();
+        }
 
         match event {
             ResponseEvent::Created => {}
             ResponseEvent::OutputItemDone(item) => {
-                let response = handle_response_item(
-                    sess,
-                    turn_context,
-                    turn_diff_tracker,
-                    sub_id,
-                    item.clone(),
-                )
-                .await?;
-                output.push(ProcessedResponseItem { item, response });
+                match tool_call_scheduling(&sess.mcp_connection_manager, &item) {
+                    ToolCallScheduling::Concurrent { server } => {
+                        // Wait for a free slot and for the running calls this one
+                        // must not overlap with.
+                        while running.must_wait(server.as_deref(), sess.max_concurrent_tool_calls) {
+                            let finished = running.next().await;
+                            running.record(finished, &mut output);
+                            if running.has_failed() {
+                                running.finish_all(&mut output).await?;
+                            }
+                        }
+                        let index = output.len();
+                        output.push(ProcessedResponseItem {
+                            item: item.clone(),
+                            response: None,
+                        });
+                        running.push(index, server, async move {
+                            // Read-only calls never apply patches, so they do not
+                            // need the turn's diff tracker.
+                            let mut turn_diff_tracker = TurnDiffTracker::new();
+                            let response = handle_response_item(
+                                sess,
+                                turn_context,
+                                &mut turn_diff_tracker,
+                                sub_id,
+                                item,
+                            )
+                            .await;
+                            (index, response)
+                        });
+                    }
+                    scheduling => {
+                        if scheduling == ToolCallScheduling::Serial {
+                            running.finish_all(&mut output).await?;
+                        }
+                        let response = match handle_response_item(
+                            sess,
+                            turn_context,
+                            turn_diff_tracker,
+                            sub_id,
+                            item.clone(),
+                        )
+                        .await
+                        {
+                            Ok(response) => response,
+                            Err(e) => {
+                                running.drain(&mut output).await;
+                                return Err(e);
+                            }
+                        };
+                        output.push(ProcessedResponseItem { item, response });
+                    }
+                }
             }
             ResponseEvent::WebSearchCallBegin { call_id } => {
                 let _ = sess
@@ -1792,6 +2146,10 @@ async fn try_run_turn(
                 response_id: _,
                 token_usage,
             } => {
+                sess.turn_metrics
+                    .model_request_completed(request_started.elapsed());
+                running.finish_all(&mut output).await?;
+
                 if let Some(token_usage) = token_usage {
                     sess.tx_event
                         .send(Event {
@@ -1850,6 +2208,164 @@ async fn try_run_turn(
     }
 }
 
+/// How a response item from the model is scheduled relative to the tool calls
+/// before it in the same turn.
+#[derive(Debug, PartialEq)]
+enum ToolCallScheduling {
+    /// Not a tool call; handled as soon as it arrives.
+    Inline,
+    /// Runs on its own, after every earlier call has finished.
+    Serial,
+    /// May run alongside other calls of the same kind: read-only shell
+    /// commands (`server` is `None`) with each other, MCP tool calls with
+    /// earlier calls to other servers. See [`RunningCalls::must_wait`].
+    Concurrent { server: Option<String> },
+}
+
+/// Calls run concurrently only when their relative order cannot matter: shell
+/// commands on the known-safe list, which are read-only and never need
+/// approval, among themselves, and MCP tool calls to different servers among
+/// themselves. An MCP tool call may write, so it never overlaps a shell
+/// command. Everything else, including `apply_patch` and commands that could
+/// write or need approval, keeps the serial order.
+fn tool_call_scheduling(mcp: &McpConnectionManager, item: &ResponseItem) -> ToolCallScheduling {
+    let read_only_shell = |command: &[String], with_escalated_permissions: Option<bool>| {
+        if is_known_safe_command(command) && !with_escalated_permissions.unwrap_or(false) {
+            ToolCallScheduling::Concurrent { server: None }
+        } else {
+            ToolCallScheduling::Serial
+        }
+    };
+    match item {
+        ResponseItem::FunctionCall {
+            name, arguments, ..
+        } => match name.as_str() {
+            "container.exec" | "shell" => {
+                match serde_json::from_str::<ShellToolCallParams>(arguments) {
+                    Ok(params) => {
+                        read_only_shell(&params.command, params.with_escalated_permissions)
+                    }
+                    Err(_) => ToolCallScheduling::Serial,
+                }
+            }
+            "view_image"
+            | "apply_patch"
+            | "update_plan"
+            | EXEC_COMMAND_TOOL_NAME
+            | WRITE_STDIN_TOOL_NAME => ToolCallScheduling::Serial,
+            _ => match mcp.parse_tool_name(name) {
+                Some((server, _)) => ToolCallScheduling::Concurrent {
+                    server: Some(server),
+                },
+                None => ToolCallScheduling::Serial,
+            },
+        },
+        ResponseItem::LocalShellCall {
+            action: LocalShellAction::Exec(action),
+            ..
+        } => read_only_shell(&action.command, None),
+        ResponseItem::CustomToolCall { .. } => ToolCallScheduling::Serial,
+        _ => ToolCallScheduling::Inline,
+    }
+}
+
+type CallResult = (usize, CodexResult<Option<ResponseInputItem>>);
+
+/// Tool calls of the current turn that run concurrently with the model stream
+/// and with each other. Each call knows the index of its item in the turn's
+/// output, so responses are recorded in call order whatever order they finish
+/// in.
+struct RunningCalls<F> {
+    calls: FuturesUnordered<F>,
+    /// MCP server of each running call that has one, by output index.
+    servers: HashMap<usize, String>,
+    /// First error returned by a call, reported once every call has finished.
+    error: Option<CodexErr>,
+}
+
+impl<F: Future<Output = CallResult>> RunningCalls<F> {
+    fn new() -> Self {
+        Self {
+            calls: FuturesUnordered::new(),
+            servers: HashMap::new(),
+            error: None,
+        }
+    }
+
+    fn is_empty(&self) -> bool {
+        self.calls.is_empty()
+    }
+
+    /// Whether a call to MCP `server`, or a read-only shell command if `None`,
+    /// has to wait for a running call to finish before it starts: when
+    /// `max_running` calls are running, when a call to the same server is
+    /// running, or when a call of the other kind is. MCP tools may write, so
+    /// a shell read issued after one must see its effects, and one issued
+    /// after a shell read must not change what the read sees.
+    fn must_wait(&self, server: Option<&str>, max_running: usize) -> bool {
+        if self.calls.len() >= max_running {
+            return true;
+        }
+        match server {
+            None => !self.servers.is_empty(),
+            Some(server) => {
+                self.servers.len() < self.calls.len() || self.servers.values().any(|s| s == server)
+            }
+        }
+    }
+
+    fn push(&mut self, index: usize, server: Option<String>, call: F) {
+        if let Some(server) = server {
+            self.servers.insert(index, server);
+        }
+        self.calls.push(call);
+    }
+
+    /// Waits for the next call to finish; `None` if none are running.
+    async fn next(&mut self) -> Option<CallResult> {
+        self.calls.next().await
+    }
+
+    /// Records the response of a finished call, or keeps its error until
+    /// [`Self::finish_all`].
+    fn record(&mut self, finished: Option<CallResult>, output: &mut [ProcessedResponseItem]) {
+        let Some((index, response)) = finished else {
+            return;
+        };
+        self.servers.remove(&index);
+        match response {
+            Ok(response) => output[index].response = response,
+            Err(e) => {
+                if self.error.is_none() {
+                    self.error = Some(e);
+                }
+            }
+        }
+    }
+
+    fn has_failed(&self) -> bool {
+        self.error.is_some()
+    }
+
+    /// Waits for every running call and returns the first error any call
+    /// returned.
+    async fn finish_all(&mut self, output: &mut [ProcessedResponseItem]) -> CodexResult<()> {
+        while let Some(finished) = self.next().await {
+            self.record(Some(finished), output);
+        }
+        self.error.take().map_or(Ok(()), Err)
+    }
+
+    /// Waits for every running call before the turn ends early with another
+    /// error. Dropping the calls instead would cancel commands halfway, and
+    /// their end events would never be sent.
+    async fn drain(&mut self, output: &mut [ProcessedResponseItem]) {
+        if let Err(e) = self.finish_all(output).await {
+            warn!("tool call failed while the turn was ending: {e}");
+        }
+    }
+}
+
 async fn run_compact_task(
     sess: Arc<Session>,
     turn_context: &TurnContext,
@@ -1868,32 +2384,72 @@ async fn run_compact_task(
         return;
     }
 
+    match summarize_history(&sess, turn_context, &sub_id, input, &compact_instructions).await {
+        Ok(()) => {}
+        Err(CodexErr::Interrupted) => return,
+        Err(e) => {
+            let event = Event {
+                id: sub_id.clone(),
+                msg: EventMsg::Error(ErrorEvent {
+                    message: e.to_string(),
+                }),
+            };
+            sess.send_event(event).await;
+            return;
+        }
+    }
+
+    sess.remove_task(&sub_id);
+
+    let event = Event {
+        id: sub_id.clone(),
+        msg: EventMsg::AgentMessage(AgentMessageEvent {
+            message: "Compact task completed".to_string(),
+        }),
+    };
+    sess.send_event(event).await;
+    let event = Event {
+        id: sub_id.clone(),
+        msg: EventMsg::TaskComplete(TaskCompleteEvent {
+            last_agent_message: None,
+        }),
+    };
+    sess.send_event(event).await;
+}
+
+/// Asks the model to summarize the history, retrying stream errors, and
+/// replaces the history with the summary.
+async fn summarize_history(
+    sess: &Session,
+    turn_context: &TurnContext,
+    sub_id: &str,
+    input: Vec<InputItem>,
+    compact_instructions: &str,
+) -> CodexResult<()> {
     let initial_input_for_turn: ResponseInputItem = ResponseInputItem::from(input);
-    let turn_input: Vec<ResponseItem> =
-        sess.turn_input_with_history(vec![initial_input_for_turn.clone().into()]);
+    let turn_input: Vec<Arc<ResponseItem>> =
+        sess.turn_input_with_history(vec![initial_input_for_turn.into()]);
 
     let prompt = Prompt {
         input: turn_input,
         store: !turn_context.disable_response_storage,
         tools: Vec::new(),
-        base_instructions_override: Some(compact_instructions.clone()),
+        base_instructions_override: Some(compact_instructions.to_string()),
     };
 
     let max_retries = turn_context.client.get_provider().stream_max_retries();
     let mut retries = 0;
 
     loop {
-        let attempt_result = drain_to_completed(&sess, turn_context, &sub_id, &prompt).await;
-
-        match attempt_result {
+        match drain_to_completed(sess, turn_context, sub_id, &prompt).await {
             Ok(()) => break,
-            Err(CodexErr::Interrupted) => return,
+            Err(CodexErr::Interrupted) => return Err(CodexErr::Interrupted),
             Err(e) => {
                 if retries < max_retries {
                     retries += 1;
                     let delay = backoff(retries);
                     sess.notify_stream_error(
-                        &sub_id,
+                        sub_id,
                         format!(
                             "stream error: {e}; retrying {retries}/{max_retries} in {delay:?}…"
                         ),
@@ -1902,40 +2458,15 @@ async fn run_compact_task(
                     tokio::time::sleep(delay).await;
                     continue;
                 } else {
-                    let event = Event {
-                        id: sub_id.clone(),
-                        msg: EventMsg::Error(ErrorEvent {
-                            message: e.to_string(),
-                        }),
-                    };
-                    sess.send_event(event).await;
-                    return;
+                    return Err(e);
                 }
             }
         }
     }
 
-    sess.remove_task(&sub_id);
-
-    {
-        let mut state = sess.state.lock_unchecked();
-        state.history.keep_last_messages(1);
-    }
-
-    let event = Event {
-        id: sub_id.clone(),
-        msg: EventMsg::AgentMessage(AgentMessageEvent {
-            message: "Compact task completed".to_string(),
-        }),
-    };
-    sess.send_event(event).await;
-    let event = Event {
-        id: sub_id.clone(),
-        msg: EventMsg::TaskComplete(TaskCompleteEvent {
-            last_agent_message: None,
-        }),
-    };
-    sess.send_event(event).await;
+    sess.state.lock_unchecked().history.keep_last_messages(1);
+    sess.record_history_checkpoint().await;
+    Ok(())
 }
 
 async fn handle_response_item(
@@ -2352,6 +2883,7 @@ pub struct ExecInvokeArgs<'a> {
     pub sandbox_policy: &'a SandboxPolicy,
     pub codex_linux_sandbox_exe: &'a Option<PathBuf>,
     pub stdout_stream: Option<StdoutStream>,
+    pub output_retention: OutputRetention,
 }
 
 fn maybe_translate_shell_command(
@@ -2484,7 +3016,7 @@ async fn handle_container_exec_with_params(
                     params.justification.clone(),
                 )
                 .await;
-            match rx_approve.await.unwrap_or_default() {
+            match sess.wait_for_approval(rx_approve).await {
                 ReviewDecision::Approved => (),
                 ReviewDecision::ApprovedForSession => {
                     sess.add_approved_command(params.command.clone());
@@ -2551,6 +3083,7 @@ async fn handle_container_exec_with_params(
                         tx_event: sess.tx_event.clone(),
                     })
                 },
+                output_retention: sess.exec_output_retention,
             },
         )
         .await;
@@ -2657,7 +3190,7 @@ async fn handle_sandbox_error(
         )
         .await;
 
-    match rx_approve.await.unwrap_or_default() {
+    match sess.wait_for_approval(rx_approve).await {
         ReviewDecision::Approved | ReviewDecision::ApprovedForSession => {
             // Persist this command as pre‑approved for the
             // remainder of the session so future
@@ -2688,6 +3221,7 @@ async fn handle_sandbox_error(
                                 tx_event: sess.tx_event.clone(),
                             })
                         },
+                        output_retention: sess.exec_output_retention,
                     },
                 )
                 .await;
@@ -2730,104 +3264,16 @@ async fn handle_sandbox_error(
 }
 
 fn format_exec_output_str(exec_output: &ExecToolCallOutput) -> String {
-    let ExecToolCallOutput {
-        aggregated_output, ..
-    } = exec_output;
-
     // Head+tail truncation for the model: show the beginning and end with an elision.
     // Clients still receive full streams; only this formatted summary is capped.
-
-    let s = aggregated_output.text.as_str();
-    let total_lines = s.lines().count();
-    if s.len() <= MODEL_FORMAT_MAX_BYTES && total_lines <= MODEL_FORMAT_MAX_LINES {
-        return s.to_string();
-    }
-
-    let lines: Vec<&str> = s.lines().collect();
-    let head_take = MODEL_FORMAT_HEAD_LINES.min(lines.len());
-    let tail_take = MODEL_FORMAT_TAIL_LINES.min(lines.len().saturating_sub(head_take));
-    let omitted = lines.len().saturating_sub(head_take + tail_take);
-
-    // Join head and tail blocks (lines() strips newlines; reinsert them)
-    let head_block = lines
-        .iter()
-        .take(head_take)
-        .cloned()
-        .collect::<Vec<_>>()
-        .join("\n");
-    let tail_block = if tail_take > 0 {
-        lines[lines.len() - tail_take..].join("\n")
-    } else {
-        String::new()
-    };
-    let marker = format!("\n[... omitted {omitted} of {total_lines} lines ...]\n\n");
-
-    // Byte budgets for head/tail around the marker
-    let mut head_budget = MODEL_FORMAT_HEAD_BYTES.min(MODEL_FORMAT_MAX_BYTES);
-    let tail_budget = MODEL_FORMAT_MAX_BYTES.saturating_sub(head_budget + marker.len());
-    if tail_budget == 0 && marker.len() >= MODEL_FORMAT_MAX_BYTES {
-        // Degenerate case: marker alone exceeds budget; return a clipped marker
-        return take_bytes_at_char_boundary(&marker, MODEL_FORMAT_MAX_BYTES).to_string();
-    }
-    if tail_budget == 0 {
-        // Make room for the marker by shrinking head
-        head_budget = MODEL_FORMAT_MAX_BYTES.saturating_sub(marker.len());
-    }
-
-    // Enforce line-count cap by trimming head/tail lines
-    let head_lines_text = head_block;
-    let tail_lines_text = tail_block;
-    // Build final string respecting byte budgets
-    let head_part = take_bytes_at_char_boundary(&head_lines_text, head_budget);
-    let mut result = String::with_capacity(MODEL_FORMAT_MAX_BYTES.min(s.len()));
-    result.push_str(head_part);
-    result.push_str(&marker);
-
-    let remaining = MODEL_FORMAT_MAX_BYTES.saturating_sub(result.len());
-    let tail_budget_final = remaining;
-    let tail_part = take_last_bytes_at_char_boundary(&tail_lines_text, tail_budget_final);
-    result.push_str(tail_part);
-
-    result
-}
-
-// Truncate a &str to a byte budget at a char boundary (prefix)
-#[inline]
-fn take_bytes_at_char_boundary(s: &str, maxb: usize) -> &str {
-    if s.len() <= maxb {
-        return s;
-    }
-    let mut last_ok = 0;
-    for (i, ch) in s.char_indices() {
-        let nb = i + ch.len_utf8();
-        if nb > maxb {
-            break;
-        }
-        last_ok = nb;
-    }
-    &s[..last_ok]
-}
-
-// Take a suffix of a &str within a byte budget at a char boundary
-#[inline]
-fn take_last_bytes_at_char_boundary(s: &str, maxb: usize) -> &str {
-    if s.len() <= maxb {
-        return s;
-    }
-    let mut start = s.len();
-    let mut used = 0usize;
-    for (i, ch) in s.char_indices().rev() {
-        let nb = ch.len_utf8();
-        if used + nb > maxb {
-            break;
-        }
-        start = i;
-        used += nb;
-        if start == 0 {
-            break;
-        }
-    }
-    &s[start..]
+    exec_output
+        .model_output
+        .render(MODEL_FORMAT_MAX_BYTES, |elision| {
+            format!(
+                "[... omitted {} of {} lines ...]\n",
+                elision.omitted_lines, elision.total_lines
+            )
+        })
 }
 
 /// Exec output is a pre-serialized JSON payload
@@ -3019,7 +3465,9 @@ mod tests {
             stdout: StreamOutput::new(String::new()),
             stderr: StreamOutput::new(String::new()),
             aggregated_output: StreamOutput::new(full.clone()),
+            model_output: HeadTailBuffer::from_text(MODEL_FORMAT_LIMITS, &full),
             duration: StdDuration::from_secs(1),
+            spawn_duration: StdDuration::ZERO,
         };
 
         let out = format_exec_output_str(&exec);
@@ -3061,7 +3509,9 @@ mod tests {
             stdout: StreamOutput::new(String::new()),
             stderr: StreamOutput::new(String::new()),
             aggregated_output: StreamOutput::new(full.clone()),
+            model_output: HeadTailBuffer::from_text(MODEL_FORMAT_LIMITS, &full),
             duration: StdDuration::from_secs(1),
+            spawn_duration: StdDuration::ZERO,
         };
 
         let out = format_exec_output_str(&exec);
@@ -3135,4 +3585,116 @@ mod tests {
 
         assert_eq!(expected, got);
     }
+
+    fn shell_call(arguments: serde_json::Value) -> ResponseItem {
+        ResponseItem::FunctionCall {
+            id: None,
+            name: "shell".to_string(),
+            arguments: arguments.to_string(),
+            call_id: "call".to_string(),
+        }
+    }
+
+    #[test]
+    fn only_read_only_calls_are_scheduled_concurrently() {
+        let mcp = McpConnectionManager::default();
+        let concurrent = ToolCallScheduling::Concurrent { server: None };
+
+        let read_only = shell_call(json!({"command": ["bash", "-lc", "rg foo | head -n 5"]}));
+        assert_eq!(tool_call_scheduling(&mcp, &read_only), concurrent);
+        let read_only = shell_call(json!({"command": ["cat", "README.md"]}));
+        assert_eq!(tool_call_scheduling(&mcp, &read_only), concurrent);
+
+        let writes = shell_call(json!({"command": ["touch", "file"]}));
+        assert_eq!(
+            tool_call_scheduling(&mcp, &writes),
+            ToolCallScheduling::Serial
+        );
+        let escalated = shell_call(json!({
+            "command": ["ls"],
+            "with_escalated_permissions": true,
+        }));
+        assert_eq!(
+            tool_call_scheduling(&mcp, &escalated),
+            ToolCallScheduling::Serial
+        );
+
+        let patch = ResponseItem::CustomToolCall {
+            id: None,
+            status: None,
+            call_id: "call".to_string(),
+            name: "apply_patch".to_string(),
+            input: String::new(),
+        };
+        assert_eq!(
+            tool_call_scheduling(&mcp, &patch),
+            ToolCallScheduling::Serial
+        );
+
+        let message = ResponseItem::Message {
+            id: None,
+            role: "assistant".to_string(),
+            content: Vec::new(),
+        };
+        assert_eq!(
+            tool_call_scheduling(&mcp, &message),
+            ToolCallScheduling::Inline
+        );
+    }
+    type TestCall = std::pin::Pin<Box<dyn Future<Output = CallResult>>>;
+
+    fn running_forever() -> TestCall {
+        Box::pin(std::future::pending())
+    }
+
+    #[test]
+    fn mcp_calls_and_shell_reads_never_overlap() {
+        // An MCP call that may write is running: a later shell read waits for
+        // it, and so does a later call to the same server.
+        let mut running = RunningCalls::<TestCall>::new();
+        running.push(0, Some("fs".to_string()), running_forever());
+        assert!(running.must_wait(None, 8));
+        assert!(running.must_wait(Some("fs"), 8));
+        assert!(!running.must_wait(Some("other"), 8));
+
+        // A shell read is running: a later MCP call waits for it, while other
+        // reads only need a free slot.
+        let mut running = RunningCalls::<TestCall>::new();
+        running.push(0, None, running_forever());
+        assert!(running.must_wait(Some("fs"), 8));
+        assert!(!running.must_wait(None, 8));
+        assert!(running.must_wait(None, 1));
+    }
+
+    #[tokio::test]
+    async fn running_calls_all_finish_before_the_first_error_is_reported() {
+        let output_item = |call_id: &str| ProcessedResponseItem {
+            item: shell_call(json!({"command": ["ls"]})),
+            response: Some(ResponseInputItem::FunctionCallOutput {
+                call_id: call_id.to_string(),
+                output: FunctionCallOutputPayload {
+                    content: String::new(),
+                    success: None,
+                },
+            }),
+        };
+        let mut output = vec![output_item("a"), output_item("b")];
+        let mut running = RunningCalls::<TestCall>::new();
+        running.push(0, None, Box::pin(async { (0, Err(CodexErr::Interrupted)) }));
+        running.push(
+            1,
+            None,
+            Box::pin(async {
+                tokio::task::yield_now().await;
+                (1, Ok(None))
+            }),
+        );
+
+        let result = running.finish_all(&mut output).await;
+
+        assert!(matches!(result, Err(CodexErr::Interrupted)));
+        assert!(running.is_empty());
+        // The call that succeeded after the failure was still recorded.
+        assert!(output[1].response.is_none());
+    }
 }
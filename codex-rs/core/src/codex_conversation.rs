@@ -1,5 +1,6 @@
 use crate::codex::Codex;
 use crate::error::Result as CodexResult;
+use crate::event_queue::EventQueueStats;
 use crate::protocol::Event;
 use crate::protocol::Op;
 use crate::protocol::Submission;
@@ -27,4 +28,8 @@ impl CodexConversation {
     pub async fn next_event(&self) -> CodexResult<Event> {
         self.codex.next_event().await
     }
+
+    pub fn event_queue_stats(&self) -> EventQueueStats {
+        self.codex.event_queue_stats()
+    }
 }
@@ -1,12 +1,14 @@
 use crate::config_profile::ConfigProfile;
 use crate::config_types::History;
 use crate::config_types::McpServerConfig;
+use crate::config_types::Rollout;
 use crate::config_types::SandboxWorkspaceWrite;
 use crate::config_types::ShellEnvironmentPolicy;
 use crate::config_types::ShellEnvironmentPolicyToml;
 use crate::config_types::Tui;
 use crate::config_types::UriBasedFileOpener;
 use crate::config_types::Verbosity;
+use crate::exec::DEFAULT_EXEC_OUTPUT_MAX_BYTES;
 use crate::git_info::resolve_root_git_project_for_trust;
 use crate::model_family::ModelFamily;
 use crate::model_family::find_family_for_model;
@@ -35,6 +37,9 @@ const OPENAI_DEFAULT_MODEL: &str = "gpt-5";
 /// the context window.
 pub(crate) const PROJECT_DOC_MAX_BYTES: usize = 32 * 1024; // 32 KiB
 
+/// Default number of read-only tool calls of a turn that may run at once.
+pub(crate) const DEFAULT_MAX_CONCURRENT_TOOL_CALLS: usize = 4;
+
 const CONFIG_TOML_FILE: &str = "config.toml";
 
 const DEFAULT_RESPONSES_ORIGINATOR_HEADER: &str = "codex_cli_rs";
@@ -53,6 +58,10 @@ pub struct Config {
     /// Maximum number of output tokens.
     pub model_max_output_tokens: Option<u64>,
 
+    /// Fraction of `model_context_window` at which the history is shrunk
+    /// automatically before the next turn. `None` disables auto-compaction.
+    pub model_auto_compact_fraction: Option<f64>,
+
     /// Key into the model_providers map that specifies which provider to use.
     pub model_provider_id: String,
 
@@ -122,6 +131,24 @@ pub struct Config {
     /// Maximum number of bytes to include from an AGENTS.md project doc file.
     pub project_doc_max_bytes: usize,
 
+    /// Maximum number of bytes of a command's combined stdout/stderr kept in
+    /// memory while it runs; the rest of the middle is dropped.
+    pub exec_output_max_bytes: usize,
+
+    /// Maximum number of read-only tool calls of one turn that run at the same
+    /// time. `1` runs every call in order.
+    pub max_concurrent_tool_calls: usize,
+
+    /// Number of sessions the conversation manager keeps spawned ahead of
+    /// time for each config it recently created a conversation with. `0`
+    /// disables the pool.
+    pub conversation_pool_size: usize,
+
+    /// How long Ollama keeps the `--oss` model loaded after the warm-up
+    /// request, in Ollama's `keep_alive` format (e.g. `"30m"`). `None` leaves
+    /// it to the server's default.
+    pub oss_keep_alive: Option<String>,
+
     /// Directory containing all Codex state (defaults to `~/.codex` but can be
     /// overridden by the `CODEX_HOME` environment variable).
     pub codex_home: PathBuf,
@@ -129,6 +156,9 @@ pub struct Config {
     /// Settings that govern if and what will be written to `~/.codex/history.jsonl`.
     pub history: History,
 
+    /// Durability settings for the session rollout files.
+    pub rollout: Rollout,
+
     /// Optional URI-based file opener. If set, citations to files in the model
     /// output will be hyperlinked using the specified URI scheme.
     pub file_opener: UriBasedFileOpener,
@@ -402,6 +432,11 @@ pub struct ConfigToml {
     /// Maximum number of output tokens.
     pub model_max_output_tokens: Option<u64>,
 
+    /// Fraction of the context window at which the history is shrunk
+    /// automatically: stale tool outputs are trimmed first, and the history is
+    /// compacted if that is not enough.
+    pub model_auto_compact_fraction: Option<f64>,
+
     /// Default approval policy for executing commands.
     pub approval_policy: Option<AskForApproval>,
 
@@ -437,6 +472,18 @@ pub struct ConfigToml {
     /// Maximum number of bytes to include from an AGENTS.md project doc file.
     pub project_doc_max_bytes: Option<usize>,
 
+    /// Maximum number of bytes of a command's output kept in memory.
+    pub exec_output_max_bytes: Option<usize>,
+
+    /// Maximum number of read-only tool calls of one turn that run at once.
+    pub max_concurrent_tool_calls: Option<usize>,
+
+    /// Number of sessions to keep spawned ahead of time per config.
+    pub conversation_pool_size: Option<usize>,
+
+    /// `keep_alive` sent with the warm-up request for the `--oss` model.
+    pub oss_keep_alive: Option<String>,
+
     /// Profile to use from the `profiles` map.
     pub profile: Option<String>,
 
@@ -448,6 +495,9 @@ pub struct ConfigToml {
     #[serde(default)]
     pub history: Option<History>,
 
+    /// Durability settings for the session rollout files.
+    pub rollout: Option<Rollout>,
+
     /// Optional URI-based file opener. If set, citations to files in the model
     /// output will be hyperlinked using the specified URI scheme.
     pub file_opener: Option<UriBasedFileOpener>,
@@ -751,6 +801,7 @@ impl Config {
             model_family,
             model_context_window,
             model_max_output_tokens,
+            model_auto_compact_fraction: cfg.model_auto_compact_fraction,
             model_provider_id,
             model_provider,
             cwd: resolved_cwd,
@@ -771,8 +822,18 @@ impl Config {
             mcp_servers: cfg.mcp_servers,
             model_providers,
             project_doc_max_bytes: cfg.project_doc_max_bytes.unwrap_or(PROJECT_DOC_MAX_BYTES),
+            exec_output_max_bytes: cfg
+                .exec_output_max_bytes
+                .unwrap_or(DEFAULT_EXEC_OUTPUT_MAX_BYTES),
+            max_concurrent_tool_calls: cfg
+                .max_concurrent_tool_calls
+                .unwrap_or(DEFAULT_MAX_CONCURRENT_TOOL_CALLS)
+                .max(1),
+            conversation_pool_size: cfg.conversation_pool_size.unwrap_or(0),
+            oss_keep_alive: cfg.oss_keep_alive,
             codex_home,
             history,
+            rollout: cfg.rollout.unwrap_or_default(),
             file_opener: cfg.file_opener.unwrap_or(UriBasedFileOpener::VsCode),
             tui: cfg.tui.unwrap_or_default(),
             codex_linux_sandbox_exe,
@@ -1086,6 +1147,8 @@ disable_response_storage = true
             request_max_retries: Some(4),
             stream_max_retries: Some(10),
             stream_idle_timeout_ms: Some(300_000),
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
         let model_provider_map = {
@@ -1144,6 +1207,7 @@ disable_response_storage = true
                 model_family: find_family_for_model("o3").expect("known model slug"),
                 model_context_window: Some(200_000),
                 model_max_output_tokens: Some(100_000),
+                model_auto_compact_fraction: None,
                 model_provider_id: "openai".to_string(),
                 model_provider: fixture.openai_provider.clone(),
                 approval_policy: AskForApproval::Never,
@@ -1156,8 +1220,13 @@ disable_response_storage = true
                 mcp_servers: HashMap::new(),
                 model_providers: fixture.model_provider_map.clone(),
                 project_doc_max_bytes: PROJECT_DOC_MAX_BYTES,
+                exec_output_max_bytes: DEFAULT_EXEC_OUTPUT_MAX_BYTES,
+                max_concurrent_tool_calls: DEFAULT_MAX_CONCURRENT_TOOL_CALLS,
+                conversation_pool_size: 0,
+                oss_keep_alive: None,
                 codex_home: fixture.codex_home(),
                 history: History::default(),
+                rollout: Rollout::default(),
                 file_opener: UriBasedFileOpener::VsCode,
                 tui: Tui::default(),
                 codex_linux_sandbox_exe: None,
@@ -1202,6 +1271,7 @@ disable_response_storage = true
             model_family: find_family_for_model("gpt-3.5-turbo").expect("known model slug"),
             model_context_window: Some(16_385),
             model_max_output_tokens: Some(4_096),
+            model_auto_compact_fraction: None,
             model_provider_id: "openai-chat-completions".to_string(),
             model_provider: fixture.openai_chat_completions_provider.clone(),
             approval_policy: AskForApproval::UnlessTrusted,
@@ -1214,8 +1284,13 @@ disable_response_storage = true
             mcp_servers: HashMap::new(),
             model_providers: fixture.model_provider_map.clone(),
             project_doc_max_bytes: PROJECT_DOC_MAX_BYTES,
+            exec_output_max_bytes: DEFAULT_EXEC_OUTPUT_MAX_BYTES,
+            max_concurrent_tool_calls: DEFAULT_MAX_CONCURRENT_TOOL_CALLS,
+            conversation_pool_size: 0,
+            oss_keep_alive: None,
             codex_home: fixture.codex_home(),
             history: History::default(),
+            rollout: Rollout::default(),
             file_opener: UriBasedFileOpener::VsCode,
             tui: Tui::default(),
             codex_linux_sandbox_exe: None,
@@ -1275,6 +1350,7 @@ disable_response_storage = true
             model_family: find_family_for_model("o3").expect("known model slug"),
             model_context_window: Some(200_000),
             model_max_output_tokens: Some(100_000),
+            model_auto_compact_fraction: None,
             model_provider_id: "openai".to_string(),
             model_provider: fixture.openai_provider.clone(),
             approval_policy: AskForApproval::OnFailure,
@@ -1287,8 +1363,13 @@ disable_response_storage = true
             mcp_servers: HashMap::new(),
             model_providers: fixture.model_provider_map.clone(),
             project_doc_max_bytes: PROJECT_DOC_MAX_BYTES,
+            exec_output_max_bytes: DEFAULT_EXEC_OUTPUT_MAX_BYTES,
+            max_concurrent_tool_calls: DEFAULT_MAX_CONCURRENT_TOOL_CALLS,
+            conversation_pool_size: 0,
+            oss_keep_alive: None,
             codex_home: fixture.codex_home(),
             history: History::default(),
+            rollout: Rollout::default(),
             file_opener: UriBasedFileOpener::VsCode,
             tui: Tui::default(),
             codex_linux_sandbox_exe: None,
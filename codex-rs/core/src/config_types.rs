@@ -74,6 +74,41 @@ pub enum HistoryPersistence {
     None,
 }
 
+/// Settings for the session rollout files written to `~/.codex/sessions`.
+#[derive(Deserialize, Debug, Copy, Clone, PartialEq, Eq)]
+#[serde(default)]
+pub struct Rollout {
+    /// When written items are fsynced to disk.
+    pub fsync: RolloutFsync,
+
+    /// Minimum time between two fsyncs when `fsync` is `interval`.
+    pub fsync_interval_ms: u64,
+}
+
+impl Default for Rollout {
+    fn default() -> Self {
+        Self {
+            fsync: RolloutFsync::default(),
+            fsync_interval_ms: 1_000,
+        }
+    }
+}
+
+#[derive(Deserialize, Debug, Copy, Clone, PartialEq, Eq, Default)]
+#[serde(rename_all = "kebab-case")]
+pub enum RolloutFsync {
+    /// Never fsync; every batch is only flushed to the OS, which writes the
+    /// file back when it sees fit.
+    #[default]
+    Never,
+    /// fsync after every batch of items is written.
+    Item,
+    /// fsync once at the end of every turn.
+    Turn,
+    /// fsync at most once every `fsync_interval_ms`.
+    Interval,
+}
+
 /// Collection of settings that are specific to the TUI.
 #[derive(Deserialize, Debug, Clone, PartialEq, Default)]
 pub struct Tui {}
@@ -1,19 +1,37 @@
+use std::sync::Arc;
+
+use codex_protocol::models::FunctionCallOutputPayload;
 use codex_protocol::models::ResponseItem;
 
+use crate::exec_output::HeadTailBuffer;
+use crate::exec_output::HeadTailLimits;
+use crate::token_estimator::estimate_tokens;
+
 /// Transcript of conversation history
+///
+/// Items are shared behind `Arc`s so that building a prompt from the
+/// transcript, which happens on every turn, only copies pointers; the items
+/// themselves (some of which hold large tool outputs) are never cloned again
+/// after they have been recorded.
 #[derive(Debug, Clone, Default)]
 pub(crate) struct ConversationHistory {
     /// The oldest items are at the beginning of the vector.
-    items: Vec<ResponseItem>,
+    items: Vec<Arc<ResponseItem>>,
+    /// Sum of [`estimate_tokens`] over `items`, kept up to date as items are
+    /// recorded so that checking it before every turn is free.
+    estimated_tokens: u64,
 }
 
 impl ConversationHistory {
     pub(crate) fn new() -> Self {
-        Self { items: Vec::new() }
+        Self {
+            items: Vec::new(),
+            estimated_tokens: 0,
+        }
     }
 
-    /// Returns a clone of the contents in the transcript.
-    pub(crate) fn contents(&self) -> Vec<ResponseItem> {
+    /// Returns the contents of the transcript. Only the `Arc`s are cloned.
+    pub(crate) fn contents(&self) -> Vec<Arc<ResponseItem>> {
         self.items.clone()
     }
 
@@ -28,39 +46,111 @@ impl ConversationHistory {
                 continue;
             }
 
-            self.items.push(item.clone());
+            self.estimated_tokens += estimate_tokens(&item);
+            self.items.push(Arc::new(item.clone()));
+        }
+    }
+
+    /// Estimated number of tokens the transcript occupies in the context
+    /// window.
+    pub(crate) fn estimated_tokens(&self) -> u64 {
+        self.estimated_tokens
+    }
+
+    /// Shortens the output of every tool call except those among the newest
+    /// `keep_recent` items to at most `max_output_bytes`, keeping its first
+    /// and last lines. Old outputs are rarely looked at again by the model,
+    /// so this reclaims most of the context they occupy without losing the
+    /// conversation itself. Returns the number of estimated tokens freed.
+    pub(crate) fn trim_stale_tool_outputs(
+        &mut self,
+        keep_recent: usize,
+        max_output_bytes: usize,
+    ) -> u64 {
+        let stale = self.items.len().saturating_sub(keep_recent);
+        let mut freed = 0;
+        for item in &mut self.items[..stale] {
+            let trimmed = match item.as_ref() {
+                ResponseItem::FunctionCallOutput { call_id, output }
+                    if output.content.len() > max_output_bytes =>
+                {
+                    ResponseItem::FunctionCallOutput {
+                        call_id: call_id.clone(),
+                        output: FunctionCallOutputPayload {
+                            content: trim_output(&output.content, max_output_bytes),
+                            success: output.success,
+                        },
+                    }
+                }
+                ResponseItem::CustomToolCallOutput { call_id, output }
+                    if output.len() > max_output_bytes =>
+                {
+                    ResponseItem::CustomToolCallOutput {
+                        call_id: call_id.clone(),
+                        output: trim_output(output, max_output_bytes),
+                    }
+                }
+                _ => continue,
+            };
+            let before = estimate_tokens(item);
+            let after = estimate_tokens(&trimmed);
+            *item = Arc::new(trimmed);
+            freed += before.saturating_sub(after);
         }
+        self.estimated_tokens = self.estimated_tokens.saturating_sub(freed);
+        freed
     }
 
     pub(crate) fn keep_last_messages(&mut self, n: usize) {
         if n == 0 {
             self.items.clear();
+            self.estimated_tokens = 0;
             return;
         }
 
         // Collect the last N message items (assistant/user), newest to oldest.
-        let mut kept: Vec<ResponseItem> = Vec::with_capacity(n);
+        let mut kept: Vec<Arc<ResponseItem>> = Vec::with_capacity(n);
         for item in self.items.iter().rev() {
-            if let ResponseItem::Message { role, content, .. } = item {
-                kept.push(ResponseItem::Message {
+            let kept_item = match item.as_ref() {
+                // Already in the shape we keep, so it can be shared.
+                ResponseItem::Message { id: None, .. } => item.clone(),
+                ResponseItem::Message { role, content, .. } => Arc::new(ResponseItem::Message {
                     // we need to remove the id or the model will complain that messages are sent without
                     // their reasonings
                     id: None,
                     role: role.clone(),
                     content: content.clone(),
-                });
-                if kept.len() == n {
-                    break;
-                }
+                }),
+                _ => continue,
+            };
+            kept.push(kept_item);
+            if kept.len() == n {
+                break;
             }
         }
 
         // Preserve chronological order (oldest to newest) within the kept slice.
         kept.reverse();
         self.items = kept;
+        self.estimated_tokens = self.items.iter().map(|item| estimate_tokens(item)).sum();
     }
 }
 
+fn trim_output(output: &str, max_bytes: usize) -> String {
+    let limits = HeadTailLimits {
+        head_bytes: max_bytes / 2,
+        tail_bytes: max_bytes - max_bytes / 2,
+        head_lines: usize::MAX,
+        tail_lines: usize::MAX,
+    };
+    HeadTailBuffer::from_text(limits, output).render(max_bytes, |elision| {
+        format!(
+            "[... omitted {} bytes of old tool output ...]",
+            elision.omitted_bytes
+        )
+    })
+}
+
 /// Anything that is not a system message or "reasoning" message is considered
 /// an API message.
 fn is_api_message(message: &ResponseItem) -> bool {
@@ -119,7 +209,7 @@ mod tests {
         let a = assistant_msg("hello");
         h.record_items([&u, &a]);
 
-        let items = h.contents();
+        let items: Vec<ResponseItem> = h.contents().iter().map(|i| (**i).clone()).collect();
         assert_eq!(
             items,
             vec![
@@ -140,4 +230,103 @@ mod tests {
             ]
         );
     }
+
+    #[test]
+    fn contents_share_recorded_items() {
+        let mut h = ConversationHistory::default();
+        h.record_items([&user_msg("hi"), &assistant_msg("hello")]);
+
+        let first = h.contents();
+        let second = h.contents();
+        assert!(first.iter().zip(&second).all(|(a, b)| Arc::ptr_eq(a, b)));
+    }
+
+    #[test]
+    fn keep_last_messages_drops_ids_and_other_items() {
+        let mut h = ConversationHistory::default();
+        let with_id = ResponseItem::Message {
+            id: Some("msg_1".to_string()),
+            role: "assistant".to_string(),
+            content: vec![ContentItem::OutputText {
+                text: "first".to_string(),
+            }],
+        };
+        let reasoning = ResponseItem::Reasoning {
+            id: "r_1".to_string(),
+            summary: Vec::new(),
+            content: None,
+            encrypted_content: None,
+        };
+        h.record_items([&user_msg("q"), &with_id, &reasoning, &user_msg("last")]);
+
+        h.keep_last_messages(2);
+
+        let items: Vec<ResponseItem> = h.contents().iter().map(|i| (**i).clone()).collect();
+        assert_eq!(items, vec![assistant_msg("first"), user_msg("last")]);
+        assert_eq!(
+            h.estimated_tokens(),
+            estimate_tokens(&assistant_msg("first")) + estimate_tokens(&user_msg("last"))
+        );
+    }
+
+    #[test]
+    fn keep_no_messages_resets_the_estimate() {
+        let mut h = ConversationHistory::default();
+        h.record_items([&user_msg("q"), &assistant_msg("a")]);
+
+        h.keep_last_messages(0);
+
+        assert!(h.contents().is_empty());
+        assert_eq!(h.estimated_tokens(), 0);
+    }
+
+    fn tool_output(call_id: &str, content: String) -> ResponseItem {
+        ResponseItem::FunctionCallOutput {
+            call_id: call_id.to_string(),
+            output: FunctionCallOutputPayload {
+                content,
+                success: Some(true),
+            },
+        }
+    }
+
+    #[test]
+    fn estimated_tokens_track_recorded_items() {
+        let mut h = ConversationHistory::default();
+        let u = user_msg("hi");
+        let out = tool_output("call_1", "x".repeat(1000));
+        h.record_items([&u, &out]);
+        assert_eq!(
+            h.estimated_tokens(),
+            estimate_tokens(&u) + estimate_tokens(&out)
+        );
+    }
+
+    #[test]
+    fn trims_only_stale_oversized_tool_outputs() {
+        let mut h = ConversationHistory::default();
+        let long = (0..1000).map(|i| format!("line {i}\n")).collect::<String>();
+        h.record_items([
+            &tool_output("old", long.clone()),
+            &tool_output("small", "ok".to_string()),
+            &user_msg("next"),
+            &tool_output("recent", long.clone()),
+        ]);
+        let before = h.estimated_tokens();
+
+        let freed = h.trim_stale_tool_outputs(1, 256);
+
+        assert!(freed > 0);
+        assert_eq!(h.estimated_tokens(), before - freed);
+        let items = h.contents();
+        let ResponseItem::FunctionCallOutput { output, .. } = items[0].as_ref() else {
+            panic!("expected a tool output");
+        };
+        assert!(output.content.len() <= 256);
+        assert!(output.content.starts_with("line 0\n"));
+        assert!(output.content.contains("bytes of old tool output"));
+        assert!(output.content.ends_with("line 999\n"));
+        assert_eq!(*items[1], tool_output("small", "ok".to_string()));
+        assert_eq!(*items[3], tool_output("recent", long));
+    }
 }
@@ -1,9 +1,15 @@
 use std::collections::HashMap;
+use std::collections::VecDeque;
 use std::sync::Arc;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::time::Duration;
+use std::time::Instant;
 
 use codex_login::AuthManager;
 use codex_login::CodexAuth;
 use tokio::sync::RwLock;
+use tracing::warn;
 use uuid::Uuid;
 
 use crate::codex::Codex;
@@ -13,6 +19,7 @@ use crate::codex_conversation::CodexConversation;
 use crate::config::Config;
 use crate::error::CodexErr;
 use crate::error::Result as CodexResult;
+use crate::mcp_connection_manager::McpConnectionManager;
 use crate::protocol::Event;
 use crate::protocol::EventMsg;
 use crate::protocol::SessionConfiguredEvent;
@@ -31,6 +38,7 @@ pub struct NewConversation {
 pub struct ConversationManager {
     conversations: Arc<RwLock<HashMap<Uuid, Arc<CodexConversation>>>>,
     auth_manager: Arc<AuthManager>,
+    warm_pool: Option<Arc<WarmPool>>,
 }
 
 impl ConversationManager {
@@ -38,9 +46,24 @@ impl ConversationManager {
         Self {
             conversations: Arc::new(RwLock::new(HashMap::new())),
             auth_manager,
+            warm_pool: None,
         }
     }
 
+    /// Keep up to `size` pre-spawned conversations per configuration ready so
+    /// that [`ConversationManager::new_conversation`] does not have to wait for
+    /// session startup (MCP servers, rollout file, AGENTS.md discovery). A
+    /// `size` of zero disables the pool.
+    pub fn with_warm_pool(mut self, size: usize) -> Self {
+        self.warm_pool = (size > 0).then(|| Arc::new(WarmPool::new(size)));
+        self
+    }
+
+    /// Number of pre-spawned conversations currently waiting to be handed out.
+    pub fn warm_conversations(&self) -> usize {
+        self.warm_pool.as_ref().map_or(0, |pool| pool.ready_len())
+    }
+
     /// Construct with a dummy AuthManager containing the provided CodexAuth.
     /// Used for integration tests: should not be used by ordinary business logic.
     pub fn with_auth(auth: CodexAuth) -> Self {
@@ -48,55 +71,76 @@ impl ConversationManager {
     }
 
     pub async fn new_conversation(&self, config: Config) -> CodexResult<NewConversation> {
-        self.spawn_conversation(config, self.auth_manager.clone())
-            .await
+        let Some(pool) = &self.warm_pool else {
+            return self
+                .spawn_conversation(config, self.auth_manager.clone(), None)
+                .await;
+        };
+
+        if let Some(warm) = pool.take(&config) {
+            pool.replenish(&config, &self.auth_manager);
+            return Ok(self
+                .register(warm.codex, warm.conversation_id, warm.session_configured)
+                .await);
+        }
+
+        let shared = pool.mcp_connection_manager(&config);
+        let is_first_for_config = shared.is_none();
+        let CodexSpawnOk {
+            codex,
+            session_id: conversation_id,
+            mcp_connection_manager,
+        } = Codex::spawn_with_mcp_connection_manager(
+            config.clone(),
+            self.auth_manager.clone(),
+            None,
+            shared,
+        )
+        .await?;
+        if is_first_for_config {
+            pool.insert_slot(&config, mcp_connection_manager);
+        }
+        pool.replenish(&config, &self.auth_manager);
+        let session_configured = first_session_configured(&codex).await?;
+        Ok(self
+            .register(codex, conversation_id, session_configured)
+            .await)
     }
 
     async fn spawn_conversation(
         &self,
         config: Config,
         auth_manager: Arc<AuthManager>,
+        initial_history: Option<Vec<ResponseItem>>,
     ) -> CodexResult<NewConversation> {
         let CodexSpawnOk {
             codex,
             session_id: conversation_id,
-        } = {
-            let initial_history = None;
-            Codex::spawn(config, auth_manager, initial_history).await?
-        };
-        self.finalize_spawn(codex, conversation_id).await
+            ..
+        } = Codex::spawn(config, auth_manager, initial_history).await?;
+        let session_configured = first_session_configured(&codex).await?;
+        Ok(self
+            .register(codex, conversation_id, session_configured)
+            .await)
     }
 
-    async fn finalize_spawn(
+    async fn register(
         &self,
         codex: Codex,
         conversation_id: Uuid,
-    ) -> CodexResult<NewConversation> {
-        // The first event must be `SessionInitialized`. Validate and forward it
-        // to the caller so that they can display it in the conversation
-        // history.
-        let event = codex.next_event().await?;
-        let session_configured = match event {
-            Event {
-                id,
-                msg: EventMsg::SessionConfigured(session_configured),
-            } if id == INITIAL_SUBMIT_ID => session_configured,
-            _ => {
-                return Err(CodexErr::SessionConfiguredNotFirstEvent);
-            }
-        };
-
+        session_configured: SessionConfiguredEvent,
+    ) -> NewConversation {
         let conversation = Arc::new(CodexConversation::new(codex));
         self.conversations
             .write()
             .await
             .insert(conversation_id, conversation.clone());
 
-        Ok(NewConversation {
+        NewConversation {
             conversation_id,
             conversation,
             session_configured,
-        })
+        }
     }
 
     pub async fn get_conversation(
@@ -129,16 +173,179 @@ impl ConversationManager {
             truncate_after_dropping_last_messages(conversation_history, num_messages_to_drop);
 
         // Spawn a new conversation with the computed initial history.
-        let auth_manager = self.auth_manager.clone();
-        let CodexSpawnOk {
-            codex,
-            session_id: conversation_id,
-        } = Codex::spawn(config, auth_manager, Some(truncated_history)).await?;
+        self.spawn_conversation(config, self.auth_manager.clone(), Some(truncated_history))
+            .await
+    }
+}
 
-        self.finalize_spawn(codex, conversation_id).await
+/// The first event must be `SessionInitialized`. Validate and return it so
+/// that the caller can display it in the conversation history.
+async fn first_session_configured(codex: &Codex) -> CodexResult<SessionConfiguredEvent> {
+    let event = codex.next_event().await?;
+    match event {
+        Event {
+            id,
+            msg: EventMsg::SessionConfigured(session_configured),
+        } if id == INITIAL_SUBMIT_ID => Ok(session_configured),
+        _ => Err(CodexErr::SessionConfiguredNotFirstEvent),
     }
 }
 
+/// Pre-spawned conversations older than this are discarded rather than handed
+/// out: their instructions (AGENTS.md, project docs) were read at spawn time
+/// and may have changed on disk since.
+const WARM_CONVERSATION_TTL: Duration = Duration::from_secs(5 * 60);
+
+/// Number of distinct configurations the pool keeps conversations for; the
+/// least recently used one is dropped when a new configuration shows up.
+const MAX_POOLED_CONFIGS: usize = 4;
+
+/// Pre-spawned conversations, grouped by the exact [`Config`] they were
+/// spawned with. All conversations for one configuration share a single set of
+/// MCP server connections.
+struct WarmPool {
+    size: usize,
+    slots: Mutex<Vec<PoolSlot>>,
+}
+
+struct PoolSlot {
+    config: Config,
+    mcp_connection_manager: Arc<McpConnectionManager>,
+    ready: VecDeque<WarmConversation>,
+    /// Background spawns in flight for this slot.
+    spawning: usize,
+    last_used: Instant,
+}
+
+struct WarmConversation {
+    codex: Codex,
+    conversation_id: Uuid,
+    session_configured: SessionConfiguredEvent,
+    spawned_at: Instant,
+}
+
+impl WarmPool {
+    fn new(size: usize) -> Self {
+        Self {
+            size,
+            slots: Mutex::new(Vec::new()),
+        }
+    }
+
+    fn lock(&self) -> std::sync::MutexGuard<'_, Vec<PoolSlot>> {
+        self.slots.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+
+    fn ready_len(&self) -> usize {
+        self.lock().iter().map(|slot| slot.ready.len()).sum()
+    }
+
+    /// Pop a conversation spawned with `config` that has not gone stale.
+    fn take(&self, config: &Config) -> Option<WarmConversation> {
+        let mut slots = self.lock();
+        let slot = slots.iter_mut().find(|slot| slot.config == *config)?;
+        slot.last_used = Instant::now();
+        while let Some(warm) = slot.ready.pop_front() {
+            if warm.spawned_at.elapsed() < WARM_CONVERSATION_TTL {
+                return Some(warm);
+            }
+        }
+        None
+    }
+
+    fn mcp_connection_manager(&self, config: &Config) -> Option<Arc<McpConnectionManager>> {
+        self.lock()
+            .iter()
+            .find(|slot| slot.config == *config)
+            .map(|slot| slot.mcp_connection_manager.clone())
+    }
+
+    fn insert_slot(&self, config: &Config, mcp_connection_manager: Arc<McpConnectionManager>) {
+        let mut slots = self.lock();
+        if slots.iter().any(|slot| slot.config == *config) {
+            return;
+        }
+        if slots.len() >= MAX_POOLED_CONFIGS
+            && let Some(lru) = slots
+                .iter()
+                .enumerate()
+                .min_by_key(|(_, slot)| slot.last_used)
+                .map(|(idx, _)| idx)
+        {
+            slots.swap_remove(lru);
+        }
+        slots.push(PoolSlot {
+            config: config.clone(),
+            mcp_connection_manager,
+            ready: VecDeque::new(),
+            spawning: 0,
+            last_used: Instant::now(),
+        });
+    }
+
+    /// Top the slot for `config` back up to `size` conversations in the
+    /// background.
+    fn replenish(self: &Arc<Self>, config: &Config, auth_manager: &Arc<AuthManager>) {
+        let (missing, mcp_connection_manager) = {
+            let mut slots = self.lock();
+            let Some(slot) = slots.iter_mut().find(|slot| slot.config == *config) else {
+                return;
+            };
+            let missing = self.size.saturating_sub(slot.ready.len() + slot.spawning);
+            slot.spawning += missing;
+            (missing, slot.mcp_connection_manager.clone())
+        };
+
+        for _ in 0..missing {
+            let pool = Arc::clone(self);
+            let config = config.clone();
+            let auth_manager = auth_manager.clone();
+            let mcp_connection_manager = mcp_connection_manager.clone();
+            tokio::spawn(async move {
+                let warm =
+                    spawn_warm_conversation(config.clone(), auth_manager, mcp_connection_manager)
+                        .await;
+                let mut slots = pool.lock();
+                // The slot may have been evicted while the spawn was running;
+                // in that case the conversation is simply dropped.
+                let Some(slot) = slots.iter_mut().find(|slot| slot.config == config) else {
+                    return;
+                };
+                slot.spawning = slot.spawning.saturating_sub(1);
+                match warm {
+                    Ok(warm) => slot.ready.push_back(warm),
+                    Err(e) => warn!("failed to pre-spawn conversation: {e}"),
+                }
+            });
+        }
+    }
+}
+
+async fn spawn_warm_conversation(
+    config: Config,
+    auth_manager: Arc<AuthManager>,
+    mcp_connection_manager: Arc<McpConnectionManager>,
+) -> CodexResult<WarmConversation> {
+    let CodexSpawnOk {
+        codex,
+        session_id: conversation_id,
+        ..
+    } = Codex::spawn_with_mcp_connection_manager(
+        config,
+        auth_manager,
+        None,
+        Some(mcp_connection_manager),
+    )
+    .await?;
+    let session_configured = first_session_configured(&codex).await?;
+    Ok(WarmConversation {
+        codex,
+        conversation_id,
+        session_configured,
+        spawned_at: Instant::now(),
+    })
+}
+
 /// Return a prefix of `items` obtained by dropping the last `n` user messages
 /// and all items that follow them.
 fn truncate_after_dropping_last_messages(items: Vec<ResponseItem>, n: usize) -> Vec<ResponseItem> {
@@ -0,0 +1,434 @@
+//! Bounded queue for the events a session sends to its consumer.
+//!
+//! The queue holds at most `capacity` events. When it is full, `send` waits
+//! for the consumer to make room, so a consumer that falls behind (a client on
+//! the other end of a pipe, a slow terminal) slows the session down instead of
+//! letting the queue grow without bound. No event is ever dropped.
+//!
+//! Streaming deltas are what fill the queue during a busy turn. Once the
+//! consumer is more than [`COALESCE_AFTER_DEPTH`] events behind, a delta that
+//! continues the one at the back of the queue (same submission, same kind and,
+//! for exec output, the same call and stream) is appended to it instead of
+//! taking a slot of its own. The consumer then receives fewer, larger deltas
+//! with the same concatenated contents. Every other event is queued as is and
+//! ends a run of deltas, so the order of events is preserved.
+
+use std::collections::VecDeque;
+use std::pin::pin;
+use std::sync::Arc;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+
+use bytes::BytesMut;
+use tokio::sync::Notify;
+
+use crate::protocol::Event;
+use crate::protocol::EventMsg;
+
+/// Number of events a session's queue holds before senders have to wait.
+pub const EVENT_QUEUE_CAPACITY: usize = 256;
+
+/// Queue depth at which deltas start being merged.
+const COALESCE_AFTER_DEPTH: usize = 32;
+
+/// Upper bound on the size of a merged delta, so that a stalled consumer does
+/// not turn every slot of the queue into an arbitrarily large payload.
+const MAX_COALESCED_DELTA_BYTES: usize = 64 * 1024;
+
+/// Snapshot of how far behind the consumer of a queue is.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct EventQueueStats {
+    /// Events currently waiting to be received.
+    pub depth: usize,
+    /// Largest `depth` seen so far.
+    pub max_depth: usize,
+    /// Deltas that were merged into the delta queued before them.
+    pub coalesced: u64,
+    /// Sends that had to wait because the queue was full.
+    pub blocked_sends: u64,
+}
+
+/// Returned by [`EventSender::send`] once the receiver has been dropped.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct EventQueueClosed;
+
+impl std::fmt::Display for EventQueueClosed {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.write_str("event queue closed")
+    }
+}
+
+impl std::error::Error for EventQueueClosed {}
+
+/// Creates a queue that holds at most `capacity` events.
+pub fn channel(capacity: usize) -> (EventSender, EventReceiver) {
+    let shared = Arc::new(Shared {
+        capacity: capacity.max(1),
+        state: Mutex::new(State {
+            events: VecDeque::new(),
+            senders: 1,
+            receiver_dropped: false,
+            stats: EventQueueStats::default(),
+        }),
+        ready: Notify::new(),
+        space: Notify::new(),
+    });
+    (
+        EventSender {
+            shared: shared.clone(),
+        },
+        EventReceiver { shared },
+    )
+}
+
+struct Shared {
+    capacity: usize,
+    state: Mutex<State>,
+    /// Signalled when an event is queued or the last sender goes away.
+    ready: Notify,
+    /// Signalled when an event is received or the receiver goes away.
+    space: Notify,
+}
+
+struct State {
+    events: VecDeque<Event>,
+    senders: usize,
+    receiver_dropped: bool,
+    stats: EventQueueStats,
+}
+
+impl Shared {
+    fn lock(&self) -> std::sync::MutexGuard<'_, State> {
+        self.state.lock().unwrap_or_else(PoisonError::into_inner)
+    }
+}
+
+impl State {
+    /// Queues `event`, merging it into the event at the back when the
+    /// consumer is behind. Hands the event back if the queue is full.
+    fn push(&mut self, event: Event, capacity: usize) -> Result<(), Event> {
+        let behind = self.events.len() >= COALESCE_AFTER_DEPTH;
+        let event = match self.events.back_mut() {
+            Some(back) if behind => match coalesce(back, event) {
+                Ok(()) => {
+                    self.stats.coalesced += 1;
+                    return Ok(());
+                }
+                Err(event) => event,
+            },
+            _ => event,
+        };
+        if self.events.len() >= capacity {
+            return Err(event);
+        }
+        self.events.push_back(event);
+        self.stats.depth = self.events.len();
+        self.stats.max_depth = self.stats.max_depth.max(self.stats.depth);
+        Ok(())
+    }
+
+    fn pop(&mut self) -> Option<Event> {
+        let event = self.events.pop_front()?;
+        self.stats.depth = self.events.len();
+        Some(event)
+    }
+}
+
+/// Appends `next` to `back` if it continues the same stream of deltas.
+fn coalesce(back: &mut Event, next: Event) -> Result<(), Event> {
+    if back.id != next.id {
+        return Err(next);
+    }
+    let fits = |a: usize, b: usize| a + b <= MAX_COALESCED_DELTA_BYTES;
+    match (&mut back.msg, next.msg) {
+        (EventMsg::AgentMessageDelta(back), EventMsg::AgentMessageDelta(next))
+            if fits(back.delta.len(), next.delta.len()) =>
+        {
+            back.delta.push_str(&next.delta);
+            Ok(())
+        }
+        (EventMsg::AgentReasoningDelta(back), EventMsg::AgentReasoningDelta(next))
+            if fits(back.delta.len(), next.delta.len()) =>
+        {
+            back.delta.push_str(&next.delta);
+            Ok(())
+        }
+        (
+            EventMsg::AgentReasoningRawContentDelta(back),
+            EventMsg::AgentReasoningRawContentDelta(next),
+        ) if fits(back.delta.len(), next.delta.len()) => {
+            back.delta.push_str(&next.delta);
+            Ok(())
+        }
+        (EventMsg::ExecCommandOutputDelta(back), EventMsg::ExecCommandOutputDelta(next))
+            if back.call_id == next.call_id
+                && back.stream == next.stream
+                && fits(back.chunk.len(), next.chunk.len()) =>
+        {
+            let mut chunk = BytesMut::with_capacity(back.chunk.len() + next.chunk.len());
+            chunk.extend_from_slice(&back.chunk);
+            chunk.extend_from_slice(&next.chunk);
+            back.chunk = chunk.freeze();
+            Ok(())
+        }
+        (_, msg) => Err(Event { id: next.id, msg }),
+    }
+}
+
+/// Sending half of an event queue. Cloning it adds another sender; the
+/// receiver sees the end of the queue once every sender has been dropped.
+pub struct EventSender {
+    shared: Arc<Shared>,
+}
+
+impl EventSender {
+    /// Queues `event`, waiting for room if the queue is full. Fails only if
+    /// the receiver has been dropped.
+    pub async fn send(&self, event: Event) -> Result<(), EventQueueClosed> {
+        let mut event = event;
+        let mut blocked = false;
+        loop {
+            // Register for a wakeup before looking at the queue so that room
+            // made in between is not missed.
+            let mut space = pin!(self.shared.space.notified());
+            space.as_mut().enable();
+            {
+                let mut state = self.shared.lock();
+                if state.receiver_dropped {
+                    return Err(EventQueueClosed);
+                }
+                match state.push(event, self.shared.capacity) {
+                    Ok(()) => {
+                        drop(state);
+                        self.shared.ready.notify_one();
+                        return Ok(());
+                    }
+                    Err(rejected) => event = rejected,
+                }
+                if !blocked {
+                    blocked = true;
+                    state.stats.blocked_sends += 1;
+                }
+            }
+            space.await;
+        }
+    }
+}
+
+impl Clone for EventSender {
+    fn clone(&self) -> Self {
+        self.shared.lock().senders += 1;
+        Self {
+            shared: self.shared.clone(),
+        }
+    }
+}
+
+impl Drop for EventSender {
+    fn drop(&mut self) {
+        let last = {
+            let mut state = self.shared.lock();
+            state.senders -= 1;
+            state.senders == 0
+        };
+        if last {
+            self.shared.ready.notify_one();
+        }
+    }
+}
+
+/// Receiving half of an event queue.
+pub struct EventReceiver {
+    shared: Arc<Shared>,
+}
+
+impl EventReceiver {
+    /// Waits for the next event. Returns `None` once every sender has been
+    /// dropped and the queue is empty.
+    pub async fn recv(&self) -> Option<Event> {
+        loop {
+            {
+                let mut state = self.shared.lock();
+                if let Some(event) = state.pop() {
+                    drop(state);
+                    self.shared.space.notify_one();
+                    return Some(event);
+                }
+                if state.senders == 0 {
+                    return None;
+                }
+            }
+            // `notify_one` stores a permit when nobody is waiting, so an event
+            // queued after the check above still wakes this call.
+            self.shared.ready.notified().await;
+        }
+    }
+
+    /// Returns the next event if one is queued.
+    pub fn try_recv(&self) -> Option<Event> {
+        let event = self.shared.lock().pop()?;
+        self.shared.space.notify_one();
+        Some(event)
+    }
+
+    pub fn stats(&self) -> EventQueueStats {
+        self.shared.lock().stats
+    }
+}
+
+impl Drop for EventReceiver {
+    fn drop(&mut self) {
+        self.shared.lock().receiver_dropped = true;
+        self.shared.space.notify_waiters();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::protocol::AgentMessageDeltaEvent;
+    use crate::protocol::ExecCommandOutputDeltaEvent;
+    use crate::protocol::ExecOutputStream;
+    use crate::protocol::TaskCompleteEvent;
+    use bytes::Bytes;
+    use pretty_assertions::assert_eq;
+    use std::time::Duration;
+
+    fn delta(id: &str, text: &str) -> Event {
+        Event {
+            id: id.to_string(),
+            msg: EventMsg::AgentMessageDelta(AgentMessageDeltaEvent {
+                delta: text.to_string(),
+            }),
+        }
+    }
+
+    fn task_complete(id: &str) -> Event {
+        Event {
+            id: id.to_string(),
+            msg: EventMsg::TaskComplete(TaskCompleteEvent {
+                last_agent_message: None,
+            }),
+        }
+    }
+
+    fn output(call_id: &str, chunk: &'static [u8]) -> Event {
+        Event {
+            id: "1".to_string(),
+            msg: EventMsg::ExecCommandOutputDelta(ExecCommandOutputDeltaEvent {
+                call_id: call_id.to_string(),
+                stream: ExecOutputStream::Stdout,
+                chunk: Bytes::from_static(chunk),
+            }),
+        }
+    }
+
+    fn message_deltas(events: &[Event]) -> Vec<String> {
+        events
+            .iter()
+            .filter_map(|event| match &event.msg {
+                EventMsg::AgentMessageDelta(delta) => Some(delta.delta.clone()),
+                _ => None,
+            })
+            .collect()
+    }
+
+    fn drain(rx: &EventReceiver) -> Vec<Event> {
+        std::iter::from_fn(|| rx.try_recv()).collect()
+    }
+
+    #[tokio::test]
+    async fn deltas_are_delivered_as_is_while_the_consumer_keeps_up() {
+        let (tx, rx) = channel(EVENT_QUEUE_CAPACITY);
+        for text in ["a", "b", "c"] {
+            tx.send(delta("1", text)).await.unwrap();
+        }
+        assert_eq!(message_deltas(&drain(&rx)), vec!["a", "b", "c"]);
+        assert_eq!(rx.stats().coalesced, 0);
+    }
+
+    #[tokio::test]
+    async fn deltas_merge_once_the_consumer_falls_behind() {
+        let (tx, rx) = channel(EVENT_QUEUE_CAPACITY);
+        for _ in 0..COALESCE_AFTER_DEPTH {
+            tx.send(task_complete("0")).await.unwrap();
+        }
+        for text in ["a", "b", "c"] {
+            tx.send(delta("1", text)).await.unwrap();
+        }
+        // A lifecycle event ends the run; so does a delta for another turn.
+        tx.send(task_complete("1")).await.unwrap();
+        tx.send(delta("1", "d")).await.unwrap();
+        tx.send(delta("2", "e")).await.unwrap();
+
+        let events = drain(&rx);
+        assert_eq!(message_deltas(&events), vec!["abc", "d", "e"]);
+        assert_eq!(events.len(), COALESCE_AFTER_DEPTH + 4);
+        assert_eq!(rx.stats().coalesced, 2);
+    }
+
+    #[tokio::test]
+    async fn exec_output_merges_only_within_one_call() {
+        let (tx, rx) = channel(EVENT_QUEUE_CAPACITY);
+        for _ in 0..COALESCE_AFTER_DEPTH {
+            tx.send(task_complete("0")).await.unwrap();
+        }
+        tx.send(output("call-1", b"hello ")).await.unwrap();
+        tx.send(output("call-1", b"world")).await.unwrap();
+        tx.send(output("call-2", b"other")).await.unwrap();
+
+        let chunks: Vec<Bytes> = drain(&rx)
+            .into_iter()
+            .filter_map(|event| match event.msg {
+                EventMsg::ExecCommandOutputDelta(delta) => Some(delta.chunk),
+                _ => None,
+            })
+            .collect();
+        assert_eq!(
+            chunks,
+            vec![
+                Bytes::from_static(b"hello world"),
+                Bytes::from_static(b"other")
+            ]
+        );
+    }
+
+    #[tokio::test]
+    async fn full_queue_blocks_instead_of_dropping() {
+        let (tx, rx) = channel(2);
+        tx.send(task_complete("1")).await.unwrap();
+        tx.send(task_complete("2")).await.unwrap();
+
+        let blocked = tokio::spawn(async move { tx.send(task_complete("3")).await });
+        tokio::time::sleep(Duration::from_millis(50)).await;
+        assert!(!blocked.is_finished());
+        assert_eq!(rx.stats().blocked_sends, 1);
+
+        assert_eq!(rx.recv().await.map(|event| event.id), Some("1".to_string()));
+        blocked.await.unwrap().unwrap();
+        let ids: Vec<String> = drain(&rx).into_iter().map(|event| event.id).collect();
+        assert_eq!(ids, vec!["2", "3"]);
+        assert_eq!(rx.stats().max_depth, 2);
+    }
+
+    #[tokio::test]
+    async fn recv_ends_after_the_last_sender_is_dropped() {
+        let (tx, rx) = channel(EVENT_QUEUE_CAPACITY);
+        let tx2 = tx.clone();
+        tx.send(task_complete("1")).await.unwrap();
+        drop(tx);
+        drop(tx2);
+        assert!(rx.recv().await.is_some());
+        assert!(rx.recv().await.is_none());
+    }
+
+    #[tokio::test]
+    async fn send_fails_once_the_receiver_is_dropped() {
+        let (tx, rx) = channel(1);
+        tx.send(task_complete("1")).await.unwrap();
+        let blocked = tokio::spawn(async move { tx.send(task_complete("2")).await });
+        tokio::time::sleep(Duration::from_millis(50)).await;
+        drop(rx);
+        assert_eq!(blocked.await.unwrap(), Err(EventQueueClosed));
+    }
+}
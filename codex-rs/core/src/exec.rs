@@ -5,18 +5,24 @@ use std::collections::HashMap;
 use std::io;
 use std::path::PathBuf;
 use std::process::ExitStatus;
+use std::sync::Arc;
+use std::sync::Mutex;
+use std::sync::PoisonError;
 use std::time::Duration;
 use std::time::Instant;
 
-use async_channel::Sender;
+use bytes::Bytes;
+use bytes::BytesMut;
 use tokio::io::AsyncRead;
 use tokio::io::AsyncReadExt;
-use tokio::io::BufReader;
 use tokio::process::Child;
 
 use crate::error::CodexErr;
 use crate::error::Result;
 use crate::error::SandboxErr;
+use crate::event_queue::EventSender;
+use crate::exec_output::ExecOutputStore;
+use crate::exec_output::HeadTailBuffer;
 use crate::landlock::spawn_command_under_linux_sandbox;
 use crate::protocol::Event;
 use crate::protocol::EventMsg;
@@ -26,7 +32,6 @@ use crate::protocol::SandboxPolicy;
 use crate::seatbelt::spawn_command_under_seatbelt;
 use crate::spawn::StdioPolicy;
 use crate::spawn::spawn_child_async;
-use serde_bytes::ByteBuf;
 
 const DEFAULT_TIMEOUT_MS: u64 = 10_000;
 
@@ -38,10 +43,18 @@ const EXIT_CODE_SIGNAL_BASE: i32 = 128; // conventional shell: 128 + signal
 
 // I/O buffer sizing
 const READ_CHUNK_SIZE: usize = 8192; // bytes per read
-const AGGREGATE_BUFFER_INITIAL_CAPACITY: usize = 8 * 1024; // 8 KiB
+/// Reads shorter than this are copied out of the read buffer instead of
+/// sharing it, so that a stream of small reads doesn't pin one
+/// `READ_CHUNK_SIZE` allocation per chunk in the retained output.
+const SHARED_CHUNK_MIN_SIZE: usize = READ_CHUNK_SIZE / 2;
+
+/// Default for [`OutputRetention`]: how much of a command's combined output is
+/// kept in memory, split evenly between its beginning and its end.
+pub const DEFAULT_EXEC_OUTPUT_MAX_BYTES: usize = 4 * 1024 * 1024; // 4 MiB
 
 /// Limit the number of ExecCommandOutputDelta events emitted per exec call.
-/// Aggregation still collects full output; only the live event stream is capped.
+/// Aggregation still collects the retained output; only the live event stream
+/// is capped.
 pub(crate) const MAX_EXEC_OUTPUT_DELTAS_PER_CALL: usize = 10_000;
 
 #[derive(Debug, Clone)]
@@ -60,6 +73,32 @@ impl ExecParams {
     }
 }
 
+/// How much of an exec call's output is kept in memory. Output beyond the
+/// first `head_bytes` and before the last `tail_bytes` of the combined
+/// stdout/stderr stream is dropped as it arrives and replaced by a marker.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct OutputRetention {
+    pub head_bytes: usize,
+    pub tail_bytes: usize,
+}
+
+impl OutputRetention {
+    /// Splits `max_bytes` evenly between the head and the tail.
+    pub const fn from_max_bytes(max_bytes: usize) -> Self {
+        let head_bytes = max_bytes / 2;
+        Self {
+            head_bytes,
+            tail_bytes: max_bytes - head_bytes,
+        }
+    }
+}
+
+impl Default for OutputRetention {
+    fn default() -> Self {
+        Self::from_max_bytes(DEFAULT_EXEC_OUTPUT_MAX_BYTES)
+    }
+}
+
 #[derive(Clone, Copy, Debug, PartialEq)]
 pub enum SandboxType {
     None,
@@ -75,7 +114,7 @@ pub enum SandboxType {
 pub struct StdoutStream {
     pub sub_id: String,
     pub call_id: String,
-    pub tx_event: Sender<Event>,
+    pub tx_event: EventSender,
 }
 
 pub async fn process_exec_tool_call(
@@ -84,29 +123,28 @@ pub async fn process_exec_tool_call(
     sandbox_policy: &SandboxPolicy,
     codex_linux_sandbox_exe: &Option<PathBuf>,
     stdout_stream: Option<StdoutStream>,
+    output_retention: OutputRetention,
 ) -> Result<ExecToolCallOutput> {
     let start = Instant::now();
+    let timeout = params.timeout_duration();
 
-    let raw_output_result: std::result::Result<RawExecToolCallOutput, CodexErr> = match sandbox_type
-    {
-        SandboxType::None => exec(params, sandbox_policy, stdout_stream.clone()).await,
+    let child: Result<Child> = match sandbox_type {
+        SandboxType::None => spawn_unsandboxed(params, sandbox_policy).await,
         SandboxType::MacosSeatbelt => {
-            let timeout = params.timeout_duration();
             let ExecParams {
                 command, cwd, env, ..
             } = params;
-            let child = spawn_command_under_seatbelt(
+            spawn_command_under_seatbelt(
                 command,
                 sandbox_policy,
                 cwd,
                 StdioPolicy::RedirectForShellTool,
                 env,
             )
-            .await?;
-            consume_truncated_output(child, timeout, stdout_stream.clone()).await
+            .await
+            .map_err(CodexErr::from)
         }
         SandboxType::LinuxSeccomp => {
-            let timeout = params.timeout_duration();
             let ExecParams {
                 command, cwd, env, ..
             } = params;
@@ -114,7 +152,7 @@ pub async fn process_exec_tool_call(
             let codex_linux_sandbox_exe = codex_linux_sandbox_exe
                 .as_ref()
                 .ok_or(CodexErr::LandlockSandboxExecutableNotProvided)?;
-            let child = spawn_command_under_linux_sandbox(
+            spawn_command_under_linux_sandbox(
                 codex_linux_sandbox_exe,
                 command,
                 sandbox_policy,
@@ -122,10 +160,17 @@ pub async fn process_exec_tool_call(
                 StdioPolicy::RedirectForShellTool,
                 env,
             )
-            .await?;
+            .await
+            .map_err(CodexErr::from)
+        }
+    };
+    let spawn_duration = start.elapsed();
 
-            consume_truncated_output(child, timeout, stdout_stream).await
+    let raw_output_result: std::result::Result<RawExecToolCallOutput, CodexErr> = match child {
+        Ok(child) => {
+            consume_truncated_output(child, timeout, stdout_stream, output_retention).await
         }
+        Err(err) => Err(err),
     };
     let duration = start.elapsed();
     match raw_output_result {
@@ -157,7 +202,9 @@ pub async fn process_exec_tool_call(
                 stdout,
                 stderr,
                 aggregated_output: raw_output.aggregated_output.from_utf8_lossy(),
+                model_output: raw_output.model_output,
                 duration,
+                spawn_duration,
             })
         }
         Err(err) => {
@@ -198,6 +245,7 @@ struct RawExecToolCallOutput {
     pub stdout: StreamOutput<Vec<u8>>,
     pub stderr: StreamOutput<Vec<u8>>,
     pub aggregated_output: StreamOutput<Vec<u8>>,
+    pub model_output: HeadTailBuffer,
 }
 
 impl StreamOutput<String> {
@@ -218,26 +266,23 @@ impl StreamOutput<Vec<u8>> {
     }
 }
 
-#[inline]
-fn append_all(dst: &mut Vec<u8>, src: &[u8]) {
-    dst.extend_from_slice(src);
-}
-
 #[derive(Debug)]
 pub struct ExecToolCallOutput {
     pub exit_code: i32,
     pub stdout: StreamOutput<String>,
     pub stderr: StreamOutput<String>,
     pub aggregated_output: StreamOutput<String>,
+    /// Head and tail of the combined output, collected while it streamed, from
+    /// which the summary sent to the model is rendered.
+    pub model_output: HeadTailBuffer,
     pub duration: Duration,
+    /// The part of `duration` spent setting up the sandbox and spawning the
+    /// command.
+    pub spawn_duration: Duration,
 }
 
-async fn exec(
-    params: ExecParams,
-    sandbox_policy: &SandboxPolicy,
-    stdout_stream: Option<StdoutStream>,
-) -> Result<RawExecToolCallOutput> {
-    let timeout = params.timeout_duration();
+/// Spawns `params.command` without a sandbox.
+async fn spawn_unsandboxed(params: ExecParams, sandbox_policy: &SandboxPolicy) -> Result<Child> {
     let ExecParams {
         command, cwd, env, ..
     } = params;
@@ -259,15 +304,19 @@ async fn exec(
         env,
     )
     .await?;
-    consume_truncated_output(child, timeout, stdout_stream).await
+    Ok(child)
 }
 
 /// Consumes the output of a child process, truncating it so it is suitable for
 /// use as the output of a `shell` tool call. Also enforces specified timeout.
+///
+/// Both streams are read into a single [`ExecOutputStore`] bounded by
+/// `output_retention`, so memory use does not grow with the amount of output.
 async fn consume_truncated_output(
     mut child: Child,
     timeout: Duration,
     stdout_stream: Option<StdoutStream>,
+    output_retention: OutputRetention,
 ) -> Result<RawExecToolCallOutput> {
     // Both stdout and stderr were configured with `Stdio::piped()`
     // above, therefore `take()` should normally return `Some`.  If it doesn't
@@ -284,19 +333,19 @@ async fn consume_truncated_output(
         ))
     })?;
 
-    let (agg_tx, agg_rx) = async_channel::unbounded::<Vec<u8>>();
+    let store = Arc::new(Mutex::new(ExecOutputStore::new(output_retention)));
 
     let stdout_handle = tokio::spawn(read_capped(
-        BufReader::new(stdout_reader),
+        stdout_reader,
         stdout_stream.clone(),
-        false,
-        Some(agg_tx.clone()),
+        ExecOutputStream::Stdout,
+        store.clone(),
     ));
     let stderr_handle = tokio::spawn(read_capped(
-        BufReader::new(stderr_reader),
+        stderr_reader,
         stdout_stream.clone(),
-        true,
-        Some(agg_tx.clone()),
+        ExecOutputStream::Stderr,
+        store.clone(),
     ));
 
     let exit_status = tokio::select! {
@@ -318,58 +367,53 @@ async fn consume_truncated_output(
         }
     };
 
-    let stdout = stdout_handle.await??;
-    let stderr = stderr_handle.await??;
-
-    drop(agg_tx);
-
-    let mut combined_buf = Vec::with_capacity(AGGREGATE_BUFFER_INITIAL_CAPACITY);
-    while let Ok(chunk) = agg_rx.recv().await {
-        append_all(&mut combined_buf, &chunk);
-    }
-    let aggregated_output = StreamOutput {
-        text: combined_buf,
-        truncated_after_lines: None,
-    };
+    stdout_handle.await??;
+    stderr_handle.await??;
 
+    let store = store.lock().unwrap_or_else(PoisonError::into_inner);
     Ok(RawExecToolCallOutput {
         exit_status,
-        stdout,
-        stderr,
-        aggregated_output,
+        stdout: store.stream_output(ExecOutputStream::Stdout),
+        stderr: store.stream_output(ExecOutputStream::Stderr),
+        aggregated_output: store.aggregated_output(),
+        model_output: store.model_output(),
     })
 }
 
+/// Reads `reader` to EOF, pushing every chunk into `store` and, while under
+/// the cap, emitting it as an `ExecCommandOutputDelta`. The delta event and the
+/// store share each chunk. Large reads are frozen out of `buf` without a copy;
+/// small ones are copied into a chunk of their own size and `buf` is reused.
 async fn read_capped<R: AsyncRead + Unpin + Send + 'static>(
     mut reader: R,
     stream: Option<StdoutStream>,
-    is_stderr: bool,
-    aggregate_tx: Option<Sender<Vec<u8>>>,
-) -> io::Result<StreamOutput<Vec<u8>>> {
-    let mut buf = Vec::with_capacity(AGGREGATE_BUFFER_INITIAL_CAPACITY);
-    let mut tmp = [0u8; READ_CHUNK_SIZE];
+    output_stream: ExecOutputStream,
+    store: Arc<Mutex<ExecOutputStore>>,
+) -> io::Result<()> {
+    let mut buf = BytesMut::with_capacity(READ_CHUNK_SIZE);
     let mut emitted_deltas: usize = 0;
 
-    // No caps: append all bytes
-
     loop {
-        let n = reader.read(&mut tmp).await?;
+        buf.reserve(READ_CHUNK_SIZE);
+        let n = reader.read_buf(&mut buf).await?;
         if n == 0 {
             break;
         }
+        let chunk = if n < SHARED_CHUNK_MIN_SIZE {
+            let chunk = Bytes::copy_from_slice(&buf);
+            buf.clear();
+            chunk
+        } else {
+            buf.split().freeze()
+        };
 
         if let Some(stream) = &stream
             && emitted_deltas < MAX_EXEC_OUTPUT_DELTAS_PER_CALL
         {
-            let chunk = tmp[..n].to_vec();
             let msg = EventMsg::ExecCommandOutputDelta(ExecCommandOutputDeltaEvent {
                 call_id: stream.call_id.clone(),
-                stream: if is_stderr {
-                    ExecOutputStream::Stderr
-                } else {
-                    ExecOutputStream::Stdout
-                },
-                chunk: ByteBuf::from(chunk),
+                stream: output_stream,
+                chunk: chunk.clone(),
             });
             let event = Event {
                 id: stream.sub_id.clone(),
@@ -380,18 +424,14 @@ async fn read_capped<R: AsyncRead + Unpin + Send + 'static>(
             emitted_deltas += 1;
         }
 
-        if let Some(tx) = &aggregate_tx {
-            let _ = tx.send(tmp[..n].to_vec()).await;
-        }
-
-        append_all(&mut buf, &tmp[..n]);
+        store
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .push(output_stream, chunk);
         // Continue reading to EOF to avoid back-pressure
     }
 
-    Ok(StreamOutput {
-        text: buf,
-        truncated_after_lines: None,
-    })
+    Ok(())
 }
 
 #[cfg(unix)]
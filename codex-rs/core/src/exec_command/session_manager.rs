@@ -19,6 +19,8 @@ use crate::exec_command::exec_command_params::ExecCommandParams;
 use crate::exec_command::exec_command_params::WriteStdinParams;
 use crate::exec_command::exec_command_session::ExecCommandSession;
 use crate::exec_command::session_id::SessionId;
+use crate::exec_output::HeadTailBuffer;
+use crate::exec_output::HeadTailLimits;
 use codex_protocol::models::FunctionCallOutputPayload;
 
 #[derive(Debug, Default)]
@@ -105,12 +107,11 @@ impl SessionManager {
         let mut output_rx = session.output_receiver();
         self.sessions.lock().await.insert(session_id, session);
 
-        // Collect output until either timeout expires or process exits.
-        // Do not cap during collection; truncate at the end if needed.
-        // Use a modest initial capacity to avoid large preallocation.
+        // Collect output until either timeout expires or process exits,
+        // keeping only as much of its head and tail as the cap allows.
         let cap_bytes_u64 = params.max_output_tokens.saturating_mul(4);
         let cap_bytes: usize = cap_bytes_u64.min(usize::MAX as u64) as usize;
-        let mut collected: Vec<u8> = Vec::with_capacity(4096);
+        let mut collected = output_buffer(cap_bytes);
 
         let start_time = Instant::now();
         let deadline = start_time + Duration::from_millis(params.yield_time_ms);
@@ -130,7 +131,7 @@ impl SessionManager {
                     while Instant::now() < grace_deadline {
                         match timeout(Duration::from_millis(1), output_rx.recv()).await {
                             Ok(Ok(chunk)) => {
-                                collected.extend_from_slice(&chunk);
+                                collected.push(&chunk);
                             }
                             Ok(Err(tokio::sync::broadcast::error::RecvError::Lagged(_))) => {
                                 // Skip missed messages; keep trying within grace period.
@@ -145,7 +146,7 @@ impl SessionManager {
                 chunk = timeout(remaining, output_rx.recv()) => {
                     match chunk {
                         Ok(Ok(chunk)) => {
-                            collected.extend_from_slice(&chunk);
+                            collected.push(&chunk);
                         }
                         Ok(Err(tokio::sync::broadcast::error::RecvError::Lagged(_))) => {
                             // Skip missed messages; continue collecting fresh output.
@@ -157,16 +158,14 @@ impl SessionManager {
             }
         }
 
-        let output = String::from_utf8_lossy(&collected).to_string();
-
         let exit_status = if let Some(code) = exit_code {
             ExitStatus::Exited(code)
         } else {
             ExitStatus::Ongoing(session_id)
         };
 
-        // If output exceeds cap, truncate the middle and record original token estimate.
-        let (output, original_token_count) = truncate_middle(&output, cap_bytes);
+        // If output exceeds cap, elide the middle and record original token estimate.
+        let (output, original_token_count) = render_output(&collected, cap_bytes);
         Ok(ExecCommandOutput {
             wall_time: Instant::now().duration_since(start_time),
             exit_status,
@@ -204,7 +203,9 @@ impl SessionManager {
         }
 
         // Collect output up to yield_time_ms, truncating to max_output_tokens bytes.
-        let mut collected: Vec<u8> = Vec::with_capacity(4096);
+        let cap_bytes_u64 = max_output_tokens.saturating_mul(4);
+        let cap_bytes: usize = cap_bytes_u64.min(usize::MAX as u64) as usize;
+        let mut collected = output_buffer(cap_bytes);
         let start_time = Instant::now();
         let deadline = start_time + Duration::from_millis(yield_time_ms);
         loop {
@@ -215,8 +216,8 @@ impl SessionManager {
             let remaining = deadline - now;
             match timeout(remaining, output_rx.recv()).await {
                 Ok(Ok(chunk)) => {
-                    // Collect all output within the time budget; truncate at the end.
-                    collected.extend_from_slice(&chunk);
+                    // Collect all output within the time budget; only its head and tail are kept.
+                    collected.push(&chunk);
                 }
                 Ok(Err(tokio::sync::broadcast::error::RecvError::Lagged(_))) => {
                     // Skip missed messages; continue collecting fresh output.
@@ -227,10 +228,7 @@ impl SessionManager {
         }
 
         // Return structured output, truncating middle if over cap.
-        let output = String::from_utf8_lossy(&collected).to_string();
-        let cap_bytes_u64 = max_output_tokens.saturating_mul(4);
-        let cap_bytes: usize = cap_bytes_u64.min(usize::MAX as u64) as usize;
-        let (output, original_token_count) = truncate_middle(&output, cap_bytes);
+        let (output, original_token_count) = render_output(&collected, cap_bytes);
         Ok(ExecCommandOutput {
             wall_time: Instant::now().duration_since(start_time),
             exit_status: ExitStatus::Ongoing(session_id),
@@ -347,110 +345,28 @@ async fn create_exec_command_session(
     Ok((session, exit_rx))
 }
 
-/// Truncate the middle of a UTF-8 string to at most `max_bytes` bytes,
-/// preserving the beginning and the end. Returns the possibly truncated
-/// string and `Some(original_token_count)` (estimated at 4 bytes/token)
-/// if truncation occurred; otherwise returns the original string and `None`.
-fn truncate_middle(s: &str, max_bytes: usize) -> (String, Option<u64>) {
-    // No truncation needed
-    if s.len() <= max_bytes {
-        return (s.to_string(), None);
-    }
-    let est_tokens = (s.len() as u64).div_ceil(4);
-    if max_bytes == 0 {
-        // Cannot keep any content; still return a full marker (never truncated).
-        return (format!("…{est_tokens} tokens truncated…"), Some(est_tokens));
-    }
-
-    // Helper to truncate a string to a given byte length on a char boundary.
-    fn truncate_on_boundary(input: &str, max_len: usize) -> &str {
-        if input.len() <= max_len {
-            return input;
-        }
-        let mut end = max_len;
-        while end > 0 && !input.is_char_boundary(end) {
-            end -= 1;
-        }
-        &input[..end]
-    }
-
-    // Given a left/right budget, prefer newline boundaries; otherwise fall back
-    // to UTF-8 char boundaries.
-    fn pick_prefix_end(s: &str, left_budget: usize) -> usize {
-        if let Some(head) = s.get(..left_budget)
-            && let Some(i) = head.rfind('\n')
-        {
-            return i + 1; // keep the newline so suffix starts on a fresh line
-        }
-        truncate_on_boundary(s, left_budget).len()
-    }
-
-    fn pick_suffix_start(s: &str, right_budget: usize) -> usize {
-        let start_tail = s.len().saturating_sub(right_budget);
-        if let Some(tail) = s.get(start_tail..)
-            && let Some(i) = tail.find('\n')
-        {
-            return start_tail + i + 1; // start after newline
-        }
-        // Fall back to a char boundary at or after start_tail.
-        let mut idx = start_tail.min(s.len());
-        while idx < s.len() && !s.is_char_boundary(idx) {
-            idx += 1;
-        }
-        idx
-    }
-
-    // Refine marker length and budgets until stable. Marker is never truncated.
-    let mut guess_tokens = est_tokens; // worst-case: everything truncated
-    for _ in 0..4 {
-        let marker = format!("…{guess_tokens} tokens truncated…");
-        let marker_len = marker.len();
-        let keep_budget = max_bytes.saturating_sub(marker_len);
-        if keep_budget == 0 {
-            // No room for any content within the cap; return a full, untruncated marker
-            // that reflects the entire truncated content.
-            return (format!("…{est_tokens} tokens truncated…"), Some(est_tokens));
-        }
-
-        let left_budget = keep_budget / 2;
-        let right_budget = keep_budget - left_budget;
-        let prefix_end = pick_prefix_end(s, left_budget);
-        let mut suffix_start = pick_suffix_start(s, right_budget);
-        if suffix_start < prefix_end {
-            suffix_start = prefix_end;
-        }
-        let kept_content_bytes = prefix_end + (s.len() - suffix_start);
-        let truncated_content_bytes = s.len().saturating_sub(kept_content_bytes);
-        let new_tokens = (truncated_content_bytes as u64).div_ceil(4);
-        if new_tokens == guess_tokens {
-            let mut out = String::with_capacity(marker_len + kept_content_bytes + 1);
-            out.push_str(&s[..prefix_end]);
-            out.push_str(&marker);
-            // Place marker on its own line for symmetry when we keep line boundaries.
-            out.push('\n');
-            out.push_str(&s[suffix_start..]);
-            return (out, Some(est_tokens));
-        }
-        guess_tokens = new_tokens;
-    }
+/// Buffer for session output that keeps at most `cap_bytes`, split between the
+/// beginning and the end, so a chatty process cannot grow it without bound.
+fn output_buffer(cap_bytes: usize) -> HeadTailBuffer {
+    let head_bytes = cap_bytes / 2;
+    HeadTailBuffer::new(HeadTailLimits {
+        head_bytes,
+        tail_bytes: cap_bytes - head_bytes,
+        head_lines: usize::MAX,
+        tail_lines: usize::MAX,
+    })
+}
 
-    // Fallback: use last guess to build output.
-    let marker = format!("…{guess_tokens} tokens truncated…");
-    let marker_len = marker.len();
-    let keep_budget = max_bytes.saturating_sub(marker_len);
-    if keep_budget == 0 {
-        return (format!("…{est_tokens} tokens truncated…"), Some(est_tokens));
-    }
-    let left_budget = keep_budget / 2;
-    let right_budget = keep_budget - left_budget;
-    let prefix_end = pick_prefix_end(s, left_budget);
-    let suffix_start = pick_suffix_start(s, right_budget);
-    let mut out = String::with_capacity(marker_len + prefix_end + (s.len() - suffix_start) + 1);
-    out.push_str(&s[..prefix_end]);
-    out.push_str(&marker);
-    out.push('\n');
-    out.push_str(&s[suffix_start..]);
-    (out, Some(est_tokens))
+/// Renders collected output in at most `max_bytes` bytes, preserving the
+/// beginning and the end. Returns the possibly truncated string and
+/// `Some(original_token_count)` (estimated at 4 bytes/token) if truncation
+/// occurred; otherwise returns the full output and `None`.
+fn render_output(output: &HeadTailBuffer, max_bytes: usize) -> (String, Option<u64>) {
+    let text = output.render(max_bytes, |elision| {
+        format!("…{} tokens truncated…", elision.omitted_bytes.div_ceil(4))
+    });
+    let original_token_count = (!output.fits(max_bytes)).then(|| output.total_bytes().div_ceil(4));
+    (text, original_token_count)
 }
 
 #[cfg(test)]
@@ -617,12 +533,21 @@ abc"#;
         assert_eq!(expected, text);
     }
 
+    fn collect(s: &str, max_bytes: usize) -> HeadTailBuffer {
+        let mut buffer = output_buffer(max_bytes);
+        // Feed in small chunks, as the PTY reader would.
+        for chunk in s.as_bytes().chunks(7) {
+            buffer.push(chunk);
+        }
+        buffer
+    }
+
     #[test]
-    fn truncate_middle_no_newlines_fallback() {
+    fn render_output_no_newlines_fallback() {
         // A long string with no newlines that exceeds the cap.
         let s = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
         let max_bytes = 16; // force truncation
-        let (out, original) = truncate_middle(s, max_bytes);
+        let (out, original) = render_output(&collect(s, max_bytes), max_bytes);
         // For very small caps, we return the full, untruncated marker,
         // even if it exceeds the cap.
         assert_eq!(out, "…16 tokens truncated…");
@@ -631,7 +556,7 @@ abc"#;
     }
 
     #[test]
-    fn truncate_middle_prefers_newline_boundaries() {
+    fn render_output_prefers_newline_boundaries() {
         // Build a multi-line string of 20 numbered lines (each "NNN\n").
         let mut s = String::new();
         for i in 1..=20 {
@@ -645,7 +570,7 @@ abc"#;
         let max_bytes = 64;
         // Expect exact output: first 4 lines, marker, last 4 lines, and correct token estimate (80/4 = 20).
         assert_eq!(
-            truncate_middle(&s, max_bytes),
+            render_output(&collect(&s, max_bytes), max_bytes),
             (
                 r#"001
 002
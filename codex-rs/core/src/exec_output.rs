@@ -0,0 +1,537 @@
+//! Bounded, shared storage for the output of a running exec call.
+//!
+//! stdout and stderr are read into refcounted [`Bytes`] chunks that are pushed
+//! into a single [`ExecOutputStore`] in arrival order. The same chunk is handed
+//! to the `ExecCommandOutputDelta` event and kept by the store, so the bytes
+//! are never copied while the command runs. The store keeps the first
+//! `head_bytes` and the last `tail_bytes` of the combined output and only
+//! counts what falls in between, so memory per call is bounded no matter how
+//! much the command prints.
+//!
+//! The summary that is sent to the model is bounded by line count as well as
+//! by bytes, so it is built alongside the store by a [`HeadTailBuffer`] that
+//! sees every chunk as it arrives. The same buffer bounds the output collected
+//! by `exec_command` sessions.
+
+use std::collections::VecDeque;
+
+use bytes::Bytes;
+
+use crate::codex::MODEL_FORMAT_LIMITS;
+use crate::exec::OutputRetention;
+use crate::exec::StreamOutput;
+use crate::protocol::ExecOutputStream;
+
+#[derive(Debug)]
+struct OutputChunk {
+    stream: ExecOutputStream,
+    bytes: Bytes,
+}
+
+#[derive(Debug)]
+pub(crate) struct ExecOutputStore {
+    retention: OutputRetention,
+    head: Vec<OutputChunk>,
+    head_len: usize,
+    tail: VecDeque<OutputChunk>,
+    tail_len: usize,
+    elided_stdout_bytes: u64,
+    elided_stderr_bytes: u64,
+    model_output: HeadTailBuffer,
+}
+
+impl ExecOutputStore {
+    pub(crate) fn new(retention: OutputRetention) -> Self {
+        Self {
+            retention,
+            head: Vec::new(),
+            head_len: 0,
+            tail: VecDeque::new(),
+            tail_len: 0,
+            elided_stdout_bytes: 0,
+            elided_stderr_bytes: 0,
+            model_output: HeadTailBuffer::new(MODEL_FORMAT_LIMITS),
+        }
+    }
+
+    /// Appends a chunk read from `stream`. Slicing a `Bytes` only adjusts its
+    /// bounds, so splitting a chunk between head and tail does not copy.
+    pub(crate) fn push(&mut self, stream: ExecOutputStream, mut bytes: Bytes) {
+        self.model_output.push(&bytes);
+        let head_room = self.retention.head_bytes.saturating_sub(self.head_len);
+        if head_room > 0 {
+            let head_part = bytes.split_to(head_room.min(bytes.len()));
+            self.head_len += head_part.len();
+            self.head.push(OutputChunk {
+                stream,
+                bytes: head_part,
+            });
+        }
+        if bytes.is_empty() {
+            return;
+        }
+
+        self.tail_len += bytes.len();
+        self.tail.push_back(OutputChunk { stream, bytes });
+        while self.tail_len > self.retention.tail_bytes {
+            let excess = self.tail_len - self.retention.tail_bytes;
+            let Some(front) = self.tail.front_mut() else {
+                break;
+            };
+            let dropped = excess.min(front.bytes.len());
+            match front.stream {
+                ExecOutputStream::Stdout => self.elided_stdout_bytes += dropped as u64,
+                ExecOutputStream::Stderr => self.elided_stderr_bytes += dropped as u64,
+            }
+            self.tail_len -= dropped;
+            if dropped == front.bytes.len() {
+                self.tail.pop_front();
+            } else {
+                let _ = front.bytes.split_to(dropped);
+            }
+        }
+    }
+
+    /// Total number of bytes that were dropped between the head and the tail.
+    pub(crate) fn elided_bytes(&self) -> u64 {
+        self.elided_stdout_bytes + self.elided_stderr_bytes
+    }
+
+    /// Head and tail of the combined output, within the budget for the model.
+    pub(crate) fn model_output(&self) -> HeadTailBuffer {
+        self.model_output.clone()
+    }
+
+    /// Retained output of a single stream.
+    pub(crate) fn stream_output(&self, stream: ExecOutputStream) -> StreamOutput<Vec<u8>> {
+        let elided = match stream {
+            ExecOutputStream::Stdout => self.elided_stdout_bytes,
+            ExecOutputStream::Stderr => self.elided_stderr_bytes,
+        };
+        self.collect(|chunk_stream| chunk_stream == stream, elided)
+    }
+
+    /// Retained output of both streams, interleaved in arrival order.
+    pub(crate) fn aggregated_output(&self) -> StreamOutput<Vec<u8>> {
+        self.collect(|_| true, self.elided_bytes())
+    }
+
+    fn collect(
+        &self,
+        include: impl Fn(ExecOutputStream) -> bool,
+        elided: u64,
+    ) -> StreamOutput<Vec<u8>> {
+        let head = self.head.iter().filter(|chunk| include(chunk.stream));
+        let tail = self.tail.iter().filter(|chunk| include(chunk.stream));
+        let len: usize = head
+            .clone()
+            .chain(tail.clone())
+            .map(|c| c.bytes.len())
+            .sum();
+        let marker = (elided > 0).then(|| elision_marker(elided));
+        let mut text = Vec::with_capacity(len + marker.as_ref().map_or(0, String::len));
+        for chunk in head {
+            text.extend_from_slice(&chunk.bytes);
+        }
+        if let Some(marker) = &marker {
+            text.extend_from_slice(marker.as_bytes());
+        }
+        for chunk in tail {
+            text.extend_from_slice(&chunk.bytes);
+        }
+        StreamOutput {
+            text,
+            truncated_after_lines: None,
+        }
+    }
+}
+
+fn elision_marker(elided: u64) -> String {
+    format!("\n[... omitted {elided} bytes of output ...]\n")
+}
+
+/// Byte and line budgets for the two ends of a [`HeadTailBuffer`]. Use
+/// `usize::MAX` for a line budget that should not apply.
+#[derive(Clone, Copy, Debug)]
+pub struct HeadTailLimits {
+    pub head_bytes: usize,
+    pub tail_bytes: usize,
+    pub head_lines: usize,
+    pub tail_lines: usize,
+}
+
+/// What a rendering of a [`HeadTailBuffer`] leaves out, for use in its marker.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct Elision {
+    pub omitted_bytes: u64,
+    pub omitted_lines: u64,
+    pub total_lines: u64,
+}
+
+/// Keeps the beginning and the end of a byte stream within [`HeadTailLimits`]
+/// while it is being written, counting everything that falls in between.
+///
+/// Bytes go to the head until it reaches either of its budgets and to a ring
+/// buffer for the tail afterwards; the tail is trimmed from the front after
+/// every push. Memory use is therefore bounded by the limits, not by the
+/// length of the stream.
+#[derive(Clone, Debug)]
+pub struct HeadTailBuffer {
+    limits: HeadTailLimits,
+    head: Vec<u8>,
+    head_newlines: usize,
+    head_closed: bool,
+    tail: VecDeque<u8>,
+    tail_newlines: usize,
+    /// Whether the byte just before the front of `tail` was a newline.
+    tail_at_line_start: bool,
+    dropped_bytes: u64,
+    total_bytes: u64,
+    total_newlines: u64,
+    ends_with_newline: bool,
+}
+
+impl HeadTailBuffer {
+    pub fn new(limits: HeadTailLimits) -> Self {
+        Self {
+            limits,
+            head: Vec::new(),
+            head_newlines: 0,
+            head_closed: limits.head_bytes == 0 || limits.head_lines == 0,
+            tail: VecDeque::new(),
+            tail_newlines: 0,
+            tail_at_line_start: true,
+            dropped_bytes: 0,
+            total_bytes: 0,
+            total_newlines: 0,
+            ends_with_newline: false,
+        }
+    }
+
+    pub fn from_text(limits: HeadTailLimits, text: &str) -> Self {
+        let mut buffer = Self::new(limits);
+        buffer.push(text.as_bytes());
+        buffer
+    }
+
+    pub fn push(&mut self, mut data: &[u8]) {
+        let Some(&last) = data.last() else {
+            return;
+        };
+        self.total_bytes += data.len() as u64;
+        self.total_newlines += count_newlines(data) as u64;
+        self.ends_with_newline = last == b'\n';
+
+        if !self.head_closed {
+            let room = self.limits.head_bytes - self.head.len();
+            let lines_room = self.limits.head_lines - self.head_newlines;
+            let mut take = room.min(data.len());
+            if let Some(pos) = nth_newline(&data[..take], lines_room) {
+                take = pos + 1;
+            }
+            let (head_part, rest) = data.split_at(take);
+            let newlines = count_newlines(head_part);
+            self.head.extend_from_slice(head_part);
+            self.head_newlines += newlines;
+            if self.head.len() == self.limits.head_bytes
+                || self.head_newlines == self.limits.head_lines
+            {
+                self.head_closed = true;
+                self.tail_at_line_start = self.head.last().is_none_or(|b| *b == b'\n');
+            }
+            data = rest;
+        }
+        if data.is_empty() {
+            return;
+        }
+
+        self.tail.extend(data);
+        self.tail_newlines += count_newlines(data);
+        if self.tail.len() > self.limits.tail_bytes {
+            self.drop_tail_front(self.tail.len() - self.limits.tail_bytes);
+        }
+        let tail_lines = self.tail_newlines + usize::from(!self.ends_with_newline);
+        if tail_lines > self.limits.tail_lines {
+            let surplus = tail_lines - self.limits.tail_lines;
+            let end = self
+                .tail
+                .iter()
+                .enumerate()
+                .filter(|(_, b)| **b == b'\n')
+                .nth(surplus - 1)
+                .map_or(self.tail.len(), |(i, _)| i + 1);
+            self.drop_tail_front(end);
+        }
+    }
+
+    fn drop_tail_front(&mut self, n: usize) {
+        let mut newlines = 0;
+        let mut last = None;
+        for b in self.tail.drain(..n) {
+            newlines += usize::from(b == b'\n');
+            last = Some(b);
+        }
+        self.tail_newlines -= newlines;
+        self.dropped_bytes += n as u64;
+        if let Some(last) = last {
+            self.tail_at_line_start = last == b'\n';
+        }
+    }
+
+    pub fn total_bytes(&self) -> u64 {
+        self.total_bytes
+    }
+
+    /// Whether [`Self::render`] returns the whole stream for `max_bytes`.
+    pub fn fits(&self, max_bytes: usize) -> bool {
+        self.dropped_bytes == 0 && self.head.len() + self.tail.len() <= max_bytes
+    }
+
+    /// Renders the retained text in at most `max_bytes`, putting the text
+    /// returned by `marker` on its own line where the output was cut. Cuts
+    /// prefer line boundaries and always fall on char boundaries.
+    ///
+    /// If not even the marker fits, the marker for the whole stream is
+    /// returned on its own and may exceed `max_bytes`.
+    pub fn render(&self, max_bytes: usize, marker: impl Fn(&Elision) -> String) -> String {
+        if self.fits(max_bytes) {
+            let mut bytes = self.head.clone();
+            bytes.extend(&self.tail);
+            return String::from_utf8_lossy(&bytes).into_owned();
+        }
+
+        // The marker is sized for the case where nothing is kept, so the
+        // marker for the actual cut never needs more room than this.
+        let worst_case = marker(&self.elision("", ""));
+        // Room for the newlines around the marker.
+        let keep = max_bytes.saturating_sub(worst_case.len() + 2);
+        if keep == 0 {
+            return worst_case;
+        }
+
+        let head = utf8_prefix(&self.head);
+        let tail = utf8_suffix(self.tail.iter().copied().collect());
+        let head_budget = keep / 2;
+        let prefix = &head[..prefix_end(&head, head_budget)];
+        let suffix = &tail[suffix_start(&tail, keep - head_budget, self.tail_at_line_start)..];
+
+        let marker = marker(&self.elision(prefix, suffix));
+        let mut out = String::with_capacity(prefix.len() + marker.len() + suffix.len() + 2);
+        out.push_str(prefix);
+        if !prefix.is_empty() && !prefix.ends_with('\n') {
+            out.push('\n');
+        }
+        out.push_str(&marker);
+        out.push('\n');
+        out.push_str(suffix);
+        out
+    }
+
+    fn elision(&self, prefix: &str, suffix: &str) -> Elision {
+        let total_lines =
+            self.total_newlines + u64::from(self.total_bytes > 0 && !self.ends_with_newline);
+        Elision {
+            omitted_bytes: self
+                .total_bytes
+                .saturating_sub((prefix.len() + suffix.len()) as u64),
+            omitted_lines: total_lines.saturating_sub(count_lines(prefix) + count_lines(suffix)),
+            total_lines,
+        }
+    }
+}
+
+fn count_newlines(bytes: &[u8]) -> usize {
+    bytes.iter().filter(|b| **b == b'\n').count()
+}
+
+fn count_lines(s: &str) -> u64 {
+    (count_newlines(s.as_bytes()) + usize::from(!s.is_empty() && !s.ends_with('\n'))) as u64
+}
+
+/// Position of the `n`th newline in `bytes`, counting from one.
+fn nth_newline(bytes: &[u8], n: usize) -> Option<usize> {
+    let n = n.checked_sub(1)?;
+    bytes
+        .iter()
+        .enumerate()
+        .filter(|(_, b)| **b == b'\n')
+        .nth(n)
+        .map(|(i, _)| i)
+}
+
+/// Decodes `bytes`, dropping a char that was cut off at the end.
+fn utf8_prefix(bytes: &[u8]) -> String {
+    let end = match std::str::from_utf8(bytes) {
+        Err(err) if err.error_len().is_none() => err.valid_up_to(),
+        _ => bytes.len(),
+    };
+    String::from_utf8_lossy(&bytes[..end]).into_owned()
+}
+
+/// Decodes `bytes`, dropping a char that was cut off at the start.
+fn utf8_suffix(bytes: Vec<u8>) -> String {
+    let start = bytes
+        .iter()
+        .take(3)
+        .take_while(|b| (**b & 0xC0) == 0x80)
+        .count();
+    String::from_utf8_lossy(&bytes[start..]).into_owned()
+}
+
+fn prefix_end(head: &str, budget: usize) -> usize {
+    if head.len() <= budget {
+        return head.len();
+    }
+    let mut end = budget;
+    while !head.is_char_boundary(end) {
+        end -= 1;
+    }
+    head[..end].rfind('\n').map_or(end, |i| i + 1)
+}
+
+fn suffix_start(tail: &str, budget: usize, at_line_start: bool) -> usize {
+    let mut start = tail.len().saturating_sub(budget);
+    if start == 0 && at_line_start {
+        return 0;
+    }
+    while !tail.is_char_boundary(start) {
+        start += 1;
+    }
+    match tail[start..].find('\n') {
+        Some(i) if start + i + 1 < tail.len() => start + i + 1,
+        _ => start,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use pretty_assertions::assert_eq;
+
+    fn store(head_bytes: usize, tail_bytes: usize) -> ExecOutputStore {
+        ExecOutputStore::new(OutputRetention {
+            head_bytes,
+            tail_bytes,
+        })
+    }
+
+    fn text(output: StreamOutput<Vec<u8>>) -> String {
+        String::from_utf8(output.text).expect("utf8")
+    }
+
+    #[test]
+    fn small_output_is_kept_verbatim() {
+        let mut store = store(16, 16);
+        store.push(ExecOutputStream::Stdout, Bytes::from_static(b"out1\n"));
+        store.push(ExecOutputStream::Stderr, Bytes::from_static(b"err1\n"));
+        store.push(ExecOutputStream::Stdout, Bytes::from_static(b"out2\n"));
+
+        assert_eq!(store.elided_bytes(), 0);
+        assert_eq!(text(store.aggregated_output()), "out1\nerr1\nout2\n");
+        assert_eq!(
+            text(store.stream_output(ExecOutputStream::Stdout)),
+            "out1\nout2\n"
+        );
+        assert_eq!(
+            text(store.stream_output(ExecOutputStream::Stderr)),
+            "err1\n"
+        );
+    }
+
+    #[test]
+    fn middle_of_large_output_is_elided() {
+        let mut store = store(4, 4);
+        store.push(ExecOutputStream::Stdout, Bytes::from_static(b"0123456789"));
+        store.push(ExecOutputStream::Stderr, Bytes::from_static(b"abcdef"));
+
+        // Head keeps "0123", tail keeps "cdef"; "456789ab" is dropped.
+        assert_eq!(store.elided_bytes(), 8);
+        assert_eq!(
+            text(store.aggregated_output()),
+            format!("0123{}cdef", elision_marker(8))
+        );
+        assert_eq!(
+            text(store.stream_output(ExecOutputStream::Stdout)),
+            format!("0123{}", elision_marker(6))
+        );
+        assert_eq!(
+            text(store.stream_output(ExecOutputStream::Stderr)),
+            format!("{}cdef", elision_marker(2))
+        );
+    }
+
+    #[test]
+    fn retained_bytes_stay_bounded() {
+        let mut store = store(8, 8);
+        for _ in 0..10_000 {
+            store.push(ExecOutputStream::Stdout, Bytes::from_static(b"line\n"));
+        }
+        assert!(store.head_len <= 8);
+        assert!(store.tail_len <= 8);
+        assert_eq!(store.elided_bytes(), 10_000 * 5 - 16);
+    }
+
+    fn limits(bytes: usize, lines: usize) -> HeadTailLimits {
+        HeadTailLimits {
+            head_bytes: bytes,
+            tail_bytes: bytes,
+            head_lines: lines,
+            tail_lines: lines,
+        }
+    }
+
+    fn line_marker(elision: &Elision) -> String {
+        format!(
+            "[{} of {} lines, {} bytes]",
+            elision.omitted_lines, elision.total_lines, elision.omitted_bytes
+        )
+    }
+
+    #[test]
+    fn head_tail_keeps_short_output_verbatim() {
+        let mut buffer = HeadTailBuffer::new(limits(8, 2));
+        for chunk in ["a\n", "b\nc", "\nd"] {
+            buffer.push(chunk.as_bytes());
+        }
+        assert!(buffer.fits(64));
+        assert_eq!(buffer.render(64, line_marker), "a\nb\nc\nd");
+    }
+
+    #[test]
+    fn head_tail_bounds_lines_while_streaming() {
+        let mut buffer = HeadTailBuffer::new(limits(1024, 2));
+        for i in 1..=10_000 {
+            buffer.push(format!("line{i}\n").as_bytes());
+        }
+        assert_eq!(buffer.head_newlines, 2);
+        assert_eq!(buffer.tail_newlines, 2);
+        assert_eq!(
+            buffer.render(1024, line_marker),
+            "line1\nline2\n[9996 of 10000 lines, 88863 bytes]\nline9999\nline10000\n"
+        );
+    }
+
+    #[test]
+    fn head_tail_cuts_bytes_on_line_and_char_boundaries() {
+        // 40 lines of "é<n>\n" so that byte cuts land inside multibyte chars.
+        let text: String = (0..40).map(|i| format!("é{i:02}\n")).collect();
+        let mut buffer = HeadTailBuffer::new(limits(21, usize::MAX));
+        for chunk in text.as_bytes().chunks(3) {
+            buffer.push(chunk);
+        }
+        assert!(buffer.head.len() <= 21 && buffer.tail.len() <= 21);
+
+        let out = buffer.render(64, line_marker);
+        assert!(out.len() <= 64, "{out:?}");
+        let (head, rest) = out.split_once('[').expect("marker");
+        let (_, tail) = rest.split_once("]\n").expect("marker end");
+        assert!(head.ends_with('\n') && text.starts_with(head), "{head:?}");
+        assert!(tail.starts_with('é') && text.ends_with(tail), "{tail:?}");
+    }
+
+    #[test]
+    fn head_tail_returns_marker_alone_when_nothing_fits() {
+        let buffer = HeadTailBuffer::from_text(limits(4, usize::MAX), "0123456789");
+        assert_eq!(buffer.render(4, line_marker), "[1 of 1 lines, 10 bytes]");
+    }
+}
@@ -11,6 +11,7 @@ env_flags! {
         value.parse().map(Duration::from_millis)
     };
 
-    /// Fixture path for offline tests (see client.rs).
+    /// Fixture path for offline tests: an SSE file, or a directory with one
+    /// `.sse` file per request (see client.rs).
     pub CODEX_RS_SSE_FIXTURE: Option<&str> = None;
 }
@@ -1,6 +1,12 @@
+use std::collections::HashMap;
 use std::collections::HashSet;
 use std::path::Path;
 use std::path::PathBuf;
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::time::Duration;
+use std::time::SystemTime;
 
 use codex_protocol::mcp_protocol::GitSha;
 use futures::future::join_all;
@@ -10,6 +16,7 @@ use tokio::process::Command;
 use tokio::time::Duration as TokioDuration;
 use tokio::time::timeout;
 
+use crate::lru_cache::LruCache;
 use crate::util::is_inside_git_repo;
 
 /// Timeout for git commands to prevent freezing on large repositories
@@ -37,25 +44,37 @@ pub struct GitDiffToRemote {
 /// Collect git repository information from the given working directory using command-line git.
 /// Returns None if no git repository is found or if git operations fail.
 /// Uses timeouts to prevent freezing on large repositories.
-/// All git commands (except the initial repo check) run in parallel for better performance.
+/// All git commands run in parallel for better performance, and the result is cached per
+/// repository until its refs change.
 pub async fn collect_git_info(cwd: &Path) -> Option<GitInfo> {
-    // Check if we're in a git repository first
-    let is_git_repo = run_git_command_with_timeout(&["rev-parse", "--git-dir"], cwd)
-        .await?
-        .status
-        .success();
+    let cache_key = git_metadata_cache_key(cwd);
+    if let Some((git_dir, stamp)) = &cache_key
+        && let Some(git_info) = cached_git_metadata(git_dir, stamp).and_then(|m| m.info)
+    {
+        return Some(git_info);
+    }
 
-    if !is_git_repo {
-        return None;
+    let git_info = collect_git_info_uncached(cwd).await?;
+    if let Some((git_dir, stamp)) = cache_key {
+        update_cached_git_metadata(git_dir, stamp, |m| m.info = Some(git_info.clone()));
     }
+    Some(git_info)
+}
 
-    // Run all git info collection commands in parallel
-    let (commit_result, branch_result, url_result) = tokio::join!(
+async fn collect_git_info_uncached(cwd: &Path) -> Option<GitInfo> {
+    // Run the repo check alongside the info collection commands; the latter
+    // simply fail outside of a repository.
+    let (git_dir_result, commit_result, branch_result, url_result) = tokio::join!(
+        run_git_command_with_timeout(&["rev-parse", "--git-dir"], cwd),
         run_git_command_with_timeout(&["rev-parse", "HEAD"], cwd),
         run_git_command_with_timeout(&["rev-parse", "--abbrev-ref", "HEAD"], cwd),
         run_git_command_with_timeout(&["remote", "get-url", "origin"], cwd)
     );
 
+    if !git_dir_result?.status.success() {
+        return None;
+    }
+
     let mut git_info = GitInfo {
         commit_hash: None,
         branch: None,
@@ -98,9 +117,7 @@ pub async fn git_diff_to_remote(cwd: &Path) -> Option<GitDiffToRemote> {
         return None;
     }
 
-    let remotes = get_git_remotes(cwd).await?;
-    let branches = branch_ancestry(cwd).await?;
-    let base_sha = find_closest_sha(cwd, &branches, &remotes).await?;
+    let base_sha = closest_remote_sha(cwd).await?;
     let diff = diff_against_sha(cwd, &base_sha).await?;
 
     Some(GitDiffToRemote {
@@ -109,6 +126,125 @@ pub async fn git_diff_to_remote(cwd: &Path) -> Option<GitDiffToRemote> {
     })
 }
 
+/// The closest sha to HEAD that is on a remote. Cached per repository until its refs change;
+/// the diff against it depends on the working tree and is always recomputed.
+async fn closest_remote_sha(cwd: &Path) -> Option<GitSha> {
+    let cache_key = git_metadata_cache_key(cwd);
+    if let Some((git_dir, stamp)) = &cache_key
+        && let Some(sha) = cached_git_metadata(git_dir, stamp).and_then(|m| m.closest_remote_sha)
+    {
+        return Some(sha);
+    }
+
+    let remotes = get_git_remotes(cwd).await?;
+    let branches = branch_ancestry(cwd, &remotes).await?;
+    let sha = find_closest_sha(cwd, &branches, &remotes).await?;
+    if let Some((git_dir, stamp)) = cache_key {
+        update_cached_git_metadata(git_dir, stamp, |m| {
+            m.closest_remote_sha = Some(sha.clone());
+        });
+    }
+    Some(sha)
+}
+
+/// Number of repositories whose metadata is remembered.
+const GIT_METADATA_CACHE_CAPACITY: usize = 16;
+
+/// Files whose modification time is closer than this to the current time are not trusted to
+/// change again on the next update, since the update could fall within the same timestamp tick.
+const RACY_MTIME_WINDOW: Duration = Duration::from_secs(2);
+
+/// Git metadata that only changes when HEAD, the refs or the repository config change, shared by
+/// all sessions in the process.
+static GIT_METADATA_CACHE: LazyLock<Mutex<LruCache<PathBuf, CachedGitMetadata>>> =
+    LazyLock::new(|| Mutex::new(LruCache::new(GIT_METADATA_CACHE_CAPACITY)));
+
+#[derive(Clone, Debug, Default)]
+struct GitMetadata {
+    info: Option<GitInfo>,
+    closest_remote_sha: Option<GitSha>,
+}
+
+#[derive(Clone, Debug)]
+struct CachedGitMetadata {
+    stamp: GitStateStamp,
+    metadata: GitMetadata,
+}
+
+/// Modification times of `HEAD`, the config, the packed refs and every directory under `refs/`.
+/// Git updates loose refs by renaming a lock file into place, which bumps the mtime of the
+/// containing directory.
+#[derive(Clone, Debug, PartialEq, Eq)]
+struct GitStateStamp(Vec<Option<SystemTime>>);
+
+fn cached_git_metadata(git_dir: &Path, stamp: &GitStateStamp) -> Option<GitMetadata> {
+    let cached = GIT_METADATA_CACHE
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .get(git_dir)?;
+    (cached.stamp == *stamp).then_some(cached.metadata)
+}
+
+fn update_cached_git_metadata(
+    git_dir: PathBuf,
+    stamp: GitStateStamp,
+    update: impl FnOnce(&mut GitMetadata),
+) {
+    let mut cache = GIT_METADATA_CACHE
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner);
+    let mut metadata = cache
+        .get(&git_dir)
+        .filter(|cached| cached.stamp == stamp)
+        .map(|cached| cached.metadata)
+        .unwrap_or_default();
+    update(&mut metadata);
+    cache.insert(git_dir, CachedGitMetadata { stamp, metadata });
+}
+
+/// The `.git` directory for `cwd` and a stamp of its current state, or None when the metadata
+/// for `cwd` must not be cached: outside of a repository, in a linked worktree or submodule
+/// (where `.git` is a file), or when the refs changed too recently to trust their mtimes.
+fn git_metadata_cache_key(cwd: &Path) -> Option<(PathBuf, GitStateStamp)> {
+    let git_dir = cwd
+        .ancestors()
+        .map(|dir| dir.join(".git"))
+        .find(|git_dir| git_dir.exists())
+        .filter(|git_dir| git_dir.is_dir())?;
+    let stamp = git_state_stamp(&git_dir)?;
+    Some((git_dir, stamp))
+}
+
+fn git_state_stamp(git_dir: &Path) -> Option<GitStateStamp> {
+    let mut mtimes: Vec<Option<SystemTime>> = ["HEAD", "config", "packed-refs", "reftable"]
+        .iter()
+        .map(|name| mtime(&git_dir.join(name)))
+        .collect();
+    let mut pending = vec![git_dir.join("refs")];
+    while let Some(dir) = pending.pop() {
+        mtimes.push(mtime(&dir));
+        if let Ok(entries) = std::fs::read_dir(&dir) {
+            pending.extend(
+                entries
+                    .flatten()
+                    .filter(|entry| entry.file_type().is_ok_and(|t| t.is_dir()))
+                    .map(|entry| entry.path()),
+            );
+        }
+    }
+
+    let now = SystemTime::now();
+    let settled = mtimes.iter().flatten().all(|modified| {
+        now.duration_since(*modified)
+            .is_ok_and(|age| age >= RACY_MTIME_WINDOW)
+    });
+    settled.then_some(GitStateStamp(mtimes))
+}
+
+fn mtime(path: &Path) -> Option<SystemTime> {
+    std::fs::metadata(path).and_then(|m| m.modified()).ok()
+}
+
 /// Run a git command with a timeout to prevent blocking on large repositories
 async fn run_git_command_with_timeout(args: &[&str], cwd: &Path) -> Option<std::process::Output> {
     let result = timeout(
@@ -146,9 +282,8 @@ async fn get_git_remotes(cwd: &Path) -> Option<Vec<String>> {
 /// 1) The symbolic ref at `refs/remotes/<remote>/HEAD` for the first remote (origin prioritized)
 /// 2) `git remote show <remote>` parsed for "HEAD branch: <name>"
 /// 3) Local fallback to existing `main` or `master` if present
-async fn get_default_branch(cwd: &Path) -> Option<String> {
+async fn get_default_branch(cwd: &Path, remotes: &[String]) -> Option<String> {
     // Prefer the first remote (with origin prioritized)
-    let remotes = get_git_remotes(cwd).await.unwrap_or_default();
     for remote in remotes {
         // Try symbolic-ref, which returns something like: refs/remotes/origin/main
         if let Some(symref_output) = run_git_command_with_timeout(
@@ -171,7 +306,7 @@ async fn get_default_branch(cwd: &Path) -> Option<String> {
 
         // Fall back to parsing `git remote show <remote>` output
         if let Some(show_output) =
-            run_git_command_with_timeout(&["remote", "show", &remote], cwd).await
+            run_git_command_with_timeout(&["remote", "show", remote], cwd).await
             && show_output.status.success()
             && let Ok(text) = String::from_utf8(show_output.stdout)
         {
@@ -210,10 +345,16 @@ async fn get_default_branch(cwd: &Path) -> Option<String> {
 
 /// Build an ancestry of branches starting at the current branch and ending at the
 /// repository's default branch (if determinable)..
-async fn branch_ancestry(cwd: &Path) -> Option<Vec<String>> {
-    // Discover current branch (ignore detached HEAD by treating it as None)
-    let current_branch = run_git_command_with_timeout(&["rev-parse", "--abbrev-ref", "HEAD"], cwd)
-        .await
+async fn branch_ancestry(cwd: &Path, remotes: &[String]) -> Option<Vec<String>> {
+    // Discover the current branch, the default branch and the remote branches
+    // that contain HEAD concurrently.
+    let (current_branch, default_branch, remote_branches) = tokio::join!(
+        run_git_command_with_timeout(&["rev-parse", "--abbrev-ref", "HEAD"], cwd),
+        get_default_branch(cwd, remotes),
+        remote_branches_containing_head(cwd, remotes),
+    );
+    // Ignore detached HEAD by treating it as None
+    let current_branch = current_branch
         .and_then(|o| {
             if o.status.success() {
                 String::from_utf8(o.stdout).ok()
@@ -224,52 +365,15 @@ async fn branch_ancestry(cwd: &Path) -> Option<Vec<String>> {
         .map(|s| s.trim().to_string())
         .filter(|s| s != "HEAD");
 
-    // Discover default branch
-    let default_branch = get_default_branch(cwd).await;
-
     let mut ancestry: Vec<String> = Vec::new();
     let mut seen: HashSet<String> = HashSet::new();
-    if let Some(cb) = current_branch.clone() {
-        seen.insert(cb.clone());
-        ancestry.push(cb);
-    }
-    if let Some(db) = default_branch
-        && !seen.contains(&db)
+    for branch in current_branch
+        .into_iter()
+        .chain(default_branch)
+        .chain(remote_branches)
     {
-        seen.insert(db.clone());
-        ancestry.push(db);
-    }
-
-    // Expand candidates: include any remote branches that already contain HEAD.
-    // This addresses cases where we're on a new local-only branch forked from a
-    // remote branch that isn't the repository default. We prioritize remotes in
-    // the order returned by get_git_remotes (origin first).
-    let remotes = get_git_remotes(cwd).await.unwrap_or_default();
-    for remote in remotes {
-        if let Some(output) = run_git_command_with_timeout(
-            &[
-                "for-each-ref",
-                "--format=%(refname:short)",
-                "--contains=HEAD",
-                &format!("refs/remotes/{remote}"),
-            ],
-            cwd,
-        )
-        .await
-            && output.status.success()
-            && let Ok(text) = String::from_utf8(output.stdout)
-        {
-            for line in text.lines() {
-                let short = line.trim();
-                // Expect format like: "origin/feature"; extract the branch path after "remote/"
-                if let Some(stripped) = short.strip_prefix(&format!("{remote}/"))
-                    && !stripped.is_empty()
-                    && !seen.contains(stripped)
-                {
-                    seen.insert(stripped.to_string());
-                    ancestry.push(stripped.to_string());
-                }
-            }
+        if seen.insert(branch.clone()) {
+            ancestry.push(branch);
         }
     }
 
@@ -277,100 +381,127 @@ async fn branch_ancestry(cwd: &Path) -> Option<Vec<String>> {
     Some(ancestry)
 }
 
-// Helper for a single branch: return the remote SHA if present on any remote
-// and the distance (commits ahead of HEAD) for that branch. The first item is
-// None if the branch is not present on any remote. Returns None if distance
-// could not be computed due to git errors/timeouts.
-async fn branch_remote_and_distance(
-    cwd: &Path,
-    branch: &str,
-    remotes: &[String],
-) -> Option<(Option<GitSha>, usize)> {
-    // Try to find the first remote ref that exists for this branch (origin prioritized by caller).
-    let mut found_remote_sha: Option<GitSha> = None;
-    let mut found_remote_ref: Option<String> = None;
-    for remote in remotes {
-        let remote_ref = format!("refs/remotes/{remote}/{branch}");
-        let Some(verify_output) =
-            run_git_command_with_timeout(&["rev-parse", "--verify", "--quiet", &remote_ref], cwd)
-                .await
-        else {
-            // Mirror previous behavior: if the verify call times out/fails at the process level,
-            // treat the entire branch as unusable.
-            return None;
-        };
-        if !verify_output.status.success() {
-            continue;
+/// Branch names of remote branches that already contain HEAD, in the order of
+/// `remotes` (origin first).
+///
+/// This addresses cases where we're on a new local-only branch forked from a
+/// remote branch that isn't the repository default. All remotes are queried
+/// with a single `for-each-ref`.
+async fn remote_branches_containing_head(cwd: &Path, remotes: &[String]) -> Vec<String> {
+    if remotes.is_empty() {
+        // Without patterns, for-each-ref would list every ref.
+        return Vec::new();
+    }
+    let patterns: Vec<String> = remotes
+        .iter()
+        .map(|remote| format!("refs/remotes/{remote}"))
+        .collect();
+    let mut args = vec!["for-each-ref", "--format=%(refname)", "--contains=HEAD"];
+    args.extend(patterns.iter().map(String::as_str));
+    let Some(output) = run_git_command_with_timeout(&args, cwd).await else {
+        return Vec::new();
+    };
+    if !output.status.success() {
+        return Vec::new();
+    }
+    let Ok(text) = String::from_utf8(output.stdout) else {
+        return Vec::new();
+    };
+
+    let mut branches = Vec::new();
+    for pattern in &patterns {
+        let prefix = format!("{pattern}/");
+        for line in text.lines() {
+            // Expect format like: "refs/remotes/origin/feature"; extract the branch path after the remote.
+            if let Some(stripped) = line.trim().strip_prefix(&prefix)
+                && !stripped.is_empty()
+            {
+                branches.push(stripped.to_string());
+            }
         }
-        let Ok(sha) = String::from_utf8(verify_output.stdout) else {
-            // Mirror previous behavior and skip the entire branch on parse failure.
-            return None;
-        };
-        found_remote_sha = Some(GitSha::new(sha.trim()));
-        found_remote_ref = Some(remote_ref);
-        break;
     }
+    branches
+}
+
+/// Map of every remote-tracking ref name (`refs/remotes/<remote>/<branch>`) to the sha it
+/// points at, read with a single `for-each-ref`.
+async fn remote_ref_shas(cwd: &Path) -> Option<HashMap<String, GitSha>> {
+    let output = run_git_command_with_timeout(
+        &[
+            "for-each-ref",
+            "--format=%(objectname) %(refname)",
+            "refs/remotes",
+        ],
+        cwd,
+    )
+    .await?;
+    if !output.status.success() {
+        return None;
+    }
+    let text = String::from_utf8(output.stdout).ok()?;
+    Some(
+        text.lines()
+            .filter_map(|line| line.trim().split_once(' '))
+            .map(|(sha, refname)| (refname.to_string(), GitSha::new(sha)))
+            .collect(),
+    )
+}
 
-    // Compute distance as the number of commits HEAD is ahead of the branch.
-    // Prefer local branch name if it exists; otherwise fall back to the remote ref (if any).
-    let count_output = if let Some(local_count) =
-        run_git_command_with_timeout(&["rev-list", "--count", &format!("{branch}..HEAD")], cwd)
-            .await
+// Return the distance (commits ahead of HEAD) for a branch. Prefers the local
+// branch name if it exists; otherwise falls back to the remote ref. Returns None
+// if the distance could not be computed due to git errors/timeouts.
+async fn distance_from_head(cwd: &Path, branch: &str, remote_ref: &str) -> Option<usize> {
+    let count_output = match run_git_command_with_timeout(
+        &["rev-list", "--count", &format!("{branch}..HEAD")],
+        cwd,
+    )
+    .await
     {
-        if local_count.status.success() {
-            local_count
-        } else if let Some(remote_ref) = &found_remote_ref {
-            match run_git_command_with_timeout(
+        Some(local_count) if local_count.status.success() => local_count,
+        _ => {
+            run_git_command_with_timeout(
                 &["rev-list", "--count", &format!("{remote_ref}..HEAD")],
                 cwd,
             )
-            .await
-            {
-                Some(remote_count) => remote_count,
-                None => return None,
-            }
-        } else {
-            return None;
+            .await?
         }
-    } else if let Some(remote_ref) = &found_remote_ref {
-        match run_git_command_with_timeout(
-            &["rev-list", "--count", &format!("{remote_ref}..HEAD")],
-            cwd,
-        )
-        .await
-        {
-            Some(remote_count) => remote_count,
-            None => return None,
-        }
-    } else {
-        return None;
     };
 
     if !count_output.status.success() {
         return None;
     }
-    let Ok(distance_str) = String::from_utf8(count_output.stdout) else {
-        return None;
-    };
-    let Ok(distance) = distance_str.trim().parse::<usize>() else {
-        return None;
-    };
-
-    Some((found_remote_sha, distance))
+    let distance_str = String::from_utf8(count_output.stdout).ok()?;
+    distance_str.trim().parse::<usize>().ok()
 }
 
 // Finds the closest sha that exist on any of branches and also exists on any of the remotes.
 async fn find_closest_sha(cwd: &Path, branches: &[String], remotes: &[String]) -> Option<GitSha> {
+    let remote_shas = remote_ref_shas(cwd).await?;
+
+    // For each branch, the first remote (origin prioritized by caller) that has it.
+    // Branches that are not present on a remote are skipped.
+    let candidates: Vec<(GitSha, String, &str)> = branches
+        .iter()
+        .filter_map(|branch| {
+            remotes.iter().find_map(|remote| {
+                let remote_ref = format!("refs/remotes/{remote}/{branch}");
+                let sha = remote_shas.get(&remote_ref)?.clone();
+                Some((sha, remote_ref, branch.as_str()))
+            })
+        })
+        .collect();
+
+    let distances = join_all(
+        candidates
+            .iter()
+            .map(|(_, remote_ref, branch)| distance_from_head(cwd, branch, remote_ref)),
+    )
+    .await;
+
     // A sha and how many commits away from HEAD it is.
     let mut closest_sha: Option<(GitSha, usize)> = None;
-    for branch in branches {
-        let Some((maybe_remote_sha, distance)) =
-            branch_remote_and_distance(cwd, branch, remotes).await
-        else {
-            continue;
-        };
-        let Some(remote_sha) = maybe_remote_sha else {
-            // Preserve existing behavior: skip branches that are not present on a remote.
+    for ((remote_sha, _, _), distance) in candidates.into_iter().zip(distances) {
+        let Some(distance) = distance else {
             continue;
         };
         match &closest_sha {
@@ -685,6 +816,62 @@ mod tests {
         assert_eq!(git_info.branch, Some("feature-branch".to_string()));
     }
 
+    /// Set the mtime of everything under `dir` to `age` ago. Refs older than
+    /// `RACY_MTIME_WINDOW` count as settled.
+    fn backdate(dir: &Path, age: Duration) {
+        let modified = SystemTime::now() - age;
+        let mut pending = vec![dir.to_path_buf()];
+        while let Some(path) = pending.pop() {
+            if path.is_dir() {
+                pending.extend(fs::read_dir(&path).unwrap().map(|e| e.unwrap().path()));
+            }
+            fs::File::open(&path)
+                .unwrap()
+                .set_modified(modified)
+                .unwrap();
+        }
+    }
+
+    #[tokio::test]
+    async fn collect_git_info_is_cached_until_refs_change() {
+        let temp_dir = TempDir::new().expect("Failed to create temp dir");
+        let repo_path = create_test_git_repo(&temp_dir).await;
+        let git_dir = repo_path.join(".git");
+
+        // Refs written just now are too recent to be trusted. Stamp them explicitly instead of
+        // relying on the setup above having finished within the window.
+        backdate(&git_dir, Duration::ZERO);
+        assert!(git_metadata_cache_key(&repo_path).is_none());
+
+        backdate(&git_dir, Duration::from_secs(120));
+        let (cached_dir, stamp) =
+            git_metadata_cache_key(&repo_path).expect("settled refs should be cacheable");
+        assert_eq!(cached_dir, git_dir);
+        collect_git_info(&repo_path)
+            .await
+            .expect("Should collect git info from repo");
+
+        // Tamper with the cached entry to observe that it is served from the cache.
+        update_cached_git_metadata(cached_dir, stamp, |m| {
+            if let Some(info) = m.info.as_mut() {
+                info.branch = Some("cached".to_string());
+            }
+        });
+        let git_info = collect_git_info(&repo_path).await.expect("cached git info");
+        assert_eq!(git_info.branch, Some("cached".to_string()));
+
+        Command::new("git")
+            .args(["checkout", "-b", "feature-branch"])
+            .current_dir(&repo_path)
+            .output()
+            .await
+            .expect("Failed to create branch");
+        backdate(&git_dir, Duration::from_secs(60));
+
+        let git_info = collect_git_info(&repo_path).await.expect("fresh git info");
+        assert_eq!(git_info.branch, Some("feature-branch".to_string()));
+    }
+
     #[tokio::test]
     async fn test_get_git_working_tree_state_clean_repo() {
         let temp_dir = TempDir::new().expect("Failed to create temp dir");
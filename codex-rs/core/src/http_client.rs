@@ -0,0 +1,85 @@
+//! Process-wide HTTP clients for model providers.
+//!
+//! A `reqwest::Client` owns a connection pool, so creating one per
+//! [`ModelClient`](crate::client::ModelClient) would make every session (and
+//! every per-turn client) open its own connections and repeat the TLS
+//! handshake. Instead, all sessions that talk to the same provider share one
+//! client, which keeps its connections alive between requests and multiplexes
+//! concurrent streams over HTTP/2 when the server negotiates it.
+
+use std::collections::HashMap;
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::time::Duration;
+
+use codex_login::CodexAuth;
+use tracing::debug;
+
+use crate::model_provider_info::ModelProviderInfo;
+
+const TCP_KEEPALIVE: Duration = Duration::from_secs(30);
+const POOL_IDLE_TIMEOUT: Duration = Duration::from_secs(90);
+const HTTP2_KEEP_ALIVE_INTERVAL: Duration = Duration::from_secs(30);
+const PRECONNECT_TIMEOUT: Duration = Duration::from_secs(10);
+
+/// Provider settings that affect how the client is built. Headers and auth are
+/// applied per request, so providers that differ only in those share a client.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+struct ClientKey {
+    name: String,
+    base_url: Option<String>,
+    pool_max_idle_per_host: Option<usize>,
+}
+
+static CLIENTS: LazyLock<Mutex<HashMap<ClientKey, reqwest::Client>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+/// Returns the shared client for `provider`, creating it on first use.
+/// Cloning a `reqwest::Client` only clones a handle to the same pool.
+pub(crate) fn client_for_provider(provider: &ModelProviderInfo) -> reqwest::Client {
+    let key = ClientKey {
+        name: provider.name.clone(),
+        base_url: provider.base_url.clone(),
+        pool_max_idle_per_host: provider.pool_max_idle_per_host,
+    };
+    CLIENTS
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .entry(key)
+        .or_insert_with(|| build_client(provider))
+        .clone()
+}
+
+fn build_client(provider: &ModelProviderInfo) -> reqwest::Client {
+    let mut builder = reqwest::Client::builder()
+        .tcp_nodelay(true)
+        .tcp_keepalive(TCP_KEEPALIVE)
+        .pool_idle_timeout(POOL_IDLE_TIMEOUT)
+        .http2_keep_alive_interval(HTTP2_KEEP_ALIVE_INTERVAL)
+        .http2_keep_alive_while_idle(true)
+        .http2_adaptive_window(true);
+    if let Some(max_idle) = provider.pool_max_idle_per_host {
+        builder = builder.pool_max_idle_per_host(max_idle);
+    }
+    builder.build().unwrap_or_else(|err| {
+        debug!("failed to build tuned HTTP client, using defaults: {err}");
+        reqwest::Client::new()
+    })
+}
+
+/// Opens a connection to the provider's endpoint so that it is pooled by the
+/// time the first turn is sent. The response is irrelevant and errors are
+/// only logged: a failed pre-connect just means the first request connects
+/// on its own.
+pub(crate) async fn preconnect(
+    client: reqwest::Client,
+    provider: ModelProviderInfo,
+    auth: Option<CodexAuth>,
+) {
+    let url = provider.get_full_url(&auth);
+    match client.head(&url).timeout(PRECONNECT_TIMEOUT).send().await {
+        Ok(resp) => debug!("pre-connected to {url} ({})", resp.status()),
+        Err(err) => debug!("pre-connect to {url} failed: {err}"),
+    }
+}
@@ -20,16 +20,21 @@ mod conversation_history;
 pub mod custom_prompts;
 mod environment_context;
 pub mod error;
+pub mod event_queue;
 pub mod exec;
 mod exec_command;
 pub mod exec_env;
+mod exec_output;
 mod flags;
 pub mod git_info;
+mod http_client;
 mod is_safe_command;
 pub mod landlock;
+mod lru_cache;
 mod mcp_connection_manager;
 mod mcp_tool_call;
 mod message_history;
+pub mod model_load;
 mod model_provider_info;
 pub mod parse_command;
 pub use model_provider_info::BUILT_IN_OSS_MODEL_PROVIDER_ID;
@@ -45,14 +50,17 @@ mod openai_model_info;
 mod openai_tools;
 pub mod plan_tool;
 pub mod project_doc;
+mod request_body;
 mod rollout;
 pub(crate) mod safety;
 pub mod seatbelt;
 pub mod shell;
 pub mod spawn;
 pub mod terminal;
+mod token_estimator;
 mod tool_apply_patch;
 pub mod turn_diff_tracker;
+mod turn_metrics;
 pub mod user_agent;
 mod user_notification;
 pub mod util;
@@ -64,3 +72,11 @@ pub use codex_protocol::protocol;
 // Re-export protocol config enums to ensure call sites can use the same types
 // as those in the protocol crate when constructing protocol messages.
 pub use codex_protocol::config_types as protocol_config_types;
+
+/// Stream parsers exercised by the `codex-bench` hot-path benchmarks.
+#[cfg(feature = "bench")]
+#[doc(hidden)]
+pub mod bench {
+    pub use crate::chat_completions::count_chat_sse_events;
+    pub use crate::client::count_sse_events;
+}
@@ -0,0 +1,87 @@
+//! A small bounded cache with least-recently-used eviction.
+//!
+//! Meant for memoizing pure functions of short keys, such as command
+//! classification, where a session repeats the same few inputs many times.
+//! Capacities are small, so eviction simply scans for the oldest entry.
+
+use std::borrow::Borrow;
+use std::collections::HashMap;
+use std::hash::Hash;
+
+#[derive(Debug)]
+pub(crate) struct LruCache<K, V> {
+    capacity: usize,
+    tick: u64,
+    entries: HashMap<K, (V, u64)>,
+}
+
+impl<K: Clone + Eq + Hash, V: Clone> LruCache<K, V> {
+    pub(crate) fn new(capacity: usize) -> Self {
+        Self {
+            capacity: capacity.max(1),
+            tick: 0,
+            entries: HashMap::new(),
+        }
+    }
+
+    /// Returns a clone of the value cached for `key` and marks it as the most
+    /// recently used entry.
+    pub(crate) fn get<Q>(&mut self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Eq + Hash + ?Sized,
+    {
+        self.tick += 1;
+        let (value, last_used) = self.entries.get_mut(key)?;
+        *last_used = self.tick;
+        Some(value.clone())
+    }
+
+    /// Caches `value` for `key`, evicting the least recently used entry when
+    /// the cache is full.
+    pub(crate) fn insert(&mut self, key: K, value: V) {
+        self.tick += 1;
+        if self.entries.len() >= self.capacity
+            && !self.entries.contains_key(&key)
+            && let Some(oldest) = self
+                .entries
+                .iter()
+                .min_by_key(|(_, (_, last_used))| *last_used)
+                .map(|(key, _)| key.clone())
+        {
+            self.entries.remove(&oldest);
+        }
+        self.entries.insert(key, (value, self.tick));
+    }
+
+    #[cfg(test)]
+    pub(crate) fn len(&self) -> usize {
+        self.entries.len()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use pretty_assertions::assert_eq;
+
+    #[test]
+    fn evicts_the_least_recently_used_entry() {
+        let mut cache = LruCache::new(2);
+        cache.insert("a".to_string(), 1);
+        cache.insert("b".to_string(), 2);
+        // Touch "a" so that "b" becomes the oldest entry.
+        assert_eq!(cache.get("a"), Some(1));
+        cache.insert("c".to_string(), 3);
+
+        assert_eq!(cache.len(), 2);
+        assert_eq!(cache.get("b"), None);
+        assert_eq!(cache.get("a"), Some(1));
+        assert_eq!(cache.get("c"), Some(3));
+
+        // Replacing an existing key does not evict anything.
+        cache.insert("c".to_string(), 4);
+        assert_eq!(cache.len(), 2);
+        assert_eq!(cache.get("c"), Some(4));
+    }
+}
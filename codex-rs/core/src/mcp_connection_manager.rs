@@ -5,11 +5,28 @@
 //! helpers to query the available tools across *all* servers and returns them
 //! in a single aggregated map using the fully-qualified tool name
 //! `"<server><MCP_TOOL_NAME_DELIMITER><tool>"` as the key.
-
+//!
+//! The `tools/list` result of every server is persisted under
+//! `~/.codex/mcp_tools`, keyed by a hash of the server's command, args and
+//! env. Servers with a cached catalog are not spawned until one of their tools
+//! is called; the catalog is refreshed each time such a server starts, and a
+//! catalog older than [`TOOL_CACHE_REVALIDATE_AFTER`] is refreshed in the
+//! background by a short-lived server process. Servers
+//! that go unused for [`IDLE_SHUTDOWN_TIMEOUT`] are shut down and restarted on
+//! their next call.
+
+use std::collections::BTreeMap;
 use std::collections::HashMap;
 use std::collections::HashSet;
 use std::ffi::OsString;
+use std::path::Path;
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::sync::PoisonError;
+use std::sync::Weak;
 use std::time::Duration;
+use std::time::Instant;
+use std::time::SystemTime;
 
 use anyhow::Context;
 use anyhow::Result;
@@ -39,6 +56,19 @@ const MAX_TOOL_NAME_LENGTH: usize = 64;
 /// Timeout for the `tools/list` request.
 const LIST_TOOLS_TIMEOUT: Duration = Duration::from_secs(10);
 
+/// Directory under `~/.codex` that holds the cached `tools/list` results.
+const MCP_TOOLS_CACHE_SUBDIR: &str = "mcp_tools";
+
+/// Age after which a cached tool catalog is refreshed in the background when
+/// a session loads it.
+const TOOL_CACHE_REVALIDATE_AFTER: Duration = Duration::from_secs(60 * 60);
+
+/// How long a server may go without tool calls before it is shut down.
+const IDLE_SHUTDOWN_TIMEOUT: Duration = Duration::from_secs(10 * 60);
+
+/// How often running servers are checked for idleness.
+const IDLE_CHECK_INTERVAL: Duration = Duration::from_secs(60);
+
 /// Map that holds a startup error for every MCP server that could **not** be
 /// spawned successfully.
 pub type ClientStartErrors = HashMap<String, anyhow::Error>;
@@ -81,37 +111,243 @@ struct ToolInfo {
     tool: Tool,
 }
 
-/// A thin wrapper around a set of running [`McpClient`] instances.
+/// A configured MCP server whose process is spawned on first use and shut
+/// down again once it has been idle for [`IDLE_SHUTDOWN_TIMEOUT`].
+struct LazyMcpServer {
+    server_name: String,
+    config: McpServerConfig,
+    /// Where this server's `tools/list` result is persisted, if anywhere.
+    tool_cache_path: Option<PathBuf>,
+    /// The running client, if any. Held across startup so that concurrent
+    /// callers share a single spawn.
+    client: tokio::sync::Mutex<Option<Arc<McpClient>>>,
+    last_used: std::sync::Mutex<Instant>,
+}
+
+impl LazyMcpServer {
+    fn new(server_name: String, config: McpServerConfig, tool_cache_path: Option<PathBuf>) -> Self {
+        Self {
+            server_name,
+            config,
+            tool_cache_path,
+            client: tokio::sync::Mutex::new(None),
+            last_used: std::sync::Mutex::new(Instant::now()),
+        }
+    }
+
+    fn touch(&self) {
+        *self
+            .last_used
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner) = Instant::now();
+    }
+
+    fn idle_for(&self) -> Duration {
+        self.last_used
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .elapsed()
+    }
+
+    /// Return the running client, spawning and initializing the server first
+    /// if it is not running. A lazily started server refreshes its cached
+    /// tool catalog in the background.
+    async fn client(self: &Arc<Self>) -> Result<Arc<McpClient>> {
+        self.touch();
+        let mut guard = self.client.lock().await;
+        if let Some(client) = guard.as_ref() {
+            return Ok(client.clone());
+        }
+
+        let client = Arc::new(start_server(&self.config).await?);
+        *guard = Some(client.clone());
+        drop(guard);
+
+        self.spawn_idle_shutdown();
+        let server = self.clone();
+        let refresh_client = client.clone();
+        tokio::spawn(async move {
+            // The catalog advertised for this session stays as loaded; the
+            // refreshed copy is picked up by the next session.
+            if let Err(e) = server.list_tools_and_update_cache(&refresh_client).await {
+                warn!(
+                    "failed to refresh tool cache for MCP server `{}`: {e:#}",
+                    server.server_name
+                );
+            }
+        });
+        Ok(client)
+    }
+
+    async fn list_tools_and_update_cache(&self, client: &McpClient) -> Result<Vec<Tool>> {
+        let tools = client
+            .list_tools(None, Some(LIST_TOOLS_TIMEOUT))
+            .await?
+            .tools;
+        if let Some(path) = &self.tool_cache_path
+            && let Err(e) = write_tool_cache(path, &tools).await
+        {
+            warn!("failed to write MCP tool cache {}: {e}", path.display());
+        }
+        Ok(tools)
+    }
+
+    fn spawn_idle_shutdown(self: &Arc<Self>) {
+        let server = Arc::downgrade(self);
+        tokio::spawn(shut_down_when_idle(server));
+    }
+}
+
+/// Drop the server's client once no call is in flight and it has been idle
+/// for [`IDLE_SHUTDOWN_TIMEOUT`]. Dropping the client kills the process.
+async fn shut_down_when_idle(server: Weak<LazyMcpServer>) {
+    loop {
+        tokio::time::sleep(IDLE_CHECK_INTERVAL).await;
+        let Some(server) = server.upgrade() else {
+            return;
+        };
+        let mut guard = server.client.lock().await;
+        let Some(client) = guard.as_ref() else {
+            return;
+        };
+        // In-flight calls hold their own reference to the client.
+        if Arc::strong_count(client) == 1 && server.idle_for() >= IDLE_SHUTDOWN_TIMEOUT {
+            info!("shutting down idle MCP server `{}`", server.server_name);
+            *guard = None;
+            return;
+        }
+    }
+}
+
+/// Spawn the server described by `cfg` and perform the `initialize` handshake.
+async fn start_server(cfg: &McpServerConfig) -> Result<McpClient> {
+    let McpServerConfig { command, args, env } = cfg.clone();
+    let client = McpClient::new_stdio_client(
+        command.into(),
+        args.into_iter().map(OsString::from).collect(),
+        env,
+    )
+    .await?;
+
+    // Initialize the client.
+    let params = mcp_types::InitializeRequestParams {
+        capabilities: ClientCapabilities {
+            experimental: None,
+            roots: None,
+            sampling: None,
+            // https://modelcontextprotocol.io/specification/2025-06-18/client/elicitation#capabilities
+            // indicates this should be an empty object.
+            elicitation: Some(json!({})),
+        },
+        client_info: Implementation {
+            name: "codex-mcp-client".to_owned(),
+            version: env!("CARGO_PKG_VERSION").to_owned(),
+            title: Some("Codex".into()),
+        },
+        protocol_version: mcp_types::MCP_SCHEMA_VERSION.to_owned(),
+    };
+    let initialize_notification_params = None;
+    let timeout = Some(Duration::from_secs(10));
+    client
+        .initialize(params, initialize_notification_params, timeout)
+        .await?;
+    Ok(client)
+}
+
+/// Hash of everything that determines which server process gets spawned, so
+/// that a config change invalidates the cached tool catalog.
+fn tool_cache_key(cfg: &McpServerConfig) -> String {
+    let env: Option<BTreeMap<&String, &String>> = cfg.env.as_ref().map(|env| env.iter().collect());
+    let key = json!({
+        "command": cfg.command,
+        "args": cfg.args,
+        "env": env,
+    });
+    let mut hasher = Sha1::new();
+    hasher.update(key.to_string().as_bytes());
+    format!("{:x}", hasher.finalize())
+}
+
+async fn read_tool_cache(path: &Path) -> Option<Vec<Tool>> {
+    let bytes = tokio::fs::read(path).await.ok()?;
+    match serde_json::from_slice(&bytes) {
+        Ok(tools) => Some(tools),
+        Err(e) => {
+            warn!("ignoring malformed MCP tool cache {}: {e}", path.display());
+            None
+        }
+    }
+}
+
+/// Whether the cache file at `path` was written more than
+/// [`TOOL_CACHE_REVALIDATE_AFTER`] ago.
+async fn tool_cache_is_stale(path: &Path) -> bool {
+    let modified = match tokio::fs::metadata(path).await {
+        Ok(metadata) => metadata.modified(),
+        Err(e) => Err(e),
+    };
+    modified.is_ok_and(|modified| {
+        SystemTime::now()
+            .duration_since(modified)
+            .is_ok_and(|age| age >= TOOL_CACHE_REVALIDATE_AFTER)
+    })
+}
+
+async fn write_tool_cache(path: &Path, tools: &[Tool]) -> std::io::Result<()> {
+    let bytes = serde_json::to_vec(tools)?;
+    let path = path.to_path_buf();
+    tokio::task::spawn_blocking(move || {
+        let parent = path
+            .parent()
+            .ok_or_else(|| std::io::Error::other("tool cache path has no parent"))?;
+        std::fs::create_dir_all(parent)?;
+        // Write to a uniquely named temporary file first so that concurrent
+        // writers, in this process or others, never read or rename a
+        // partially written cache.
+        let mut tmp = tempfile::NamedTempFile::new_in(parent)?;
+        std::io::Write::write_all(&mut tmp, &bytes)?;
+        tmp.persist(&path).map_err(|e| e.error)?;
+        Ok(())
+    })
+    .await
+    .map_err(std::io::Error::other)?
+}
+
+/// A thin wrapper around a set of lazily started [`McpClient`] instances.
 #[derive(Default)]
 pub(crate) struct McpConnectionManager {
-    /// Server-name -> client instance.
+    /// Server-name -> server instance.
     ///
     /// The server name originates from the keys of the `mcp_servers` map in
     /// the user configuration.
-    clients: HashMap<String, std::sync::Arc<McpClient>>,
+    servers: HashMap<String, Arc<LazyMcpServer>>,
 
     /// Fully qualified tool name -> tool instance.
     tools: HashMap<String, ToolInfo>,
 }
 
 impl McpConnectionManager {
-    /// Spawn a [`McpClient`] for each configured server.
+    /// Prepare a [`McpClient`] for each configured server.
     ///
     /// * `mcp_servers` – Map loaded from the user configuration where *keys*
     ///   are human-readable server identifiers and *values* are the spawn
     ///   instructions.
+    /// * `codex_home` – Directory under which tool catalogs are cached.
     ///
-    /// Servers that fail to start are reported in `ClientStartErrors`: the
-    /// user should be informed about these errors.
+    /// Servers with a cached tool catalog are started on first use; the
+    /// others are started now to discover their tools. Servers that fail to
+    /// start here are reported in `ClientStartErrors`: the user should be
+    /// informed about these errors.
     pub async fn new(
         mcp_servers: HashMap<String, McpServerConfig>,
+        codex_home: &Path,
     ) -> Result<(Self, ClientStartErrors)> {
         // Early exit if no servers are configured.
         if mcp_servers.is_empty() {
             return Ok((Self::default(), ClientStartErrors::default()));
         }
 
-        // Launch all configured servers concurrently.
+        let cache_dir = codex_home.join(MCP_TOOLS_CACHE_SUBDIR);
         let mut join_set = JoinSet::new();
         let mut errors = ClientStartErrors::new();
 
@@ -126,69 +362,46 @@ impl McpConnectionManager {
                 continue;
             }
 
+            let tool_cache_path = cache_dir.join(format!("{}.json", tool_cache_key(&cfg)));
+            let server = Arc::new(LazyMcpServer::new(server_name, cfg, Some(tool_cache_path)));
+            // Load cached catalogs and start the remaining servers concurrently.
             join_set.spawn(async move {
-                let McpServerConfig { command, args, env } = cfg;
-                let client_res = McpClient::new_stdio_client(
-                    command.into(),
-                    args.into_iter().map(OsString::from).collect(),
-                    env,
-                )
-                .await;
-                match client_res {
-                    Ok(client) => {
-                        // Initialize the client.
-                        let params = mcp_types::InitializeRequestParams {
-                            capabilities: ClientCapabilities {
-                                experimental: None,
-                                roots: None,
-                                sampling: None,
-                                // https://modelcontextprotocol.io/specification/2025-06-18/client/elicitation#capabilities
-                                // indicates this should be an empty object.
-                                elicitation: Some(json!({})),
-                            },
-                            client_info: Implementation {
-                                name: "codex-mcp-client".to_owned(),
-                                version: env!("CARGO_PKG_VERSION").to_owned(),
-                                title: Some("Codex".into()),
-                            },
-                            protocol_version: mcp_types::MCP_SCHEMA_VERSION.to_owned(),
-                        };
-                        let initialize_notification_params = None;
-                        let timeout = Some(Duration::from_secs(10));
-                        match client
-                            .initialize(params, initialize_notification_params, timeout)
-                            .await
-                        {
-                            Ok(_response) => (server_name, Ok(client)),
-                            Err(e) => (server_name, Err(e)),
-                        }
-                    }
-                    Err(e) => (server_name, Err(e.into())),
-                }
+                let tools = load_server_tools(&server).await;
+                (server, tools)
             });
         }
 
-        let mut clients: HashMap<String, std::sync::Arc<McpClient>> =
+        let mut servers: HashMap<String, Arc<LazyMcpServer>> =
             HashMap::with_capacity(join_set.len());
+        let mut all_tools: Vec<ToolInfo> = Vec::new();
 
         while let Some(res) = join_set.join_next().await {
-            let (server_name, client_res) = res?; // JoinError propagation
-
-            match client_res {
-                Ok(client) => {
-                    clients.insert(server_name, std::sync::Arc::new(client));
+            let (server, tools_res) = res?; // JoinError propagation
+
+            match tools_res {
+                Ok(tools) => {
+                    all_tools.extend(tools.into_iter().map(|tool| ToolInfo {
+                        server_name: server.server_name.clone(),
+                        tool_name: tool.name.clone(),
+                        tool,
+                    }));
+                    servers.insert(server.server_name.clone(), server);
                 }
                 Err(e) => {
-                    errors.insert(server_name, e);
+                    errors.insert(server.server_name.clone(), e);
                 }
             }
         }
 
-        let all_tools = list_all_tools(&clients).await?;
+        info!(
+            "aggregated {} tools from {} servers",
+            all_tools.len(),
+            servers.len()
+        );
 
         let tools = qualify_tools(all_tools);
 
-        Ok((Self { clients, tools }, errors))
+        Ok((Self { servers, tools }, errors))
     }
 
     /// Returns a single map that contains **all** tools. Each key is the
@@ -208,16 +421,21 @@ impl McpConnectionManager {
         arguments: Option<serde_json::Value>,
         timeout: Option<Duration>,
     ) -> Result<mcp_types::CallToolResult> {
-        let client = self
-            .clients
+        let mcp_server = self
+            .servers
             .get(server)
-            .ok_or_else(|| anyhow!("unknown MCP server '{server}'"))?
-            .clone();
+            .ok_or_else(|| anyhow!("unknown MCP server '{server}'"))?;
+        let client = mcp_server
+            .client()
+            .await
+            .with_context(|| format!("MCP server `{server}` failed to start"))?;
 
-        client
+        let result = client
             .call_tool(tool.to_string(), arguments, timeout)
             .await
-            .with_context(|| format!("tool call failed for `{server}/{tool}`"))
+            .with_context(|| format!("tool call failed for `{server}/{tool}`"));
+        mcp_server.touch();
+        result
     }
 
     pub fn parse_tool_name(&self, tool_name: &str) -> Option<(String, String)> {
@@ -227,50 +445,43 @@ impl McpConnectionManager {
     }
 }
 
-/// Query every server for its available tools and return a single map that
-/// contains **all** tools. Each key is the fully-qualified name for the tool.
-async fn list_all_tools(
-    clients: &HashMap<String, std::sync::Arc<McpClient>>,
-) -> Result<Vec<ToolInfo>> {
-    let mut join_set = JoinSet::new();
-
-    // Spawn one task per server so we can query them concurrently. This
-    // keeps the overall latency roughly at the slowest server instead of
-    // the cumulative latency.
-    for (server_name, client) in clients {
-        let server_name_cloned = server_name.clone();
-        let client_clone = client.clone();
-        join_set.spawn(async move {
-            let res = client_clone
-                .list_tools(None, Some(LIST_TOOLS_TIMEOUT))
-                .await;
-            (server_name_cloned, res)
-        });
-    }
-
-    let mut aggregated: Vec<ToolInfo> = Vec::with_capacity(join_set.len());
-
-    while let Some(join_res) = join_set.join_next().await {
-        let (server_name, list_result) = join_res?;
-        let list_result = list_result?;
-
-        for tool in list_result.tools {
-            let tool_info = ToolInfo {
-                server_name: server_name.clone(),
-                tool_name: tool.name.clone(),
-                tool,
-            };
-            aggregated.push(tool_info);
+/// Return the tools of `server`, from its cached catalog when there is one.
+/// Otherwise the server is started right away and asked for its tools.
+async fn load_server_tools(server: &Arc<LazyMcpServer>) -> Result<Vec<Tool>> {
+    if let Some(path) = &server.tool_cache_path
+        && let Some(tools) = read_tool_cache(path).await
+    {
+        if tool_cache_is_stale(path).await {
+            tokio::spawn(revalidate_tool_cache(server.clone()));
         }
+        return Ok(tools);
     }
 
-    info!(
-        "aggregated {} tools from {} servers",
-        aggregated.len(),
-        clients.len()
-    );
+    let client = Arc::new(start_server(&server.config).await?);
+    *server.client.lock().await = Some(client.clone());
+    server.spawn_idle_shutdown();
+    server.list_tools_and_update_cache(&client).await
+}
 
-    Ok(aggregated)
+/// Refresh the cached tool catalog of `server` with a server process that
+/// exits again once it has listed its tools, unless the server is already
+/// running for a tool call. The catalog advertised for the current session
+/// stays as loaded.
+async fn revalidate_tool_cache(server: Arc<LazyMcpServer>) {
+    let running = server.client.lock().await.clone();
+    let result = match running {
+        Some(client) => server.list_tools_and_update_cache(&client).await,
+        None => match start_server(&server.config).await {
+            Ok(client) => server.list_tools_and_update_cache(&client).await,
+            Err(e) => Err(e),
+        },
+    };
+    if let Err(e) = result {
+        warn!(
+            "failed to revalidate tool cache for MCP server `{}`: {e:#}",
+            server.server_name
+        );
+    }
 }
 
 fn is_valid_mcp_server_name(server_name: &str) -> bool {
@@ -304,6 +515,101 @@ mod tests {
         }
     }
 
+    fn server_config(args: &[&str], env: &[(&str, &str)]) -> McpServerConfig {
+        McpServerConfig {
+            command: "server".to_string(),
+            args: args.iter().map(|arg| arg.to_string()).collect(),
+            env: (!env.is_empty()).then(|| {
+                env.iter()
+                    .map(|(k, v)| (k.to_string(), v.to_string()))
+                    .collect()
+            }),
+        }
+    }
+
+    #[test]
+    fn tool_cache_key_changes_with_the_spawn_instructions() {
+        let base = tool_cache_key(&server_config(&["--stdio"], &[("A", "1"), ("B", "2")]));
+        assert_eq!(
+            base,
+            tool_cache_key(&server_config(&["--stdio"], &[("B", "2"), ("A", "1")]))
+        );
+        assert_ne!(
+            base,
+            tool_cache_key(&server_config(&["--http"], &[("A", "1"), ("B", "2")]))
+        );
+        assert_ne!(
+            base,
+            tool_cache_key(&server_config(&["--stdio"], &[("A", "1"), ("B", "3")]))
+        );
+    }
+
+    #[tokio::test]
+    async fn cached_tool_catalog_is_served_without_starting_the_server() {
+        let codex_home = tempfile::tempdir().unwrap();
+        // A command that cannot be spawned: any attempt to start it fails.
+        let mut cfg = server_config(&[], &[]);
+        cfg.command = codex_home
+            .path()
+            .join("missing-server")
+            .display()
+            .to_string();
+        let cache_path = codex_home
+            .path()
+            .join(MCP_TOOLS_CACHE_SUBDIR)
+            .join(format!("{}.json", tool_cache_key(&cfg)));
+        let tool = create_test_tool("docs", "search").tool;
+        write_tool_cache(&cache_path, std::slice::from_ref(&tool))
+            .await
+            .unwrap();
+
+        let servers = HashMap::from([("docs".to_string(), cfg)]);
+        let (manager, errors) = McpConnectionManager::new(servers, codex_home.path())
+            .await
+            .unwrap();
+
+        assert!(errors.is_empty());
+        assert_eq!(
+            manager.list_all_tools(),
+            HashMap::from([("docs__search".to_string(), tool)])
+        );
+        let err = manager
+            .call_tool("docs", "search", None, None)
+            .await
+            .unwrap_err();
+        assert!(format!("{err:#}").contains("failed to start"), "{err:#}");
+    }
+
+    #[tokio::test]
+    async fn concurrent_tool_cache_writes_leave_a_complete_catalog() {
+        let codex_home = tempfile::tempdir().unwrap();
+        let cache_path = codex_home
+            .path()
+            .join(MCP_TOOLS_CACHE_SUBDIR)
+            .join("server.json");
+        let catalogs: Vec<Vec<Tool>> = (0..8)
+            .map(|i| {
+                (0..50)
+                    .map(|j| create_test_tool("docs", &format!("tool_{i}_{j}")).tool)
+                    .collect()
+            })
+            .collect();
+
+        let writes = catalogs
+            .iter()
+            .map(|tools| write_tool_cache(&cache_path, tools));
+        for result in futures::future::join_all(writes).await {
+            result.unwrap();
+        }
+
+        let cached = read_tool_cache(&cache_path).await.unwrap();
+        assert!(catalogs.contains(&cached));
+        // No temporary files are left behind.
+        let entries = std::fs::read_dir(cache_path.parent().unwrap()).unwrap();
+        assert_eq!(entries.count(), 1);
+        assert!(!tool_cache_is_stale(&cache_path).await);
+    }
+
     #[test]
     fn test_qualify_tools_short_non_duplicated_names() {
         let tools = vec![
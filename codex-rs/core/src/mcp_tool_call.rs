@@ -1,7 +1,9 @@
 use std::time::Duration;
 use std::time::Instant;
 
+use tracing::Instrument;
 use tracing::error;
+use tracing::info_span;
 
 use crate::codex::Session;
 use crate::protocol::Event;
@@ -59,8 +61,11 @@ pub(crate) async fn handle_mcp_tool_call(
     // Perform the tool call.
     let result = sess
         .call_tool(&server, &tool_name, arguments_value.clone(), timeout)
+        .instrument(info_span!("mcp_tool_call", server = %server, tool = %tool_name))
         .await
         .map_err(|e| format!("tool call error: {e}"));
+    sess.turn_metrics()
+        .tool_call(Duration::ZERO, start.elapsed());
     let tool_call_end_event = EventMsg::McpToolCallEnd(McpToolCallEndEvent {
         call_id: call_id.clone(),
         invocation,
@@ -13,11 +13,22 @@
 //! trailing `\n`) and write it with a **single `write(2)` system call** while
 //! the file descriptor is opened with the `O_APPEND` flag. POSIX guarantees
 //! that writes up to `PIPE_BUF` bytes are atomic in that case.
+//!
+//! Next to the history lives `history.jsonl.idx`, an index of where each entry
+//! starts, so that [`lookup`] reads a single entry instead of scanning the file
+//! and [`history_metadata`] does not count its lines. The index is only
+//! written while holding the exclusive lock on the history file and catches up
+//! with entries appended without it (for instance by older versions).
 
 use std::fs::File;
 use std::fs::OpenOptions;
+use std::io::BufRead;
+use std::io::BufReader;
 use std::io::Result;
+use std::io::Seek;
+use std::io::SeekFrom;
 use std::io::Write;
+use std::path::Path;
 use std::path::PathBuf;
 
 use serde::Deserialize;
@@ -38,6 +49,14 @@ use std::os::unix::fs::PermissionsExt;
 /// Filename that stores the message history inside `~/.codex`.
 const HISTORY_FILENAME: &str = "history.jsonl";
 
+/// Filename of the history index inside `~/.codex`. It starts with the
+/// identifier of the history file it describes (see [`file_id`]), followed by
+/// one little-endian `u64` per entry: the byte offset just past the entry's
+/// trailing newline.
+const HISTORY_INDEX_FILENAME: &str = "history.jsonl.idx";
+const INDEX_HEADER_LEN: u64 = 8;
+const INDEX_RECORD_LEN: u64 = 8;
+
 const MAX_RETRIES: usize = 10;
 const RETRY_SLEEP: Duration = Duration::from_millis(100);
 
@@ -54,6 +73,12 @@ fn history_filepath(config: &Config) -> PathBuf {
     path
 }
 
+fn history_index_filepath(config: &Config) -> PathBuf {
+    let mut path = config.codex_home.clone();
+    path.push(HISTORY_INDEX_FILENAME);
+    path
+}
+
 /// Append a `text` entry associated with `session_id` to the history file. Uses
 /// advisory file locking to ensure that concurrent writes do not interleave,
 /// which entails a small amount of blocking I/O internally.
@@ -111,9 +136,14 @@ pub(crate) async fn append_entry(text: &str, session_id: &Uuid, config: &Config)
     // We use sync I/O with spawn_blocking() because we are using a
     // [`std::fs::File`] instead of a [`tokio::fs::File`] to leverage an
     // advisory file locking API that is not available in the async API.
+    let index_path = history_index_filepath(config);
     tokio::task::spawn_blocking(move || -> Result<()> {
         history_file.write_all(line.as_bytes())?;
         history_file.flush()?;
+        // The entry is saved; a stale index is caught up by the next update.
+        if let Err(e) = update_index(&history_file, &index_path) {
+            tracing::warn!(error = %e, "failed to update history index");
+        }
         Ok(())
     })
     .await??;
@@ -147,7 +177,8 @@ async fn acquire_exclusive_lock_with_retry(file: &File) -> Result<()> {
 }
 
 /// Asynchronously fetch the history file's *identifier* (inode on Unix) and
-/// the current number of entries by counting newline characters.
+/// the current number of entries. The count comes from the index, which is
+/// brought up to date first; if that fails, newline characters are counted.
 pub(crate) async fn history_metadata(config: &Config) -> (u64, usize) {
     let path = history_filepath(config);
 
@@ -165,6 +196,11 @@ pub(crate) async fn history_metadata(config: &Config) -> (u64, usize) {
     #[cfg(not(unix))]
     let log_id = 0u64;
 
+    match indexed_entry_count(&path, &history_index_filepath(config)).await {
+        Ok(count) => return (log_id, count),
+        Err(e) => tracing::warn!(error = %e, "failed to read history index"),
+    }
+
     // Open the file.
     let mut file = match fs::File::open(&path).await {
         Ok(f) => f,
@@ -187,6 +223,17 @@ pub(crate) async fn history_metadata(config: &Config) -> (u64, usize) {
     (log_id, count)
 }
 
+/// Updates the index of the history file at `path` under the exclusive lock
+/// and returns the number of entries it holds.
+async fn indexed_entry_count(path: &Path, index_path: &Path) -> Result<usize> {
+    let history_file = OpenOptions::new().read(true).open(path)?;
+    acquire_exclusive_lock_with_retry(&history_file).await?;
+    let index_path = index_path.to_path_buf();
+    let entries =
+        tokio::task::spawn_blocking(move || update_index(&history_file, &index_path)).await??;
+    usize::try_from(entries).map_err(std::io::Error::other)
+}
+
 /// Given a `log_id` (on Unix this is the file's inode number) and a zero-based
 /// `offset`, return the corresponding `HistoryEntry` if the identifier matches
 /// the current history file **and** the requested offset exists. Any I/O or
@@ -196,8 +243,6 @@ pub(crate) async fn history_metadata(config: &Config) -> (u64, usize) {
 /// locking API.
 #[cfg(unix)]
 pub(crate) fn lookup(log_id: u64, offset: usize, config: &Config) -> Option<HistoryEntry> {
-    use std::io::BufRead;
-    use std::io::BufReader;
     use std::os::unix::fs::MetadataExt;
 
     let path = history_filepath(config);
@@ -227,6 +272,12 @@ pub(crate) fn lookup(log_id: u64, offset: usize, config: &Config) -> Option<Hist
         return None;
     }
 
+    match indexed_entry_range(&file, &history_index_filepath(config), offset) {
+        Ok(Some((start, end))) => return read_entry_at(&file, start, end),
+        Ok(None) => {}
+        Err(e) => tracing::warn!(error = %e, "failed to read history index"),
+    }
+
     let reader = BufReader::new(&file);
     for (idx, line_res) in reader.lines().enumerate() {
         let line = match line_res {
@@ -251,6 +302,55 @@ pub(crate) fn lookup(log_id: u64, offset: usize, config: &Config) -> Option<Hist
     None
 }
 
+/// Reads and parses the entry stored at `start..end` of the history file,
+/// where `end` is just past its trailing newline.
+#[cfg(unix)]
+fn read_entry_at(file: &File, start: u64, end: u64) -> Option<HistoryEntry> {
+    let len = end.saturating_sub(start + 1);
+    let mut line = vec![0u8; usize::try_from(len).ok()?];
+    if let Err(e) = read_exact_at(file, &mut line, start) {
+        tracing::warn!(error = %e, "failed to read line from history file");
+        return None;
+    }
+    match serde_json::from_slice::<HistoryEntry>(&line) {
+        Ok(entry) => Some(entry),
+        Err(e) => {
+            tracing::warn!(error = %e, "failed to parse history entry");
+            None
+        }
+    }
+}
+
+/// Returns the byte range of entry `offset` according to the index, or `None`
+/// when the index is missing, stale or does not reach `offset`. The caller
+/// must hold a lock on `history`.
+#[cfg(unix)]
+fn indexed_entry_range(
+    history: &File,
+    index_path: &Path,
+    offset: usize,
+) -> Result<Option<(u64, u64)>> {
+    let index = match File::open(index_path) {
+        Ok(f) => f,
+        Err(e) if e.kind() == std::io::ErrorKind::NotFound => return Ok(None),
+        Err(e) => return Err(e),
+    };
+    let Some((entries, _)) = read_index_state(&index, history)? else {
+        return Ok(None);
+    };
+    let offset = offset as u64;
+    if offset >= entries {
+        return Ok(None);
+    }
+    let start = if offset == 0 {
+        0
+    } else {
+        read_index_record(&index, offset - 1)?
+    };
+    let end = read_index_record(&index, offset)?;
+    Ok(Some((start, end)))
+}
+
 /// Fallback stub for non-Unix systems: currently always returns `None`.
 #[cfg(not(unix))]
 pub(crate) fn lookup(log_id: u64, offset: usize, config: &Config) -> Option<HistoryEntry> {
@@ -278,6 +378,130 @@ fn acquire_shared_lock_with_retry(file: &File) -> Result<()> {
     ))
 }
 
+/// Identifier of the history file stored in the index header, so that an
+/// index left behind by a replaced history file is not trusted.
+fn file_id(file: &File) -> Result<u64> {
+    #[cfg(unix)]
+    {
+        use std::os::unix::fs::MetadataExt;
+        Ok(file.metadata()?.ino())
+    }
+    #[cfg(not(unix))]
+    {
+        let _ = file;
+        Ok(0)
+    }
+}
+
+/// Brings the index at `index_path` up to date with `history` by indexing the
+/// entries appended since its last update, or all of them when the index is
+/// missing or stale. Returns the number of indexed entries. A trailing line
+/// without a newline is not indexed until it is complete. The caller must
+/// hold the exclusive lock on `history`.
+fn update_index(history: &File, index_path: &Path) -> Result<u64> {
+    let mut options = OpenOptions::new();
+    options.read(true).write(true).create(true);
+    #[cfg(unix)]
+    {
+        options.mode(0o600);
+    }
+    let mut index = options.open(index_path)?;
+
+    let (mut entries, covered) = match read_index_state(&index, history)? {
+        Some(state) => state,
+        None => {
+            index.set_len(0)?;
+            index.seek(SeekFrom::Start(0))?;
+            index.write_all(&file_id(history)?.to_le_bytes())?;
+            (0, 0)
+        }
+    };
+
+    let mut reader = BufReader::new(history);
+    reader.seek(SeekFrom::Start(covered))?;
+    let mut records = Vec::new();
+    let mut pos = covered;
+    loop {
+        let buf = reader.fill_buf()?;
+        if buf.is_empty() {
+            break;
+        }
+        for (i, _) in buf.iter().enumerate().filter(|(_, b)| **b == b'\n') {
+            records.extend_from_slice(&(pos + i as u64 + 1).to_le_bytes());
+        }
+        let n = buf.len();
+        pos += n as u64;
+        reader.consume(n);
+    }
+
+    if !records.is_empty() {
+        index.seek(SeekFrom::Start(
+            INDEX_HEADER_LEN + entries * INDEX_RECORD_LEN,
+        ))?;
+        index.write_all(&records)?;
+        entries += records.len() as u64 / INDEX_RECORD_LEN;
+    }
+    Ok(entries)
+}
+
+/// Returns the number of entries in `index` and the history byte offset it
+/// covers, or `None` when the index does not describe `history`: it is
+/// empty, truncated mid-record, written for another file, or points past the
+/// end of an entry.
+fn read_index_state(index: &File, history: &File) -> Result<Option<(u64, u64)>> {
+    let index_len = index.metadata()?.len();
+    if index_len < INDEX_HEADER_LEN
+        || !(index_len - INDEX_HEADER_LEN).is_multiple_of(INDEX_RECORD_LEN)
+    {
+        return Ok(None);
+    }
+    let mut header = [0u8; INDEX_HEADER_LEN as usize];
+    read_exact_at(index, &mut header, 0)?;
+    if u64::from_le_bytes(header) != file_id(history)? {
+        return Ok(None);
+    }
+
+    let entries = (index_len - INDEX_HEADER_LEN) / INDEX_RECORD_LEN;
+    if entries == 0 {
+        return Ok(Some((0, 0)));
+    }
+    let covered = read_index_record(index, entries - 1)?;
+    if covered == 0 || covered > history.metadata()?.len() {
+        return Ok(None);
+    }
+    let mut last = [0u8; 1];
+    read_exact_at(history, &mut last, covered - 1)?;
+    if last[0] != b'\n' {
+        return Ok(None);
+    }
+    Ok(Some((entries, covered)))
+}
+
+fn read_index_record(index: &File, entry: u64) -> Result<u64> {
+    let mut record = [0u8; INDEX_RECORD_LEN as usize];
+    read_exact_at(
+        index,
+        &mut record,
+        INDEX_HEADER_LEN + entry * INDEX_RECORD_LEN,
+    )?;
+    Ok(u64::from_le_bytes(record))
+}
+
+/// Reads at `offset` without moving the file cursor on Unix, where lookups
+/// fall back to scanning the history from the start.
+#[cfg(unix)]
+fn read_exact_at(file: &File, buf: &mut [u8], offset: u64) -> Result<()> {
+    use std::os::unix::fs::FileExt;
+    file.read_exact_at(buf, offset)
+}
+
+#[cfg(not(unix))]
+fn read_exact_at(mut file: &File, buf: &mut [u8], offset: u64) -> Result<()> {
+    use std::io::Read;
+    file.seek(SeekFrom::Start(offset))?;
+    file.read_exact(buf)
+}
+
 /// On Unix systems ensure the file permissions are `0o600` (rw-------). If the
 /// permissions cannot be changed the error is propagated to the caller.
 #[cfg(unix)]
@@ -299,3 +523,85 @@ async fn ensure_owner_only_permissions(_file: &File) -> Result<()> {
     // For now, on non-Unix, simply succeed.
     Ok(())
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use pretty_assertions::assert_eq;
+    use tempfile::TempDir;
+
+    fn entry_line(text: &str) -> String {
+        let entry = HistoryEntry {
+            session_id: "session".to_string(),
+            ts: 1,
+            text: text.to_string(),
+        };
+        format!("{}\n", serde_json::to_string(&entry).unwrap())
+    }
+
+    fn append(path: &Path, data: &str) {
+        let mut file = OpenOptions::new()
+            .append(true)
+            .create(true)
+            .open(path)
+            .unwrap();
+        file.write_all(data.as_bytes()).unwrap();
+    }
+
+    #[cfg(unix)]
+    fn indexed_text(history: &File, index_path: &Path, offset: usize) -> Option<String> {
+        let (start, end) = indexed_entry_range(history, index_path, offset).unwrap()?;
+        read_entry_at(history, start, end).map(|entry| entry.text)
+    }
+
+    #[test]
+    fn index_catches_up_with_appended_entries() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join(HISTORY_FILENAME);
+        let index_path = dir.path().join(HISTORY_INDEX_FILENAME);
+        append(&path, &(entry_line("one") + &entry_line("two")));
+
+        let history = File::open(&path).unwrap();
+        assert_eq!(update_index(&history, &index_path).unwrap(), 2);
+
+        // A partially written line is left for a later update.
+        let third = entry_line("three");
+        let (head, tail) = third.split_at(5);
+        append(&path, head);
+        assert_eq!(update_index(&history, &index_path).unwrap(), 2);
+        append(&path, tail);
+        assert_eq!(update_index(&history, &index_path).unwrap(), 3);
+
+        #[cfg(unix)]
+        {
+            assert_eq!(
+                indexed_text(&history, &index_path, 0).as_deref(),
+                Some("one")
+            );
+            assert_eq!(
+                indexed_text(&history, &index_path, 2).as_deref(),
+                Some("three")
+            );
+            assert_eq!(indexed_entry_range(&history, &index_path, 3).unwrap(), None);
+        }
+    }
+
+    #[test]
+    fn stale_index_is_rebuilt() {
+        let dir = TempDir::new().unwrap();
+        let path = dir.path().join(HISTORY_FILENAME);
+        let index_path = dir.path().join(HISTORY_INDEX_FILENAME);
+        append(
+            &path,
+            &(entry_line("first entry") + &entry_line("second entry")),
+        );
+        let history = File::open(&path).unwrap();
+        assert_eq!(update_index(&history, &index_path).unwrap(), 2);
+
+        // Rewrite the history in place with entries of different lengths.
+        std::fs::write(&path, entry_line("a") + &entry_line("b") + &entry_line("c")).unwrap();
+        assert_eq!(update_index(&history, &index_path).unwrap(), 3);
+        #[cfg(unix)]
+        assert_eq!(indexed_text(&history, &index_path, 1).as_deref(), Some("b"));
+    }
+}
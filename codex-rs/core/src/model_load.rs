@@ -0,0 +1,112 @@
+//! Tracks models that a local provider is still loading in response to a
+//! warm-up request, so that the first turn waits for that load instead of
+//! sending a second cold request alongside it.
+
+use std::collections::HashMap;
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::time::Duration;
+use std::time::Instant;
+
+use tokio::sync::watch;
+
+/// Longest a request waits for a warm-up before it is sent anyway.
+const MAX_MODEL_LOAD_WAIT: Duration = Duration::from_secs(300);
+
+/// `(provider id, model)`.
+type ModelKey = (String, String);
+
+/// Receivers whose sender is dropped once the model has loaded.
+static LOADING: LazyLock<Mutex<HashMap<ModelKey, watch::Receiver<()>>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+/// Held while a warm-up request for a model is in flight. Dropping it, whether
+/// the load succeeded or not, releases requests waiting on the model.
+#[derive(Debug)]
+pub struct ModelLoadGuard {
+    key: ModelKey,
+    loaded: watch::Sender<()>,
+}
+
+/// Marks `model` of provider `provider_id` as loading until the returned guard
+/// is dropped.
+pub fn begin_model_load(provider_id: &str, model: &str) -> ModelLoadGuard {
+    let key = (provider_id.to_string(), model.to_string());
+    let (loaded, rx) = watch::channel(());
+    LOADING
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .insert(key.clone(), rx);
+    ModelLoadGuard { key, loaded }
+}
+
+impl Drop for ModelLoadGuard {
+    fn drop(&mut self) {
+        let ours = self.loaded.subscribe();
+        let mut loading = LOADING.lock().unwrap_or_else(PoisonError::into_inner);
+        // A later warm-up of the same model may have replaced this one.
+        if loading
+            .get(&self.key)
+            .is_some_and(|rx| rx.same_channel(&ours))
+        {
+            loading.remove(&self.key);
+        }
+    }
+}
+
+/// Waits until no warm-up of `model` is in flight, or until
+/// [`MAX_MODEL_LOAD_WAIT`] has passed, and returns how long it waited.
+pub(crate) async fn wait_for_model_load(provider_id: &str, model: &str) -> Duration {
+    let rx = LOADING
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .get(&(provider_id.to_string(), model.to_string()))
+        .cloned();
+    let Some(mut rx) = rx else {
+        return Duration::ZERO;
+    };
+    let start = Instant::now();
+    // Nothing is ever sent, so this resolves when the guard is dropped.
+    let _ = tokio::time::timeout(MAX_MODEL_LOAD_WAIT, rx.changed()).await;
+    start.elapsed()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[tokio::test]
+    async fn waits_until_the_guard_is_dropped() {
+        assert_eq!(
+            wait_for_model_load("test-provider", "unloaded").await,
+            Duration::ZERO
+        );
+
+        let guard = begin_model_load("test-provider", "loading");
+        let waiter = tokio::spawn(wait_for_model_load("test-provider", "loading"));
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        assert!(!waiter.is_finished());
+
+        drop(guard);
+        let waited = waiter.await.expect("waiter task");
+        assert!(waited >= Duration::from_millis(20));
+        assert_eq!(
+            wait_for_model_load("test-provider", "loading").await,
+            Duration::ZERO
+        );
+    }
+
+    #[tokio::test]
+    async fn dropping_a_replaced_guard_keeps_the_newer_load() {
+        let first = begin_model_load("test-provider", "reloaded");
+        let second = begin_model_load("test-provider", "reloaded");
+        drop(first);
+
+        let waiter = tokio::spawn(wait_for_model_load("test-provider", "reloaded"));
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        assert!(!waiter.is_finished());
+        drop(second);
+        waiter.await.expect("waiter task");
+    }
+}
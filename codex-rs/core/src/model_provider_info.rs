@@ -80,6 +80,16 @@ pub struct ModelProviderInfo {
     /// the connection as lost.
     pub stream_idle_timeout_ms: Option<u64>,
 
+    /// Maximum number of idle connections per host kept by the HTTP client that
+    /// all sessions using this provider share.
+    pub pool_max_idle_per_host: Option<usize>,
+
+    /// Open a connection to the provider as soon as a session is configured,
+    /// so the first turn does not wait for DNS resolution and the TLS
+    /// handshake.
+    #[serde(default)]
+    pub preconnect: bool,
+
     /// Whether this provider requires some form of standard authentication (API key, ChatGPT token).
     #[serde(default)]
     pub requires_openai_auth: bool,
@@ -278,6 +288,8 @@ pub fn built_in_model_providers() -> HashMap<String, ModelProviderInfo> {
                 request_max_retries: None,
                 stream_max_retries: None,
                 stream_idle_timeout_ms: None,
+                pool_max_idle_per_host: None,
+                preconnect: false,
                 requires_openai_auth: true,
             },
         ),
@@ -322,6 +334,8 @@ pub fn create_oss_provider_with_base_url(base_url: &str) -> ModelProviderInfo {
         request_max_retries: None,
         stream_max_retries: None,
         stream_idle_timeout_ms: None,
+        pool_max_idle_per_host: None,
+        preconnect: false,
         requires_openai_auth: false,
     }
 }
@@ -349,6 +363,8 @@ base_url = "http://localhost:11434/v1"
             request_max_retries: None,
             stream_max_retries: None,
             stream_idle_timeout_ms: None,
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
 
@@ -378,6 +394,8 @@ query_params = { api-version = "2025-04-01-preview" }
             request_max_retries: None,
             stream_max_retries: None,
             stream_idle_timeout_ms: None,
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
 
@@ -410,6 +428,8 @@ env_http_headers = { "X-Example-Env-Header" = "EXAMPLE_ENV_VAR" }
             request_max_retries: None,
             stream_max_retries: None,
             stream_idle_timeout_ms: None,
+            pool_max_idle_per_host: None,
+            preconnect: false,
             requires_openai_auth: false,
         };
 
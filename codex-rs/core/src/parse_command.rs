@@ -1,9 +1,19 @@
-use crate::bash::try_parse_bash;
-use crate::bash::try_parse_word_only_commands_sequence;
+use crate::bash::parse_bash_lc_plain_commands;
+use crate::lru_cache::LruCache;
 use serde::Deserialize;
 use serde::Serialize;
 use shlex::split as shlex_split;
 use shlex::try_join as shlex_try_join;
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+
+/// Number of distinct commands whose summaries are remembered; agents repeat
+/// the same commands (`git status`, `cargo test -p x`) many times a session.
+const PARSED_COMMANDS_CACHE_CAPACITY: usize = 256;
+
+static PARSED_COMMANDS_CACHE: LazyLock<Mutex<LruCache<Vec<String>, Vec<ParsedCommand>>>> =
+    LazyLock::new(|| Mutex::new(LruCache::new(PARSED_COMMANDS_CACHE_CAPACITY)));
 
 #[derive(Debug, Clone, PartialEq, Eq, Deserialize, Serialize)]
 pub enum ParsedCommand {
@@ -75,6 +85,14 @@ fn shlex_join(tokens: &[String]) -> String {
 /// The goal of the parsed metadata is to be able to provide the user with a human readable gis
 /// of what it is doing.
 pub fn parse_command(command: &[String]) -> Vec<ParsedCommand> {
+    if let Some(parsed) = PARSED_COMMANDS_CACHE
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .get(command)
+    {
+        return parsed;
+    }
+
     // Parse and then collapse consecutive duplicate commands to avoid redundant summaries.
     let parsed = parse_command_impl(command);
     let mut deduped: Vec<ParsedCommand> = Vec::with_capacity(parsed.len());
@@ -84,6 +102,10 @@ pub fn parse_command(command: &[String]) -> Vec<ParsedCommand> {
         }
         deduped.push(cmd);
     }
+    PARSED_COMMANDS_CACHE
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner)
+        .insert(command.to_vec(), deduped.clone());
     deduped
 }
 
@@ -1562,8 +1584,7 @@ fn parse_bash_lc_commands(original: &[String]) -> Option<Vec<ParsedCommand>> {
     if bash != "bash" || flag != "-lc" {
         return None;
     }
-    if let Some(tree) = try_parse_bash(script)
-        && let Some(all_commands) = try_parse_word_only_commands_sequence(&tree, script)
+    if let Some(all_commands) = parse_bash_lc_plain_commands(original)
         && !all_commands.is_empty()
     {
         let script_tokens = shlex_split(script)
@@ -0,0 +1,191 @@
+//! Incremental serialization of Responses API request bodies.
+//!
+//! Every request in a session repeats the input of the previous one and
+//! appends the items produced since. The history shares those items behind
+//! `Arc`s, so [`RequestBodyCache`] can recognize the already-sent prefix by
+//! pointer and reuse its serialized bytes; only the new items are run through
+//! `serde_json`. The remaining fields (instructions, tools, and so on) are
+//! small next to a long history and are serialized on every request.
+//!
+//! The body is byte-for-byte what `serde_json::to_vec` produces for the whole
+//! [`ResponsesApiRequest`], so the prefix stays identical across turns.
+
+use std::collections::HashMap;
+use std::sync::Arc;
+use std::sync::LazyLock;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::sync::Weak;
+
+use bytes::Bytes;
+use bytes::BytesMut;
+use codex_protocol::models::ResponseItem;
+use uuid::Uuid;
+
+use crate::client_common::ResponsesApiRequest;
+
+/// The `input` field of a request serialized with no items. A JSON string
+/// cannot contain it unescaped, so its first occurrence is the field itself.
+const EMPTY_INPUT_FIELD: &[u8] = br#""input":[]"#;
+
+static SESSION_CACHES: LazyLock<Mutex<HashMap<Uuid, Weak<Mutex<RequestBodyCache>>>>> =
+    LazyLock::new(|| Mutex::new(HashMap::new()));
+
+/// Returns the cache shared by every [`ModelClient`](crate::client::ModelClient)
+/// of session `session_id`. Turns with overridden settings get their own
+/// client but still send the session's history.
+pub(crate) fn request_body_cache_for_session(session_id: Uuid) -> Arc<Mutex<RequestBodyCache>> {
+    let mut caches = SESSION_CACHES
+        .lock()
+        .unwrap_or_else(PoisonError::into_inner);
+    if let Some(cache) = caches.get(&session_id).and_then(Weak::upgrade) {
+        return cache;
+    }
+    caches.retain(|_, cache| cache.strong_count() > 0);
+    let cache = Arc::new(Mutex::new(RequestBodyCache::default()));
+    caches.insert(session_id, Arc::downgrade(&cache));
+    cache
+}
+
+#[derive(Debug, Default)]
+pub(crate) struct RequestBodyCache {
+    /// Input of the last request, with the serialized bytes of each item. The
+    /// `Arc`s keep the items alive so that a pointer match cannot be a reused
+    /// allocation.
+    items: Vec<(Arc<ResponseItem>, Bytes)>,
+}
+
+impl RequestBodyCache {
+    /// Serializes `payload`, reusing the bytes of the leading input items that
+    /// the previous call already serialized.
+    pub(crate) fn encode(
+        &mut self,
+        payload: &ResponsesApiRequest<'_>,
+    ) -> serde_json::Result<Bytes> {
+        let reused = self
+            .items
+            .iter()
+            .zip(payload.input)
+            .take_while(|((cached, _), item)| Arc::ptr_eq(cached, item))
+            .count();
+        self.items.truncate(reused);
+        for item in &payload.input[reused..] {
+            let bytes = Bytes::from(serde_json::to_vec(item.as_ref())?);
+            self.items.push((item.clone(), bytes));
+        }
+
+        let envelope = serde_json::to_vec(&ResponsesApiRequest {
+            input: &[],
+            ..payload.clone()
+        })?;
+        let Some(field_start) = envelope
+            .windows(EMPTY_INPUT_FIELD.len())
+            .position(|window| window == EMPTY_INPUT_FIELD)
+        else {
+            return serde_json::to_vec(payload).map(Bytes::from);
+        };
+        // Position of the `]` that closes the empty array.
+        let split = field_start + EMPTY_INPUT_FIELD.len() - 1;
+
+        let items_len: usize = self.items.iter().map(|(_, bytes)| bytes.len() + 1).sum();
+        let mut body = BytesMut::with_capacity(envelope.len() + items_len);
+        body.extend_from_slice(&envelope[..split]);
+        for (i, (_, bytes)) in self.items.iter().enumerate() {
+            if i > 0 {
+                body.extend_from_slice(b",");
+            }
+            body.extend_from_slice(bytes);
+        }
+        body.extend_from_slice(&envelope[split..]);
+        Ok(body.freeze())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use codex_protocol::models::ContentItem;
+    use pretty_assertions::assert_eq;
+
+    fn message(text: &str) -> Arc<ResponseItem> {
+        Arc::new(ResponseItem::Message {
+            id: None,
+            role: "user".to_string(),
+            content: vec![ContentItem::InputText {
+                text: text.to_string(),
+            }],
+        })
+    }
+
+    fn request<'a>(
+        instructions: &'a str,
+        input: &'a [Arc<ResponseItem>],
+    ) -> ResponsesApiRequest<'a> {
+        ResponsesApiRequest {
+            model: "gpt-5",
+            instructions,
+            input,
+            tools: &[],
+            tool_choice: "auto",
+            parallel_tool_calls: false,
+            reasoning: None,
+            store: false,
+            stream: true,
+            include: vec![],
+            prompt_cache_key: Some("session".to_string()),
+            text: None,
+        }
+    }
+
+    #[test]
+    fn body_matches_full_serialization_across_turns() {
+        let mut cache = RequestBodyCache::default();
+        // Serialized with escaped quotes, so it must not be mistaken for the field.
+        let instructions = r#"say "input":[] twice"#;
+
+        let first = vec![message("one"), message("two")];
+        let payload = request(instructions, &first);
+        let body = cache.encode(&payload).expect("encode");
+        assert_eq!(body, serde_json::to_vec(&payload).expect("json"));
+
+        let mut second = first.clone();
+        second.push(message("three"));
+        let payload = request(instructions, &second);
+        let body = cache.encode(&payload).expect("encode");
+        assert_eq!(body, serde_json::to_vec(&payload).expect("json"));
+        assert!(Arc::ptr_eq(&cache.items[0].0, &first[0]));
+        assert_eq!(cache.items.len(), 3);
+    }
+
+    #[test]
+    fn diverging_input_replaces_the_cached_tail() {
+        let mut cache = RequestBodyCache::default();
+        let shared = message("shared");
+
+        let first = vec![shared.clone(), message("old")];
+        cache.encode(&request("i", &first)).expect("encode");
+
+        let second = vec![shared, message("new")];
+        let payload = request("i", &second);
+        let body = cache.encode(&payload).expect("encode");
+        assert_eq!(body, serde_json::to_vec(&payload).expect("json"));
+        assert!(Arc::ptr_eq(&cache.items[1].0, &second[1]));
+
+        let empty = request("i", &[]);
+        let body = cache.encode(&empty).expect("encode");
+        assert_eq!(body, serde_json::to_vec(&empty).expect("json"));
+        assert!(cache.items.is_empty());
+    }
+
+    #[test]
+    fn clients_of_a_session_share_one_cache() {
+        let session_id = Uuid::new_v4();
+        let first = request_body_cache_for_session(session_id);
+        let second = request_body_cache_for_session(session_id);
+        assert!(Arc::ptr_eq(&first, &second));
+        assert!(!Arc::ptr_eq(
+            &first,
+            &request_body_cache_for_session(Uuid::new_v4())
+        ));
+    }
+}
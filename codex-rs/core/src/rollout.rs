@@ -2,8 +2,14 @@
 
 use std::fs::File;
 use std::fs::{self};
+use std::io::BufRead;
+use std::io::BufReader;
 use std::io::Error as IoError;
+use std::io::Read;
+use std::io::Seek;
+use std::io::SeekFrom;
 use std::path::Path;
+use std::time::Duration;
 
 use serde::Deserialize;
 use serde::Serialize;
@@ -15,11 +21,15 @@ use tokio::io::AsyncWriteExt;
 use tokio::sync::mpsc::Sender;
 use tokio::sync::mpsc::{self};
 use tokio::sync::oneshot;
+use tokio::time::Instant;
+use tracing::error;
 use tracing::info;
 use tracing::warn;
 use uuid::Uuid;
 
 use crate::config::Config;
+use crate::config_types::Rollout;
+use crate::config_types::RolloutFsync;
 use crate::git_info::GitInfo;
 use crate::git_info::collect_git_info;
 use codex_protocol::models::ResponseItem;
@@ -42,7 +52,18 @@ struct SessionMetaWithGit {
 }
 
 #[derive(Serialize, Deserialize, Default, Clone)]
-pub struct SessionStateSnapshot {}
+pub struct SessionStateSnapshot {
+    /// Set when the conversation history was replaced, e.g. by compaction, to
+    /// the whole history at that point. Items recorded before such a
+    /// checkpoint are not part of the resumed history.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub history: Option<Vec<ResponseItem>>,
+    /// Written at least every [`CHECKPOINT_MARKER_INTERVAL`] bytes: the
+    /// offset of the last line holding a `history` checkpoint, or 0 if there
+    /// is none. Resume reads the file backwards only up to the last such line.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub last_checkpoint: Option<u64>,
+}
 
 #[derive(Serialize, Deserialize, Default, Clone)]
 pub struct SavedSession {
@@ -54,8 +75,9 @@ pub struct SavedSession {
     pub session_id: Uuid,
 }
 
-/// Records all [`ResponseItem`]s for a session and flushes them to disk after
-/// every update.
+/// Records all [`ResponseItem`]s for a session. A background task writes the
+/// queued items in batches and fsyncs the file according to the configured
+/// [`RolloutFsync`] policy.
 ///
 /// Rollouts are recorded as JSONL and can be inspected with tools such as:
 ///
@@ -71,7 +93,13 @@ pub(crate) struct RolloutRecorder {
 enum RolloutCmd {
     AddItems(Vec<ResponseItem>),
     UpdateState(SessionStateSnapshot),
-    Shutdown { ack: oneshot::Sender<()> },
+    /// The current turn has finished.
+    EndTurn,
+    /// Writes and syncs everything queued so far, then reports the first I/O
+    /// error since the previous shutdown.
+    Shutdown {
+        ack: oneshot::Sender<std::io::Result<()>>,
+    },
 }
 
 impl RolloutRecorder {
@@ -115,7 +143,9 @@ impl RolloutRecorder {
                 id: session_id,
                 instructions,
             }),
+            None,
             cwd,
+            config.rollout,
         ));
 
         Ok(Self { tx })
@@ -157,74 +187,45 @@ impl RolloutRecorder {
             .map_err(|e| IoError::other(format!("failed to queue rollout state: {e}")))
     }
 
+    /// Tells the writer that a turn has finished, which is when the
+    /// [`RolloutFsync::Turn`] policy syncs the file.
+    pub(crate) async fn end_turn(&self) -> std::io::Result<()> {
+        self.tx
+            .send(RolloutCmd::EndTurn)
+            .await
+            .map_err(|e| IoError::other(format!("failed to queue rollout turn end: {e}")))
+    }
+
     pub async fn resume(
         path: &Path,
         cwd: std::path::PathBuf,
+        settings: Rollout,
     ) -> std::io::Result<(Self, SavedSession)> {
         info!("Resuming rollout from {path:?}");
-        let text = tokio::fs::read_to_string(path).await?;
-        let mut lines = text.lines();
-        let meta_line = lines
-            .next()
-            .ok_or_else(|| IoError::other("empty session file"))?;
-        let session: SessionMeta = serde_json::from_str(meta_line)
-            .map_err(|e| IoError::other(format!("failed to parse session meta: {e}")))?;
-        let mut items = Vec::new();
-        let mut state = SessionStateSnapshot::default();
-
-        for line in lines {
-            if line.trim().is_empty() {
-                continue;
-            }
-            let v: Value = match serde_json::from_str(line) {
-                Ok(v) => v,
-                Err(_) => continue,
-            };
-            if v.get("record_type")
-                .and_then(|rt| rt.as_str())
-                .map(|s| s == "state")
-                .unwrap_or(false)
-            {
-                if let Ok(s) = serde_json::from_value::<SessionStateSnapshot>(v.clone()) {
-                    state = s
-                }
-                continue;
-            }
-            match serde_json::from_value::<ResponseItem>(v.clone()) {
-                Ok(item) => match item {
-                    ResponseItem::Message { .. }
-                    | ResponseItem::LocalShellCall { .. }
-                    | ResponseItem::FunctionCall { .. }
-                    | ResponseItem::FunctionCallOutput { .. }
-                    | ResponseItem::CustomToolCall { .. }
-                    | ResponseItem::CustomToolCallOutput { .. }
-                    | ResponseItem::Reasoning { .. } => items.push(item),
-                    ResponseItem::WebSearchCall { .. } | ResponseItem::Other => {}
-                },
-                Err(e) => {
-                    warn!("failed to parse item: {v:?}, error: {e}");
-                }
-            }
-        }
-
-        let saved = SavedSession {
-            session: session.clone(),
-            items: items.clone(),
-            state: state.clone(),
-            session_id: session.id,
-        };
+        // Parsing a long rollout is CPU-bound, so keep it off the async runtime.
+        let read_path = path.to_path_buf();
+        let (saved, last_checkpoint) =
+            tokio::task::spawn_blocking(move || read_rollout(&read_path))
+                .await
+                .map_err(|e| IoError::other(format!("failed to read rollout: {e}")))??;
 
         let file = std::fs::OpenOptions::new()
             .append(true)
             .read(true)
             .open(path)?;
+        let len = file.metadata()?.len();
 
         let (tx, rx) = mpsc::channel::<RolloutCmd>(256);
         tokio::task::spawn(rollout_writer(
             tokio::fs::File::from_std(file),
             rx,
             None,
+            Some(AppendAfter {
+                len,
+                last_checkpoint,
+            }),
             cwd,
+            settings,
         ));
         info!("Resumed rollout successfully from {path:?}");
         Ok((Self { tx }, saved))
@@ -235,7 +236,7 @@ impl RolloutRecorder {
         match self.tx.send(RolloutCmd::Shutdown { ack: tx_done }).await {
             Ok(_) => rx_done
                 .await
-                .map_err(|e| IoError::other(format!("failed waiting for rollout shutdown: {e}"))),
+                .map_err(|e| IoError::other(format!("failed waiting for rollout shutdown: {e}")))?,
             Err(e) => {
                 warn!("failed to send rollout shutdown command: {e}");
                 Err(IoError::other(format!(
@@ -246,6 +247,219 @@ impl RolloutRecorder {
     }
 }
 
+/// Start of every state line written by [`rollout_writer`], which serializes
+/// `record_type` first.
+const STATE_RECORD_PREFIX: &str = r#"{"record_type":"state""#;
+
+/// Start of every state line written by [`rollout_writer`] that holds a
+/// history checkpoint, which is serialized right after `record_type`.
+const CHECKPOINT_RECORD_PREFIX: &[u8] = br#"{"record_type":"state","history":"#;
+
+/// Start of every state line written by [`rollout_writer`] that only holds
+/// [`SessionStateSnapshot::last_checkpoint`].
+const CHECKPOINT_MARKER_PREFIX: &[u8] = br#"{"record_type":"state","last_checkpoint":"#;
+
+/// Most bytes [`rollout_writer`] appends between two lines that
+/// [`find_last_checkpoint`] stops at, which bounds how much of the file a
+/// resume reads backwards.
+const CHECKPOINT_MARKER_INTERVAL: u64 = 1024 * 1024;
+
+/// Size of the blocks in which [`find_last_checkpoint`] reads a rollout
+/// backwards.
+const CHECKPOINT_SCAN_BLOCK: u64 = 64 * 1024;
+
+/// Reads a rollout file one line at a time. Item lines are parsed straight
+/// into [`ResponseItem`]s; only lines that fail to parse go through
+/// `serde_json::Value`, to recognize state records with a different key order.
+///
+/// Reading starts at the last history checkpoint, found by scanning the file
+/// backwards for it or for a marker saying where it is, so the items before
+/// it are never read. A session that never compacted has a marker saying so
+/// near the end of the file. Without a readable checkpoint or marker the
+/// whole file is read, which still applies any checkpoint.
+///
+/// Also returns the offset of the checkpoint the history starts at, or 0.
+fn read_rollout(path: &Path) -> std::io::Result<(SavedSession, u64)> {
+    let mut file = File::open(path)?;
+    let found = find_last_checkpoint(&mut file)?;
+    file.seek(SeekFrom::Start(0))?;
+    let mut reader = BufReader::new(file);
+    let mut line = String::new();
+    let meta_len = reader.read_line(&mut line)? as u64;
+    if meta_len == 0 {
+        return Err(IoError::other("empty session file"));
+    }
+    let session: SessionMeta = serde_json::from_str(&line)
+        .map_err(|e| IoError::other(format!("failed to parse session meta: {e}")))?;
+    let mut items = Vec::new();
+    let mut state = SessionStateSnapshot::default();
+    let mut last_checkpoint = 0;
+
+    // Where to read items from: after the checkpoint, or after the meta line.
+    let mut pos = meta_len;
+    if let Some(offset) = found {
+        let mut at = offset;
+        let mut checkpoint = read_state_at(&mut reader, at)?;
+        if let Some((
+            SessionStateSnapshot {
+                last_checkpoint: Some(marked),
+                ..
+            },
+            _,
+        )) = checkpoint
+        {
+            at = marked;
+            checkpoint = match marked {
+                0 => None,
+                marked => read_state_at(&mut reader, marked)?,
+            };
+        }
+        match checkpoint {
+            Some((s, next)) if s.history.is_some() => {
+                apply_state(s, &mut items, &mut state);
+                last_checkpoint = at;
+                pos = next;
+            }
+            // The marker says the session never compacted.
+            _ if at == 0 => {}
+            _ => warn!("failed to parse rollout checkpoint at byte {at}; reading all items"),
+        }
+    }
+    reader.seek(SeekFrom::Start(pos))?;
+
+    loop {
+        line.clear();
+        let line_start = pos;
+        let read = reader.read_line(&mut line)?;
+        if read == 0 {
+            break;
+        }
+        pos += read as u64;
+        let line = line.trim();
+        if line.is_empty() {
+            continue;
+        }
+        if line.starts_with(STATE_RECORD_PREFIX) {
+            if let Ok(s) = serde_json::from_str::<SessionStateSnapshot>(line)
+                && apply_state(s, &mut items, &mut state)
+            {
+                last_checkpoint = line_start;
+            }
+            continue;
+        }
+        match serde_json::from_str::<ResponseItem>(line) {
+            Ok(item) => match item {
+                ResponseItem::Message { .. }
+                | ResponseItem::LocalShellCall { .. }
+                | ResponseItem::FunctionCall { .. }
+                | ResponseItem::FunctionCallOutput { .. }
+                | ResponseItem::CustomToolCall { .. }
+                | ResponseItem::CustomToolCallOutput { .. }
+                | ResponseItem::Reasoning { .. } => items.push(item),
+                ResponseItem::WebSearchCall { .. } | ResponseItem::Other => {}
+            },
+            Err(e) => {
+                let Ok(v) = serde_json::from_str::<Value>(line) else {
+                    continue;
+                };
+                if v.get("record_type").and_then(|rt| rt.as_str()) == Some("state") {
+                    if let Ok(s) = serde_json::from_value::<SessionStateSnapshot>(v)
+                        && apply_state(s, &mut items, &mut state)
+                    {
+                        last_checkpoint = line_start;
+                    }
+                } else {
+                    warn!("failed to parse item: {v:?}, error: {e}");
+                }
+            }
+        }
+    }
+
+    let saved = SavedSession {
+        session_id: session.id,
+        session,
+        items,
+        state,
+    };
+    Ok((saved, last_checkpoint))
+}
+
+/// Parses the state line at `offset`, returning it with the offset just past
+/// the line, or `None` if the line is not a state record.
+fn read_state_at(
+    reader: &mut BufReader<File>,
+    offset: u64,
+) -> std::io::Result<Option<(SessionStateSnapshot, u64)>> {
+    reader.seek(SeekFrom::Start(offset))?;
+    let mut line = String::new();
+    let read = reader.read_line(&mut line)?;
+    Ok(serde_json::from_str::<SessionStateSnapshot>(&line)
+        .ok()
+        .map(|s| (s, offset + read as u64)))
+}
+
+/// Makes `s` the current state. A history checkpoint in it replaces the
+/// items read so far; returns whether there was one.
+fn apply_state(
+    mut s: SessionStateSnapshot,
+    items: &mut Vec<ResponseItem>,
+    state: &mut SessionStateSnapshot,
+) -> bool {
+    let history = s.history.take();
+    let is_checkpoint = history.is_some();
+    if let Some(history) = history {
+        *items = history;
+    }
+    *state = s;
+    is_checkpoint
+}
+
+/// Returns the offset of the last complete line of `file` that starts with
+/// [`CHECKPOINT_RECORD_PREFIX`] or [`CHECKPOINT_MARKER_PREFIX`], reading the
+/// file backwards from its end so that only the part after that line is read.
+fn find_last_checkpoint(file: &mut File) -> std::io::Result<Option<u64>> {
+    let mut end = file.seek(SeekFrom::End(0))?;
+    // Bytes from `end` up to the end of the last complete line, which start
+    // in the middle of a line.
+    let mut carry = Vec::new();
+    let mut at_eof = true;
+    while end > 0 {
+        let start = end.saturating_sub(CHECKPOINT_SCAN_BLOCK);
+        let mut block = vec![0; (end - start) as usize];
+        file.seek(SeekFrom::Start(start))?;
+        file.read_exact(&mut block)?;
+        block.extend_from_slice(&carry);
+
+        let mut line_end = block.len();
+        for newline in newlines_rev(&block) {
+            // A partial last line is not a checkpoint yet.
+            let line = &block[newline + 1..line_end];
+            if !at_eof
+                && (line.starts_with(CHECKPOINT_RECORD_PREFIX)
+                    || line.starts_with(CHECKPOINT_MARKER_PREFIX))
+            {
+                return Ok(Some(start + newline as u64 + 1));
+            }
+            at_eof = false;
+            line_end = newline;
+        }
+        block.truncate(line_end);
+        carry = block;
+        end = start;
+    }
+    // The first line is the session meta.
+    Ok(None)
+}
+
+/// Positions of the newlines in `bytes`, last first.
+fn newlines_rev(bytes: &[u8]) -> impl Iterator<Item = usize> + '_ {
+    bytes
+        .iter()
+        .enumerate()
+        .rev()
+        .filter_map(|(i, b)| (*b == b'\n').then_some(i))
+}
+
 struct LogFileInfo {
     /// Opened file handle to the rollout file.
     file: File,
@@ -291,13 +505,22 @@ fn create_log_file(config: &Config, session_id: Uuid) -> std::io::Result<LogFile
     })
 }
 
+/// Where a resumed rollout file ended before the writer appends to it.
+struct AppendAfter {
+    len: u64,
+    /// See [`SessionStateSnapshot::last_checkpoint`].
+    last_checkpoint: u64,
+}
+
 async fn rollout_writer(
     file: tokio::fs::File,
     mut rx: mpsc::Receiver<RolloutCmd>,
     mut meta: Option<SessionMeta>,
+    append_after: Option<AppendAfter>,
     cwd: std::path::PathBuf,
-) -> std::io::Result<()> {
-    let mut writer = JsonlWriter { file };
+    settings: Rollout,
+) {
+    let mut writer = JsonlWriter::new(file, settings, append_after);
 
     // If we have a meta, collect git info asynchronously and write meta first
     if let Some(session_meta) = meta.take() {
@@ -308,61 +531,437 @@ async fn rollout_writer(
         };
 
         // Write the SessionMeta as the first item in the file
-        writer.write_line(&session_meta_with_git).await?;
+        writer.push_line(&session_meta_with_git);
+        writer.write_batch().await;
     }
 
-    // Process rollout commands
-    while let Some(cmd) = rx.recv().await {
-        match cmd {
-            RolloutCmd::AddItems(items) => {
-                for item in items {
-                    match item {
-                        ResponseItem::Message { .. }
-                        | ResponseItem::LocalShellCall { .. }
-                        | ResponseItem::FunctionCall { .. }
-                        | ResponseItem::FunctionCallOutput { .. }
-                        | ResponseItem::CustomToolCall { .. }
-                        | ResponseItem::CustomToolCallOutput { .. }
-                        | ResponseItem::Reasoning { .. } => {
-                            writer.write_line(&item).await?;
+    loop {
+        let cmd = match writer.sync_deadline() {
+            Some(deadline) => tokio::select! {
+                cmd = rx.recv() => cmd,
+                () = tokio::time::sleep_until(deadline) => {
+                    writer.sync().await;
+                    continue;
+                }
+            },
+            None => rx.recv().await,
+        };
+        let Some(cmd) = cmd else { break };
+
+        // Serialize every command that is already queued, then write them
+        // with a single call.
+        let mut end_turn = false;
+        let mut shutdown_ack = None;
+        let mut next = Some(cmd);
+        while let Some(cmd) = next.take() {
+            match cmd {
+                RolloutCmd::AddItems(items) => {
+                    for item in &items {
+                        match item {
+                            ResponseItem::Message { .. }
+                            | ResponseItem::LocalShellCall { .. }
+                            | ResponseItem::FunctionCall { .. }
+                            | ResponseItem::FunctionCallOutput { .. }
+                            | ResponseItem::CustomToolCall { .. }
+                            | ResponseItem::CustomToolCallOutput { .. }
+                            | ResponseItem::Reasoning { .. } => writer.push_line(item),
+                            ResponseItem::WebSearchCall { .. } | ResponseItem::Other => {}
                         }
-                        ResponseItem::WebSearchCall { .. } | ResponseItem::Other => {}
                     }
                 }
-            }
-            RolloutCmd::UpdateState(state) => {
-                #[derive(Serialize)]
-                struct StateLine<'a> {
-                    record_type: &'static str,
-                    #[serde(flatten)]
-                    state: &'a SessionStateSnapshot,
+                RolloutCmd::UpdateState(state) => writer.push_state(&state),
+                RolloutCmd::EndTurn => end_turn = true,
+                RolloutCmd::Shutdown { ack } => {
+                    shutdown_ack = Some(ack);
+                    break;
                 }
-                writer
-                    .write_line(&StateLine {
-                        record_type: "state",
-                        state: &state,
-                    })
-                    .await?;
-            }
-            RolloutCmd::Shutdown { ack } => {
-                let _ = ack.send(());
             }
+            next = rx.try_recv().ok();
+        }
+
+        writer.push_marker_if_due();
+        writer.write_batch().await;
+        if end_turn && settings.fsync == RolloutFsync::Turn {
+            writer.sync().await;
+        }
+        if let Some(ack) = shutdown_ack {
+            let _ = ack.send(writer.finish().await);
         }
     }
 
-    Ok(())
+    if let Err(e) = writer.finish().await {
+        warn!("rollout writer stopped after an error: {e}");
+    }
 }
 
 struct JsonlWriter {
     file: tokio::fs::File,
+    settings: Rollout,
+    /// Serialized lines of the current batch. Reused across batches.
+    buf: Vec<u8>,
+    /// Length of the file once the current batch is written, minus the batch.
+    pos: u64,
+    /// See [`SessionStateSnapshot::last_checkpoint`].
+    last_checkpoint: u64,
+    /// Offset of the last checkpoint or marker line, `None` until one is
+    /// written to a resumed file.
+    last_marker: Option<u64>,
+    /// Whether anything was written since the last fsync.
+    unsynced: bool,
+    last_sync: Instant,
+    /// First error since the last [`JsonlWriter::finish`].
+    error: Option<IoError>,
 }
 
 impl JsonlWriter {
-    async fn write_line(&mut self, item: &impl serde::Serialize) -> std::io::Result<()> {
-        let mut json = serde_json::to_string(item)?;
-        json.push('\n');
-        let _ = self.file.write_all(json.as_bytes()).await;
-        self.file.flush().await?;
-        Ok(())
+    fn new(file: tokio::fs::File, settings: Rollout, append_after: Option<AppendAfter>) -> Self {
+        let (pos, last_checkpoint, last_marker) = match append_after {
+            Some(AppendAfter {
+                len,
+                last_checkpoint,
+            }) => (len, last_checkpoint, None),
+            None => (0, 0, Some(0)),
+        };
+        Self {
+            file,
+            settings,
+            buf: Vec::new(),
+            pos,
+            last_checkpoint,
+            last_marker,
+            unsynced: false,
+            last_sync: Instant::now(),
+            error: None,
+        }
+    }
+
+    /// Appends `item` to the current batch as one JSON line.
+    fn push_line(&mut self, item: &impl serde::Serialize) {
+        let start = self.buf.len();
+        match serde_json::to_writer(&mut self.buf, item) {
+            Ok(()) => self.buf.push(b'\n'),
+            Err(e) => {
+                self.buf.truncate(start);
+                self.record_error(e.into());
+            }
+        }
+    }
+
+    /// Appends a state line to the current batch, remembering where a history
+    /// checkpoint goes.
+    fn push_state(&mut self, state: &SessionStateSnapshot) {
+        #[derive(Serialize)]
+        struct StateLine<'a> {
+            record_type: &'static str,
+            #[serde(flatten)]
+            state: &'a SessionStateSnapshot,
+        }
+        let offset = self.pos + self.buf.len() as u64;
+        if state.history.is_some() {
+            self.last_checkpoint = offset;
+            self.last_marker = Some(offset);
+        }
+        self.push_line(&StateLine {
+            record_type: "state",
+            state,
+        });
+    }
+
+    /// Ends the current batch with a [`SessionStateSnapshot::last_checkpoint`]
+    /// marker once [`CHECKPOINT_MARKER_INTERVAL`] bytes were written since the
+    /// last checkpoint or marker, and in the first batch appended to a resumed
+    /// file, whose older part may have no markers.
+    fn push_marker_if_due(&mut self) {
+        if self.buf.is_empty() {
+            return;
+        }
+        let end = self.pos + self.buf.len() as u64;
+        if self
+            .last_marker
+            .is_some_and(|marker| end - marker < CHECKPOINT_MARKER_INTERVAL)
+        {
+            return;
+        }
+        self.last_marker = Some(end);
+        self.push_state(&SessionStateSnapshot {
+            last_checkpoint: Some(self.last_checkpoint),
+            ..Default::default()
+        });
+    }
+
+    /// Writes the current batch, syncing afterwards under [`RolloutFsync::Item`].
+    async fn write_batch(&mut self) {
+        if self.buf.is_empty() {
+            return;
+        }
+        let result = match self.file.write_all(&self.buf).await {
+            Ok(()) => self.file.flush().await,
+            Err(e) => Err(e),
+        };
+        // Offsets past a failed write are off; resume checks the line at an
+        // offset before it uses it.
+        self.pos += self.buf.len() as u64;
+        self.buf.clear();
+        match result {
+            Ok(()) => self.unsynced = true,
+            Err(e) => self.record_error(e),
+        }
+        if self.settings.fsync == RolloutFsync::Item {
+            self.sync().await;
+        }
+    }
+
+    async fn sync(&mut self) {
+        if !self.unsynced {
+            return;
+        }
+        self.unsynced = false;
+        self.last_sync = Instant::now();
+        if let Err(e) = self.file.sync_data().await {
+            self.record_error(e);
+        }
+    }
+
+    /// When the next fsync is due under [`RolloutFsync::Interval`].
+    fn sync_deadline(&self) -> Option<Instant> {
+        (self.settings.fsync == RolloutFsync::Interval && self.unsynced)
+            .then(|| self.last_sync + Duration::from_millis(self.settings.fsync_interval_ms))
+    }
+
+    /// Writes and syncs everything pending and returns the first error since
+    /// the previous call.
+    async fn finish(&mut self) -> std::io::Result<()> {
+        self.write_batch().await;
+        if self.settings.fsync != RolloutFsync::Never {
+            self.sync().await;
+        }
+        self.error.take().map_or(Ok(()), Err)
+    }
+
+    fn record_error(&mut self, e: IoError) {
+        error!("failed to write rollout: {e}");
+        if self.error.is_none() {
+            self.error = Some(e);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use codex_protocol::models::ContentItem;
+    use pretty_assertions::assert_eq;
+
+    fn message(text: &str) -> ResponseItem {
+        ResponseItem::Message {
+            id: None,
+            role: "user".to_string(),
+            content: vec![ContentItem::InputText {
+                text: text.to_string(),
+            }],
+        }
+    }
+
+    #[tokio::test]
+    async fn writer_batches_queued_commands_and_acks_shutdown() {
+        let dir = tempfile::tempdir().expect("tempdir");
+        let path = dir.path().join("rollout.jsonl");
+        let file = tokio::fs::File::create(&path).await.expect("create");
+
+        // Queue everything before the writer starts so it is written as one batch.
+        let (tx, rx) = mpsc::channel::<RolloutCmd>(16);
+        tx.send(RolloutCmd::AddItems(vec![message("one"), message("two")]))
+            .await
+            .expect("send");
+        tx.send(RolloutCmd::UpdateState(SessionStateSnapshot::default()))
+            .await
+            .expect("send");
+        tx.send(RolloutCmd::EndTurn).await.expect("send");
+        let (ack, done) = oneshot::channel();
+        tx.send(RolloutCmd::Shutdown { ack }).await.expect("send");
+
+        let settings = Rollout {
+            fsync: RolloutFsync::Item,
+            ..Rollout::default()
+        };
+        tokio::spawn(rollout_writer(
+            file,
+            rx,
+            None,
+            None,
+            dir.path().to_path_buf(),
+            settings,
+        ));
+        done.await
+            .expect("ack")
+            .expect("rollout written without errors");
+
+        let text = std::fs::read_to_string(&path).expect("read");
+        let lines: Vec<&str> = text.lines().collect();
+        assert_eq!(lines.len(), 3);
+        assert!(lines[0].contains(r#""text":"one""#));
+        assert!(lines[1].contains(r#""text":"two""#));
+        assert_eq!(lines[2], r#"{"record_type":"state"}"#);
+    }
+
+    #[test]
+    fn read_rollout_skips_state_records_and_bad_lines() {
+        let dir = tempfile::tempdir().expect("tempdir");
+        let path = dir.path().join("rollout.jsonl");
+        let session_id = Uuid::new_v4();
+        let mut text = format!(
+            r#"{{"id":"{session_id}","timestamp":"2025-01-01T00:00:00.000Z","instructions":null,"git":{{}}}}"#
+        );
+        text.push('\n');
+        for line in [
+            serde_json::to_string(&message("one")).expect("json"),
+            r#"{"record_type":"state"}"#.to_string(),
+            String::new(),
+            "not json".to_string(),
+            r#"{"extra":1,"record_type":"state"}"#.to_string(),
+            serde_json::to_string(&message("two")).expect("json"),
+        ] {
+            text.push_str(&line);
+            text.push('\n');
+        }
+        std::fs::write(&path, text).expect("write");
+
+        let (saved, _) = read_rollout(&path).expect("read rollout");
+        assert_eq!(saved.session_id, session_id);
+        assert_eq!(saved.items, vec![message("one"), message("two")]);
+    }
+
+    #[test]
+    fn read_rollout_starts_at_the_last_history_checkpoint() {
+        let dir = tempfile::tempdir().expect("tempdir");
+        let path = dir.path().join("rollout.jsonl");
+        let session_id = Uuid::new_v4();
+        let checkpoint = |items: Vec<ResponseItem>| {
+            let line = serde_json::json!({ "record_type": "state", "history": items });
+            serde_json::to_string(&line).expect("json")
+        };
+        let mut text = format!(
+            r#"{{"id":"{session_id}","timestamp":"2025-01-01T00:00:00.000Z","instructions":null}}"#
+        );
+        text.push('\n');
+        // Enough items before the last checkpoint to span several scan blocks.
+        let old = serde_json::to_string(&message(&"x".repeat(1000))).expect("json");
+        for _ in 0..200 {
+            text.push_str(&old);
+            text.push('\n');
+        }
+        for line in [
+            checkpoint(vec![message("first summary")]),
+            serde_json::to_string(&message("one")).expect("json"),
+            checkpoint(vec![message("summary")]),
+            serde_json::to_string(&message("two")).expect("json"),
+            r#"{"record_type":"state"}"#.to_string(),
+        ] {
+            text.push_str(&line);
+            text.push('\n');
+        }
+        std::fs::write(&path, &text).expect("write");
+
+        let mut file = File::open(&path).expect("open");
+        let offset = find_last_checkpoint(&mut file).expect("scan");
+        assert_eq!(
+            offset,
+            text.rfind(r#"{"record_type":"state","history""#)
+                .map(|i| i as u64)
+        );
+        let (saved, last_checkpoint) = read_rollout(&path).expect("read rollout");
+        assert_eq!(saved.items, vec![message("summary"), message("two")]);
+        assert_eq!(Some(last_checkpoint), offset);
+
+        // A checkpoint that was not completely written is not used.
+        text.push_str(&checkpoint(vec![message("torn")]));
+        std::fs::write(&path, &text).expect("write");
+        let (saved, _) = read_rollout(&path).expect("read rollout");
+        assert_eq!(saved.items, vec![message("summary"), message("two")]);
+    }
+
+    /// Appends `batches` to the rollout at `path` through [`rollout_writer`],
+    /// as a resumed session would.
+    async fn append_with_writer(path: &Path, last_checkpoint: u64, batches: Vec<RolloutCmd>) {
+        let file = std::fs::OpenOptions::new()
+            .append(true)
+            .open(path)
+            .expect("open");
+        let len = file.metadata().expect("metadata").len();
+        let (tx, rx) = mpsc::channel::<RolloutCmd>(16);
+        tokio::spawn(rollout_writer(
+            tokio::fs::File::from_std(file),
+            rx,
+            None,
+            Some(AppendAfter {
+                len,
+                last_checkpoint,
+            }),
+            std::env::temp_dir(),
+            Rollout::default(),
+        ));
+        for cmd in batches {
+            tx.send(cmd).await.expect("send");
+            // Let the writer write each command as its own batch.
+            tokio::task::yield_now().await;
+        }
+        let (ack, done) = oneshot::channel();
+        tx.send(RolloutCmd::Shutdown { ack }).await.expect("send");
+        done.await.expect("ack").expect("rollout written");
+    }
+
+    #[tokio::test]
+    async fn writer_markers_bound_the_checkpoint_scan() {
+        let dir = tempfile::tempdir().expect("tempdir");
+        let path = dir.path().join("rollout.jsonl");
+        let session_id = Uuid::new_v4();
+        std::fs::write(
+            &path,
+            format!(
+                r#"{{"id":"{session_id}","timestamp":"2025-01-01T00:00:00.000Z","instructions":null}}"#
+            ) + "\n",
+        )
+        .expect("write meta");
+        let big = message(&"x".repeat(64 * 1024));
+        let items = |n: usize| -> Vec<RolloutCmd> {
+            (0..n)
+                .map(|_| RolloutCmd::AddItems(vec![big.clone()]))
+                .collect()
+        };
+
+        // A session that never compacted: the scan stops at a marker near the
+        // end, which says there is no checkpoint, and every item is restored.
+        append_with_writer(&path, 0, items(40)).await;
+        let len = std::fs::metadata(&path).expect("metadata").len();
+        let mut file = File::open(&path).expect("open");
+        let marker = find_last_checkpoint(&mut file)
+            .expect("scan")
+            .expect("marker");
+        assert!(len - marker <= CHECKPOINT_MARKER_INTERVAL + 2 * CHECKPOINT_SCAN_BLOCK);
+        let (saved, last_checkpoint) = read_rollout(&path).expect("read rollout");
+        assert_eq!(saved.items.len(), 40);
+        assert_eq!(last_checkpoint, 0);
+
+        // After a checkpoint, markers point back at it.
+        let mut batches = vec![RolloutCmd::UpdateState(SessionStateSnapshot {
+            history: Some(vec![message("summary")]),
+            ..Default::default()
+        })];
+        batches.extend(items(40));
+        append_with_writer(&path, 0, batches).await;
+        let (saved, checkpoint) = read_rollout(&path).expect("read rollout");
+        assert_eq!(saved.items.len(), 41);
+        assert_eq!(saved.items[0], message("summary"));
+        let text = std::fs::read_to_string(&path).expect("read");
+        assert_eq!(
+            Some(checkpoint),
+            text.find(r#"{"record_type":"state","history""#)
+                .map(|i| i as u64)
+        );
+        let mut file = File::open(&path).expect("open");
+        let marker = find_last_checkpoint(&mut file)
+            .expect("scan")
+            .expect("marker");
+        assert!(marker > checkpoint);
     }
 }
@@ -300,6 +300,37 @@ mod tests {
         assert_eq!(expected_args, args);
     }
 
+    #[cfg(unix)]
+    #[test]
+    fn seatbelt_args_follow_a_retargeted_symlinked_root() {
+        let tmp = TempDir::new().expect("tempdir");
+        let old_target = tmp.path().join("old");
+        let new_target = tmp.path().join("new");
+        fs::create_dir_all(&old_target).expect("create old");
+        fs::create_dir_all(&new_target).expect("create new");
+        let link = tmp.path().join("link");
+        std::os::unix::fs::symlink(&old_target, &link).expect("symlink");
+        let policy = SandboxPolicy::WorkspaceWrite {
+            writable_roots: vec![link.clone()],
+            network_access: false,
+            exclude_tmpdir_env_var: true,
+            exclude_slash_tmp: true,
+        };
+        let cwd = tmp.path().join("cwd");
+        let root_param = |target: &Path| {
+            let target = target.canonicalize().expect("canonicalize");
+            format!("-DWRITABLE_ROOT_0={}", target.to_string_lossy())
+        };
+
+        let before = create_seatbelt_command_args(vec!["true".to_string()], &policy, &cwd);
+        assert_eq!(before[2], root_param(&old_target));
+
+        fs::remove_file(&link).expect("remove symlink");
+        std::os::unix::fs::symlink(&new_target, &link).expect("symlink");
+        let after = create_seatbelt_command_args(vec!["true".to_string()], &policy, &cwd);
+        assert_eq!(after[2], root_param(&new_target));
+    }
+
     struct PopulatedTmp {
         root_with_git: PathBuf,
         root_without_git: PathBuf,
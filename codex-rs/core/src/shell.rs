@@ -272,6 +272,7 @@ mod tests {
             use std::path::PathBuf;
 
             use crate::exec::ExecParams;
+            use crate::exec::OutputRetention;
             use crate::exec::SandboxType;
             use crate::exec::process_exec_tool_call;
             use crate::protocol::SandboxPolicy;
@@ -322,6 +323,7 @@ mod tests {
                 &SandboxPolicy::DangerFullAccess,
                 &None,
                 None,
+                OutputRetention::default(),
             )
             .await
             .unwrap();
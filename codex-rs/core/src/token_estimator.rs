@@ -0,0 +1,119 @@
+//! Cheap, local estimate of how many tokens a [`ResponseItem`] occupies in
+//! the model's context window.
+//!
+//! The exact count depends on the tokenizer, which is not available locally,
+//! and is reported by the server only after a turn completes. The estimate is
+//! used to decide *before* a turn whether the history needs to be shrunk, so
+//! it only has to be in the right ballpark: every model family Codex supports
+//! averages roughly four bytes of English text or code per token, and the
+//! same ratio is used for all of them.
+
+use codex_protocol::models::ContentItem;
+use codex_protocol::models::LocalShellAction;
+use codex_protocol::models::ReasoningItemContent;
+use codex_protocol::models::ReasoningItemReasoningSummary;
+use codex_protocol::models::ResponseItem;
+
+const APPROX_BYTES_PER_TOKEN: u64 = 4;
+
+/// Framing added around every item (role, type and call id markers).
+const TOKENS_PER_ITEM: u64 = 4;
+
+/// Images are billed by tile rather than by the size of their encoding; this
+/// is the cost of a typical screenshot at the default detail level.
+const TOKENS_PER_IMAGE: u64 = 765;
+
+/// Estimated number of tokens `item` occupies when sent to the model.
+pub(crate) fn estimate_tokens(item: &ResponseItem) -> u64 {
+    let mut text_bytes = 0usize;
+    let mut images = 0u64;
+    match item {
+        ResponseItem::Message { content, .. } => {
+            for part in content {
+                match part {
+                    ContentItem::InputText { text } | ContentItem::OutputText { text } => {
+                        text_bytes += text.len();
+                    }
+                    ContentItem::InputImage { .. } => images += 1,
+                }
+            }
+        }
+        ResponseItem::Reasoning {
+            summary,
+            content,
+            encrypted_content,
+            ..
+        } => {
+            for ReasoningItemReasoningSummary::SummaryText { text } in summary {
+                text_bytes += text.len();
+            }
+            for part in content.iter().flatten() {
+                match part {
+                    ReasoningItemContent::ReasoningText { text }
+                    | ReasoningItemContent::Text { text } => text_bytes += text.len(),
+                }
+            }
+            // The encrypted payload is base64 of roughly the same content, so
+            // it is a reasonable proxy when the plain text is not available.
+            text_bytes += encrypted_content.as_ref().map_or(0, String::len);
+        }
+        ResponseItem::LocalShellCall {
+            action: LocalShellAction::Exec(exec),
+            ..
+        } => {
+            text_bytes += exec.command.iter().map(|arg| arg.len() + 1).sum::<usize>();
+        }
+        ResponseItem::FunctionCall {
+            name, arguments, ..
+        } => text_bytes += name.len() + arguments.len(),
+        ResponseItem::FunctionCallOutput { output, .. } => text_bytes += output.content.len(),
+        ResponseItem::CustomToolCall { name, input, .. } => text_bytes += name.len() + input.len(),
+        ResponseItem::CustomToolCallOutput { output, .. } => text_bytes += output.len(),
+        ResponseItem::WebSearchCall { .. } | ResponseItem::Other => {}
+    }
+    TOKENS_PER_ITEM
+        + (text_bytes as u64).div_ceil(APPROX_BYTES_PER_TOKEN)
+        + images * TOKENS_PER_IMAGE
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use codex_protocol::models::FunctionCallOutputPayload;
+
+    #[test]
+    fn text_is_estimated_at_four_bytes_per_token() {
+        let item = ResponseItem::Message {
+            id: None,
+            role: "user".to_string(),
+            content: vec![ContentItem::InputText {
+                text: "a".repeat(400),
+            }],
+        };
+        assert_eq!(estimate_tokens(&item), TOKENS_PER_ITEM + 100);
+    }
+
+    #[test]
+    fn images_are_not_estimated_by_encoded_size() {
+        let item = ResponseItem::Message {
+            id: None,
+            role: "user".to_string(),
+            content: vec![ContentItem::InputImage {
+                image_url: format!("data:image/png;base64,{}", "A".repeat(1 << 20)),
+            }],
+        };
+        assert_eq!(estimate_tokens(&item), TOKENS_PER_ITEM + TOKENS_PER_IMAGE);
+    }
+
+    #[test]
+    fn tool_output_counts_its_content() {
+        let item = ResponseItem::FunctionCallOutput {
+            call_id: "call_1".to_string(),
+            output: FunctionCallOutputPayload {
+                content: "x".repeat(4_001),
+                success: Some(true),
+            },
+        };
+        assert_eq!(estimate_tokens(&item), TOKENS_PER_ITEM + 1_001);
+    }
+}
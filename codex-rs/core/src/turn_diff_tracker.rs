@@ -1,8 +1,11 @@
 use std::collections::HashMap;
 use std::fs;
+use std::num::NonZeroUsize;
 use std::path::Path;
 use std::path::PathBuf;
 use std::process::Command;
+use std::time::Duration;
+use std::time::SystemTime;
 
 use anyhow::Context;
 use anyhow::Result;
@@ -40,6 +43,9 @@ pub struct TurnDiffTracker {
     temp_name_to_current_path: HashMap<String, PathBuf>,
     /// Cache of known git worktree roots to avoid repeated filesystem walks.
     git_root_cache: Vec<PathBuf>,
+    /// Internal filename -> diff from the last `get_unified_diff` call, reused while the file's
+    /// metadata is unchanged so that untouched files are neither re-hashed nor re-diffed.
+    diff_cache: HashMap<String, CachedFileDiff>,
 }
 
 impl TurnDiffTracker {
@@ -202,26 +208,15 @@ impl TurnDiffTracker {
     /// Returns None if no repository is found or git invocation fails.
     fn git_blob_oid_for_path(&mut self, path: &Path) -> Option<String> {
         let root = self.find_git_root_cached(path)?;
-        // Compute a path relative to the repo root for better portability across platforms.
-        let rel = path.strip_prefix(&root).unwrap_or(path);
-        let output = Command::new("git")
-            .arg("-C")
-            .arg(&root)
-            .arg("hash-object")
-            .arg("--")
-            .arg(rel)
-            .output()
-            .ok()?;
-        if !output.status.success() {
-            return None;
-        }
-        let s = String::from_utf8_lossy(&output.stdout).trim().to_string();
-        if s.len() == 40 { Some(s) } else { None }
+        git_blob_oid(&root, path)
     }
 
     /// Recompute the aggregated unified diff by comparing all of the in-memory snapshots that were
     /// collected before the first time they were touched by apply_patch during this turn with
     /// the current repo state.
+    ///
+    /// Files whose metadata is unchanged since the previous call reuse their cached diff; the
+    /// rest are re-read and re-diffed, in parallel when there are enough of them.
     pub fn get_unified_diff(&mut self) -> Result<Option<String>> {
         let mut aggregated = String::new();
 
@@ -235,8 +230,41 @@ impl TurnDiffTracker {
                 .unwrap_or_default()
         });
 
-        for internal in baseline_file_names {
-            aggregated.push_str(self.get_file_diff(&internal).as_str());
+        // Taken before any file is read so that writes racing with this call are never cached.
+        let computed_at = SystemTime::now();
+        let mut jobs = Vec::new();
+        for internal in &baseline_file_names {
+            let Some(job) = self.file_diff_job(internal) else {
+                self.diff_cache.remove(internal);
+                continue;
+            };
+            let up_to_date = self
+                .diff_cache
+                .get(internal)
+                .is_some_and(|cached| cached.reusable && cached.key == job.key);
+            if !up_to_date {
+                jobs.push(job);
+            }
+        }
+
+        let diffs = compute_file_diffs(&jobs, &self.baseline_file_info);
+        for (job, diff) in jobs.into_iter().zip(diffs) {
+            let reusable = job.key.is_settled(computed_at);
+            self.diff_cache.insert(
+                job.internal,
+                CachedFileDiff {
+                    key: job.key,
+                    reusable,
+                    diff,
+                },
+            );
+        }
+
+        for internal in &baseline_file_names {
+            let Some(cached) = self.diff_cache.get(internal) else {
+                continue;
+            };
+            aggregated.push_str(&cached.diff);
             if !aggregated.ends_with('\n') {
                 aggregated.push('\n');
             }
@@ -249,47 +277,176 @@ impl TurnDiffTracker {
         }
     }
 
-    fn get_file_diff(&mut self, internal_file_name: &str) -> String {
+    /// Gather everything needed to diff `internal_file_name` that requires `&mut self`, so the
+    /// diff itself can be computed on another thread.
+    fn file_diff_job(&mut self, internal_file_name: &str) -> Option<FileDiffJob> {
+        let baseline_external_path = self
+            .baseline_file_info
+            .get(internal_file_name)
+            .map(|info| info.path.clone())
+            .unwrap_or_default();
+        let current_path = self.get_path_for_internal(internal_file_name)?;
+        let left_display = self.relative_to_git_root_str(&baseline_external_path);
+        let right_display = self.relative_to_git_root_str(&current_path);
+        let git_root = self.find_git_root_cached(&current_path);
+        let stamp = file_stamp(&current_path);
+        Some(FileDiffJob {
+            internal: internal_file_name.to_string(),
+            git_root,
+            key: FileDiffKey {
+                current_path,
+                left_display,
+                right_display,
+                stamp,
+            },
+        })
+    }
+}
+
+/// Modification times closer than this to the time a diff was computed are not trusted, since a
+/// write within the filesystem's timestamp granularity could leave the metadata unchanged.
+const RACY_MTIME_WINDOW: Duration = Duration::from_secs(2);
+
+/// Minimum number of files to re-diff before the work is spread across threads.
+const PARALLEL_DIFF_MIN_FILES: usize = 8;
+
+/// Metadata of a file on disk, used to detect whether it changed since its diff was computed.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+struct FileStamp {
+    len: u64,
+    modified: Option<SystemTime>,
+    inode: u64,
+    mode: FileMode,
+}
+
+fn file_stamp(path: &Path) -> Option<FileStamp> {
+    let meta = fs::symlink_metadata(path).ok()?;
+    Some(FileStamp {
+        len: meta.len(),
+        modified: meta.modified().ok(),
+        inode: file_inode(&meta),
+        mode: file_mode_for_path(path).unwrap_or(FileMode::Regular),
+    })
+}
+
+#[cfg(unix)]
+fn file_inode(meta: &fs::Metadata) -> u64 {
+    use std::os::unix::fs::MetadataExt;
+    meta.ino()
+}
+
+#[cfg(not(unix))]
+fn file_inode(_meta: &fs::Metadata) -> u64 {
+    0
+}
+
+/// Everything a cached per-file diff depends on besides the (immutable) baseline.
+#[derive(Debug, PartialEq, Eq)]
+struct FileDiffKey {
+    current_path: PathBuf,
+    left_display: String,
+    right_display: String,
+    /// `None` when the file does not exist.
+    stamp: Option<FileStamp>,
+}
+
+impl FileDiffKey {
+    /// Whether the file's metadata is old enough, relative to `computed_at`, for a later
+    /// matching stamp to guarantee that the contents are unchanged.
+    fn is_settled(&self, computed_at: SystemTime) -> bool {
+        self.stamp.is_none_or(|stamp| {
+            stamp.modified.is_some_and(|modified| {
+                computed_at
+                    .duration_since(modified)
+                    .is_ok_and(|age| age >= RACY_MTIME_WINDOW)
+            })
+        })
+    }
+}
+
+struct CachedFileDiff {
+    key: FileDiffKey,
+    /// False when the file was modified too recently to trust its stamp.
+    reusable: bool,
+    diff: String,
+}
+
+struct FileDiffJob {
+    internal: String,
+    git_root: Option<PathBuf>,
+    key: FileDiffKey,
+}
+
+fn compute_file_diffs(
+    jobs: &[FileDiffJob],
+    baselines: &HashMap<String, BaselineFileInfo>,
+) -> Vec<String> {
+    let parallelism = std::thread::available_parallelism().map_or(1, NonZeroUsize::get);
+    if jobs.len() < PARALLEL_DIFF_MIN_FILES || parallelism == 1 {
+        return jobs
+            .iter()
+            .map(|job| job.compute(baselines.get(&job.internal)))
+            .collect();
+    }
+
+    let chunk_size = jobs.len().div_ceil(parallelism);
+    std::thread::scope(|scope| {
+        let handles: Vec<_> = jobs
+            .chunks(chunk_size)
+            .map(|chunk| {
+                scope.spawn(move || {
+                    chunk
+                        .iter()
+                        .map(|job| job.compute(baselines.get(&job.internal)))
+                        .collect::<Vec<_>>()
+                })
+            })
+            .collect();
+        handles
+            .into_iter()
+            .flat_map(|handle| {
+                handle
+                    .join()
+                    .unwrap_or_else(|panic| std::panic::resume_unwind(panic))
+            })
+            .collect()
+    })
+}
+
+impl FileDiffJob {
+    fn compute(&self, baseline: Option<&BaselineFileInfo>) -> String {
         let mut aggregated = String::new();
 
-        // Snapshot lightweight fields only.
-        let (baseline_external_path, baseline_mode, left_oid) = {
-            if let Some(info) = self.baseline_file_info.get(internal_file_name) {
-                (info.path.clone(), info.mode, info.oid.clone())
-            } else {
-                (PathBuf::new(), FileMode::Regular, ZERO_OID.to_string())
-            }
+        let FileDiffKey {
+            current_path: current_external_path,
+            left_display,
+            right_display,
+            ..
+        } = &self.key;
+        let (baseline_mode, left_oid) = match baseline {
+            Some(info) => (info.mode, info.oid.as_str()),
+            None => (FileMode::Regular, ZERO_OID),
         };
-        let current_external_path = match self.get_path_for_internal(internal_file_name) {
-            Some(p) => p,
-            None => return aggregated,
-        };
-
-        let current_mode = file_mode_for_path(&current_external_path).unwrap_or(FileMode::Regular);
-        let right_bytes = blob_bytes(&current_external_path, &current_mode);
 
-        // Compute displays with &mut self before borrowing any baseline content.
-        let left_display = self.relative_to_git_root_str(&baseline_external_path);
-        let right_display = self.relative_to_git_root_str(&current_external_path);
+        let current_mode = file_mode_for_path(current_external_path).unwrap_or(FileMode::Regular);
+        let right_bytes = blob_bytes(current_external_path, &current_mode);
 
-        // Compute right oid before borrowing baseline content.
         let right_oid = if let Some(b) = right_bytes.as_ref() {
             if current_mode == FileMode::Symlink {
                 format!("{:x}", git_blob_sha1_hex_bytes(b))
             } else {
-                self.git_blob_oid_for_path(&current_external_path)
+                self.git_root
+                    .as_deref()
+                    .and_then(|root| git_blob_oid(root, current_external_path))
                     .unwrap_or_else(|| format!("{:x}", git_blob_sha1_hex_bytes(b)))
             }
         } else {
             ZERO_OID.to_string()
         };
 
-        // Borrow baseline content only after all &mut self uses are done.
-        let left_present = left_oid.as_str() != ZERO_OID;
+        let left_present = left_oid != ZERO_OID;
         let left_bytes: Option<&[u8]> = if left_present {
-            self.baseline_file_info
-                .get(internal_file_name)
-                .map(|i| i.content.as_slice())
+            baseline.map(|i| i.content.as_slice())
         } else {
             None
         };
@@ -368,6 +525,26 @@ impl TurnDiffTracker {
     }
 }
 
+/// Ask git to compute the blob SHA-1 for the file at `path` within the repository at `root`.
+/// Returns None if the git invocation fails.
+fn git_blob_oid(root: &Path, path: &Path) -> Option<String> {
+    // Compute a path relative to the repo root for better portability across platforms.
+    let rel = path.strip_prefix(root).unwrap_or(path);
+    let output = Command::new("git")
+        .arg("-C")
+        .arg(root)
+        .arg("hash-object")
+        .arg("--")
+        .arg(rel)
+        .output()
+        .ok()?;
+    if !output.status.success() {
+        return None;
+    }
+    let s = String::from_utf8_lossy(&output.stdout).trim().to_string();
+    if s.len() == 40 { Some(s) } else { None }
+}
+
 /// Compute the Git SHA-1 blob object ID for the given content (bytes).
 fn git_blob_sha1_hex_bytes(data: &[u8]) -> Output<sha1::Sha1> {
     // Git blob hash is sha1 of: "blob <len>\0<data>"
@@ -503,6 +680,101 @@ mod tests {
         out
     }
 
+    /// Backdate `path` so that its stamp is outside the racy-mtime window.
+    fn set_old_mtime(path: &Path) {
+        let modified = SystemTime::now() - Duration::from_secs(60);
+        fs::File::options()
+            .write(true)
+            .open(path)
+            .unwrap()
+            .set_modified(modified)
+            .unwrap();
+    }
+
+    #[test]
+    fn unchanged_files_reuse_cached_diff() {
+        let mut acc = TurnDiffTracker::new();
+        let dir = tempdir().unwrap();
+        let file = dir.path().join("cached.txt");
+        fs::write(&file, "one\n").unwrap();
+
+        let update = HashMap::from([(
+            file.clone(),
+            FileChange::Update {
+                unified_diff: "".to_owned(),
+                move_path: None,
+            },
+        )]);
+        acc.on_patch_begin(&update);
+        fs::write(&file, "one\ntwo\n").unwrap();
+
+        // Freshly written files are always re-diffed.
+        let first = acc.get_unified_diff().unwrap();
+        assert!(acc.diff_cache.values().all(|cached| !cached.reusable));
+
+        set_old_mtime(&file);
+        assert_eq!(acc.get_unified_diff().unwrap(), first);
+        assert!(acc.diff_cache.values().all(|cached| cached.reusable));
+
+        // A cached entry is reused verbatim while the stamp is unchanged.
+        for cached in acc.diff_cache.values_mut() {
+            cached.diff = "cached\n".to_string();
+        }
+        assert_eq!(
+            acc.get_unified_diff().unwrap(),
+            Some("cached\n".to_string())
+        );
+
+        // Any metadata change invalidates it.
+        fs::write(&file, "one\ntwo\nthree\n").unwrap();
+        set_old_mtime(&file);
+        let diff = acc.get_unified_diff().unwrap().unwrap();
+        assert!(diff.contains("+three"), "{diff}");
+    }
+
+    #[test]
+    fn parallel_diff_matches_sequential_diff() {
+        let dir = tempdir().unwrap();
+        let changes: HashMap<PathBuf, FileChange> = (0..PARALLEL_DIFF_MIN_FILES * 2)
+            .map(|i| {
+                let path = dir.path().join(format!("file{i}.txt"));
+                fs::write(&path, format!("line {i}\n")).unwrap();
+                let change = FileChange::Update {
+                    unified_diff: "".to_owned(),
+                    move_path: None,
+                };
+                (path, change)
+            })
+            .collect();
+
+        let mut acc = TurnDiffTracker::new();
+        acc.on_patch_begin(&changes);
+        for path in changes.keys() {
+            fs::write(path, "replaced\n").unwrap();
+        }
+        let parallel = acc.get_unified_diff().unwrap().unwrap();
+
+        let mut sequential = String::new();
+        let mut paths: Vec<_> = changes.keys().collect();
+        paths.sort();
+        for path in paths {
+            let mut single = TurnDiffTracker::new();
+            let internal = acc.external_to_temp_name[path].clone();
+            let baseline = &acc.baseline_file_info[&internal];
+            single.baseline_file_info.insert(
+                internal.clone(),
+                BaselineFileInfo {
+                    path: baseline.path.clone(),
+                    content: baseline.content.clone(),
+                    mode: baseline.mode,
+                    oid: baseline.oid.clone(),
+                },
+            );
+            sequential.push_str(&single.get_unified_diff().unwrap().unwrap());
+        }
+        assert_eq!(parallel, sequential);
+    }
+
     #[test]
     fn accumulates_add_and_update() {
         let mut acc = TurnDiffTracker::new();
@@ -0,0 +1,161 @@
+//! Accumulates where the wall-clock time of a task goes, so that it can be
+//! reported as a [`TurnMetricsEvent`] when the task completes.
+//!
+//! Each phase is also wrapped in a `tracing` span at its call site (`task`,
+//! `turn_attempt`, `model_load_wait`, `model_request`, `exec_command`,
+//! `mcp_tool_call`, `approval_wait` and `rollout_write`), which is what a
+//! subscriber exporting traces sees; this type only keeps the per-task totals.
+//! `turn_attempt` covers a whole attempt, tool calls included, while
+//! `model_request` is entered only to send the request and poll its stream.
+
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::time::Duration;
+use std::time::Instant;
+
+use crate::protocol::TurnMetricsEvent;
+
+/// Totals for the task a session is currently running. A session runs at
+/// most one task at a time, so the totals are reset when a task starts.
+#[derive(Default)]
+pub(crate) struct TurnMetrics {
+    state: Mutex<State>,
+}
+
+#[derive(Default)]
+struct State {
+    started: Option<Instant>,
+    first_request: Option<Instant>,
+    totals: TurnMetricsEvent,
+}
+
+impl TurnMetrics {
+    fn with_state<R>(&self, f: impl FnOnce(&mut State) -> R) -> R {
+        f(&mut self.state.lock().unwrap_or_else(PoisonError::into_inner))
+    }
+
+    pub(crate) fn start_task(&self) {
+        self.with_state(|state| {
+            *state = State {
+                started: Some(Instant::now()),
+                ..State::default()
+            };
+        });
+    }
+
+    pub(crate) fn model_request_started(&self) {
+        self.with_state(|state| {
+            state.totals.model_requests += 1;
+            state.first_request.get_or_insert_with(Instant::now);
+        });
+    }
+
+    /// Called once per request, on its first output from the model.
+    pub(crate) fn model_output_started(&self) {
+        self.with_state(|state| {
+            if state.totals.time_to_first_token.is_none() {
+                state.totals.time_to_first_token = state.first_request.map(|t| t.elapsed());
+            }
+        });
+    }
+
+    pub(crate) fn model_request_completed(&self, elapsed: Duration) {
+        self.with_state(|state| state.totals.model_stream += elapsed);
+    }
+
+    pub(crate) fn retry(&self, backoff: Duration) {
+        self.with_state(|state| {
+            state.totals.retries += 1;
+            state.totals.retry_backoff += backoff;
+        });
+    }
+
+    pub(crate) fn model_load_wait(&self, elapsed: Duration) {
+        self.with_state(|state| state.totals.model_load_wait += elapsed);
+    }
+
+    pub(crate) fn tool_call(&self, sandbox_setup: Duration, run: Duration) {
+        self.with_state(|state| {
+            state.totals.tool_calls += 1;
+            state.totals.tool_sandbox_setup += sandbox_setup;
+            state.totals.tool_run += run;
+        });
+    }
+
+    pub(crate) fn approval_wait(&self, elapsed: Duration) {
+        self.with_state(|state| state.totals.approval_wait += elapsed);
+    }
+
+    pub(crate) fn rollout_write(&self, elapsed: Duration) {
+        self.with_state(|state| state.totals.rollout_write += elapsed);
+    }
+
+    /// Returns the totals of the current task and resets them.
+    pub(crate) fn finish_task(&self) -> TurnMetricsEvent {
+        self.with_state(|state| {
+            let State {
+                started, totals, ..
+            } = std::mem::take(state);
+            TurnMetricsEvent {
+                duration: started.map(|t| t.elapsed()).unwrap_or_default(),
+                ..totals
+            }
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use pretty_assertions::assert_eq;
+
+    #[test]
+    fn totals_accumulate_per_task() {
+        let metrics = TurnMetrics::default();
+        metrics.start_task();
+        metrics.model_request_started();
+        metrics.model_output_started();
+        metrics.model_request_completed(Duration::from_millis(30));
+        metrics.retry(Duration::from_millis(200));
+        metrics.model_load_wait(Duration::from_millis(400));
+        metrics.model_request_started();
+        metrics.model_output_started();
+        metrics.model_request_completed(Duration::from_millis(20));
+        metrics.tool_call(Duration::from_millis(2), Duration::from_millis(8));
+        metrics.tool_call(Duration::ZERO, Duration::from_millis(5));
+        metrics.approval_wait(Duration::from_millis(100));
+        metrics.rollout_write(Duration::from_millis(1));
+
+        let totals = metrics.finish_task();
+        assert_eq!(totals.model_requests, 2);
+        assert!(totals.time_to_first_token.is_some());
+        assert_eq!(totals.model_stream, Duration::from_millis(50));
+        assert_eq!(totals.retries, 1);
+        assert_eq!(totals.retry_backoff, Duration::from_millis(200));
+        assert_eq!(totals.model_load_wait, Duration::from_millis(400));
+        assert_eq!(totals.tool_calls, 2);
+        assert_eq!(totals.tool_sandbox_setup, Duration::from_millis(2));
+        assert_eq!(totals.tool_run, Duration::from_millis(13));
+        assert_eq!(totals.approval_wait, Duration::from_millis(100));
+        assert_eq!(totals.rollout_write, Duration::from_millis(1));
+
+        // The next task starts from zero.
+        metrics.start_task();
+        let next = metrics.finish_task();
+        assert_eq!(
+            next,
+            TurnMetricsEvent {
+                duration: next.duration,
+                ..TurnMetricsEvent::default()
+            }
+        );
+    }
+
+    #[test]
+    fn no_first_token_without_output() {
+        let metrics = TurnMetrics::default();
+        metrics.start_task();
+        metrics.model_request_started();
+        assert_eq!(metrics.finish_task().time_to_first_token, None);
+    }
+}
@@ -640,6 +640,8 @@ async fn azure_overrides_assign_properties_used_for_responses_url() {
         request_max_retries: None,
         stream_max_retries: None,
         stream_idle_timeout_ms: None,
+        pool_max_idle_per_host: None,
+        preconnect: false,
         requires_openai_auth: false,
     };
 
@@ -716,6 +718,8 @@ async fn env_var_overrides_loaded_auth() {
         request_max_retries: None,
         stream_max_retries: None,
         stream_idle_timeout_ms: None,
+        pool_max_idle_per_host: None,
+        preconnect: false,
         requires_openai_auth: false,
     };
 
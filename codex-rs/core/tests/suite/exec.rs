@@ -4,6 +4,7 @@ use std::collections::HashMap;
 
 use codex_core::exec::ExecParams;
 use codex_core::exec::ExecToolCallOutput;
+use codex_core::exec::OutputRetention;
 use codex_core::exec::SandboxType;
 use codex_core::exec::process_exec_tool_call;
 use codex_core::protocol::SandboxPolicy;
@@ -39,7 +40,15 @@ async fn run_test_cmd(tmp: TempDir, cmd: Vec<&str>) -> Result<ExecToolCallOutput
 
     let policy = SandboxPolicy::new_read_only_policy();
 
-    process_exec_tool_call(params, sandbox_type, &policy, &None, None).await
+    process_exec_tool_call(
+        params,
+        sandbox_type,
+        &policy,
+        &None,
+        None,
+        OutputRetention::default(),
+    )
+    .await
 }
 
 /// Command succeeds with exit code 0 normally
@@ -3,20 +3,22 @@
 use std::collections::HashMap;
 use std::path::PathBuf;
 
-use async_channel::Receiver;
+use codex_core::event_queue;
+use codex_core::event_queue::EVENT_QUEUE_CAPACITY;
+use codex_core::event_queue::EventReceiver;
 use codex_core::exec::ExecParams;
+use codex_core::exec::OutputRetention;
 use codex_core::exec::SandboxType;
 use codex_core::exec::StdoutStream;
 use codex_core::exec::process_exec_tool_call;
-use codex_core::protocol::Event;
 use codex_core::protocol::EventMsg;
 use codex_core::protocol::ExecCommandOutputDeltaEvent;
 use codex_core::protocol::ExecOutputStream;
 use codex_core::protocol::SandboxPolicy;
 
-fn collect_stdout_events(rx: Receiver<Event>) -> Vec<u8> {
+fn collect_stdout_events(rx: EventReceiver) -> Vec<u8> {
     let mut out = Vec::new();
-    while let Ok(ev) = rx.try_recv() {
+    while let Some(ev) = rx.try_recv() {
         if let EventMsg::ExecCommandOutputDelta(ExecCommandOutputDeltaEvent {
             stream: ExecOutputStream::Stdout,
             chunk,
@@ -31,7 +33,7 @@ fn collect_stdout_events(rx: Receiver<Event>) -> Vec<u8> {
 
 #[tokio::test]
 async fn test_exec_stdout_stream_events_echo() {
-    let (tx, rx) = async_channel::unbounded::<Event>();
+    let (tx, rx) = event_queue::channel(EVENT_QUEUE_CAPACITY);
 
     let stdout_stream = StdoutStream {
         sub_id: "test-sub".to_string(),
@@ -63,6 +65,7 @@ async fn test_exec_stdout_stream_events_echo() {
         &policy,
         &None,
         Some(stdout_stream),
+        OutputRetention::default(),
     )
     .await;
 
@@ -81,7 +84,7 @@ async fn test_exec_stdout_stream_events_echo() {
 
 #[tokio::test]
 async fn test_exec_stderr_stream_events_echo() {
-    let (tx, rx) = async_channel::unbounded::<Event>();
+    let (tx, rx) = event_queue::channel(EVENT_QUEUE_CAPACITY);
 
     let stdout_stream = StdoutStream {
         sub_id: "test-sub".to_string(),
@@ -113,6 +116,7 @@ async fn test_exec_stderr_stream_events_echo() {
         &policy,
         &None,
         Some(stdout_stream),
+        OutputRetention::default(),
     )
     .await;
 
@@ -127,7 +131,7 @@ async fn test_exec_stderr_stream_events_echo() {
 
     // Collect only stderr delta events
     let mut err = Vec::new();
-    while let Ok(ev) = rx.try_recv() {
+    while let Some(ev) = rx.try_recv() {
         if let EventMsg::ExecCommandOutputDelta(ExecCommandOutputDeltaEvent {
             stream: ExecOutputStream::Stderr,
             chunk,
@@ -160,9 +164,16 @@ async fn test_aggregated_output_interleaves_in_order() {
 
     let policy = SandboxPolicy::new_read_only_policy();
 
-    let result = process_exec_tool_call(params, SandboxType::None, &policy, &None, None)
-        .await
-        .expect("process_exec_tool_call");
+    let result = process_exec_tool_call(
+        params,
+        SandboxType::None,
+        &policy,
+        &None,
+        None,
+        OutputRetention::default(),
+    )
+    .await
+    .expect("process_exec_tool_call");
 
     assert_eq!(result.exit_code, 0);
     assert_eq!(result.stdout.text, "O1\nO2\n");
@@ -170,3 +181,42 @@ async fn test_aggregated_output_interleaves_in_order() {
     assert_eq!(result.aggregated_output.text, "O1\nE1\nO2\nE2\n");
     assert_eq!(result.aggregated_output.truncated_after_lines, None);
 }
+
+#[tokio::test]
+async fn test_large_output_keeps_only_head_and_tail() {
+    // ~1 MB of output with distinct first and last lines.
+    let cmd = vec![
+        "/bin/sh".to_string(),
+        "-c".to_string(),
+        "echo FIRST; i=0; while [ $i -lt 20000 ]; do echo 'filler line that is fifty bytes long..........'; i=$((i+1)); done; echo LAST".to_string(),
+    ];
+
+    let params = ExecParams {
+        command: cmd,
+        cwd: std::env::current_dir().unwrap_or_else(|_| PathBuf::from(".")),
+        timeout_ms: Some(30_000),
+        env: HashMap::new(),
+        with_escalated_permissions: None,
+        justification: None,
+    };
+
+    let policy = SandboxPolicy::new_read_only_policy();
+
+    let result = process_exec_tool_call(
+        params,
+        SandboxType::None,
+        &policy,
+        &None,
+        None,
+        OutputRetention::from_max_bytes(1024),
+    )
+    .await
+    .expect("process_exec_tool_call");
+
+    assert_eq!(result.exit_code, 0);
+    let text = &result.aggregated_output.text;
+    assert!(text.starts_with("FIRST\n"), "unexpected head: {text}");
+    assert!(text.ends_with("LAST\n"), "unexpected tail: {text}");
+    assert!(text.contains("[... omitted "), "missing marker: {text}");
+    assert!(text.len() < 2048, "retained {} bytes", text.len());
+}
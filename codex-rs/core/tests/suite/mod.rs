@@ -10,3 +10,4 @@ mod prompt_caching;
 mod seatbelt;
 mod stream_error_allows_next_turn;
 mod stream_no_completed;
+mod warm_pool;
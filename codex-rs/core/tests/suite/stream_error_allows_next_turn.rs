@@ -80,6 +80,8 @@ async fn continue_after_stream_error() {
         request_max_retries: Some(1),
         stream_max_retries: Some(1),
         stream_idle_timeout_ms: Some(2_000),
+        pool_max_idle_per_host: None,
+        preconnect: false,
         requires_openai_auth: false,
     };
 
@@ -0,0 +1,43 @@
+use std::time::Duration;
+
+use codex_core::ConversationManager;
+use codex_login::CodexAuth;
+use core_test_support::load_default_config_for_test;
+use tempfile::TempDir;
+
+#[tokio::test(flavor = "multi_thread", worker_threads = 2)]
+async fn new_conversation_is_served_from_warm_pool() {
+    let codex_home = TempDir::new().unwrap();
+    let config = load_default_config_for_test(&codex_home);
+
+    let conversation_manager =
+        ConversationManager::with_auth(CodexAuth::from_api_key("Test API Key")).with_warm_pool(1);
+
+    let first = conversation_manager
+        .new_conversation(config.clone())
+        .await
+        .expect("create first conversation");
+
+    // The pool is refilled in the background after the first conversation.
+    tokio::time::timeout(Duration::from_secs(10), async {
+        while conversation_manager.warm_conversations() < 1 {
+            tokio::time::sleep(Duration::from_millis(10)).await;
+        }
+    })
+    .await
+    .expect("warm conversation should be spawned");
+
+    let second = conversation_manager
+        .new_conversation(config)
+        .await
+        .expect("create second conversation");
+
+    assert_ne!(first.conversation_id, second.conversation_id);
+    assert_eq!(second.session_configured.session_id, second.conversation_id);
+    assert!(
+        conversation_manager
+            .get_conversation(second.conversation_id)
+            .await
+            .is_ok()
+    );
+}
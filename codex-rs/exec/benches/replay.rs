@@ -0,0 +1,235 @@
+#![allow(clippy::expect_used, clippy::unwrap_used)]
+
+//! Replays recorded multi-turn sessions through `codex-exec` and reports how
+//! long each model turn took and how much memory the process peaked at.
+//!
+//! Each directory under `tests/fixtures/replay` is one session: `CODEX_RS_SSE_FIXTURE`
+//! points at it, so the n-th request to the model is answered with the n-th
+//! `.sse` file and no network is involved.
+//!
+//! Run with:
+//!
+//! ```text
+//! cargo bench -p codex-exec --bench replay
+//! ```
+//!
+//! Set `CODEX_REPLAY_REPORT=<path>` to save the results, and
+//! `CODEX_REPLAY_BASELINE=<path>` to a previously saved report to fail when a
+//! session got slower or larger by more than `REGRESSION_TOLERANCE`.
+//! Peak RSS is read with wait4(2), so the replay only runs on Linux.
+
+fn main() {
+    #[cfg(target_os = "linux")]
+    codex_bench::run(&[("replay", linux::replay_benchmark)]);
+}
+
+#[cfg(target_os = "linux")]
+mod linux {
+    use codex_bench::report;
+    use codex_bench::report_value;
+    use serde_json::Value;
+    use serde_json::json;
+    use std::io::BufRead;
+    use std::io::BufReader;
+    use std::path::Path;
+    use std::process::Command;
+    use std::process::Stdio;
+    use std::time::Duration;
+    use std::time::Instant;
+    use tempfile::tempdir;
+
+    /// Each session is replayed this many times and the fastest run is kept, to
+    /// keep scheduler noise out of the comparison.
+    const RUNS_PER_SESSION: usize = 3;
+
+    /// Fraction by which a session may exceed its baseline before it is reported.
+    pub(super) const REGRESSION_TOLERANCE: f64 = 0.25;
+
+    struct SessionReport {
+        name: String,
+        turn_latencies: Vec<Duration>,
+        total: Duration,
+        max_rss_kib: i64,
+    }
+
+    impl SessionReport {
+        fn mean_turn(&self) -> Duration {
+            let total: Duration = self.turn_latencies.iter().sum();
+            total / self.turn_latencies.len().max(1) as u32
+        }
+
+        fn mean_turn_ms(&self) -> f64 {
+            self.mean_turn().as_secs_f64() * 1e3
+        }
+
+        fn to_json(&self) -> Value {
+            json!({
+                "session": self.name,
+                "turns": self.turn_latencies.len(),
+                "mean_turn_ms": self.mean_turn_ms(),
+                "total_ms": self.total.as_secs_f64() * 1e3,
+                "max_rss_kib": self.max_rss_kib,
+            })
+        }
+    }
+
+    /// Runs `codex-exec` once over the recorded turns in `session_dir`.
+    fn replay(name: &str, session_dir: &Path) -> SessionReport {
+        let cwd = tempdir().expect("failed to create temp dir");
+        // Reaped with wait4(2) below.
+        #[allow(clippy::zombie_processes)]
+        let mut child = Command::new(env!("CARGO_BIN_EXE_codex-exec"))
+            .current_dir(cwd.path())
+            .env("CODEX_HOME", cwd.path())
+            .env("OPENAI_API_KEY", "dummy")
+            .env("CODEX_RS_SSE_FIXTURE", session_dir)
+            .env("OPENAI_BASE_URL", "http://unused.local")
+            .arg("--skip-git-repo-check")
+            .arg("--json")
+            .arg("-s")
+            .arg("danger-full-access")
+            .arg("replay the recorded session")
+            .stdout(Stdio::piped())
+            .stderr(Stdio::null())
+            .spawn()
+            .expect("spawn codex-exec");
+
+        // A turn ends with the token usage reported for its model response.
+        let started = Instant::now();
+        let mut turn_started = started;
+        let mut turn_latencies = Vec::new();
+        let stdout = child.stdout.take().expect("piped stdout");
+        for line in BufReader::new(stdout).lines() {
+            let line = line.expect("read codex-exec output");
+            let Ok(event) = serde_json::from_str::<Value>(&line) else {
+                continue;
+            };
+            match event["msg"]["type"].as_str() {
+                Some("task_started") => turn_started = Instant::now(),
+                Some("token_count") => {
+                    let now = Instant::now();
+                    turn_latencies.push(now - turn_started);
+                    turn_started = now;
+                }
+                _ => {}
+            }
+        }
+        let total = started.elapsed();
+
+        // Reap the child with wait4(2) rather than Child::wait so that its own
+        // peak RSS is reported instead of the maximum over all children.
+        let pid = child.id() as libc::pid_t;
+        let mut status = 0;
+        // SAFETY: rusage is plain old data for which all-zero bytes are valid.
+        let mut usage: libc::rusage = unsafe { std::mem::zeroed() };
+        // SAFETY: `pid` is our own unreaped child and both out pointers are valid.
+        let reaped = unsafe { libc::wait4(pid, &mut status, 0, &mut usage) };
+        assert_eq!(reaped, pid, "wait4 failed");
+        assert!(
+            libc::WIFEXITED(status) && libc::WEXITSTATUS(status) == 0,
+            "codex-exec failed replaying {name} (status {status})"
+        );
+
+        SessionReport {
+            name: name.to_string(),
+            turn_latencies,
+            total,
+            max_rss_kib: usage.ru_maxrss,
+        }
+    }
+
+    /// Returns a description of every way `report` is worse than `baseline`.
+    fn regressions(report: &SessionReport, baseline: &Value) -> Vec<String> {
+        let mut found = Vec::new();
+        let limit = 1.0 + REGRESSION_TOLERANCE;
+        if let Some(base) = baseline["mean_turn_ms"].as_f64()
+            && report.mean_turn_ms() > base * limit
+        {
+            found.push(format!(
+                "{}: mean turn latency {:.1} ms vs {base:.1} ms baseline",
+                report.name,
+                report.mean_turn_ms()
+            ));
+        }
+        if let Some(base) = baseline["max_rss_kib"].as_i64()
+            && report.max_rss_kib as f64 > base as f64 * limit
+        {
+            found.push(format!(
+                "{}: peak RSS {} KiB vs {base} KiB baseline",
+                report.name, report.max_rss_kib
+            ));
+        }
+        found
+    }
+
+    pub(super) fn replay_benchmark() {
+        let sessions_root = Path::new(env!("CARGO_MANIFEST_DIR")).join("tests/fixtures/replay");
+        let mut sessions: Vec<_> = std::fs::read_dir(&sessions_root)
+            .expect("read replay fixtures")
+            .map(|entry| entry.expect("read replay fixture").path())
+            .filter(|path| path.is_dir())
+            .collect();
+        sessions.sort();
+
+        let baseline: Vec<Value> = std::env::var("CODEX_REPLAY_BASELINE")
+            .ok()
+            .map(|path| {
+                let text = std::fs::read_to_string(&path).expect("read replay baseline");
+                text.lines()
+                    .map(|line| serde_json::from_str(line).expect("parse replay baseline"))
+                    .collect()
+            })
+            .unwrap_or_default();
+
+        let mut report_lines = Vec::new();
+        let mut found = Vec::new();
+        for session_dir in &sessions {
+            let name = session_dir
+                .file_name()
+                .expect("session directory name")
+                .to_string_lossy()
+                .into_owned();
+            let session = (0..RUNS_PER_SESSION)
+                .map(|_| replay(&name, session_dir))
+                .min_by_key(|session| session.total)
+                .expect("at least one run");
+            let turns = std::fs::read_dir(session_dir)
+                .expect("read session fixtures")
+                .filter(|entry| {
+                    entry
+                        .as_ref()
+                        .is_ok_and(|entry| entry.path().extension().is_some_and(|ext| ext == "sse"))
+                })
+                .count();
+            assert_eq!(
+                session.turn_latencies.len(),
+                turns,
+                "{name}: expected one token count per recorded turn"
+            );
+
+            report(
+                "replay",
+                &format!("{name}, per turn ({turns} turns)"),
+                session.mean_turn(),
+            );
+            report("replay", &format!("{name}, total"), session.total);
+            report_value(
+                "replay",
+                &format!("{name}, peak RSS"),
+                format!("{} KiB", session.max_rss_kib),
+            );
+            if let Some(base) = baseline
+                .iter()
+                .find(|base| base["session"].as_str() == Some(name.as_str()))
+            {
+                found.extend(regressions(&session, base));
+            }
+            report_lines.push(session.to_json().to_string());
+        }
+
+        if let Ok(path) = std::env::var("CODEX_REPLAY_REPORT") {
+            std::fs::write(&path, report_lines.join("\n") + "\n").expect("write replay report");
+        }
+        assert!(found.is_empty(), "regressions:\n{}", found.join("\n"));
+    }
+}
@@ -189,6 +189,37 @@ impl EventProcessor for EventProcessorWithHumanOutput {
                 }
                 return CodexStatus::InitiateShutdown;
             }
+            EventMsg::TurnMetrics(metrics) => {
+                let mut summary = format!(
+                    "task took {}: model {} over {} request(s)",
+                    format_duration(metrics.duration),
+                    format_duration(metrics.model_stream),
+                    metrics.model_requests,
+                );
+                if let Some(ttft) = metrics.time_to_first_token {
+                    summary.push_str(&format!(", first token after {}", format_duration(ttft)));
+                }
+                if !metrics.model_load_wait.is_zero() {
+                    summary.push_str(&format!(
+                        ", waited {} for the model to load",
+                        format_duration(metrics.model_load_wait)
+                    ));
+                }
+                if metrics.tool_calls > 0 {
+                    summary.push_str(&format!(
+                        ", tools {} over {} call(s)",
+                        format_duration(metrics.tool_sandbox_setup + metrics.tool_run),
+                        metrics.tool_calls,
+                    ));
+                }
+                if !metrics.approval_wait.is_zero() {
+                    summary.push_str(&format!(
+                        ", waited {} for approval",
+                        format_duration(metrics.approval_wait)
+                    ));
+                }
+                ts_println!(self, "{}", summary.style(self.dimmed));
+            }
             EventMsg::TokenCount(token_usage) => {
                 ts_println!(self, "tokens used: {}", token_usage.blended_total());
             }
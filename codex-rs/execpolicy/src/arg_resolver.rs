@@ -15,7 +15,7 @@ pub struct PositionalArg {
 pub fn resolve_observed_args_with_patterns(
     program: &str,
     args: Vec<PositionalArg>,
-    arg_patterns: &Vec<ArgMatcher>,
+    arg_patterns: &[ArgMatcher],
 ) -> Result<Vec<MatchedArg>> {
     // Naive matching implementation. Among `arg_patterns`, there is allowed to
     // be at most one vararg pattern. Assuming `arg_patterns` is non-empty, we
@@ -40,7 +40,7 @@ pub fn resolve_observed_args_with_patterns(
         vararg_pattern,
     } = partition_args(program, arg_patterns)?;
 
-    let mut matched_args = Vec::<MatchedArg>::new();
+    let mut matched_args = Vec::<MatchedArg>::with_capacity(args.len());
 
     let prefix = get_range_checked(&args, 0..num_prefix_args)?;
     let mut prefix_arg_index = 0;
@@ -55,7 +55,7 @@ pub fn resolve_observed_args_with_patterns(
             let matched_arg = MatchedArg::new(
                 positional_arg.index,
                 pattern.arg_type(),
-                &positional_arg.value.clone(),
+                &positional_arg.value,
             )?;
             matched_args.push(matched_arg);
         }
@@ -66,7 +66,7 @@ pub fn resolve_observed_args_with_patterns(
         return Err(Error::NotEnoughArgs {
             program: program.to_string(),
             args,
-            arg_patterns: arg_patterns.clone(),
+            arg_patterns: arg_patterns.to_vec(),
         });
     }
 
@@ -87,14 +87,14 @@ pub fn resolve_observed_args_with_patterns(
                 if vararg.is_empty() {
                     return Err(Error::VarargMatcherDidNotMatchAnything {
                         program: program.to_string(),
-                        matcher: pattern,
+                        matcher: pattern.clone(),
                     });
                 } else {
                     for positional_arg in vararg {
                         let matched_arg = MatchedArg::new(
                             positional_arg.index,
                             pattern.arg_type(),
-                            &positional_arg.value.clone(),
+                            &positional_arg.value,
                         )?;
                         matched_args.push(matched_arg);
                     }
@@ -105,7 +105,7 @@ pub fn resolve_observed_args_with_patterns(
                     let matched_arg = MatchedArg::new(
                         positional_arg.index,
                         pattern.arg_type(),
-                        &positional_arg.value.clone(),
+                        &positional_arg.value,
                     )?;
                     matched_args.push(matched_arg);
                 }
@@ -126,7 +126,7 @@ pub fn resolve_observed_args_with_patterns(
             let matched_arg = MatchedArg::new(
                 positional_arg.index,
                 pattern.arg_type(),
-                &positional_arg.value.clone(),
+                &positional_arg.value,
             )?;
             matched_args.push(matched_arg);
         }
@@ -145,15 +145,15 @@ pub fn resolve_observed_args_with_patterns(
 }
 
 #[derive(Default)]
-struct ParitionedArgs {
+struct ParitionedArgs<'a> {
     num_prefix_args: usize,
     num_suffix_args: usize,
-    prefix_patterns: Vec<ArgMatcher>,
-    suffix_patterns: Vec<ArgMatcher>,
-    vararg_pattern: Option<ArgMatcher>,
+    prefix_patterns: Vec<&'a ArgMatcher>,
+    suffix_patterns: Vec<&'a ArgMatcher>,
+    vararg_pattern: Option<&'a ArgMatcher>,
 }
 
-fn partition_args(program: &str, arg_patterns: &Vec<ArgMatcher>) -> Result<ParitionedArgs> {
+fn partition_args<'a>(program: &str, arg_patterns: &'a [ArgMatcher]) -> Result<ParitionedArgs<'a>> {
     let mut in_prefix = true;
     let mut partitioned_args = ParitionedArgs::default();
 
@@ -161,22 +161,22 @@ fn partition_args(program: &str, arg_patterns: &Vec<ArgMatcher>) -> Result<Parit
         match pattern.cardinality().is_exact() {
             Some(n) => {
                 if in_prefix {
-                    partitioned_args.prefix_patterns.push(pattern.clone());
+                    partitioned_args.prefix_patterns.push(pattern);
                     partitioned_args.num_prefix_args += n;
                 } else {
-                    partitioned_args.suffix_patterns.push(pattern.clone());
+                    partitioned_args.suffix_patterns.push(pattern);
                     partitioned_args.num_suffix_args += n;
                 }
             }
             None => match partitioned_args.vararg_pattern {
                 None => {
-                    partitioned_args.vararg_pattern = Some(pattern.clone());
+                    partitioned_args.vararg_pattern = Some(pattern);
                     in_prefix = false;
                 }
                 Some(existing_pattern) => {
                     return Err(Error::MultipleVarargPatterns {
                         program: program.to_string(),
-                        first: existing_pattern,
+                        first: existing_pattern.clone(),
                         second: pattern.clone(),
                     });
                 }
@@ -1,3 +1,5 @@
+use std::collections::HashMap;
+
 use multimap::MultiMap;
 use regex_lite::Error as RegexError;
 use regex_lite::Regex;
@@ -14,7 +16,14 @@ use crate::program::PositiveExampleFailedCheck;
 
 pub struct Policy {
     programs: MultiMap<String, ProgramSpec>,
+    /// For each program with more than one spec, the specs that allow each
+    /// option, by their position in `programs`. A call passing an option that
+    /// a spec does not allow fails that spec's check, so it is not tried.
+    option_specs: HashMap<String, HashMap<String, Vec<usize>>>,
     forbidden_program_regexes: Vec<ForbiddenProgramRegex>,
+    /// Union of `forbidden_program_regexes`, so that a program that matches
+    /// none of them (the common case) is rejected in a single pass.
+    forbidden_programs_pattern: Option<Regex>,
     forbidden_substrings_pattern: Option<Regex>,
 }
 
@@ -34,24 +43,56 @@ impl Policy {
                 .join("|");
             Some(Regex::new(&format!("({escaped_substrings})"))?)
         };
+        let forbidden_programs_pattern = if forbidden_program_regexes.is_empty() {
+            None
+        } else {
+            let alternatives = forbidden_program_regexes
+                .iter()
+                .map(|ForbiddenProgramRegex { regex, .. }| format!("(?:{})", regex.as_str()))
+                .collect::<Vec<_>>()
+                .join("|");
+            Some(Regex::new(&alternatives)?)
+        };
+        let option_specs = programs
+            .iter_all()
+            .filter(|(_, specs)| specs.len() > 1)
+            .map(|(program, specs)| {
+                let mut table: HashMap<String, Vec<usize>> = HashMap::new();
+                for (index, spec) in specs.iter().enumerate() {
+                    for option in spec.allowed_options.keys() {
+                        table.entry(option.clone()).or_default().push(index);
+                    }
+                }
+                (program.clone(), table)
+            })
+            .collect();
         Ok(Self {
             programs,
+            option_specs,
             forbidden_program_regexes,
+            forbidden_programs_pattern,
             forbidden_substrings_pattern,
         })
     }
 
     pub fn check(&self, exec_call: &ExecCall) -> Result<MatchedExec> {
         let ExecCall { program, args } = &exec_call;
-        for ForbiddenProgramRegex { regex, reason } in &self.forbidden_program_regexes {
-            if regex.is_match(program) {
-                return Ok(MatchedExec::Forbidden {
-                    cause: Forbidden::Program {
-                        program: program.clone(),
-                        exec_call: exec_call.clone(),
-                    },
-                    reason: reason.clone(),
-                });
+        if self
+            .forbidden_programs_pattern
+            .as_ref()
+            .is_some_and(|pattern| pattern.is_match(program))
+        {
+            // Find the first matching regex to report its reason.
+            for ForbiddenProgramRegex { regex, reason } in &self.forbidden_program_regexes {
+                if regex.is_match(program) {
+                    return Ok(MatchedExec::Forbidden {
+                        cause: Forbidden::Program {
+                            program: program.clone(),
+                            exec_call: exec_call.clone(),
+                        },
+                        reason: reason.clone(),
+                    });
+                }
             }
         }
 
@@ -73,7 +114,13 @@ impl Policy {
             program: program.clone(),
         });
         if let Some(spec_list) = self.programs.get_vec(program) {
-            for spec in spec_list {
+            let ruled_out = self.specs_ruled_out_by_options(program, args, spec_list.len());
+            for (index, spec) in spec_list.iter().enumerate() {
+                // The last spec is always checked, since its error is the one
+                // reported when no spec matches.
+                if index + 1 < spec_list.len() && ruled_out.get(index).copied().unwrap_or(false) {
+                    continue;
+                }
                 match spec.check(exec_call) {
                     Ok(matched_exec) => return Ok(matched_exec),
                     Err(err) => {
@@ -85,6 +132,29 @@ impl Policy {
         last_err
     }
 
+    /// Which of the `spec_count` specs of `program` do not allow one of the
+    /// options in `args`. Every arg starting with `-` is either looked up as an
+    /// option or rejected as the value of one, so it must be an allowed option
+    /// for a spec to match.
+    fn specs_ruled_out_by_options(
+        &self,
+        program: &str,
+        args: &[String],
+        spec_count: usize,
+    ) -> Vec<bool> {
+        let Some(table) = self.option_specs.get(program) else {
+            return Vec::new();
+        };
+        let mut ruled_out = vec![false; spec_count];
+        for arg in args.iter().filter(|arg| arg.starts_with('-')) {
+            let allowing = table.get(arg.as_str()).map_or(&[][..], Vec::as_slice);
+            for (index, out) in ruled_out.iter_mut().enumerate() {
+                *out |= !allowing.contains(&index);
+            }
+        }
+        ruled_out
+    }
+
     pub fn check_each_good_list_individually(&self) -> Vec<PositiveExampleFailedCheck> {
         let mut violations = Vec::new();
         for (_program, spec) in self.programs.flat_iter() {
@@ -0,0 +1,51 @@
+use codex_execpolicy::ExecCall;
+use codex_execpolicy::Forbidden;
+use codex_execpolicy::MatchedExec;
+use codex_execpolicy::PolicyParser;
+
+#[test]
+fn first_matching_forbidden_program_regex_gives_the_reason() {
+    let unparsed_policy = r#"
+define_program(
+    program="ls",
+)
+forbid_program_regex(regex="^rm$", reason="rm deletes files")
+forbid_program_regex(regex="(?i)sudo", reason="no privilege escalation")
+forbid_program_regex(regex="^s", reason="starts with s")
+"#;
+    let parser = PolicyParser::new("test_forbidden_programs", unparsed_policy);
+    let policy = parser.parse().expect("failed to parse policy");
+
+    let reason_for = |program: &str| match policy.check(&ExecCall::new(program, &[])) {
+        Ok(MatchedExec::Forbidden {
+            cause: Forbidden::Program { .. },
+            reason,
+        }) => Some(reason),
+        _ => None,
+    };
+    assert_eq!(Some("rm deletes files".to_string()), reason_for("rm"));
+    assert_eq!(
+        Some("no privilege escalation".to_string()),
+        reason_for("SUDO")
+    );
+    assert_eq!(
+        Some("no privilege escalation".to_string()),
+        reason_for("sudo")
+    );
+    assert_eq!(Some("starts with s".to_string()), reason_for("sed"));
+    assert_eq!(None, reason_for("rmdir"));
+    assert_eq!(
+        Ok(MatchedExec::Forbidden {
+            cause: Forbidden::Program {
+                program: "rm".to_string(),
+                exec_call: ExecCall::new("rm", &["-rf", "/"]),
+            },
+            reason: "rm deletes files".to_string(),
+        }),
+        policy.check(&ExecCall::new("rm", &["-rf", "/"]))
+    );
+    assert!(matches!(
+        policy.check(&ExecCall::new("ls", &[])),
+        Ok(MatchedExec::Match { .. })
+    ));
+}
@@ -1,10 +1,12 @@
 // Aggregates all former standalone integration tests as modules.
 mod bad;
 mod cp;
+mod forbidden;
 mod good;
 mod head;
 mod literal;
 mod ls;
+mod multiple_specs;
 mod parse_sed_command;
 mod pwd;
 mod sed;
@@ -0,0 +1,52 @@
+use codex_execpolicy::Error;
+use codex_execpolicy::ExecCall;
+use codex_execpolicy::Forbidden;
+use codex_execpolicy::MatchedExec;
+use codex_execpolicy::PolicyParser;
+
+#[test]
+fn specs_are_tried_in_order_skipping_those_without_the_options() {
+    let unparsed_policy = r#"
+define_program(
+    program="tool",
+    options=[flag("-a")],
+    forbidden="-a is forbidden",
+)
+define_program(
+    program="tool",
+    options=[flag("-a"), flag("-b")],
+)
+define_program(
+    program="tool",
+    options=[flag("-c")],
+)
+"#;
+    let parser = PolicyParser::new("test_multiple_specs", unparsed_policy);
+    let policy = parser.parse().expect("failed to parse policy");
+
+    // The first spec allowing every option wins.
+    assert!(matches!(
+        policy.check(&ExecCall::new("tool", &["-a"])),
+        Ok(MatchedExec::Forbidden {
+            cause: Forbidden::Exec { .. },
+            ..
+        })
+    ));
+    assert!(matches!(
+        policy.check(&ExecCall::new("tool", &["-a", "-b"])),
+        Ok(MatchedExec::Match { .. })
+    ));
+    assert!(matches!(
+        policy.check(&ExecCall::new("tool", &["-c"])),
+        Ok(MatchedExec::Match { .. })
+    ));
+
+    // When no spec matches, the error comes from the last one.
+    assert_eq!(
+        Err(Error::UnknownOption {
+            program: "tool".to_string(),
+            option: "-b".to_string(),
+        }),
+        policy.check(&ExecCall::new("tool", &["-b"]))
+    );
+}
@@ -33,6 +33,12 @@ pub struct Cli {
     #[clap(long, default_value = "2")]
     pub threads: NonZero<usize>,
 
+    /// Read search patterns from stdin, one per line, instead of taking a
+    /// single pattern. The directory is indexed once and each pattern is
+    /// answered from memory; the index is rescanned only when the tree changes.
+    #[arg(long, default_value = "false", conflicts_with = "pattern")]
+    pub stdin: bool,
+
     /// Exclude patterns
     #[arg(short, long, action = ArgAction::Append)]
     pub exclude: Vec<String>,
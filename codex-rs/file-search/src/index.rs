@@ -0,0 +1,519 @@
+//! Long-lived, in-memory index of the files under a search directory.
+//!
+//! [`run`](crate::run) walks the whole tree for every query, which is fine for
+//! a one-shot invocation but far too slow to repeat on every keystroke in a
+//! large repository. A [`FileIndex`] walks the tree once, keeps the relative
+//! paths in memory, and answers queries against that snapshot without touching
+//! the disk.
+//!
+//! The index is kept up to date by rescanning: [`FileIndex::refresh_if_stale`]
+//! compares the modification time of every directory seen during the last walk
+//! (which changes whenever an entry is created, removed or renamed in it) and
+//! rebuilds the snapshot only when one of them differs. Queries keep being
+//! served from the previous snapshot while a rescan is in progress.
+//!
+//! When a query extends the previous one (the user typed more characters),
+//! only the paths that matched the previous query are scored again: a path
+//! that does not match a prefix of the query cannot match the full query.
+//!
+//! Paths are stored in a [`PathArena`]: one contiguous buffer plus an array of
+//! end offsets, rather than one heap allocation per path. Scoring walks the
+//! buffer sequentially and keeps matches as `u32` indices into it.
+
+use std::cell::UnsafeCell;
+use std::cmp::Reverse;
+use std::num::NonZero;
+use std::ops::Range;
+use std::path::Path;
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::sync::Mutex;
+use std::sync::PoisonError;
+use std::sync::RwLock;
+use std::sync::TryLockError;
+use std::sync::atomic::AtomicBool;
+use std::sync::atomic::AtomicUsize;
+use std::sync::atomic::Ordering;
+use std::time::SystemTime;
+
+use nucleo_matcher::Matcher;
+use nucleo_matcher::pattern::Pattern;
+
+use crate::BestMatchesList;
+use crate::FileSearchResults;
+use crate::WorkerCount;
+use crate::build_walker;
+use crate::create_pattern;
+use crate::create_worker_count;
+use crate::get_file_path;
+use crate::merge_best_matches;
+
+/// Each scoring thread only reads the cancel flag every N paths.
+const CHECK_INTERVAL: usize = 1024;
+
+/// In-memory path index for a single search directory.
+///
+/// All methods take `&self` so that one index can be shared (e.g. behind an
+/// `Arc`) between the threads that answer queries and the thread that rescans
+/// the tree.
+pub struct FileIndex {
+    search_directory: PathBuf,
+    exclude: Vec<String>,
+    threads: NonZero<usize>,
+    snapshot: RwLock<Arc<Snapshot>>,
+    /// Serializes walks so that at most one scan of the tree runs at a time.
+    scan_lock: Mutex<()>,
+    last_query: Mutex<Option<CachedQuery>>,
+}
+
+#[derive(Default)]
+struct Snapshot {
+    /// Incremented on every scan; `0` means the tree has not been walked yet.
+    generation: u64,
+    /// Paths of all files, relative to the search directory.
+    paths: PathArena,
+    /// Every directory visited by the walk along with its modification time.
+    directories: Vec<(PathBuf, Option<SystemTime>)>,
+}
+
+impl Snapshot {
+    fn is_stale(&self) -> bool {
+        self.directories.iter().any(|(dir, modified)| {
+            std::fs::metadata(dir).and_then(|m| m.modified()).ok() != *modified
+        })
+    }
+}
+
+/// Append-only, columnar storage for a list of paths.
+#[derive(Default)]
+struct PathArena {
+    /// Every path concatenated, without separators.
+    bytes: String,
+    /// `ends[i]` is the offset in `bytes` one past the end of path `i`.
+    ends: Vec<usize>,
+}
+
+impl PathArena {
+    fn push(&mut self, path: &str) {
+        self.bytes.push_str(path);
+        self.ends.push(self.bytes.len());
+    }
+
+    fn len(&self) -> usize {
+        self.ends.len()
+    }
+
+    fn get(&self, index: usize) -> &str {
+        let start = match index {
+            0 => 0,
+            _ => self.ends[index - 1],
+        };
+        &self.bytes[start..self.ends[index]]
+    }
+
+    fn append(&mut self, other: PathArena) {
+        let base = self.bytes.len();
+        self.bytes.push_str(&other.bytes);
+        self.ends
+            .extend(other.ends.into_iter().map(|end| base + end));
+    }
+}
+
+/// The paths that matched the most recent query, used to answer a refinement
+/// of that query without scoring the whole corpus again.
+struct CachedQuery {
+    query: String,
+    generation: u64,
+    /// Indices into `Snapshot::paths`.
+    matched: Arc<Vec<u32>>,
+}
+
+struct ChunkResult {
+    best_list: BestMatchesList<u32>,
+    matched: Vec<u32>,
+}
+
+impl FileIndex {
+    /// Creates an empty index. The tree is not walked until
+    /// [`FileIndex::ensure_built`] or [`FileIndex::refresh_if_stale`] is called.
+    pub fn new(search_directory: PathBuf, exclude: Vec<String>, threads: NonZero<usize>) -> Self {
+        Self {
+            search_directory,
+            exclude,
+            threads,
+            snapshot: RwLock::new(Arc::new(Snapshot::default())),
+            scan_lock: Mutex::new(()),
+            last_query: Mutex::new(None),
+        }
+    }
+
+    pub fn search_directory(&self) -> &Path {
+        &self.search_directory
+    }
+
+    /// Returns `true` once the tree has been walked at least once.
+    pub fn is_built(&self) -> bool {
+        self.current_snapshot().generation > 0
+    }
+
+    /// Walks the tree unless that has already happened. If another thread is
+    /// currently scanning, this waits for it to finish.
+    pub fn ensure_built(&self) -> anyhow::Result<()> {
+        let _guard = self
+            .scan_lock
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        if self.is_built() {
+            return Ok(());
+        }
+        self.rescan()
+    }
+
+    /// Rescans the tree if it was never walked or if any directory changed
+    /// since the last walk. Returns `Ok(true)` if the snapshot was rebuilt.
+    ///
+    /// If another thread is already scanning, this returns `Ok(false)`
+    /// immediately rather than waiting for it.
+    pub fn refresh_if_stale(&self) -> anyhow::Result<bool> {
+        let _guard = match self.scan_lock.try_lock() {
+            Ok(guard) => guard,
+            Err(TryLockError::Poisoned(err)) => err.into_inner(),
+            Err(TryLockError::WouldBlock) => return Ok(false),
+        };
+        let snapshot = self.current_snapshot();
+        if snapshot.generation > 0 && !snapshot.is_stale() {
+            return Ok(false);
+        }
+        self.rescan()?;
+        Ok(true)
+    }
+
+    /// Number of files in the current snapshot.
+    pub fn len(&self) -> usize {
+        self.current_snapshot().paths.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Fuzzy-matches `pattern_text` against the current snapshot. Returns an
+    /// empty result if `cancel_flag` is set while scoring.
+    pub fn search(
+        &self,
+        pattern_text: &str,
+        limit: NonZero<usize>,
+        cancel_flag: &AtomicBool,
+        compute_indices: bool,
+    ) -> FileSearchResults {
+        let snapshot = self.current_snapshot();
+        let candidates = self.refinement_candidates(pattern_text, snapshot.generation);
+        let pattern = create_pattern(pattern_text);
+
+        let num_candidates = candidates
+            .as_ref()
+            .map_or(snapshot.paths.len(), |c| c.len());
+        let num_chunks = self.threads.get().min(num_candidates.max(1));
+        let chunk_size = num_candidates.div_ceil(num_chunks);
+        let chunks: Vec<ChunkResult> = {
+            let snapshot = snapshot.as_ref();
+            let candidates = candidates.as_ref().map(|c| c.as_slice());
+            let pattern = &pattern;
+            std::thread::scope(|scope| {
+                let handles: Vec<_> = (0..num_chunks)
+                    .map(|chunk| {
+                        let start = (chunk * chunk_size).min(num_candidates);
+                        let end = (start + chunk_size).min(num_candidates);
+                        scope.spawn(move || {
+                            score_range(
+                                snapshot,
+                                candidates,
+                                start..end,
+                                pattern,
+                                limit,
+                                cancel_flag,
+                            )
+                        })
+                    })
+                    .collect();
+                handles
+                    .into_iter()
+                    .map(|handle| {
+                        handle
+                            .join()
+                            .unwrap_or_else(|err| std::panic::resume_unwind(err))
+                    })
+                    .collect()
+            })
+        };
+
+        if cancel_flag.load(Ordering::Relaxed) {
+            return FileSearchResults {
+                matches: Vec::new(),
+                total_match_count: 0,
+            };
+        }
+
+        let matched: Vec<u32> = chunks
+            .iter()
+            .flat_map(|chunk| chunk.matched.iter().copied())
+            .collect();
+        *self
+            .last_query
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner) = Some(CachedQuery {
+            query: pattern_text.to_string(),
+            generation: snapshot.generation,
+            matched: Arc::new(matched),
+        });
+
+        merge_best_matches(
+            chunks.iter().flat_map(|chunk| {
+                chunk
+                    .best_list
+                    .binary_heap
+                    .iter()
+                    .map(|Reverse((score, path_index))| {
+                        (*score, snapshot.paths.get(*path_index as usize))
+                    })
+            }),
+            chunks.iter().map(|chunk| chunk.best_list.num_matches).sum(),
+            limit,
+            &pattern,
+            compute_indices,
+        )
+    }
+
+    fn current_snapshot(&self) -> Arc<Snapshot> {
+        self.snapshot
+            .read()
+            .unwrap_or_else(PoisonError::into_inner)
+            .clone()
+    }
+
+    /// Walks the tree and swaps in the new snapshot. The caller must hold
+    /// `scan_lock`.
+    fn rescan(&self) -> anyhow::Result<()> {
+        let generation = self.current_snapshot().generation + 1;
+        let snapshot = walk_tree(
+            &self.search_directory,
+            &self.exclude,
+            self.threads,
+            generation,
+        )?;
+        *self
+            .snapshot
+            .write()
+            .unwrap_or_else(PoisonError::into_inner) = Arc::new(snapshot);
+        Ok(())
+    }
+
+    fn refinement_candidates(&self, pattern_text: &str, generation: u64) -> Option<Arc<Vec<u32>>> {
+        let last_query = self
+            .last_query
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner);
+        match last_query.as_ref() {
+            Some(cached)
+                if cached.generation == generation
+                    && is_refinement(&cached.query, pattern_text) =>
+            {
+                Some(cached.matched.clone())
+            }
+            _ => None,
+        }
+    }
+}
+
+/// Every path matching `query` also matches `previous` when `query` only
+/// appends characters to it. A trailing backslash is excluded because it may
+/// turn into an escaped space once more text is typed.
+fn is_refinement(previous: &str, query: &str) -> bool {
+    query.starts_with(previous) && !previous.ends_with('\\')
+}
+
+fn score_range(
+    snapshot: &Snapshot,
+    candidates: Option<&[u32]>,
+    range: Range<usize>,
+    pattern: &Pattern,
+    limit: NonZero<usize>,
+    cancel_flag: &AtomicBool,
+) -> ChunkResult {
+    let mut best_list = BestMatchesList::new(
+        limit.get(),
+        pattern.clone(),
+        Matcher::new(nucleo_matcher::Config::DEFAULT),
+    );
+    let mut matched = Vec::new();
+    for (processed, position) in range.enumerate() {
+        if processed % CHECK_INTERVAL == 0 && cancel_flag.load(Ordering::Relaxed) {
+            break;
+        }
+        let path_index = match candidates {
+            Some(candidates) => candidates[position],
+            None => position as u32,
+        };
+        if best_list.insert(snapshot.paths.get(path_index as usize), || path_index) {
+            matched.push(path_index);
+        }
+    }
+    ChunkResult { best_list, matched }
+}
+
+fn walk_tree(
+    search_directory: &Path,
+    exclude: &[String],
+    threads: NonZero<usize>,
+    generation: u64,
+) -> anyhow::Result<Snapshot> {
+    let WorkerCount {
+        num_walk_builder_threads,
+        num_best_matches_lists,
+    } = create_worker_count(threads);
+    let outputs_per_worker: Vec<UnsafeCell<Snapshot>> = (0..num_best_matches_lists)
+        .map(|_| UnsafeCell::new(Snapshot::default()))
+        .collect();
+
+    let walker = build_walker(search_directory, exclude, num_walk_builder_threads)?;
+    let index_counter = AtomicUsize::new(0);
+    walker.run(|| {
+        let index = index_counter.fetch_add(1, Ordering::Relaxed);
+        let output_ptr = outputs_per_worker[index].get();
+        let output = unsafe { &mut *output_ptr };
+
+        Box::new(move |entry| {
+            if let Ok(dir_entry) = &entry
+                && dir_entry.file_type().is_some_and(|ft| ft.is_dir())
+            {
+                let modified = dir_entry.metadata().ok().and_then(|m| m.modified().ok());
+                output
+                    .directories
+                    .push((dir_entry.path().to_path_buf(), modified));
+            } else if let Some(path) = get_file_path(&entry, search_directory) {
+                output.paths.push(path);
+            }
+            ignore::WalkState::Continue
+        })
+    });
+
+    let mut snapshot = Snapshot {
+        generation,
+        ..Default::default()
+    };
+    for output in outputs_per_worker {
+        let output = output.into_inner();
+        snapshot.paths.append(output.paths);
+        snapshot.directories.extend(output.directories);
+    }
+    Ok(snapshot)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use pretty_assertions::assert_eq;
+    use tempfile::TempDir;
+
+    const LIMIT: NonZero<usize> = NonZero::new(16).unwrap();
+    const THREADS: NonZero<usize> = NonZero::new(2).unwrap();
+
+    fn make_tree(files: &[&str]) -> TempDir {
+        let dir = TempDir::new().expect("tempdir");
+        for file in files {
+            let path = dir.path().join(file);
+            if let Some(parent) = path.parent() {
+                std::fs::create_dir_all(parent).expect("create parent");
+            }
+            std::fs::write(path, "").expect("write file");
+        }
+        dir
+    }
+
+    fn search_paths(index: &FileIndex, query: &str) -> Vec<String> {
+        let cancel = AtomicBool::new(false);
+        index
+            .search(query, LIMIT, &cancel, false)
+            .matches
+            .into_iter()
+            .map(|m| m.path)
+            .collect()
+    }
+
+    #[test]
+    fn path_arena_round_trips() {
+        let mut first = PathArena::default();
+        first.push("a.rs");
+        first.push("");
+        let mut second = PathArena::default();
+        second.push("src/b.rs");
+        first.append(second);
+
+        assert_eq!(first.len(), 3);
+        assert_eq!(
+            (0..first.len()).map(|i| first.get(i)).collect::<Vec<_>>(),
+            vec!["a.rs", "", "src/b.rs"]
+        );
+    }
+
+    #[test]
+    fn index_matches_full_walk() {
+        let dir = make_tree(&["src/lib.rs", "src/main.rs", "README.md", "docs/guide.md"]);
+        let index = FileIndex::new(dir.path().to_path_buf(), Vec::new(), THREADS);
+        index.ensure_built().expect("build index");
+        assert_eq!(index.len(), 4);
+
+        for query in ["rs", "md", "src", "zzz"] {
+            let expected: Vec<String> = crate::run(
+                query,
+                LIMIT,
+                dir.path(),
+                Vec::new(),
+                THREADS,
+                Arc::new(AtomicBool::new(false)),
+                false,
+            )
+            .expect("run")
+            .matches
+            .into_iter()
+            .map(|m| m.path)
+            .collect();
+            assert_eq!(search_paths(&index, query), expected, "query {query:?}");
+        }
+    }
+
+    #[test]
+    fn refined_query_only_rescores_previous_matches() {
+        let dir = make_tree(&["src/lib.rs", "src/main.rs", "README.md"]);
+        let index = FileIndex::new(dir.path().to_path_buf(), Vec::new(), THREADS);
+        index.ensure_built().expect("build index");
+
+        assert_eq!(search_paths(&index, "s").len(), 2);
+        let candidates = index
+            .refinement_candidates("sr", 1)
+            .expect("refinement should reuse the previous matches");
+        assert_eq!(candidates.len(), 2);
+        assert_eq!(search_paths(&index, "srcl"), vec!["src/lib.rs".to_string()]);
+
+        // An unrelated query must score the whole corpus again.
+        assert!(index.refinement_candidates("md", 1).is_none());
+        assert_eq!(search_paths(&index, "md"), vec!["README.md".to_string()]);
+    }
+
+    #[test]
+    fn refresh_picks_up_new_files_only_when_stale() {
+        let dir = make_tree(&["a.txt"]);
+        let index = FileIndex::new(dir.path().to_path_buf(), Vec::new(), THREADS);
+        assert!(index.refresh_if_stale().expect("initial scan"));
+        assert!(!index.refresh_if_stale().expect("unchanged tree"));
+
+        std::fs::create_dir(dir.path().join("nested")).expect("mkdir");
+        std::fs::write(dir.path().join("nested/b.txt"), "").expect("write");
+        assert!(index.refresh_if_stale().expect("changed tree"));
+        let expected = Path::new("nested").join("b.txt");
+        assert_eq!(
+            search_paths(&index, "b.txt"),
+            vec![expected.to_string_lossy().into_owned()]
+        );
+    }
+}
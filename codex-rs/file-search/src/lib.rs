@@ -1,4 +1,5 @@
 use ignore::WalkBuilder;
+use ignore::WalkParallel;
 use ignore::overrides::OverrideBuilder;
 use nucleo_matcher::Matcher;
 use nucleo_matcher::Utf32Str;
@@ -16,11 +17,18 @@ use std::sync::Arc;
 use std::sync::atomic::AtomicBool;
 use std::sync::atomic::AtomicUsize;
 use std::sync::atomic::Ordering;
+use tokio::io::AsyncBufReadExt;
+use tokio::io::BufReader;
 use tokio::process::Command;
 
+use crate::prefilter::Prefilter;
+
 mod cli;
+mod index;
+mod prefilter;
 
 pub use cli::Cli;
+pub use index::FileIndex;
 
 /// A single match result returned from the search.
 ///
@@ -49,6 +57,9 @@ pub trait Reporter {
     fn report_match(&self, file_match: &FileMatch);
     fn warn_matches_truncated(&self, total_match_count: usize, shown_match_count: usize);
     fn warn_no_search_pattern(&self, search_directory: &Path);
+
+    /// Called in `--stdin` mode after all matches for `pattern` were reported.
+    fn report_query_complete(&self, _pattern: &str) {}
 }
 
 pub async fn run_main<T: Reporter>(
@@ -60,6 +71,7 @@ pub async fn run_main<T: Reporter>(
         json: _,
         exclude,
         threads,
+        stdin,
     }: Cli,
     reporter: T,
 ) -> anyhow::Result<()> {
@@ -67,6 +79,15 @@ pub async fn run_main<T: Reporter>(
         Some(dir) => dir,
         None => std::env::current_dir()?,
     };
+    if stdin {
+        return run_stdin_queries(
+            FileIndex::new(search_directory, exclude, threads),
+            limit,
+            compute_indices,
+            reporter,
+        )
+        .await;
+    }
     let pattern_text = match pattern {
         Some(pattern) => pattern,
         None => {
@@ -119,6 +140,33 @@ pub async fn run_main<T: Reporter>(
     Ok(())
 }
 
+/// Answer every pattern read from stdin against a single in-memory index.
+async fn run_stdin_queries<T: Reporter>(
+    index: FileIndex,
+    limit: NonZero<usize>,
+    compute_indices: bool,
+    reporter: T,
+) -> anyhow::Result<()> {
+    let cancel_flag = AtomicBool::new(false);
+    let mut lines = BufReader::new(tokio::io::stdin()).lines();
+    while let Some(pattern_text) = lines.next_line().await? {
+        index.refresh_if_stale()?;
+        let FileSearchResults {
+            total_match_count,
+            matches,
+        } = index.search(&pattern_text, limit, &cancel_flag, compute_indices);
+        let match_count = matches.len();
+        for file_match in matches {
+            reporter.report_match(&file_match);
+        }
+        if total_match_count > match_count {
+            reporter.warn_matches_truncated(total_match_count, match_count);
+        }
+        reporter.report_query_complete(&pattern_text);
+    }
+    Ok(())
+}
+
 /// The worker threads will periodically check `cancel_flag` to see if they
 /// should stop processing files.
 pub fn run(
@@ -138,7 +186,8 @@ pub fn run(
         num_walk_builder_threads,
         num_best_matches_lists,
     } = create_worker_count(threads);
-    let best_matchers_per_worker: Vec<UnsafeCell<BestMatchesList>> = (0..num_best_matches_lists)
+    let best_matchers_per_worker: Vec<UnsafeCell<BestMatchesList<String>>> = (0
+        ..num_best_matches_lists)
         .map(|_| {
             UnsafeCell::new(BestMatchesList::new(
                 limit.get(),
@@ -148,21 +197,7 @@ pub fn run(
         })
         .collect();
 
-    // Use the same tree-walker library that ripgrep uses. We use it directly so
-    // that we can leverage the parallelism it provides.
-    let mut walk_builder = WalkBuilder::new(search_directory);
-    walk_builder.threads(num_walk_builder_threads);
-    if !exclude.is_empty() {
-        let mut override_builder = OverrideBuilder::new(search_directory);
-        for exclude in exclude {
-            // The `!` prefix is used to indicate an exclude pattern.
-            let exclude_pattern = format!("!{exclude}");
-            override_builder.add(&exclude_pattern)?;
-        }
-        let override_matcher = override_builder.build()?;
-        walk_builder.overrides(override_matcher);
-    }
-    let walker = walk_builder.build_parallel();
+    let walker = build_walker(search_directory, &exclude, num_walk_builder_threads)?;
 
     // Each worker created by `WalkParallel::run()` will have its own
     // `BestMatchesList` to update.
@@ -181,7 +216,7 @@ pub fn run(
 
         Box::new(move |entry| {
             if let Some(path) = get_file_path(&entry, search_directory) {
-                best_list.insert(path);
+                best_list.insert(path, || path.to_string());
             }
 
             processed += 1;
@@ -193,24 +228,6 @@ pub fn run(
         })
     });
 
-    fn get_file_path<'a>(
-        entry_result: &'a Result<ignore::DirEntry, ignore::Error>,
-        search_directory: &std::path::Path,
-    ) -> Option<&'a str> {
-        let entry = match entry_result {
-            Ok(e) => e,
-            Err(_) => return None,
-        };
-        if entry.file_type().is_some_and(|ft| ft.is_dir()) {
-            return None;
-        }
-        let path = entry.path();
-        match path.strip_prefix(search_directory) {
-            Ok(rel_path) => rel_path.to_str(),
-            Err(_) => None,
-        }
-    }
-
     // If the cancel flag is set, we return early with an empty result.
     if cancel_flag.load(Ordering::Relaxed) {
         return Ok(FileSearchResults {
@@ -219,25 +236,86 @@ pub fn run(
         });
     }
 
-    // Merge results across best_matchers_per_worker.
-    let mut global_heap: BinaryHeap<Reverse<(u32, String)>> = BinaryHeap::new();
-    let mut total_match_count = 0;
-    for best_list_cell in best_matchers_per_worker.iter() {
-        let best_list = unsafe { &*best_list_cell.get() };
-        total_match_count += best_list.num_matches;
-        for &Reverse((score, ref line)) in best_list.binary_heap.iter() {
-            if global_heap.len() < limit.get() {
-                global_heap.push(Reverse((score, line.clone())));
-            } else if let Some(min_element) = global_heap.peek()
-                && score > min_element.0.0
-            {
-                global_heap.pop();
-                global_heap.push(Reverse((score, line.clone())));
-            }
+    let best_lists: Vec<BestMatchesList<String>> = best_matchers_per_worker
+        .into_iter()
+        .map(UnsafeCell::into_inner)
+        .collect();
+    Ok(merge_best_matches(
+        best_lists.iter().flat_map(|list| {
+            list.binary_heap
+                .iter()
+                .map(|Reverse((score, path))| (*score, path.as_str()))
+        }),
+        best_lists.iter().map(|list| list.num_matches).sum(),
+        limit,
+        &pattern,
+        compute_indices,
+    ))
+}
+
+/// Use the same tree-walker library that ripgrep uses. We use it directly so
+/// that we can leverage the parallelism it provides.
+fn build_walker(
+    search_directory: &Path,
+    exclude: &[String],
+    num_threads: usize,
+) -> anyhow::Result<WalkParallel> {
+    let mut walk_builder = WalkBuilder::new(search_directory);
+    walk_builder.threads(num_threads);
+    if !exclude.is_empty() {
+        let mut override_builder = OverrideBuilder::new(search_directory);
+        for exclude in exclude {
+            // The `!` prefix is used to indicate an exclude pattern.
+            let exclude_pattern = format!("!{exclude}");
+            override_builder.add(&exclude_pattern)?;
         }
+        let override_matcher = override_builder.build()?;
+        walk_builder.overrides(override_matcher);
     }
+    Ok(walk_builder.build_parallel())
+}
+
+fn get_file_path<'a>(
+    entry_result: &'a Result<ignore::DirEntry, ignore::Error>,
+    search_directory: &Path,
+) -> Option<&'a str> {
+    let entry = match entry_result {
+        Ok(e) => e,
+        Err(_) => return None,
+    };
+    if entry.file_type().is_some_and(|ft| ft.is_dir()) {
+        return None;
+    }
+    let path = entry.path();
+    match path.strip_prefix(search_directory) {
+        Ok(rel_path) => rel_path.to_str(),
+        Err(_) => None,
+    }
+}
 
-    let mut raw_matches: Vec<(u32, String)> = global_heap.into_iter().map(|r| r.0).collect();
+/// Merge the `(score, path)` candidates kept by the per-worker lists into the
+/// global top `limit` matches, optionally computing the highlight indices for
+/// each of them. Only the final matches are copied into owned `String`s.
+fn merge_best_matches<'a>(
+    candidates: impl Iterator<Item = (u32, &'a str)>,
+    total_match_count: usize,
+    limit: NonZero<usize>,
+    pattern: &Pattern,
+    compute_indices: bool,
+) -> FileSearchResults {
+    let mut global_heap: BinaryHeap<Reverse<(u32, &'a str)>> = BinaryHeap::new();
+    for (score, line) in candidates {
+        if global_heap.len() < limit.get() {
+            global_heap.push(Reverse((score, line)));
+        } else if let Some(min_element) = global_heap.peek()
+            && score > min_element.0.0
+        {
+            global_heap.pop();
+            global_heap.push(Reverse((score, line)));
+        }
+    }
+
+    let mut raw_matches: Vec<(u32, &str)> = global_heap.into_iter().map(|r| r.0).collect();
     sort_matches(&mut raw_matches);
 
     // Transform into `FileMatch`, optionally computing indices.
@@ -252,7 +330,7 @@ pub fn run(
         .map(|(score, path)| {
             let indices = if compute_indices {
                 let mut buf = Vec::<char>::new();
-                let haystack: Utf32Str<'_> = Utf32Str::new(&path, &mut buf);
+                let haystack: Utf32Str<'_> = Utf32Str::new(path, &mut buf);
                 let mut idx_vec: Vec<u32> = Vec::new();
                 if let Some(ref mut m) = matcher {
                     // Ignore the score returned from indices – we already have `score`.
@@ -267,20 +345,20 @@ pub fn run(
 
             FileMatch {
                 score,
-                path,
+                path: path.to_string(),
                 indices,
             }
         })
         .collect();
 
-    Ok(FileSearchResults {
+    FileSearchResults {
         matches,
         total_match_count,
-    })
+    }
 }
 
 /// Sort matches in-place by descending score, then ascending path.
-fn sort_matches(matches: &mut [(u32, String)]) {
+fn sort_matches<P: Ord>(matches: &mut [(u32, P)]) {
     matches.sort_by(|a, b| match b.0.cmp(&a.0) {
         std::cmp::Ordering::Equal => a.1.cmp(&b.1),
         other => other,
@@ -288,22 +366,28 @@ fn sort_matches(matches: &mut [(u32, String)]) {
 }
 
 /// Maintains the `max_count` best matches for a given pattern.
-struct BestMatchesList {
+///
+/// `K` identifies a kept match: an owned `String` when paths come straight
+/// from the directory walk, or an index into the corpus for [`FileIndex`], so
+/// that searching the index does not allocate per candidate.
+struct BestMatchesList<K> {
     max_count: usize,
     num_matches: usize,
     pattern: Pattern,
+    prefilter: Option<Prefilter>,
     matcher: Matcher,
-    binary_heap: BinaryHeap<Reverse<(u32, String)>>,
+    binary_heap: BinaryHeap<Reverse<(u32, K)>>,
 
     /// Internal buffer for converting strings to UTF-32.
     utf32buf: Vec<char>,
 }
 
-impl BestMatchesList {
+impl<K: Ord> BestMatchesList<K> {
     fn new(max_count: usize, pattern: Pattern, matcher: Matcher) -> Self {
         Self {
             max_count,
             num_matches: 0,
+            prefilter: Prefilter::new(&pattern),
             pattern,
             matcher,
             binary_heap: BinaryHeap::new(),
@@ -311,7 +395,14 @@ impl BestMatchesList {
         }
     }
 
-    fn insert(&mut self, line: &str) {
+    /// Scores `line` against the pattern, returning `true` if it matched.
+    /// `key` is only called if the match is kept.
+    fn insert(&mut self, line: &str, key: impl FnOnce() -> K) -> bool {
+        if let Some(prefilter) = &self.prefilter
+            && !prefilter.may_match(line)
+        {
+            return false;
+        }
         let haystack: Utf32Str<'_> = Utf32Str::new(line, &mut self.utf32buf);
         if let Some(score) = self.pattern.score(haystack, &mut self.matcher) {
             // In the tests below, we verify that score() returns None for a
@@ -319,13 +410,16 @@ impl BestMatchesList {
             self.num_matches += 1;
 
             if self.binary_heap.len() < self.max_count {
-                self.binary_heap.push(Reverse((score, line.to_string())));
+                self.binary_heap.push(Reverse((score, key())));
             } else if let Some(min_element) = self.binary_heap.peek()
                 && score > min_element.0.0
             {
                 self.binary_heap.pop();
-                self.binary_heap.push(Reverse((score, line.to_string())));
+                self.binary_heap.push(Reverse((score, key())));
             }
+            true
+        } else {
+            false
         }
     }
 }
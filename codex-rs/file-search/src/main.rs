@@ -69,6 +69,15 @@ impl Reporter for StdioReporter {
         }
     }
 
+    fn report_query_complete(&self, pattern: &str) {
+        if self.write_output_as_json {
+            let value = json!({"query_complete": pattern});
+            println!("{}", serde_json::to_string(&value).unwrap());
+        } else {
+            println!();
+        }
+    }
+
     fn warn_no_search_pattern(&self, search_directory: &Path) {
         eprintln!(
             "No search pattern specified. Showing the contents of the current directory ({}):",
@@ -0,0 +1,141 @@
+//! Cheap rejection of paths that cannot match a fuzzy pattern.
+//!
+//! A fuzzy atom only matches a haystack that contains the atom's characters as
+//! a subsequence, so checking that is a necessary condition for a match. For
+//! ASCII needles and haystacks the check compares bytes under ASCII case
+//! folding and uses `memchr`/`memchr2` (SIMD-accelerated on the platforms we
+//! ship) to jump from one needle byte to the next. Only the paths that pass it
+//! are converted to UTF-32 and scored by `nucleo_matcher`.
+//!
+//! The check must never reject a path that `nucleo_matcher` would accept, so
+//! it is skipped whenever Unicode normalization or case folding could make a
+//! non-ASCII character match: for non-ASCII haystacks and for patterns whose
+//! needles contain non-ASCII characters.
+
+use nucleo_matcher::Utf32Str;
+use nucleo_matcher::pattern::AtomKind;
+use nucleo_matcher::pattern::Pattern;
+
+pub(crate) struct Prefilter {
+    /// ASCII-lowercased needle of every atom in the pattern.
+    needles: Vec<Vec<u8>>,
+}
+
+impl Prefilter {
+    /// Returns `None` when the pattern cannot be prefiltered safely.
+    pub(crate) fn new(pattern: &Pattern) -> Option<Self> {
+        let mut needles = Vec::with_capacity(pattern.atoms.len());
+        for atom in &pattern.atoms {
+            if atom.negative || !matches!(atom.kind, AtomKind::Fuzzy) {
+                return None;
+            }
+            match atom.needle_text() {
+                Utf32Str::Ascii(bytes) => needles.push(bytes.to_ascii_lowercase()),
+                Utf32Str::Unicode(_) => return None,
+            }
+        }
+        Some(Self { needles })
+    }
+
+    /// Returns `false` only if `haystack` is guaranteed not to match.
+    pub(crate) fn may_match(&self, haystack: &str) -> bool {
+        if !haystack.is_ascii() {
+            return true;
+        }
+        let haystack = haystack.as_bytes();
+        self.needles
+            .iter()
+            .all(|needle| contains_subsequence_ignore_ascii_case(haystack, needle))
+    }
+}
+
+/// `needle` must already be ASCII-lowercased.
+fn contains_subsequence_ignore_ascii_case(haystack: &[u8], needle: &[u8]) -> bool {
+    if needle.len() > haystack.len() {
+        return false;
+    }
+    let mut rest = haystack;
+    for &lower in needle {
+        let upper = lower.to_ascii_uppercase();
+        let found = if upper == lower {
+            memchr::memchr(lower, rest)
+        } else {
+            memchr::memchr2(lower, upper, rest)
+        };
+        match found {
+            Some(pos) => rest = &rest[pos + 1..],
+            None => return false,
+        }
+    }
+    true
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::create_pattern;
+    use nucleo_matcher::Matcher;
+
+    fn prefilter(pattern: &str) -> Option<Prefilter> {
+        Prefilter::new(&create_pattern(pattern))
+    }
+
+    #[test]
+    fn subsequence_check_folds_ascii_case() {
+        assert!(contains_subsequence_ignore_ascii_case(
+            b"src/Main.rs",
+            b"smain"
+        ));
+        assert!(contains_subsequence_ignore_ascii_case(b"README.md", b"rmd"));
+        assert!(!contains_subsequence_ignore_ascii_case(
+            b"README.md",
+            b"mdr"
+        ));
+        assert!(!contains_subsequence_ignore_ascii_case(b"ab", b"abc"));
+        assert!(contains_subsequence_ignore_ascii_case(b"anything", b""));
+    }
+
+    #[test]
+    fn every_atom_must_be_present() {
+        let filter = prefilter("src main").expect("ascii pattern");
+        assert!(filter.may_match("src/bin/main.rs"));
+        assert!(!filter.may_match("src/lib.rs"));
+    }
+
+    #[test]
+    fn non_ascii_disables_the_check() {
+        assert!(prefilter("café").is_none());
+        let filter = prefilter("cafe").expect("ascii pattern");
+        // `é` may be normalized to `e` by nucleo, so the path must be scored.
+        assert!(filter.may_match("docs/café.md"));
+    }
+
+    #[test]
+    fn never_rejects_a_nucleo_match() {
+        let haystacks = [
+            "src/lib.rs",
+            "Cargo.toml",
+            "tui/src/bottom_pane/chat_composer.rs",
+            "docs/Getting Started.md",
+            "naïve/Ünïcode.txt",
+        ];
+        let queries = ["lib", "CT", "cc", "tui chat", "gs", "unic", "NAI", "zz"];
+        let mut matcher = Matcher::new(nucleo_matcher::Config::DEFAULT);
+        let mut buf = Vec::new();
+        for query in queries {
+            let pattern = create_pattern(query);
+            let Some(filter) = Prefilter::new(&pattern) else {
+                continue;
+            };
+            for haystack in haystacks {
+                let score = pattern.score(Utf32Str::new(haystack, &mut buf), &mut matcher);
+                if score.is_some() {
+                    assert!(
+                        filter.may_match(haystack),
+                        "prefilter rejected {haystack:?} for {query:?}"
+                    );
+                }
+            }
+        }
+    }
+}
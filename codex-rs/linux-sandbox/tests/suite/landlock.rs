@@ -3,6 +3,7 @@ use codex_core::config_types::ShellEnvironmentPolicy;
 use codex_core::error::CodexErr;
 use codex_core::error::SandboxErr;
 use codex_core::exec::ExecParams;
+use codex_core::exec::OutputRetention;
 use codex_core::exec::SandboxType;
 use codex_core::exec::process_exec_tool_call;
 use codex_core::exec_env::create_env;
@@ -61,6 +62,7 @@ async fn run_cmd(cmd: &[&str], writable_roots: &[PathBuf], timeout_ms: u64) {
         &sandbox_policy,
         &codex_linux_sandbox_exe,
         None,
+        OutputRetention::default(),
     )
     .await
     .unwrap();
@@ -153,6 +155,7 @@ async fn assert_network_blocked(cmd: &[&str]) {
         &sandbox_policy,
         &codex_linux_sandbox_exe,
         None,
+        OutputRetention::default(),
     )
     .await;
 
@@ -11,9 +11,11 @@
 //! interact with the [`ModelContextProtocolRequest`] trait from `mcp-types` to
 //! issue requests and receive strongly-typed results.
 
+use std::borrow::Cow;
 use std::collections::HashMap;
 use std::ffi::OsString;
 use std::sync::Arc;
+use std::sync::PoisonError;
 use std::sync::atomic::AtomicI64;
 use std::sync::atomic::Ordering;
 use std::time::Duration;
@@ -23,27 +25,27 @@ use anyhow::Result;
 use anyhow::anyhow;
 use mcp_types::CallToolRequest;
 use mcp_types::CallToolRequestParams;
+use mcp_types::CancelledNotification;
+use mcp_types::CancelledNotificationParams;
 use mcp_types::InitializeRequest;
 use mcp_types::InitializeRequestParams;
 use mcp_types::InitializedNotification;
 use mcp_types::JSONRPC_VERSION;
-use mcp_types::JSONRPCMessage;
-use mcp_types::JSONRPCNotification;
-use mcp_types::JSONRPCRequest;
-use mcp_types::JSONRPCResponse;
+use mcp_types::JSONRPCErrorError;
 use mcp_types::ListToolsRequest;
 use mcp_types::ListToolsRequestParams;
 use mcp_types::ListToolsResult;
 use mcp_types::ModelContextProtocolNotification;
 use mcp_types::ModelContextProtocolRequest;
 use mcp_types::RequestId;
+use serde::Deserialize;
 use serde::Serialize;
 use serde::de::DeserializeOwned;
+use serde_json::value::RawValue;
 use tokio::io::AsyncBufReadExt;
 use tokio::io::AsyncWriteExt;
 use tokio::io::BufReader;
 use tokio::process::Command;
-use tokio::sync::Mutex;
 use tokio::sync::mpsc;
 use tokio::sync::oneshot;
 use tokio::time;
@@ -56,8 +58,49 @@ use tracing::warn;
 /// client API and the IO tasks.
 const CHANNEL_CAPACITY: usize = 128;
 
-/// Internal representation of a pending request sender.
-type PendingSender = oneshot::Sender<JSONRPCMessage>;
+/// Maximum number of queued messages the writer task coalesces into a single
+/// write to the child's STDIN.
+const MAX_WRITE_BATCH: usize = 64;
+
+/// The reply to a request, borrowed from the line the reader task just read.
+enum Reply<'a> {
+    /// The unparsed `result` member of a response. `None` if it was `null`.
+    Result(Option<&'a RawValue>),
+    Error(JSONRPCErrorError),
+}
+
+/// Internal representation of a pending request: completes the request with
+/// its reply. It runs on the reader task, so the typed result is deserialized
+/// straight from the line that was read, without an intermediate
+/// `serde_json::Value`.
+type PendingSender = Box<dyn FnOnce(Reply<'_>) + Send>;
+
+type PendingMap = Arc<std::sync::Mutex<HashMap<i64, PendingSender>>>;
+
+/// A JSON-RPC message read from the server. Only the members needed to route
+/// it are parsed; `result` is left as raw JSON for the pending request.
+#[derive(Deserialize)]
+struct IncomingMessage<'a> {
+    #[serde(default)]
+    id: Option<RequestId>,
+    #[serde(default, borrow)]
+    method: Option<Cow<'a, str>>,
+    #[serde(default, borrow)]
+    result: Option<&'a RawValue>,
+    #[serde(default)]
+    error: Option<JSONRPCErrorError>,
+}
+
+/// A JSON-RPC request or notification (without `id`) as written to the server.
+#[derive(Serialize)]
+struct OutgoingMessage<'a> {
+    jsonrpc: &'a str,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    id: Option<&'a RequestId>,
+    method: &'a str,
+    #[serde(skip_serializing_if = "Option::is_none")]
+    params: Option<&'a RawValue>,
+}
 
 /// A running MCP client instance.
 pub struct McpClient {
@@ -67,12 +110,13 @@ pub struct McpClient {
     #[allow(dead_code)]
     child: tokio::process::Child,
 
-    /// Channel for sending JSON-RPC messages *to* the background writer task.
-    outgoing_tx: mpsc::Sender<JSONRPCMessage>,
+    /// Channel for sending serialized JSON-RPC messages *to* the background
+    /// writer task.
+    outgoing_tx: mpsc::Sender<Vec<u8>>,
 
-    /// Map of `request.id -> oneshot::Sender` used to dispatch responses back
+    /// Map of `request.id -> PendingSender` used to dispatch responses back
     /// to the originating caller.
-    pending: Arc<Mutex<HashMap<i64, PendingSender>>>,
+    pending: PendingMap,
 
     /// Monotonically increasing counter used to generate request IDs.
     id_counter: AtomicI64,
@@ -109,29 +153,36 @@ impl McpClient {
             .take()
             .ok_or_else(|| std::io::Error::other("failed to capture child stdout"))?;
 
-        let (outgoing_tx, mut outgoing_rx) = mpsc::channel::<JSONRPCMessage>(CHANNEL_CAPACITY);
-        let pending: Arc<Mutex<HashMap<i64, PendingSender>>> = Arc::new(Mutex::new(HashMap::new()));
+        let (outgoing_tx, mut outgoing_rx) = mpsc::channel::<Vec<u8>>(CHANNEL_CAPACITY);
+        let pending: PendingMap = Arc::new(std::sync::Mutex::new(HashMap::new()));
 
         // Spawn writer task. It listens on the `outgoing_rx` channel and
-        // writes messages to the child's STDIN.
+        // writes messages to the child's STDIN, coalescing whatever has queued
+        // up since the previous write into a single write.
         let writer_handle = {
             let mut stdin = stdin;
             tokio::spawn(async move {
-                while let Some(msg) = outgoing_rx.recv().await {
-                    match serde_json::to_string(&msg) {
-                        Ok(json) => {
-                            debug!("MCP message to server: {json}");
-                            if stdin.write_all(json.as_bytes()).await.is_err() {
-                                error!("failed to write message to child stdin");
-                                break;
-                            }
-                            if stdin.write_all(b"\n").await.is_err() {
-                                error!("failed to write newline to child stdin");
-                                break;
-                            }
-                            // No explicit flush needed on a pipe; write_all is sufficient.
+                let mut batch: Vec<u8> = Vec::new();
+                while let Some(first) = outgoing_rx.recv().await {
+                    batch.clear();
+                    let mut next = Some(first);
+                    let mut batched = 0;
+                    while let Some(message) = next.take() {
+                        debug!(
+                            "MCP message to server: {}",
+                            String::from_utf8_lossy(&message)
+                        );
+                        batch.extend_from_slice(&message);
+                        batch.push(b'\n');
+                        batched += 1;
+                        if batched < MAX_WRITE_BATCH {
+                            next = outgoing_rx.try_recv().ok();
                         }
-                        Err(e) => error!("failed to serialize JSONRPCMessage: {e}"),
+                    }
+                    // No explicit flush needed on a pipe; write_all is sufficient.
+                    if stdin.write_all(&batch).await.is_err() {
+                        error!("failed to write messages to child stdin");
+                        break;
                     }
                 }
             })
@@ -141,32 +192,30 @@ impl McpClient {
         // STDOUT and dispatches responses to the pending map.
         let reader_handle = {
             let pending = pending.clone();
-            let mut lines = BufReader::new(stdout).lines();
+            let mut reader = BufReader::new(stdout);
 
             tokio::spawn(async move {
-                while let Ok(Some(line)) = lines.next_line().await {
-                    debug!("MCP message from server: {line}");
-                    match serde_json::from_str::<JSONRPCMessage>(&line) {
-                        Ok(JSONRPCMessage::Response(resp)) => {
-                            Self::dispatch_response(resp, &pending).await;
-                        }
-                        Ok(JSONRPCMessage::Error(err)) => {
-                            Self::dispatch_error(err, &pending).await;
-                        }
-                        Ok(JSONRPCMessage::Notification(JSONRPCNotification { .. })) => {
-                            // For now we only log server-initiated notifications.
-                            info!("<- notification: {}", line);
-                        }
-                        Ok(other) => {
-                            // Batch responses and requests are currently not
-                            // expected from the server – log and ignore.
-                            info!("<- unhandled message: {:?}", other);
-                        }
-                        Err(e) => {
-                            error!("failed to deserialize JSONRPCMessage: {e}; line = {}", line)
-                        }
+                // Reuse one buffer for every line; replies are parsed in place.
+                let mut line = String::new();
+                loop {
+                    line.clear();
+                    match reader.read_line(&mut line).await {
+                        Ok(0) | Err(_) => break,
+                        Ok(_) => {}
+                    }
+                    let line = line.trim_end();
+                    if line.is_empty() {
+                        continue;
                     }
+                    debug!("MCP message from server: {line}");
+                    Self::dispatch_line(line, &pending);
                 }
+                // The server is gone: fail every request still waiting for a
+                // reply instead of leaving it hanging.
+                pending
+                    .lock()
+                    .unwrap_or_else(PoisonError::into_inner)
+                    .clear();
             })
         };
 
@@ -188,7 +237,10 @@ impl McpClient {
     ///
     /// If `timeout` is `None` the call waits indefinitely. If `Some(duration)`
     /// is supplied and no response is received within the given period, a
-    /// timeout error is returned.
+    /// timeout error is returned. Any number of requests may be in flight at
+    /// once. If the request times out, or the returned future is dropped
+    /// before the reply arrives, the server is sent `notifications/cancelled`
+    /// for it.
     pub async fn send_request<R>(
         &self,
         params: R::Params,
@@ -202,34 +254,36 @@ impl McpClient {
         // Create a new unique ID.
         let id = self.id_counter.fetch_add(1, Ordering::SeqCst);
         let request_id = RequestId::Integer(id);
-
-        // Serialize params -> JSON. For many request types `Params` is
-        // `Option<T>` and `None` should be encoded as *absence* of the field.
-        let params_json = serde_json::to_value(&params)?;
-        let params_field = if params_json.is_null() {
-            None
-        } else {
-            Some(params_json)
-        };
-
-        let jsonrpc_request = JSONRPCRequest {
-            id: request_id.clone(),
-            jsonrpc: JSONRPC_VERSION.to_string(),
-            method: R::METHOD.to_string(),
-            params: params_field,
-        };
-
-        let message = JSONRPCMessage::Request(jsonrpc_request);
-
-        // oneshot channel for the response.
-        let (tx, rx) = oneshot::channel();
+        let message = encode_message(Some(&request_id), R::METHOD, &params)?;
+
+        // oneshot channel for the typed result.
+        let (tx, rx) = oneshot::channel::<Result<R::Result>>();
+        let complete: PendingSender = Box::new(move |reply| {
+            let result = match reply {
+                Reply::Result(result) => {
+                    serde_json::from_str(result.map_or("null", RawValue::get)).map_err(Into::into)
+                }
+                Reply::Error(err) => Err(anyhow!(
+                    "server returned JSON-RPC error: code = {}, message = {}",
+                    err.code,
+                    err.message
+                )),
+            };
+            // Ignore send errors – the receiver might have been dropped.
+            let _ = tx.send(result);
+        });
 
         // Register in pending map *before* sending the message so a race where
         // the response arrives immediately cannot be lost.
-        {
-            let mut guard = self.pending.lock().await;
-            guard.insert(id, tx);
-        }
+        self.pending
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .insert(id, complete);
+        let mut in_flight = InFlightRequest {
+            id,
+            client: self,
+            cancel_reason: None,
+        };
 
         // Send to writer task.
         if self.outgoing_tx.send(message).await.is_err() {
@@ -239,45 +293,19 @@ impl McpClient {
         }
 
         // Await the response, optionally bounded by a timeout.
-        let msg = match timeout {
-            Some(duration) => {
-                match time::timeout(duration, rx).await {
-                    Ok(Ok(msg)) => msg,
-                    Ok(Err(_)) => {
-                        // Channel closed without a reply – remove the pending entry.
-                        let mut guard = self.pending.lock().await;
-                        guard.remove(&id);
-                        return Err(anyhow!(
-                            "response channel closed before a reply was received"
-                        ));
-                    }
-                    Err(_) => {
-                        // Timed out. Remove the pending entry so we don't leak.
-                        let mut guard = self.pending.lock().await;
-                        guard.remove(&id);
-                        return Err(anyhow!("request timed out"));
-                    }
+        let reply = match timeout {
+            Some(duration) => match time::timeout(duration, rx).await {
+                Ok(reply) => reply,
+                Err(_) => {
+                    // Timed out. Dropping `in_flight` removes the pending entry
+                    // so we don't leak, and tells the server to stop.
+                    in_flight.cancel_reason = Some("request timed out");
+                    return Err(anyhow!("request timed out"));
                 }
-            }
-            None => rx
-                .await
-                .map_err(|_| anyhow!("response channel closed before a reply was received"))?,
+            },
+            None => rx.await,
         };
-
-        match msg {
-            JSONRPCMessage::Response(JSONRPCResponse { result, .. }) => {
-                let typed: R::Result = serde_json::from_value(result)?;
-                Ok(typed)
-            }
-            JSONRPCMessage::Error(err) => Err(anyhow!(format!(
-                "server returned JSON-RPC error: code = {}, message = {}",
-                err.error.code, err.error.message
-            ))),
-            other => Err(anyhow!(format!(
-                "unexpected message variant received in reply path: {:?}",
-                other
-            ))),
-        }
+        reply.map_err(|_| anyhow!("response channel closed before a reply was received"))?
     }
 
     pub async fn send_notification<N>(&self, params: N::Params) -> Result<()>
@@ -285,23 +313,8 @@ impl McpClient {
         N: ModelContextProtocolNotification,
         N::Params: Serialize,
     {
-        // Serialize params -> JSON. For many request types `Params` is
-        // `Option<T>` and `None` should be encoded as *absence* of the field.
-        let params_json = serde_json::to_value(&params)?;
-        let params_field = if params_json.is_null() {
-            None
-        } else {
-            Some(params_json)
-        };
-
-        let method = N::METHOD.to_string();
-        let jsonrpc_notification = JSONRPCNotification {
-            jsonrpc: JSONRPC_VERSION.to_string(),
-            method: method.clone(),
-            params: params_field,
-        };
-
-        let notification = JSONRPCMessage::Notification(jsonrpc_notification);
+        let method = N::METHOD;
+        let notification = encode_message(None, method, &params)?;
         self.outgoing_tx
             .send(notification)
             .await
@@ -347,12 +360,41 @@ impl McpClient {
         self.send_request::<CallToolRequest>(params, timeout).await
     }
 
-    /// Internal helper: route a JSON-RPC *response* object to the pending map.
-    async fn dispatch_response(
-        resp: JSONRPCResponse,
-        pending: &Arc<Mutex<HashMap<i64, PendingSender>>>,
-    ) {
-        let id = match resp.id {
+    /// Internal helper: parse one line from the server and route replies to
+    /// the pending map.
+    fn dispatch_line(line: &str, pending: &PendingMap) {
+        let message = match serde_json::from_str::<IncomingMessage>(line) {
+            Ok(message) => message,
+            Err(e) => {
+                error!("failed to deserialize JSON-RPC message: {e}; line = {line}");
+                return;
+            }
+        };
+
+        match (message.id, message.method) {
+            (Some(id), None) => {
+                let reply = match message.error {
+                    Some(err) => Reply::Error(err),
+                    None => Reply::Result(message.result),
+                };
+                Self::dispatch_reply(id, reply, pending);
+            }
+            (None, Some(_)) => {
+                // For now we only log server-initiated notifications.
+                info!("<- notification: {line}");
+            }
+            _ => {
+                // Requests from the server are currently not expected – log
+                // and ignore.
+                info!("<- unhandled message: {line}");
+            }
+        }
+    }
+
+    /// Internal helper: route a JSON-RPC *response* or *error* to the pending
+    /// map.
+    fn dispatch_reply(id: RequestId, reply: Reply<'_>, pending: &PendingMap) {
+        let id = match id {
             RequestId::Integer(i) => i,
             RequestId::String(_) => {
                 // We only ever generate integer IDs. Receiving a string here
@@ -362,34 +404,71 @@ impl McpClient {
             }
         };
 
-        let tx_opt = {
-            let mut guard = pending.lock().await;
-            guard.remove(&id)
-        };
-        if let Some(tx) = tx_opt {
-            // Ignore send errors – the receiver might have been dropped.
-            let _ = tx.send(JSONRPCMessage::Response(resp));
-        } else {
-            warn!(id, "no pending request found for response");
+        let complete = pending
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .remove(&id);
+        match complete {
+            Some(complete) => complete(reply),
+            // Expected for requests that timed out or were cancelled.
+            None => warn!(id, "no pending request found for response"),
         }
     }
+}
 
-    /// Internal helper: route a JSON-RPC *error* object to the pending map.
-    async fn dispatch_error(
-        err: mcp_types::JSONRPCError,
-        pending: &Arc<Mutex<HashMap<i64, PendingSender>>>,
-    ) {
-        let id = match err.id {
-            RequestId::Integer(i) => i,
-            RequestId::String(_) => return, // see comment above
-        };
+/// Serialize a request (with `id`) or notification (without) to a single line
+/// of JSON.
+fn encode_message<P: Serialize>(
+    id: Option<&RequestId>,
+    method: &str,
+    params: &P,
+) -> Result<Vec<u8>> {
+    // For many request types `Params` is `Option<T>` and `None` should be
+    // encoded as *absence* of the field.
+    let params = serde_json::value::to_raw_value(params)?;
+    let params = (params.get() != "null").then_some(params);
+    let message = OutgoingMessage {
+        jsonrpc: JSONRPC_VERSION,
+        id,
+        method,
+        params: params.as_deref(),
+    };
+    Ok(serde_json::to_vec(&message)?)
+}
+
+/// Tracks a request between sending it and receiving its reply. Dropped
+/// before the reply arrived (timeout, or the caller's future was dropped), it
+/// removes the pending entry and notifies the server of the cancellation.
+struct InFlightRequest<'a> {
+    id: i64,
+    client: &'a McpClient,
+    cancel_reason: Option<&'static str>,
+}
 
-        let tx_opt = {
-            let mut guard = pending.lock().await;
-            guard.remove(&id)
+impl Drop for InFlightRequest<'_> {
+    fn drop(&mut self) {
+        let still_pending = self
+            .client
+            .pending
+            .lock()
+            .unwrap_or_else(PoisonError::into_inner)
+            .remove(&self.id)
+            .is_some();
+        if !still_pending {
+            return;
+        }
+        let params = CancelledNotificationParams {
+            reason: self.cancel_reason.map(str::to_string),
+            request_id: RequestId::Integer(self.id),
         };
-        if let Some(tx) = tx_opt {
-            let _ = tx.send(JSONRPCMessage::Error(err));
+        // Drop cannot await; this is best effort if the queue is full.
+        match encode_message(None, CancelledNotification::METHOD, &params) {
+            Ok(message) => {
+                if self.client.outgoing_tx.try_send(message).is_err() {
+                    debug!(id = self.id, "could not queue cancellation for request");
+                }
+            }
+            Err(e) => error!("failed to serialize cancellation: {e}"),
         }
     }
 }
@@ -464,6 +543,73 @@ fn create_env_for_mcp_server(
 mod tests {
     use super::*;
 
+    /// Spawn `sh -c script` as an MCP server.
+    #[cfg(unix)]
+    async fn spawn_sh_server(script: &str, env: HashMap<String, String>) -> McpClient {
+        McpClient::new_stdio_client("sh".into(), vec!["-c".into(), script.into()], Some(env))
+            .await
+            .expect("spawn sh")
+    }
+
+    #[cfg(unix)]
+    #[tokio::test]
+    async fn concurrent_requests_receive_their_own_responses() {
+        // Echo each request id back in a `tools/list` result naming that id.
+        let script = r#"while read -r line; do
+            id=$(printf '%s' "$line" | sed -n 's/.*"id":\([0-9]*\).*/\1/p')
+            printf '{"jsonrpc":"2.0","id":%s,"result":{"tools":[],"nextCursor":"%s"}}\n' "$id" "$id"
+        done"#;
+        let client = Arc::new(spawn_sh_server(script, HashMap::new()).await);
+
+        let mut requests = tokio::task::JoinSet::new();
+        for _ in 0..16 {
+            let client = client.clone();
+            requests.spawn(async move {
+                client
+                    .list_tools(None, Some(Duration::from_secs(5)))
+                    .await
+                    .expect("tools/list")
+                    .next_cursor
+            });
+        }
+        let mut cursors = Vec::new();
+        while let Some(cursor) = requests.join_next().await {
+            cursors.push(cursor.expect("join").expect("cursor"));
+        }
+        cursors.sort_by_key(|cursor| cursor.parse::<i64>().expect("numeric id"));
+        let expected: Vec<String> = (1..=16).map(|id| id.to_string()).collect();
+        assert_eq!(cursors, expected);
+    }
+
+    #[cfg(unix)]
+    #[tokio::test]
+    async fn timed_out_request_is_cancelled() {
+        let log =
+            std::env::temp_dir().join(format!("mcp-client-cancel-{}.jsonl", std::process::id()));
+        // Record every message and never reply.
+        let script = r#"while read -r line; do printf '%s\n' "$line" >> "$LOG"; done"#;
+        let env = HashMap::from([("LOG".to_string(), log.display().to_string())]);
+        let client = spawn_sh_server(script, env).await;
+
+        let err = client
+            .list_tools(None, Some(Duration::from_millis(50)))
+            .await
+            .expect_err("no reply");
+        assert_eq!(err.to_string(), "request timed out");
+        assert!(client.pending.lock().unwrap().is_empty());
+
+        let expected = r#"{"jsonrpc":"2.0","method":"notifications/cancelled","params":{"reason":"request timed out","requestId":1}}"#;
+        for _ in 0..100 {
+            let received = std::fs::read_to_string(&log).unwrap_or_default();
+            if received.lines().any(|line| line == expected) {
+                let _ = std::fs::remove_file(&log);
+                return;
+            }
+            tokio::time::sleep(Duration::from_millis(20)).await;
+        }
+        panic!("server never received the cancellation");
+    }
+
     #[test]
     fn test_create_env_for_mcp_server() {
         let env_var = "USER";
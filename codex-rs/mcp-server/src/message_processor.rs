@@ -55,7 +55,10 @@ impl MessageProcessor {
         let outgoing = Arc::new(outgoing);
         let auth_manager =
             AuthManager::shared(config.codex_home.clone(), config.preferred_auth_method);
-        let conversation_manager = Arc::new(ConversationManager::new(auth_manager.clone()));
+        let conversation_manager = Arc::new(
+            ConversationManager::new(auth_manager.clone())
+                .with_warm_pool(config.conversation_pool_size),
+        );
         let codex_message_processor = CodexMessageProcessor::new(
             auth_manager,
             conversation_manager.clone(),
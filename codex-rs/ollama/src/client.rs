@@ -4,6 +4,8 @@ use futures::stream::BoxStream;
 use serde_json::Value as JsonValue;
 use std::collections::VecDeque;
 use std::io;
+use std::time::Duration;
+use std::time::Instant;
 
 use crate::parser::pull_events_from_value;
 use crate::pull::PullEvent;
@@ -183,6 +185,34 @@ impl OllamaClient {
         Ok(Box::pin(s))
     }
 
+    /// Ask the server to load `model` into memory without generating anything,
+    /// keeping it loaded for `keep_alive` (Ollama's duration format) if given.
+    /// Returns how long the load took.
+    pub async fn load_model(&self, model: &str, keep_alive: Option<&str>) -> io::Result<Duration> {
+        let url = format!("{}/api/generate", self.host_root.trim_end_matches('/'));
+        let mut body = serde_json::json!({"model": model});
+        if let Some(keep_alive) = keep_alive {
+            body["keep_alive"] = JsonValue::from(keep_alive);
+        }
+        let start = Instant::now();
+        let resp = self
+            .client
+            .post(url)
+            .json(&body)
+            .send()
+            .await
+            .map_err(io::Error::other)?;
+        if !resp.status().is_success() {
+            return Err(io::Error::other(format!(
+                "failed to load model: HTTP {}",
+                resp.status()
+            )));
+        }
+        // The response is sent once the model is loaded.
+        resp.bytes().await.map_err(io::Error::other)?;
+        Ok(start.elapsed())
+    }
+
     /// High-level helper to pull a model and drive a progress reporter.
     pub async fn pull_with_reporter(
         &self,
@@ -268,6 +298,41 @@ mod tests {
         assert!(models.contains(&"mistral".to_string()));
     }
 
+    #[tokio::test]
+    async fn test_load_model_sends_keep_alive() {
+        if std::env::var(codex_core::spawn::CODEX_SANDBOX_NETWORK_DISABLED_ENV_VAR).is_ok() {
+            tracing::info!(
+                "{} is set; skipping test_load_model_sends_keep_alive",
+                codex_core::spawn::CODEX_SANDBOX_NETWORK_DISABLED_ENV_VAR
+            );
+            return;
+        }
+
+        let server = wiremock::MockServer::start().await;
+        wiremock::Mock::given(wiremock::matchers::method("POST"))
+            .and(wiremock::matchers::path("/api/generate"))
+            .and(wiremock::matchers::body_json(serde_json::json!({
+                "model": "gpt-oss:20b",
+                "keep_alive": "30m"
+            })))
+            .respond_with(
+                wiremock::ResponseTemplate::new(200).set_body_raw(
+                    serde_json::json!({"model": "gpt-oss:20b", "done": true, "done_reason": "load"})
+                        .to_string(),
+                    "application/json",
+                ),
+            )
+            .expect(1)
+            .mount(&server)
+            .await;
+
+        let client = OllamaClient::from_host_root(server.uri());
+        client
+            .load_model("gpt-oss:20b", Some("30m"))
+            .await
+            .expect("load model");
+    }
+
     #[tokio::test]
     async fn test_probe_server_happy_path_openai_compat_and_native() {
         if std::env::var(codex_core::spawn::CODEX_SANDBOX_NETWORK_DISABLED_ENV_VAR).is_ok() {
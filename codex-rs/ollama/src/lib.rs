@@ -5,6 +5,7 @@ mod url;
 
 pub use client::OllamaClient;
 use codex_core::config::Config;
+use codex_core::model_load::begin_model_load;
 pub use pull::CliProgressReporter;
 pub use pull::PullEvent;
 pub use pull::PullProgressReporter;
@@ -17,6 +18,9 @@ pub const DEFAULT_OSS_MODEL: &str = "gpt-oss:20b";
 ///
 /// - Ensures a local Ollama server is reachable.
 /// - Checks if the model exists locally and pulls it if missing.
+/// - Starts loading the model in the background; the first request to it
+///   waits for the load (see [`codex_core::model_load`]) instead of sending a
+///   second cold request.
 pub async fn ensure_oss_ready(config: &Config) -> std::io::Result<()> {
     // Only download when the requested model is the default OSS model (or when -m is not provided).
     let model = config.model.as_ref();
@@ -40,5 +44,19 @@ pub async fn ensure_oss_ready(config: &Config) -> std::io::Result<()> {
         }
     }
 
+    let loading = begin_model_load(&config.model_provider_id, model);
+    let model = model.to_string();
+    let keep_alive = config.oss_keep_alive.clone();
+    tokio::spawn(async move {
+        let _loading = loading;
+        match ollama_client
+            .load_model(&model, keep_alive.as_deref())
+            .await
+        {
+            Ok(elapsed) => tracing::info!("Loaded {model} in {elapsed:?}"),
+            Err(err) => tracing::warn!("Failed to warm up {model}: {err}"),
+        }
+    });
+
     Ok(())
 }
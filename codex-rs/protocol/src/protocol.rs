@@ -11,11 +11,11 @@ use std::str::FromStr;
 use std::time::Duration;
 
 use crate::custom_prompts::CustomPrompt;
+use bytes::Bytes;
 use mcp_types::CallToolResult;
 use mcp_types::Tool as McpTool;
 use serde::Deserialize;
 use serde::Serialize;
-use serde_bytes::ByteBuf;
 use strum_macros::Display;
 use ts_rs::TS;
 use uuid::Uuid;
@@ -410,6 +410,9 @@ pub enum EventMsg {
     /// Agent has completed all actions
     TaskComplete(TaskCompleteEvent),
 
+    /// Where the time of a task went. Sent right before `TaskComplete`.
+    TurnMetrics(TurnMetricsEvent),
+
     /// Token count event, sent periodically to report the number of tokens
     /// used in the current session.
     TokenCount(TokenUsage),
@@ -503,6 +506,39 @@ pub struct TaskCompleteEvent {
     pub last_agent_message: Option<String>,
 }
 
+/// Wall-clock breakdown of a task. Phases may overlap: read-only tool calls
+/// run while the model is still streaming, and a tool call that needs approval
+/// counts towards both `approval_wait` and the stream it arrived in.
+#[derive(Debug, Clone, Default, PartialEq, Deserialize, Serialize)]
+pub struct TurnMetricsEvent {
+    /// From the start of the task until it completed.
+    pub duration: Duration,
+    /// Requests sent to the model, including retried ones.
+    pub model_requests: u32,
+    /// From sending the first request until the model produced its first
+    /// output. `None` if it never did.
+    pub time_to_first_token: Option<Duration>,
+    /// Time from sending each request until its `response.completed`.
+    pub model_stream: Duration,
+    /// Requests retried after a stream error.
+    pub retries: u32,
+    /// Time slept before those retries.
+    pub retry_backoff: Duration,
+    /// Time requests waited for a local model that was still loading.
+    pub model_load_wait: Duration,
+    /// Exec and MCP tool calls.
+    pub tool_calls: u32,
+    /// Time spent setting up the sandbox and spawning commands.
+    pub tool_sandbox_setup: Duration,
+    /// Time spent running tool calls once spawned.
+    pub tool_run: Duration,
+    /// Time spent waiting for the user to review commands and patches.
+    pub approval_wait: Duration,
+    /// Time spent handing items to the rollout writer, including per-turn
+    /// flushes.
+    pub rollout_write: Duration,
+}
+
 #[derive(Debug, Clone, Deserialize, Serialize)]
 pub struct TaskStartedEvent {
     pub model_context_window: Option<u64>,
@@ -723,7 +759,7 @@ pub struct ExecCommandEndEvent {
     pub formatted_output: String,
 }
 
-#[derive(Debug, Clone, Deserialize, Serialize)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Deserialize, Serialize)]
 #[serde(rename_all = "snake_case")]
 pub enum ExecOutputStream {
     Stdout,
@@ -736,9 +772,9 @@ pub struct ExecCommandOutputDeltaEvent {
     pub call_id: String,
     /// Which stream produced this chunk.
     pub stream: ExecOutputStream,
-    /// Raw bytes from the stream (may not be valid UTF-8).
-    #[serde(with = "serde_bytes")]
-    pub chunk: ByteBuf,
+    /// Raw bytes from the stream (may not be valid UTF-8). This is a view into
+    /// the buffer the exec layer read into, so cloning it does not copy.
+    pub chunk: Bytes,
 }
 
 #[derive(Debug, Clone, Deserialize, Serialize)]
@@ -65,7 +65,10 @@ impl App {
         let (app_event_tx, mut app_event_rx) = unbounded_channel();
         let app_event_tx = AppEventSender::new(app_event_tx);
 
-        let conversation_manager = Arc::new(ConversationManager::new(auth_manager.clone()));
+        let conversation_manager = Arc::new(
+            ConversationManager::new(auth_manager.clone())
+                .with_warm_pool(config.conversation_pool_size),
+        );
 
         let enhanced_keys_supported = supports_keyboard_enhancement().unwrap_or(false);
 
@@ -153,7 +153,7 @@ impl App {
         self.backtrack.primed = true;
         self.backtrack.base_id = self.chat_widget.session_id();
         self.backtrack.overlay_preview_active = true;
-        let sel = self.compute_backtrack_selection(tui, 1);
+        let sel = self.compute_backtrack_selection(1);
         self.apply_backtrack_selection(sel);
         tui.frame_requester().schedule_frame();
     }
@@ -161,29 +161,22 @@ impl App {
     /// Step selection to the next older user message and update overlay.
     fn step_backtrack_and_highlight(&mut self, tui: &mut tui::Tui) {
         let next = self.backtrack.count.saturating_add(1);
-        let sel = self.compute_backtrack_selection(tui, next);
+        let sel = self.compute_backtrack_selection(next);
         self.apply_backtrack_selection(sel);
         tui.frame_requester().schedule_frame();
     }
 
-    /// Compute normalized target, scroll offset, and highlight for requested step.
+    /// Compute normalized target, header line to scroll to, and highlight for
+    /// requested step.
     fn compute_backtrack_selection(
         &self,
-        tui: &tui::Tui,
         requested_n: usize,
     ) -> (usize, Option<usize>, Option<(usize, usize)>) {
         let nth = backtrack_helpers::normalize_backtrack_n(&self.transcript_lines, requested_n);
         let header_idx =
             backtrack_helpers::find_nth_last_user_header_index(&self.transcript_lines, nth);
-        let offset = header_idx.map(|idx| {
-            backtrack_helpers::wrapped_offset_before(
-                &self.transcript_lines,
-                idx,
-                tui.terminal.viewport_area.width,
-            )
-        });
         let hl = backtrack_helpers::highlight_range_for_nth_last_user(&self.transcript_lines, nth);
-        (nth, offset, hl)
+        (nth, header_idx, hl)
     }
 
     /// Apply a computed backtrack selection to the overlay and internal counter.
@@ -191,11 +184,11 @@ impl App {
         &mut self,
         selection: (usize, Option<usize>, Option<(usize, usize)>),
     ) {
-        let (nth, offset, hl) = selection;
+        let (nth, header_idx, hl) = selection;
         self.backtrack.count = nth;
         if let Some(Overlay::Transcript(t)) = &mut self.overlay {
-            if let Some(off) = offset {
-                t.set_scroll_offset(off);
+            if let Some(idx) = header_idx {
+                t.scroll_to_line(idx);
             }
             t.set_highlight_range(hl);
         }
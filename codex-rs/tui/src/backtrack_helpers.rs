@@ -9,12 +9,6 @@ pub(crate) fn highlight_range_for_nth_last_user(
     Some(highlight_range_from_header(lines, header))
 }
 
-/// Compute the wrapped display-line offset before `header_idx`, for a given width.
-pub(crate) fn wrapped_offset_before(lines: &[Line<'_>], header_idx: usize, width: u16) -> usize {
-    let before = &lines[0..header_idx];
-    crate::insert_history::word_wrap_lines(before, width).len()
-}
-
 /// Find the header index for the Nth last user message in the transcript.
 /// Returns `None` if `n == 0` or there are fewer than `n` user messages.
 pub(crate) fn find_nth_last_user_header_index(lines: &[Line<'_>], n: usize) -> Option<usize> {
@@ -20,7 +20,7 @@ struct TextElement {
 }
 
 #[derive(Debug)]
-pub(crate) struct TextArea {
+pub struct TextArea {
     text: String,
     cursor_pos: usize,
     wrap_cache: RefCell<Option<WrapCache>>,
@@ -28,6 +28,9 @@ pub(crate) struct TextArea {
     elements: Vec<TextElement>,
 }
 
+/// Wrapped lines for the last width the text was laid out at. Edits keep it
+/// up to date by re-wrapping only the logical lines they touched, so typing
+/// into a large paste does not re-wrap the whole buffer.
 #[derive(Debug, Clone)]
 struct WrapCache {
     width: u16,
@@ -35,11 +38,17 @@ struct WrapCache {
 }
 
 #[derive(Debug, Default, Clone, Copy)]
-pub(crate) struct TextAreaState {
+pub struct TextAreaState {
     /// Index into wrapped lines of the first visible line.
     scroll: u16,
 }
 
+impl Default for TextArea {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
 impl TextArea {
     pub fn new() -> Self {
         Self {
@@ -70,7 +79,7 @@ impl TextArea {
     pub fn insert_str_at(&mut self, pos: usize, text: &str) {
         let pos = self.clamp_pos_for_insertion(pos);
         self.text.insert_str(pos, text);
-        self.wrap_cache.replace(None);
+        self.rewrap_edited_lines(pos, pos, text.len());
         if pos <= self.cursor_pos {
             self.cursor_pos += text.len();
         }
@@ -95,7 +104,7 @@ impl TextArea {
         let diff = inserted_len as isize - removed_len as isize;
 
         self.text.replace_range(range, text);
-        self.wrap_cache.replace(None);
+        self.rewrap_edited_lines(start, end, inserted_len);
         self.preferred_col = None;
         self.update_elements_after_replace(start, end, inserted_len);
 
@@ -823,6 +832,33 @@ impl TextArea {
         }
     }
 
+    /// Updates the wrap cache after `start..old_end` of the previous text was
+    /// replaced with `inserted_len` bytes: the logical lines the edit touched
+    /// are re-wrapped and the wrapped lines after them are shifted.
+    fn rewrap_edited_lines(&mut self, start: usize, old_end: usize, inserted_len: usize) {
+        if self.wrap_cache.get_mut().is_none() {
+            return;
+        }
+        // Text before `start` is unchanged, so the first touched line begins
+        // at the same offset in the old and the new text.
+        let region_start = self.beginning_of_line(start);
+        let region_end = self.end_of_line(start + inserted_len);
+        let diff = inserted_len as isize - (old_end - start) as isize;
+        let old_region_end = (region_end as isize - diff) as usize;
+
+        let Some(cache) = self.wrap_cache.get_mut().as_mut() else {
+            return;
+        };
+        let first = cache.lines.partition_point(|r| r.start < region_start);
+        let last = cache.lines.partition_point(|r| r.start <= old_region_end);
+        for line in &mut cache.lines[last..] {
+            line.start = (line.start as isize + diff) as usize;
+            line.end = (line.end as isize + diff) as usize;
+        }
+        let rewrapped = wrap_ranges(&self.text, region_start..region_end, cache.width);
+        cache.lines.splice(first..last, rewrapped);
+    }
+
     #[expect(clippy::unwrap_used)]
     fn wrapped_lines(&self, width: u16) -> Ref<'_, Vec<Range<usize>>> {
         // Ensure cache is ready (potentially mutably borrow, then drop)
@@ -833,25 +869,7 @@ impl TextArea {
                 None => true,
             };
             if needs_recalc {
-                let mut lines: Vec<Range<usize>> = Vec::new();
-                for line in textwrap::wrap(
-                    &self.text,
-                    Options::new(width as usize).wrap_algorithm(textwrap::WrapAlgorithm::FirstFit),
-                )
-                .iter()
-                {
-                    match line {
-                        std::borrow::Cow::Borrowed(slice) => {
-                            let start =
-                                unsafe { slice.as_ptr().offset_from(self.text.as_ptr()) as usize };
-                            let end = start + slice.len();
-                            let trailing_spaces =
-                                self.text[end..].chars().take_while(|c| *c == ' ').count();
-                            lines.push(start..end + trailing_spaces + 1);
-                        }
-                        std::borrow::Cow::Owned(_) => unreachable!(),
-                    }
-                }
+                let lines = wrap_ranges(&self.text, 0..self.text.len(), width);
                 *cache = Some(WrapCache { width, lines });
             }
         }
@@ -894,6 +912,31 @@ impl TextArea {
     }
 }
 
+/// Wraps `text[region]`, which must span whole logical lines, and returns the
+/// byte range of each wrapped line within `text`. A range also covers the
+/// line's trailing spaces plus one byte for its newline (or the end of the
+/// text), where the cursor can sit.
+fn wrap_ranges(text: &str, region: Range<usize>, width: u16) -> Vec<Range<usize>> {
+    let mut lines: Vec<Range<usize>> = Vec::new();
+    for line in textwrap::wrap(
+        &text[region],
+        Options::new(width as usize).wrap_algorithm(textwrap::WrapAlgorithm::FirstFit),
+    )
+    .iter()
+    {
+        match line {
+            std::borrow::Cow::Borrowed(slice) => {
+                let start = unsafe { slice.as_ptr().offset_from(text.as_ptr()) as usize };
+                let end = start + slice.len();
+                let trailing_spaces = text[end..].chars().take_while(|c| *c == ' ').count();
+                lines.push(start..end + trailing_spaces + 1);
+            }
+            std::borrow::Cow::Owned(_) => unreachable!(),
+        }
+    }
+    lines
+}
+
 impl WidgetRef for &TextArea {
     fn render_ref(&self, area: Rect, buf: &mut Buffer) {
         let lines = self.wrapped_lines(area.width);
@@ -1681,6 +1724,14 @@ mod tests {
                 // Sanity invariants
                 assert!(ta.cursor() <= ta.text().len());
 
+                // Incrementally maintained wrapping matches wrapping from scratch.
+                if let Some(cache) = ta.wrap_cache.borrow().as_ref() {
+                    assert_eq!(
+                        cache.lines,
+                        wrap_ranges(ta.text(), 0..ta.text().len(), cache.width)
+                    );
+                }
+
                 // Element invariants
                 for payload in &elem_texts {
                     if let Some(start) = ta.text().find(payload) {
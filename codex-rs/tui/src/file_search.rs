@@ -17,6 +17,11 @@
 //!    recent query.
 //! 4. If there is a in-flight search that is not a prefix of the latest thing
 //!    the user typed, it is cancelled.
+//!
+//! Searches run against a [`file_search::FileIndex`] that is built on the first
+//! query and then shared by every subsequent one, so a keystroke only costs an
+//! in-memory scoring pass. After each search, the index is checked for changes
+//! on disk in the background and rescanned if needed.
 
 use codex_file_search as file_search;
 use std::num::NonZeroUsize;
@@ -27,6 +32,7 @@ use std::sync::atomic::AtomicBool;
 use std::sync::atomic::Ordering;
 use std::thread;
 use std::time::Duration;
+use std::time::Instant;
 
 use crate::app_event::AppEvent;
 use crate::app_event_sender::AppEventSender;
@@ -40,12 +46,16 @@ const FILE_SEARCH_DEBOUNCE: Duration = Duration::from_millis(100);
 
 const ACTIVE_SEARCH_COMPLETE_POLL_INTERVAL: Duration = Duration::from_millis(20);
 
+/// Minimum delay between two checks of the index for changes on disk. Each
+/// check stats every directory in the tree, so avoid doing it per keystroke.
+const INDEX_REFRESH_INTERVAL: Duration = Duration::from_secs(2);
+
 /// State machine for file-search orchestration.
 pub(crate) struct FileSearchManager {
     /// Unified state guarded by one mutex.
     state: Arc<Mutex<SearchState>>,
 
-    search_dir: PathBuf,
+    index: Arc<file_search::FileIndex>,
     app_tx: AppEventSender,
 }
 
@@ -58,6 +68,9 @@ struct SearchState {
 
     /// If there is an active search, this will be the query being searched.
     active_search: Option<ActiveSearch>,
+
+    /// When the index was last checked for changes on disk.
+    last_refresh_check: Option<Instant>,
 }
 
 struct ActiveSearch {
@@ -72,8 +85,13 @@ impl FileSearchManager {
                 latest_query: String::new(),
                 is_search_scheduled: false,
                 active_search: None,
+                last_refresh_check: None,
             })),
-            search_dir,
+            index: Arc::new(file_search::FileIndex::new(
+                search_dir,
+                Vec::new(),
+                NUM_FILE_SEARCH_THREADS,
+            )),
             app_tx: tx,
         }
     }
@@ -115,7 +133,7 @@ impl FileSearchManager {
         // dropping the lock. This means we are the only thread that can spawn a
         // debounce timer.
         let state = self.state.clone();
-        let search_dir = self.search_dir.clone();
+        let index = self.index.clone();
         let tx_clone = self.app_tx.clone();
         thread::spawn(move || {
             // Always do a minimum debounce, but then poll until the
@@ -145,36 +163,33 @@ impl FileSearchManager {
                 query
             };
 
-            FileSearchManager::spawn_file_search(
-                query,
-                search_dir,
-                tx_clone,
-                cancellation_token,
-                state,
-            );
+            FileSearchManager::spawn_file_search(query, index, tx_clone, cancellation_token, state);
         });
     }
 
     fn spawn_file_search(
         query: String,
-        search_dir: PathBuf,
+        index: Arc<file_search::FileIndex>,
         tx: AppEventSender,
         cancellation_token: Arc<AtomicBool>,
         search_state: Arc<Mutex<SearchState>>,
     ) {
         let compute_indices = true;
         std::thread::spawn(move || {
-            let matches = file_search::run(
-                &query,
-                MAX_FILE_SEARCH_RESULTS,
-                &search_dir,
-                Vec::new(),
-                NUM_FILE_SEARCH_THREADS,
-                cancellation_token.clone(),
-                compute_indices,
-            )
-            .map(|res| res.matches)
-            .unwrap_or_default();
+            // Only the very first search has to walk the tree.
+            let matches = match index.ensure_built() {
+                Ok(()) => {
+                    index
+                        .search(
+                            &query,
+                            MAX_FILE_SEARCH_RESULTS,
+                            &cancellation_token,
+                            compute_indices,
+                        )
+                        .matches
+                }
+                Err(_) => Vec::new(),
+            };
 
             let is_cancelled = cancellation_token.load(Ordering::Relaxed);
             if !is_cancelled {
@@ -193,6 +208,31 @@ impl FileSearchManager {
                     st.active_search = None;
                 }
             }
+
+            FileSearchManager::maybe_refresh_index(&index, &search_state);
         });
     }
+
+    /// Rescan the index if files were added or removed since the last scan,
+    /// so that the next query sees them. This runs on the search thread after
+    /// results were delivered and `active_search` cleared, so it never delays
+    /// the current query; later searches keep using the old snapshot until the
+    /// rescan completes.
+    fn maybe_refresh_index(index: &file_search::FileIndex, search_state: &Arc<Mutex<SearchState>>) {
+        {
+            #[expect(clippy::unwrap_used)]
+            let mut st = search_state.lock().unwrap();
+            let now = Instant::now();
+            if st
+                .last_refresh_check
+                .is_some_and(|last| now.duration_since(last) < INDEX_REFRESH_INTERVAL)
+            {
+                return;
+            }
+            st.last_refresh_check = Some(now);
+        }
+        if let Err(err) = index.refresh_if_stale() {
+            tracing::debug!("failed to refresh file search index: {err}");
+        }
+    }
 }
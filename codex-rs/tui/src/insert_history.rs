@@ -262,7 +262,7 @@ where
 }
 
 /// Word-aware wrapping for a list of `Line`s preserving styles.
-pub(crate) fn word_wrap_lines(lines: &[Line], width: u16) -> Vec<Line<'static>> {
+pub fn word_wrap_lines(lines: &[Line], width: u16) -> Vec<Line<'static>> {
     let mut out = Vec::new();
     let w = width.max(1) as usize;
     for line in lines {
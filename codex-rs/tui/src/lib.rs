@@ -65,6 +65,15 @@ mod chatwidget_stream_tests;
 #[cfg(not(debug_assertions))]
 mod updates;
 
+/// Internals exercised by the `codex-bench` hot-path benchmarks.
+#[cfg(feature = "bench")]
+#[doc(hidden)]
+pub mod bench {
+    pub use crate::bottom_pane::TextArea;
+    pub use crate::insert_history::word_wrap_lines;
+    pub use crate::markdown_stream::MarkdownStreamCollector;
+}
+
 pub use cli::Cli;
 
 use crate::onboarding::TrustDirectorySelection;
@@ -5,6 +5,7 @@ use ratatui::text::Line;
 use ratatui::text::Span;
 use std::borrow::Cow;
 use std::path::Path;
+use std::path::PathBuf;
 
 pub(crate) fn append_markdown(
     markdown_source: &str,
@@ -27,28 +28,133 @@ fn append_markdown_with_opener_and_cwd(
     // - Render non-code text through `tui_markdown` (with citation rewrite).
     // - Render code block content verbatim as plain lines without additional
     //   formatting, preserving leading spaces.
+    let mut after_text = false;
     for seg in split_text_and_fences(markdown_source) {
-        match seg {
-            Segment::Text(s) => {
-                let processed = rewrite_file_citations(&s, file_opener, cwd);
-                let rendered = tui_markdown::from_str(&processed);
-                crate::render::line_utils::push_owned_lines(&rendered.lines, lines);
+        after_text = render_segment(&seg, after_text, lines, file_opener, cwd);
+    }
+}
+
+/// Appends the lines of `seg` and returns whether a text segment following it
+/// directly continues rendered text, which is what `after_text` says about
+/// `seg` itself.
+fn render_segment(
+    seg: &Segment,
+    after_text: bool,
+    lines: &mut Vec<Line<'static>>,
+    file_opener: UriBasedFileOpener,
+    cwd: &Path,
+) -> bool {
+    match seg {
+        Segment::Text(s) => {
+            let processed = rewrite_file_citations(s, file_opener, cwd);
+            let rendered = tui_markdown::from_str(&processed);
+            if rendered.lines.is_empty() {
+                return after_text;
             }
-            Segment::Code { content, .. } => {
-                // Emit the code content exactly as-is, line by line.
-                // We don't attempt syntax highlighting to avoid whitespace bugs.
-                for line in content.split_inclusive('\n') {
-                    // split_inclusive keeps the trailing \n; we want lines without it.
-                    let line = if let Some(stripped) = line.strip_suffix('\n') {
-                        stripped
-                    } else {
-                        line
-                    };
-                    let owned_line: Line<'static> = Line::from(Span::raw(line.to_string()));
-                    lines.push(owned_line);
-                }
+            // Consecutive text segments were split at a blank line between
+            // two blocks, which `tui_markdown` renders as one empty line.
+            if after_text {
+                lines.push(Line::default());
+            }
+            crate::render::line_utils::push_owned_lines(&rendered.lines, lines);
+            true
+        }
+        Segment::Code { content, .. } => {
+            // Emit the code content exactly as-is, line by line.
+            // We don't attempt syntax highlighting to avoid whitespace bugs.
+            for line in content.split_inclusive('\n') {
+                // split_inclusive keeps the trailing \n; we want lines without it.
+                let line = if let Some(stripped) = line.strip_suffix('\n') {
+                    stripped.strip_suffix('\r').unwrap_or(stripped)
+                } else {
+                    line
+                };
+                let owned_line: Line<'static> = Line::from(Span::raw(line.to_string()));
+                lines.push(owned_line);
+            }
+            false
+        }
+    }
+}
+
+/// Renders a growing markdown document like [`append_markdown`], rendering
+/// each part of it only until nothing appended to the document can change it.
+///
+/// The source is split by [`split_source`] in streaming mode, which also
+/// drops empty fenced code blocks and breaks long text at block boundaries.
+/// A segment followed by another one is final: the source up to its end is
+/// never split or rendered again, so each call only looks at what follows the
+/// last final segment. While a message streams in, that is its current
+/// paragraph or code block rather than the whole message.
+#[derive(Default)]
+pub(crate) struct IncrementalMarkdown {
+    /// Length of the prefix of the source made up of final segments.
+    stable_len: usize,
+    /// Number of leading `lines` rendered from that prefix.
+    stable_lines: usize,
+    /// Whether that prefix ends in rendered text, see [`render_segment`].
+    stable_after_text: bool,
+    lines: Vec<Line<'static>>,
+    in_open_fence: bool,
+    file_opener: Option<UriBasedFileOpener>,
+    cwd: PathBuf,
+}
+
+impl IncrementalMarkdown {
+    /// Returns the rendered lines of `markdown_source`, which must extend the
+    /// source of the previous call unless [`Self::clear`] was called since.
+    pub(crate) fn render(&mut self, markdown_source: &str, config: &Config) -> &[Line<'static>] {
+        self.render_with_opener_and_cwd(markdown_source, config.file_opener, &config.cwd)
+    }
+
+    fn render_with_opener_and_cwd(
+        &mut self,
+        markdown_source: &str,
+        file_opener: UriBasedFileOpener,
+        cwd: &Path,
+    ) -> &[Line<'static>] {
+        if self.file_opener != Some(file_opener) || self.cwd != cwd {
+            self.clear();
+            self.file_opener = Some(file_opener);
+            self.cwd = cwd.to_path_buf();
+        } else if !markdown_source.is_char_boundary(self.stable_len) {
+            // Shorter than the previous source, so it cannot extend it.
+            self.clear();
+        }
+        let tail_start = self.stable_len;
+        let tail = &markdown_source[tail_start..];
+
+        self.lines.truncate(self.stable_lines);
+        let split = split_source(tail, true);
+        let mut after_text = self.stable_after_text;
+        for (i, SourceSegment { segment, end }) in split.segments.into_iter().enumerate() {
+            after_text = render_segment(&segment, after_text, &mut self.lines, file_opener, cwd);
+            if i < split.final_segments {
+                self.stable_len = tail_start + end;
+                self.stable_lines = self.lines.len();
+                self.stable_after_text = after_text;
             }
         }
+        self.in_open_fence = split.in_open_fence;
+        &self.lines
+    }
+
+    /// The lines of the last rendered source.
+    pub(crate) fn lines(&self) -> &[Line<'static>] {
+        &self.lines
+    }
+
+    /// Whether the last rendered source ends inside a fenced code block.
+    pub(crate) fn in_open_fence(&self) -> bool {
+        self.in_open_fence
+    }
+
+    pub(crate) fn clear(&mut self) {
+        self.stable_len = 0;
+        self.stable_lines = 0;
+        self.stable_after_text = false;
+        self.lines.clear();
+        self.in_open_fence = false;
     }
 }
 
@@ -116,6 +222,36 @@ enum Segment {
 }
 
 fn split_text_and_fences(src: &str) -> Vec<Segment> {
+    split_source(src, false)
+        .segments
+        .into_iter()
+        .map(|seg| seg.segment)
+        .collect()
+}
+
+/// A segment and the offset in the source just past it.
+struct SourceSegment {
+    segment: Segment,
+    end: usize,
+}
+
+struct SplitSource {
+    segments: Vec<SourceSegment>,
+    /// Number of leading segments that nothing appended to the source changes.
+    final_segments: usize,
+    /// Whether the source ends inside a fenced code block.
+    in_open_fence: bool,
+}
+
+/// Splits `src` like [`split_text_and_fences`]. `streaming` is how
+/// [`IncrementalMarkdown`] splits a message as it streams in, which also:
+/// - drops fenced code blocks that are empty once closed, as if their fence
+///   lines were not there;
+/// - ends a text segment at a blank line when the next line starts a new
+///   paragraph or heading (see [`starts_text_block`]). Everything before such
+///   a line renders the same without what follows, and [`render_segment`]
+///   puts the blank line between the two blocks back.
+fn split_source(src: &str, streaming: bool) -> SplitSource {
     let mut segments = Vec::new();
     let mut curr_text = String::new();
     #[derive(Copy, Clone, PartialEq)]
@@ -131,12 +267,55 @@ fn split_text_and_fences(src: &str) -> Vec<Segment> {
     // We intentionally do not require a preceding blank line for indented code blocks,
     // since streamed model output often omits it. This favors preserving indentation.
 
+    // Streaming only: whether the open fence ended a text segment, which is
+    // resumed if the block turns out to be empty.
+    let mut text_before_fence = false;
+    // Streaming only: what the current text segment holds, to find block
+    // boundaries. Text holding HTML, which can span blank lines, or a quote
+    // is not split.
+    let mut text_has_content = false;
+    let mut text_has_html = false;
+    let mut after_blank = false;
+    // Streaming only: whether the last code block was closed by a partial last
+    // line, which may still turn into content (e.g. "````").
+    let mut closed_by_partial_line = false;
+
+    let mut offset = 0;
     for line in src.split_inclusive('\n') {
+        let line_start = offset;
+        offset += line.len();
         let line_no_nl = line.strip_suffix('\n');
         let trimmed_start = match line_no_nl {
             Some(l) => l.trim_start(),
             None => line.trim_start(),
         };
+        if code_mode == CodeMode::Indented {
+            // Continue while the line is blank, or starts with >=4 spaces, or a tab.
+            let raw_line = match line_no_nl {
+                Some(l) => l,
+                None => line,
+            };
+            let is_blank = raw_line.trim().is_empty();
+            let leading_spaces = raw_line.chars().take_while(|c| *c == ' ').count();
+            let starts_with_tab = raw_line.starts_with('\t');
+            if is_blank || leading_spaces >= 4 || starts_with_tab {
+                code_content.push_str(line);
+                continue;
+            }
+            // Close the indented code block and handle this line like any other,
+            // so a fence right after the block still opens one.
+            segments.push(SourceSegment {
+                segment: Segment::Code {
+                    _lang: None,
+                    content: std::mem::take(&mut code_content),
+                },
+                end: line_start,
+            });
+            code_mode = CodeMode::None;
+            text_has_content = false;
+            text_has_html = false;
+            after_blank = false;
+        }
         if code_mode == CodeMode::None {
             let open = if trimmed_start.starts_with("```") {
                 Some("```")
@@ -147,10 +326,7 @@ fn split_text_and_fences(src: &str) -> Vec<Segment> {
             };
             if let Some(tok) = open {
                 // Flush pending text segment.
-                if !curr_text.is_empty() {
-                    segments.push(Segment::Text(curr_text.clone()));
-                    curr_text.clear();
-                }
+                text_before_fence = flush_text(&mut segments, &mut curr_text, line_start);
                 fence_token = tok;
                 // Capture language after the token on this line (before newline).
                 let after = &trimmed_start[tok.len()..];
@@ -179,10 +355,7 @@ fn split_text_and_fences(src: &str) -> Vec<Segment> {
             let starts_indented_code = (leading_spaces >= 4) || starts_with_tab;
             if starts_indented_code {
                 // Flush pending text and begin an indented code block.
-                if !curr_text.is_empty() {
-                    segments.push(Segment::Text(curr_text.clone()));
-                    curr_text.clear();
-                }
+                flush_text(&mut segments, &mut curr_text, line_start);
                 code_mode = CodeMode::Indented;
                 code_content.clear();
                 code_content.push_str(line);
@@ -190,68 +363,116 @@ fn split_text_and_fences(src: &str) -> Vec<Segment> {
                 continue;
             }
             // Normal text line.
+            if raw_line.trim().is_empty() {
+                after_blank = text_has_content;
+            } else {
+                if streaming
+                    && after_blank
+                    && !text_has_html
+                    && line_no_nl.is_some()
+                    && starts_text_block(raw_line)
+                {
+                    flush_text(&mut segments, &mut curr_text, line_start);
+                }
+                after_blank = false;
+                text_has_content = true;
+                text_has_html |= trimmed_start.starts_with(['<', '>']);
+            }
             curr_text.push_str(line);
         } else {
-            match code_mode {
-                CodeMode::Fenced => {
-                    // inside fenced code: check for closing fence on its own line
-                    let trimmed = match line_no_nl {
-                        Some(l) => l.trim(),
-                        None => line.trim(),
-                    };
-                    if trimmed == fence_token {
-                        // End code block: emit segment without fences
-                        segments.push(Segment::Code {
-                            _lang: code_lang.take(),
-                            content: code_content.clone(),
-                        });
-                        code_content.clear();
-                        code_mode = CodeMode::None;
-                        fence_token = "";
-                        continue;
-                    }
-                    // Accumulate code content exactly as-is.
-                    code_content.push_str(line);
-                }
-                CodeMode::Indented => {
-                    // Continue while the line is blank, or starts with >=4 spaces, or a tab.
-                    let raw_line = match line_no_nl {
-                        Some(l) => l,
-                        None => line,
-                    };
-                    let is_blank = raw_line.trim().is_empty();
-                    let leading_spaces = raw_line.chars().take_while(|c| *c == ' ').count();
-                    let starts_with_tab = raw_line.starts_with('\t');
-                    if is_blank || leading_spaces >= 4 || starts_with_tab {
-                        code_content.push_str(line);
-                    } else {
-                        // Close the indented code block and reprocess this line as normal text.
-                        segments.push(Segment::Code {
-                            _lang: None,
-                            content: code_content.clone(),
-                        });
-                        code_content.clear();
-                        code_mode = CodeMode::None;
-                        // Now handle current line as text.
-                        curr_text.push_str(line);
+            // inside fenced code: check for closing fence on its own line
+            let trimmed = match line_no_nl {
+                Some(l) => l.trim(),
+                None => line.trim(),
+            };
+            if trimmed == fence_token {
+                code_mode = CodeMode::None;
+                fence_token = "";
+                if streaming && code_content.trim().is_empty() {
+                    // Drop the empty block and carry on with the text before it.
+                    if text_before_fence
+                        && let Some(SourceSegment {
+                            segment: Segment::Text(text),
+                            ..
+                        }) = segments.pop()
+                    {
+                        curr_text = text;
                     }
+                    code_lang = None;
+                    code_content.clear();
+                    continue;
                 }
-                CodeMode::None => unreachable!(),
+                // End code block: emit segment without fences
+                closed_by_partial_line = streaming && line_no_nl.is_none();
+                segments.push(SourceSegment {
+                    segment: Segment::Code {
+                        _lang: code_lang.take(),
+                        content: std::mem::take(&mut code_content),
+                    },
+                    end: offset,
+                });
+                text_has_content = false;
+                text_has_html = false;
+                after_blank = false;
+                continue;
             }
+            // Accumulate code content exactly as-is.
+            code_content.push_str(line);
         }
     }
 
+    let in_open_fence = code_mode == CodeMode::Fenced;
+    // Text before a fence that is still empty is resumed if the fence closes
+    // without content, and an open segment can still grow. A partial last line
+    // may yet become the closing fence, so only complete lines count.
+    let mut final_segments = segments.len();
+    let complete_code = &code_content[..code_content.rfind('\n').map_or(0, |i| i + 1)];
+    if in_open_fence && streaming && text_before_fence && complete_code.trim().is_empty() {
+        final_segments -= 1;
+    }
+    if closed_by_partial_line {
+        final_segments -= 1;
+    }
     if code_mode != CodeMode::None {
         // Unterminated code fence: treat accumulated content as a code segment.
-        segments.push(Segment::Code {
-            _lang: code_lang.take(),
-            content: code_content.clone(),
+        segments.push(SourceSegment {
+            segment: Segment::Code {
+                _lang: code_lang.take(),
+                content: code_content,
+            },
+            end: offset,
         });
-    } else if !curr_text.is_empty() {
-        segments.push(Segment::Text(curr_text.clone()));
+    } else {
+        flush_text(&mut segments, &mut curr_text, offset);
     }
 
-    segments
+    SplitSource {
+        segments,
+        final_segments,
+        in_open_fence,
+    }
+}
+
+/// Ends the current text segment at `end`, and returns whether there was one.
+fn flush_text(segments: &mut Vec<SourceSegment>, text: &mut String, end: usize) -> bool {
+    if text.is_empty() {
+        return false;
+    }
+    segments.push(SourceSegment {
+        segment: Segment::Text(std::mem::take(text)),
+        end,
+    });
+    true
+}
+
+/// Whether `line`, following a blank line, starts a paragraph or heading that
+/// no block before it can continue into. Lines that are indented (and may
+/// continue a list item) or that may start a list, quote, table, HTML block,
+/// thematic break or link reference definition don't qualify.
+fn starts_text_block(line: &str) -> bool {
+    line.chars()
+        .next()
+        .is_some_and(|c| !(c.is_whitespace() || c.is_ascii_digit() || "-*+_=>|<[".contains(c)))
 }
 
 #[cfg(test)]
@@ -579,4 +800,68 @@ Loose item"#;
             "did not expect a split into ['1.', 'Tight item']; got: {lines:?}"
         );
     }
+
+    #[test]
+    fn incremental_render_matches_full_render_for_every_prefix() {
+        let cwd = Path::new("/");
+        for src in [
+            "Intro with 【F:src/lib.rs†L3】 citation.\n\n```rust\n    fn main() {}\n```\n- a\n- b\n\n    indented code\nafter\n~~~\nraw\n~~~\nDone.\n",
+            // Without code blocks, text is split at block boundaries instead.
+            "# Plan\n\nFirst paragraph,\nwrapped over two lines.\n\n## Step 1\n\n- a\n- b\n\nAfter the list.\n\nLast **bold** paragraph.\n",
+        ] {
+            let mut incremental = IncrementalMarkdown::default();
+            for (end, _) in src.char_indices().skip(1) {
+                let prefix = &src[..end];
+                let mut full = Vec::new();
+                append_markdown_with_opener_and_cwd(
+                    prefix,
+                    &mut full,
+                    UriBasedFileOpener::VsCode,
+                    cwd,
+                );
+                let lines =
+                    incremental.render_with_opener_and_cwd(prefix, UriBasedFileOpener::VsCode, cwd);
+                assert_eq!(lines, full.as_slice(), "prefix: {prefix:?}");
+            }
+            assert!(incremental.stable_len > 0, "nothing became final: {src:?}");
+        }
+    }
+
+    #[test]
+    fn streaming_split_keeps_the_open_paragraph_and_empty_fences_open() {
+        let split = split_source("One.\n\nTwo.\n\nThree.\n", true);
+        assert_eq!(split.segments.len(), 3);
+        assert_eq!(split.final_segments, 2);
+        assert_eq!(split.segments[1].end, "One.\n\nTwo.\n\n".len());
+
+        // Lists and lines that may continue them are not split off.
+        let split = split_source("- a\n\n- b\n\n  more b\n\n", true);
+        assert_eq!(split.segments.len(), 1);
+
+        // The text before a fence stays open until the fence has content.
+        let split = split_source("Para.\n```\n", true);
+        assert_eq!((split.segments.len(), split.final_segments), (2, 0));
+        assert!(split.in_open_fence);
+        let split = split_source("Para.\n```\ncode\n", true);
+        assert_eq!(split.final_segments, 1);
+
+        // A closing fence on the partial last line may still become content.
+        let split = split_source("Para.\n```\ncode\n```", true);
+        assert_eq!((split.segments.len(), split.final_segments), (2, 1));
+        let split = split_source("Para.\n```\ncode\n```\n", true);
+        assert_eq!(split.final_segments, 2);
+
+        // An empty block is dropped and the text around it joined.
+        let split = split_source("Para.\n```\n```\n## Title\n", true);
+        let [
+            SourceSegment {
+                segment: Segment::Text(text),
+                ..
+            },
+        ] = split.segments.as_slice()
+        else {
+            panic!("expected one text segment");
+        };
+        assert_eq!(text, "Para.\n## Title\n");
+    }
 }
@@ -4,14 +4,24 @@ use codex_core::config::Config;
 use ratatui::text::Line;
 
 use crate::markdown;
-use crate::render::markdown_utils::is_inside_unclosed_fence;
-use crate::render::markdown_utils::strip_empty_fenced_code_blocks;
 
 /// Newline-gated accumulator that renders markdown and commits only fully
 /// completed logical lines.
-pub(crate) struct MarkdownStreamCollector {
+pub struct MarkdownStreamCollector {
     buffer: String,
     committed_line_count: usize,
+    /// Keeps the rendered lines of the stable part of the buffer between
+    /// commits, so each commit only re-renders the trailing segment.
+    renderer: markdown::IncrementalMarkdown,
+    /// Whether the last render unwrapped an outer ```markdown fence, in which
+    /// case the source given to `renderer` does not start with the buffer.
+    unwrapped_fence: bool,
+}
+
+impl Default for MarkdownStreamCollector {
+    fn default() -> Self {
+        Self::new()
+    }
 }
 
 impl MarkdownStreamCollector {
@@ -19,6 +29,8 @@ impl MarkdownStreamCollector {
         Self {
             buffer: String::new(),
             committed_line_count: 0,
+            renderer: markdown::IncrementalMarkdown::default(),
+            unwrapped_fence: false,
         }
     }
 
@@ -31,6 +43,8 @@ impl MarkdownStreamCollector {
     pub fn clear(&mut self) {
         self.buffer.clear();
         self.committed_line_count = 0;
+        self.renderer.clear();
+        self.unwrapped_fence = false;
     }
 
     /// Replace the buffered content and mark that the first `committed_count`
@@ -39,23 +53,34 @@ impl MarkdownStreamCollector {
         self.buffer.clear();
         self.buffer.push_str(s);
         self.committed_line_count = committed_count;
+        self.renderer.clear();
+        self.unwrapped_fence = false;
     }
 
     pub fn push_delta(&mut self, delta: &str) {
         self.buffer.push_str(delta);
     }
 
-    /// Render the full buffer and return only the newly completed logical lines
-    /// since the last commit. When the buffer does not end with a newline, the
+    /// Renders the buffer into `renderer`. In non-test builds an outer
+    /// ```markdown fence is unwrapped, so fence markers never appear in
+    /// streamed history.
+    fn render(&mut self, config: &Config) {
+        let body = markdown_language_fence_body_if_enabled(&self.buffer);
+        if body.is_some() != self.unwrapped_fence {
+            self.renderer.clear();
+            self.unwrapped_fence = body.is_some();
+        }
+        self.renderer.render(body.unwrap_or(&self.buffer), config);
+    }
+
+    /// Render the buffer and return only the newly completed logical lines
+    /// since the last commit. Only the part of the buffer after its last
+    /// finished block is rendered again. When the buffer does not end with a newline, the
     /// final rendered line is considered incomplete and is not emitted.
     pub fn commit_complete_lines(&mut self, config: &Config) -> Vec<Line<'static>> {
-        // In non-test builds, unwrap an outer ```markdown fence during commit as well,
-        // so fence markers never appear in streamed history.
-        let source = unwrap_markdown_language_fence_if_enabled(self.buffer.clone());
-        let source = strip_empty_fenced_code_blocks(&source);
-
-        let mut rendered: Vec<Line<'static>> = Vec::new();
-        markdown::append_markdown(&source, &mut rendered, config);
+        self.render(config);
+        let rendered = self.renderer.lines();
+        let in_open_fence = self.renderer.in_open_fence();
 
         let mut complete_line_count = rendered.len();
         if complete_line_count > 0
@@ -84,14 +109,14 @@ impl MarkdownStreamCollector {
             complete_line_count = complete_line_count.saturating_sub(1);
             // If we're inside an unclosed fenced code block, also drop the
             // last rendered line to avoid committing a partial code line.
-            if is_inside_unclosed_fence(&source) {
+            if in_open_fence {
                 complete_line_count = complete_line_count.saturating_sub(1);
             }
             // If the next (incomplete) line appears to begin a list item,
             // also defer the previous completed line because the renderer may
             // retroactively treat it as part of the list (e.g., ordered list item 1).
-            if let Some(last_nl) = source.rfind('\n') {
-                let tail = &source[last_nl + 1..];
+            if let Some(last_nl) = self.buffer.rfind('\n') {
+                let tail = &self.buffer[last_nl + 1..];
                 if starts_with_list_marker(tail) {
                     complete_line_count = complete_line_count.saturating_sub(1);
                 }
@@ -129,7 +154,7 @@ impl MarkdownStreamCollector {
         // Strong correctness: while a fenced code block is open (no closing fence yet),
         // do not emit any new lines from inside it. Wait until the fence closes to emit
         // the entire block together. This avoids stray backticks and misformatted content.
-        if is_inside_unclosed_fence(&source) {
+        if in_open_fence {
             return Vec::new();
         }
 
@@ -157,15 +182,11 @@ impl MarkdownStreamCollector {
     /// for rendering. Optionally unwraps ```markdown language fences in
     /// non-test builds.
     pub fn finalize_and_drain(&mut self, config: &Config) -> Vec<Line<'static>> {
-        let mut source: String = self.buffer.clone();
-        if !source.ends_with('\n') {
-            source.push('\n');
+        if !self.buffer.ends_with('\n') {
+            self.buffer.push('\n');
         }
-        let source = unwrap_markdown_language_fence_if_enabled(source);
-        let source = strip_empty_fenced_code_blocks(&source);
-
-        let mut rendered: Vec<Line<'static>> = Vec::new();
-        markdown::append_markdown(&source, &mut rendered, config);
+        self.render(config);
+        let rendered = self.renderer.lines();
 
         let out = if self.committed_line_count >= rendered.len() {
             Vec::new()
@@ -248,51 +269,33 @@ fn is_short_plain_word(s: &str) -> bool {
     t.chars().all(|c| c.is_alphanumeric())
 }
 
-/// fence helpers are provided by `crate::render::markdown_utils`
 #[cfg(test)]
-fn unwrap_markdown_language_fence_if_enabled(s: String) -> String {
+fn markdown_language_fence_body_if_enabled(_s: &str) -> Option<&str> {
     // In tests, keep content exactly as provided to simplify assertions.
-    s
+    None
 }
 
 #[cfg(not(test))]
-fn unwrap_markdown_language_fence_if_enabled(s: String) -> String {
+fn markdown_language_fence_body_if_enabled(s: &str) -> Option<&str> {
     // Best-effort unwrap of a single outer fenced markdown block.
     // Recognizes common forms like ```markdown, ```md (any case), optional
     // surrounding whitespace, and flexible trailing newlines/CRLF.
-    // If the block is not recognized, return the input unchanged.
-    let lines = s.lines().collect::<Vec<_>>();
-    if lines.len() < 2 {
-        return s;
-    }
-
-    // Identify opening fence and language.
-    let open = lines.first().map(|l| l.trim_start()).unwrap_or("");
-    if !open.starts_with("```") {
-        return s;
-    }
-    let lang = open.trim_start_matches("```").trim();
+    // Only the first and the last non-empty line are looked at, so this does
+    // not scan the whole message on every commit.
+    let (open, rest) = s.split_once('\n')?;
+    let lang = open.trim_start().strip_prefix("```")?.trim();
     let is_markdown_lang = lang.eq_ignore_ascii_case("markdown") || lang.eq_ignore_ascii_case("md");
     if !is_markdown_lang {
-        return s;
+        return None;
     }
 
-    // Find the last non-empty line and ensure it is a closing fence.
-    let mut last_idx = lines.len() - 1;
-    while last_idx > 0 && lines[last_idx].trim().is_empty() {
-        last_idx -= 1;
+    // The last non-empty line must be a closing fence.
+    let trimmed = rest.trim_end();
+    let close_start = trimmed.rfind('\n').map_or(0, |i| i + 1);
+    if trimmed[close_start..].trim() != "```" {
+        return None;
     }
-    if lines[last_idx].trim() != "```" {
-        return s;
-    }
-
-    // Reconstruct the inner content between the fences.
-    let mut out = String::new();
-    for l in lines.iter().take(last_idx).skip(1) {
-        out.push_str(l);
-        out.push('\n');
-    }
-    out
+    Some(&rest[..close_start])
 }
 
 pub(crate) struct StepResult {
@@ -1,3 +1,4 @@
+use std::collections::HashMap;
 use std::io::Result;
 use std::time::Duration;
 
@@ -71,12 +72,22 @@ fn render_key_hints(area: Rect, buf: &mut Buffer, pairs: &[(&str, &str)]) {
     Paragraph::new(vec![Line::from(spans).dim()]).render_ref(area, buf);
 }
 
+/// Source lines on either side of the viewport that are kept wrapped, so that
+/// scrolling by a few rows or a page does not wrap anything.
+const PREFETCH_LINES: usize = 64;
+
 /// Generic widget for rendering a pager view.
+///
+/// Only the lines around the viewport are wrapped; for the rest the view keeps
+/// just the number of rows each one wraps to, so opening or resizing a long
+/// transcript does not lay out all of it.
 struct PagerView {
     lines: Vec<Line<'static>>,
     scroll_offset: usize,
     title: String,
-    wrap_cache: Option<WrapCache>,
+    layout: Option<PagerLayout>,
+    /// Source line to bring to the top of the viewport on the next render.
+    pending_scroll_to_line: Option<usize>,
 }
 
 impl PagerView {
@@ -85,30 +96,13 @@ impl PagerView {
             lines,
             scroll_offset,
             title,
-            wrap_cache: None,
+            layout: None,
+            pending_scroll_to_line: None,
         }
     }
 
     fn render(&mut self, area: Rect, buf: &mut Buffer) {
-        self.render_header(area, buf);
-        let content_area = self.scroll_area(area);
-        self.ensure_wrapped(content_area.width);
-        // Compute page bounds without holding an immutable borrow on cache while mutating self
-        let wrapped_len = self
-            .wrap_cache
-            .as_ref()
-            .map(|c| c.wrapped.len())
-            .unwrap_or(0);
-        self.scroll_offset = self
-            .scroll_offset
-            .min(wrapped_len.saturating_sub(content_area.height as usize));
-        let start = self.scroll_offset;
-        let end = (start + content_area.height as usize).min(wrapped_len);
-
-        let (wrapped, _src_idx) = self.cached();
-        let page = &wrapped[start..end];
-        self.render_content_page_prepared(content_area, buf, page);
-        self.render_bottom_bar(area, content_area, buf, wrapped);
+        self.render_with_highlight(area, buf, None);
     }
 
     fn render_with_highlight(
@@ -119,23 +113,10 @@ impl PagerView {
     ) {
         self.render_header(area, buf);
         let content_area = self.scroll_area(area);
-        self.ensure_wrapped(content_area.width);
-        // Compute page bounds first to avoid borrow conflicts
-        let wrapped_len = self
-            .wrap_cache
-            .as_ref()
-            .map(|c| c.wrapped.len())
-            .unwrap_or(0);
-        self.scroll_offset = self
-            .scroll_offset
-            .min(wrapped_len.saturating_sub(content_area.height as usize));
-        let start = self.scroll_offset;
-        let end = (start + content_area.height as usize).min(wrapped_len);
-
-        let (wrapped, src_idx) = self.cached();
-        let page = self.page_with_optional_highlight(wrapped, src_idx, start, end, highlight);
-        self.render_content_page_prepared(content_area, buf, &page);
-        self.render_bottom_bar(area, content_area, buf, wrapped);
+        let rows = self.visible_rows(content_area.width, content_area.height as usize);
+        let page = highlight_rows(rows, highlight);
+        self.render_content_page_prepared(content_area, buf, page);
+        self.render_bottom_bar(area, content_area, buf);
     }
 
     fn render_header(&self, area: Rect, buf: &mut Buffer) {
@@ -146,12 +127,10 @@ impl PagerView {
         Span::from(header).dim().render_ref(area, buf);
     }
 
-    // Removed unused render_content_page (replaced by render_content_page_prepared)
-
-    fn render_content_page_prepared(&self, area: Rect, buf: &mut Buffer, page: &[Line<'static>]) {
-        Paragraph::new(page.to_vec()).render_ref(area, buf);
-
+    fn render_content_page_prepared(&self, area: Rect, buf: &mut Buffer, page: Vec<Line<'static>>) {
         let visible = page.len();
+        Paragraph::new(page).render_ref(area, buf);
+
         if visible < area.height as usize {
             for i in 0..(area.height as usize - visible) {
                 let add = ((visible + i).min(u16::MAX as usize)) as u16;
@@ -163,23 +142,21 @@ impl PagerView {
         }
     }
 
-    fn render_bottom_bar(
-        &self,
-        full_area: Rect,
-        content_area: Rect,
-        buf: &mut Buffer,
-        wrapped: &[Line<'static>],
-    ) {
+    fn render_bottom_bar(&self, full_area: Rect, content_area: Rect, buf: &mut Buffer) {
         let sep_y = content_area.bottom();
         let sep_rect = Rect::new(full_area.x, sep_y, full_area.width, 1);
 
         Span::from("─".repeat(sep_rect.width as usize))
             .dim()
             .render_ref(sep_rect, buf);
-        let percent = if wrapped.is_empty() {
+        let total_rows = self
+            .layout
+            .as_ref()
+            .map_or(0, |layout| layout.heights.total_rows());
+        let percent = if total_rows == 0 {
             100
         } else {
-            let max_scroll = wrapped.len().saturating_sub(content_area.height as usize);
+            let max_scroll = total_rows.saturating_sub(content_area.height as usize);
             if max_scroll == 0 {
                 100
             } else {
@@ -258,70 +235,126 @@ impl PagerView {
     }
 }
 
-#[derive(Debug, Clone)]
-struct WrapCache {
-    width: u16,
-    wrapped: Vec<Line<'static>>,
-    src_idx: Vec<usize>,
-    base_len: usize,
-}
-
 impl PagerView {
-    fn ensure_wrapped(&mut self, width: u16) {
+    /// Clamps the scroll offset for a viewport of `height` rows at `width`
+    /// and returns the rows it shows, each with the index of its source line.
+    fn visible_rows(&mut self, width: u16, height: usize) -> Vec<(usize, Line<'static>)> {
         let width = width.max(1);
-        let needs = match self.wrap_cache {
-            Some(ref c) => c.width != width || c.base_len != self.lines.len(),
-            None => true,
+        let mut layout = match self.layout.take() {
+            Some(layout) if layout.width == width && layout.heights.len() <= self.lines.len() => {
+                layout
+            }
+            _ => PagerLayout::new(width),
         };
-        if !needs {
-            return;
-        }
-        let mut wrapped: Vec<Line<'static>> = Vec::new();
-        let mut src_idx: Vec<usize> = Vec::new();
-        for (i, line) in self.lines.iter().enumerate() {
-            let ws = insert_history::word_wrap_lines(std::slice::from_ref(line), width);
-            src_idx.extend(std::iter::repeat_n(i, ws.len()));
-            wrapped.extend(ws);
+        layout.measure_appended(&self.lines);
+
+        if let Some(line) = self.pending_scroll_to_line.take() {
+            self.scroll_offset = layout.heights.rows_before(line);
         }
-        self.wrap_cache = Some(WrapCache {
+        self.scroll_offset = self
+            .scroll_offset
+            .min(layout.heights.total_rows().saturating_sub(height));
+        let rows = layout.rows(&self.lines, self.scroll_offset, height);
+        self.layout = Some(layout);
+        rows
+    }
+}
+
+/// Layout of a pager's lines at one width.
+struct PagerLayout {
+    width: u16,
+    heights: RowIndex,
+    /// Wrapped rows of the source lines around the viewport.
+    wrapped: HashMap<usize, Vec<Line<'static>>>,
+}
+
+impl PagerLayout {
+    fn new(width: u16) -> Self {
+        Self {
             width,
-            wrapped,
-            src_idx,
-            base_len: self.lines.len(),
-        });
+            heights: RowIndex::default(),
+            wrapped: HashMap::new(),
+        }
     }
 
-    fn cached(&self) -> (&[Line<'static>], &[usize]) {
-        if let Some(cache) = self.wrap_cache.as_ref() {
-            (&cache.wrapped, &cache.src_idx)
-        } else {
-            (&[], &[])
+    /// Measures the lines appended since the last call.
+    fn measure_appended(&mut self, lines: &[Line<'static>]) {
+        for line in &lines[self.heights.len()..] {
+            self.heights.push(wrapped_height(line, self.width));
         }
     }
 
-    fn page_with_optional_highlight<'a>(
-        &self,
-        wrapped: &'a [Line<'static>],
-        src_idx: &[usize],
-        start: usize,
-        end: usize,
-        highlight: Option<(usize, usize)>,
-    ) -> std::borrow::Cow<'a, [Line<'static>]> {
-        use ratatui::style::Modifier;
-        let (hi_start, hi_end) = match highlight {
-            Some(r) => r,
-            None => return std::borrow::Cow::Borrowed(&wrapped[start..end]),
+    /// Returns up to `height` rows starting at row `first_row`, wrapping the
+    /// source lines they come from, and those within [`PREFETCH_LINES`] of
+    /// them, as needed.
+    fn rows(
+        &mut self,
+        lines: &[Line<'static>],
+        first_row: usize,
+        height: usize,
+    ) -> Vec<(usize, Line<'static>)> {
+        let Some((first_line, mut skip)) = self.heights.line_at_row(first_row) else {
+            return Vec::new();
         };
-        let mut out: Vec<Line<'static>> = Vec::with_capacity(end - start);
-        let mut bold_done = false;
-        for (row, src_line) in wrapped
-            .iter()
-            .enumerate()
-            .skip(start)
-            .take(end.saturating_sub(start))
-        {
-            let mut line = src_line.clone();
-            if let Some(src) = src_idx.get(row).copied()
+        let mut out = Vec::with_capacity(height);
+        let mut idx = first_line;
+        while out.len() < height && idx < lines.len() {
+            let take = height - out.len();
+            out.extend(
+                self.wrap(lines, idx)
+                    .iter()
+                    .skip(skip)
+                    .take(take)
+                    .map(|row| (idx, row.clone())),
+            );
+            skip = 0;
+            idx += 1;
+        }
+
+        let keep =
+            first_line.saturating_sub(PREFETCH_LINES)..(idx + PREFETCH_LINES).min(lines.len());
+        for i in keep.clone() {
+            self.wrap(lines, i);
+        }
+        self.wrapped.retain(|i, _| keep.contains(i));
+        out
+    }
+
+    fn wrap(&mut self, lines: &[Line<'static>], idx: usize) -> &[Line<'static>] {
+        let width = self.width;
+        let heights = &mut self.heights;
+        self.wrapped.entry(idx).or_insert_with(|| {
+            let rows = insert_history::word_wrap_lines(std::slice::from_ref(&lines[idx]), width);
+            // Keep the row index exact should the measurement disagree.
+            heights.set_height(idx, rows.len());
+            rows
+        })
+    }
+}
+
+/// Number of rows `line` takes once wrapped to `width`. Lines that fit, the
+/// common case, are measured without wrapping them.
+fn wrapped_height(line: &Line<'_>, width: u16) -> usize {
+    let fits = line.width() <= width as usize
+        && !line.spans.iter().any(|span| span.content.contains('\n'));
+    if fits {
+        1
+    } else {
+        insert_history::word_wrap_lines(std::slice::from_ref(line), width).len()
+    }
+}
+
+/// Reverses the rows of source lines in `highlight`, bolding the first span
+/// of the first such row.
+fn highlight_rows(
+    rows: Vec<(usize, Line<'static>)>,
+    highlight: Option<(usize, usize)>,
+) -> Vec<Line<'static>> {
+    use ratatui::style::Modifier;
+    let mut bold_done = false;
+    rows.into_iter()
+        .map(|(src, mut line)| {
+            if let Some((hi_start, hi_end)) = highlight
                 && src >= hi_start
                 && src < hi_end
             {
@@ -333,9 +366,88 @@ impl PagerView {
                     }
                 }
             }
-            out.push(line);
+            line
+        })
+        .collect()
+}
+
+/// Wrapped heights of a pager's source lines with their prefix sums, kept in
+/// a Fenwick tree: the first row of a line, the line at a row and updating a
+/// height are all O(log n), so jumping around a long transcript needs no
+/// layout of the lines in between.
+#[derive(Debug, Default)]
+struct RowIndex {
+    heights: Vec<usize>,
+    /// `tree[i - 1]` holds the sum of the heights of lines
+    /// `i - lowbit(i)..i`.
+    tree: Vec<usize>,
+    total: usize,
+}
+
+impl RowIndex {
+    fn len(&self) -> usize {
+        self.heights.len()
+    }
+
+    fn total_rows(&self) -> usize {
+        self.total
+    }
+
+    fn push(&mut self, height: usize) {
+        let i = self.tree.len() + 1;
+        let lowbit = i & i.wrapping_neg();
+        let mut sum = height;
+        let mut step = 1;
+        while step < lowbit {
+            sum += self.tree[i - step - 1];
+            step <<= 1;
+        }
+        self.tree.push(sum);
+        self.heights.push(height);
+        self.total += height;
+    }
+
+    fn set_height(&mut self, line: usize, height: usize) {
+        let old = std::mem::replace(&mut self.heights[line], height);
+        if old == height {
+            return;
+        }
+        let mut i = line + 1;
+        while i <= self.tree.len() {
+            self.tree[i - 1] = self.tree[i - 1] + height - old;
+            i += i & i.wrapping_neg();
+        }
+        self.total = self.total + height - old;
+    }
+
+    /// Rows taken by the lines before `line`.
+    fn rows_before(&self, line: usize) -> usize {
+        let mut i = line.min(self.tree.len());
+        let mut sum = 0;
+        while i > 0 {
+            sum += self.tree[i - 1];
+            i &= i - 1;
+        }
+        sum
+    }
+
+    /// The line that `row` falls on, and the row within that line.
+    fn line_at_row(&self, row: usize) -> Option<(usize, usize)> {
+        if row >= self.total {
+            return None;
+        }
+        let mut line = 0;
+        let mut rest = row;
+        let mut mask = self.tree.len().checked_next_power_of_two()?;
+        while mask > 0 {
+            let next = line + mask;
+            if next <= self.tree.len() && self.tree[next - 1] <= rest {
+                line = next;
+                rest -= self.tree[next - 1];
+            }
+            mask >>= 1;
         }
-        std::borrow::Cow::Owned(out)
+        Some((line, rest))
     }
 }
 
@@ -360,7 +472,6 @@ impl TranscriptOverlay {
 
     pub(crate) fn insert_lines(&mut self, lines: Vec<Line<'static>>) {
         self.view.lines.extend(lines);
-        self.view.wrap_cache = None;
     }
 
     pub(crate) fn set_highlight_range(&mut self, range: Option<(usize, usize)>) {
@@ -428,8 +539,9 @@ impl TranscriptOverlay {
     pub(crate) fn is_done(&self) -> bool {
         self.is_done
     }
-    pub(crate) fn set_scroll_offset(&mut self, offset: usize) {
-        self.view.scroll_offset = offset;
+    /// Scrolls so that source line `line` is at the top of the viewport.
+    pub(crate) fn scroll_to_line(&mut self, line: usize) {
+        self.view.pending_scroll_to_line = Some(line);
     }
 }
 
@@ -554,50 +666,113 @@ mod tests {
         assert_snapshot!(term.backend());
     }
 
+    fn sample_lines() -> Vec<Line<'static>> {
+        let long = "A long line that wraps across several rows of the pager at this width.";
+        (0..40)
+            .map(|i| match i % 3 {
+                0 => Line::from(format!("{i} {long}")),
+                1 => Line::from(format!("short {i}")),
+                _ => Line::from(""),
+            })
+            .collect()
+    }
+
+    #[test]
+    fn pager_pages_match_wrapping_everything() {
+        let lines = sample_lines();
+        for width in [20u16, 36] {
+            let wrapped = insert_history::word_wrap_lines(&lines, width);
+            let mut src_idx = Vec::new();
+            for (i, line) in lines.iter().enumerate() {
+                let rows = insert_history::word_wrap_lines(std::slice::from_ref(line), width);
+                src_idx.extend(std::iter::repeat_n(i, rows.len()));
+            }
+
+            let mut pv = PagerView::new(lines.clone(), "T".to_string(), 0);
+            for offset in 0..wrapped.len() {
+                pv.scroll_offset = offset;
+                let rows = pv.visible_rows(width, 5);
+                let expected_start = offset.min(wrapped.len() - 5);
+                assert_eq!(pv.scroll_offset, expected_start);
+                let (idx, page): (Vec<usize>, Vec<Line<'static>>) = rows.into_iter().unzip();
+                assert_eq!(page, wrapped[expected_start..expected_start + 5]);
+                assert_eq!(idx, src_idx[expected_start..expected_start + 5]);
+            }
+        }
+    }
+
     #[test]
-    fn pager_wrap_cache_reuses_for_same_width_and_rebuilds_on_change() {
-        let long = "This is a long line that should wrap multiple times to ensure non-empty wrapped output.";
-        let mut pv = PagerView::new(vec![Line::from(long), Line::from(long)], "T".to_string(), 0);
-
-        // Build cache at width 24
-        pv.ensure_wrapped(24);
-        let (w1, _) = pv.cached();
-        assert!(!w1.is_empty(), "expected wrapped output to be non-empty");
-        let ptr1 = w1.as_ptr();
-
-        // Re-run with same width: cache should be reused (pointer stability heuristic)
-        pv.ensure_wrapped(24);
-        let (w2, _) = pv.cached();
-        let ptr2 = w2.as_ptr();
-        assert_eq!(ptr1, ptr2, "cache should not rebuild for unchanged width");
-
-        // Change width: cache should rebuild and likely produce different length
-        // Drop immutable borrow before mutating
-        let prev_len = w2.len();
-        pv.ensure_wrapped(36);
-        let (w3, _) = pv.cached();
-        assert_ne!(
-            prev_len,
-            w3.len(),
-            "wrapped length should change on width change"
+    fn pager_wraps_only_lines_near_the_viewport() {
+        let lines: Vec<Line<'static>> = (0..2_000).flat_map(|_| sample_lines()).collect();
+        let mut pv = PagerView::new(lines, "T".to_string(), usize::MAX);
+        let rows = pv.visible_rows(20, 10);
+        assert_eq!(rows.len(), 10);
+        let layout = pv.layout.as_ref().expect("layout");
+        assert!(layout.wrapped.len() <= 10 + 2 * PREFETCH_LINES);
+        assert_eq!(
+            pv.scroll_offset + 10,
+            layout.heights.total_rows(),
+            "End should show the last rows"
         );
     }
 
     #[test]
-    fn pager_wrap_cache_invalidates_on_append() {
-        let long = "Another long line for wrapping behavior verification.";
-        let mut pv = PagerView::new(vec![Line::from(long)], "T".to_string(), 0);
-        pv.ensure_wrapped(28);
-        let (w1, _) = pv.cached();
-        let len1 = w1.len();
-
-        // Append new lines should cause ensure_wrapped to rebuild due to len change
-        pv.lines.extend([Line::from(long), Line::from(long)]);
-        pv.ensure_wrapped(28);
-        let (w2, _) = pv.cached();
-        assert!(
-            w2.len() >= len1,
-            "wrapped length should grow or stay same after append"
+    fn pager_measures_appended_lines_and_remeasures_on_width_change() {
+        let lines = sample_lines();
+        let mut pv = PagerView::new(lines[..10].to_vec(), "T".to_string(), 0);
+        pv.visible_rows(20, 5);
+        pv.lines.extend_from_slice(&lines[10..]);
+        pv.visible_rows(20, 5);
+        let total = |pv: &PagerView| pv.layout.as_ref().expect("layout").heights.total_rows();
+        assert_eq!(
+            total(&pv),
+            insert_history::word_wrap_lines(&lines, 20).len()
+        );
+
+        pv.visible_rows(36, 5);
+        assert_eq!(
+            total(&pv),
+            insert_history::word_wrap_lines(&lines, 36).len()
         );
     }
+
+    #[test]
+    fn transcript_scroll_to_line_puts_it_at_the_top() {
+        let lines = sample_lines();
+        let mut overlay = TranscriptOverlay::new(lines.clone());
+        overlay.scroll_to_line(9);
+        let rows = overlay.view.visible_rows(20, 5);
+        assert_eq!(rows[0].0, 9);
+        assert_eq!(
+            overlay.view.scroll_offset,
+            insert_history::word_wrap_lines(&lines[..9], 20).len()
+        );
+    }
+
+    #[test]
+    fn row_index_matches_naive_prefix_sums() {
+        let mut index = RowIndex::default();
+        let mut heights: Vec<usize> = Vec::new();
+        for i in 0..100 {
+            let h = 1 + (i * 7) % 5;
+            index.push(h);
+            heights.push(h);
+        }
+        for (line, h) in [(0, 3), (17, 1), (63, 9), (99, 2)] {
+            index.set_height(line, h);
+            heights[line] = h;
+        }
+
+        let mut row = 0;
+        for (line, h) in heights.iter().enumerate() {
+            assert_eq!(index.rows_before(line), row);
+            for within in 0..*h {
+                assert_eq!(index.line_at_row(row + within), Some((line, within)));
+            }
+            row += h;
+        }
+        assert_eq!(index.total_rows(), row);
+        assert_eq!(index.rows_before(heights.len()), row);
+        assert_eq!(index.line_at_row(row), None);
+    }
 }
@@ -1,2 +1 @@
 pub mod line_utils;
-pub mod markdown_utils;
@@ -200,6 +200,19 @@ fn take_resume_action(pending: &AtomicU8) -> ResumeAction {
     }
 }
 
+/// Frame requests are coalesced so that bursts of them (streamed tokens, floods
+/// of command output) redraw at most once per interval, about 60 FPS.
+const MIN_FRAME_INTERVAL: Duration = Duration::from_millis(16);
+
+/// Returns when a frame requested for `requested` may be drawn, given when the
+/// previous frame was drawn.
+fn frame_budget_deadline(requested: Instant, last_draw: Option<Instant>) -> Instant {
+    match last_draw {
+        Some(last) => requested.max(last + MIN_FRAME_INTERVAL),
+        None => requested,
+    }
+}
+
 #[derive(Clone, Debug)]
 pub struct FrameRequester {
     frame_schedule_tx: tokio::sync::mpsc::UnboundedSender<Instant>,
@@ -238,6 +251,7 @@ impl Tui {
 
             let mut rx = frame_schedule_rx;
             let mut next_deadline: Option<Instant> = None;
+            let mut last_draw: Option<Instant> = None;
 
             loop {
                 let target = next_deadline
@@ -249,11 +263,13 @@ impl Tui {
                     recv = rx.recv() => {
                         match recv {
                             Some(at) => {
+                                let at = frame_budget_deadline(at, last_draw);
                                 if next_deadline.is_none_or(|cur| at < cur) {
                                     next_deadline = Some(at);
                                 }
                                 if at <= Instant::now() {
                                     next_deadline = None;
+                                    last_draw = Some(Instant::now());
                                     let _ = draw_tx_clone.send(());
                                 }
                             }
@@ -263,6 +279,7 @@ impl Tui {
                     _ = &mut sleep_fut => {
                         if next_deadline.is_some() {
                             next_deadline = None;
+                            last_draw = Some(Instant::now());
                             let _ = draw_tx_clone.send(());
                         }
                     }
@@ -565,3 +582,24 @@ impl Tui {
         })?
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn frame_requests_are_held_to_the_frame_budget() {
+        let now = Instant::now();
+        assert_eq!(frame_budget_deadline(now, None), now);
+
+        // A request right after a draw waits for the rest of the interval.
+        assert_eq!(
+            frame_budget_deadline(now, Some(now)),
+            now + MIN_FRAME_INTERVAL
+        );
+
+        // Requests that are already far enough out are left alone.
+        let later = now + Duration::from_millis(100);
+        assert_eq!(frame_budget_deadline(later, Some(now)), later);
+    }
+}